@@ -0,0 +1,128 @@
+#include "motif_finder.h"
+#include "pwm_scorer.h"
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+
+using namespace dna_motif;
+
+// Times every scan kernel on random sequences and checks that all of them
+// agree with the scalar path. The PWM row scores the motifs as log-odds
+// matrices at a threshold only exact matches reach, so its hit counts must
+// equal the match counts.
+//
+// Usage: kernel_benchmark [num_sequences] [num_motifs] [seed]
+//                         [sequence_length] [motif_length]
+
+namespace {
+
+std::vector<ChIPSequence> makeSequences(size_t count, size_t length,
+                                        std::mt19937 &rng) {
+  std::uniform_int_distribution<int> base(0, 3);
+  std::vector<ChIPSequence> sequences;
+  sequences.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::string seq(length, 'A');
+    for (char &c : seq) {
+      c = "ACGT"[base(rng)];
+    }
+    sequences.emplace_back(std::format("seq{}", i), seq);
+  }
+  return sequences;
+}
+
+std::vector<Motif> makeMotifs(size_t count, size_t length,
+                              std::mt19937 &rng) {
+  // Mostly specific codes, as in typical FoxA2-style motif files
+  std::discrete_distribution<int> pick{8, 8, 8, 8, 3, 3, 3, 3,
+                                       3, 3, 1, 1, 1, 1, 1};
+  std::vector<Motif> motifs;
+  motifs.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    std::string pattern(length, 'N');
+    for (char &c : pattern) {
+      c = "ACGTRYSWKMBDHVN"[pick(rng)];
+    }
+    motifs.emplace_back(pattern, 0.0, 0.0, 0.0);
+  }
+  return motifs;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t num_sequences =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t num_motifs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+  const auto seed =
+      argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10))
+               : 42u;
+  const size_t sequence_length =
+      argc > 4 ? std::strtoull(argv[4], nullptr, 10) : CHIP_SEQ_LENGTH;
+  const size_t motif_length =
+      argc > 5 ? std::strtoull(argv[5], nullptr, 10) : MOTIF_LENGTH;
+
+  std::mt19937 rng(seed);
+  const auto sequences = makeSequences(num_sequences, sequence_length, rng);
+  const auto motifs = makeMotifs(num_motifs, motif_length, rng);
+
+  MotifFinder finder(IUPACCodes::getInstance());
+  std::vector<MotifResult> reference;
+
+  std::cout << std::format(
+      "{} sequences of {} bp, {} motifs of {} bp, {} OpenMP threads\n",
+      num_sequences, sequence_length, num_motifs, motif_length,
+      omp_get_max_threads());
+  std::cout << std::format("{:<14}{:>12}{:>12}{:>10}\n", "kernel", "prepare_s",
+                           "scan_s", "agrees");
+
+  for (ScanKernel kernel :
+       {ScanKernel::Scalar, ScanKernel::WindowCodes, ScanKernel::Prefilter,
+        ScanKernel::Swar, ScanKernel::MotifMajor, ScanKernel::Auto}) {
+    finder.setKernel(kernel);
+
+    Timer prepare_timer;
+    SequenceStore store(sequences);
+    finder.prepareStore(store);
+    const double prepare_time = prepare_timer.elapsed();
+
+    Timer scan_timer;
+    auto results = finder.findMotifs(store, motifs);
+    const double scan_time = scan_timer.elapsed();
+
+    if (reference.empty()) {
+      reference = results;
+    }
+
+    std::cout << std::format("{:<14}{:>12.4f}{:>12.4f}{:>10}\n",
+                             scanKernelName(kernel), prepare_time, scan_time,
+                             results == reference ? "yes" : "NO");
+  }
+
+  std::vector<PositionWeightMatrix> matrices;
+  for (const auto &motif : motifs) {
+    matrices.push_back(*PositionWeightMatrix::fromPattern(
+        motif.pattern, IUPACCodes::getInstance()));
+  }
+
+  Timer prepare_timer;
+  const PwmScorer scorer(matrices, 0.99);
+  const SequenceStore store(sequences);
+  const double prepare_time = prepare_timer.elapsed();
+
+  Timer scan_timer;
+  const PwmScores scores = scorer.scoreBest(store);
+  const double scan_time = scan_timer.elapsed();
+
+  bool agrees = true;
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    agrees &= scores.hit_counts[m] == reference[m].match_count;
+  }
+  std::cout << std::format("{:<14}{:>12.4f}{:>12.4f}{:>10}\n", "pwm",
+                           prepare_time, scan_time, agrees ? "yes" : "NO");
+
+  return 0;
+}
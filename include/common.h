@@ -10,6 +10,7 @@
 #include <concepts>
 #include <condition_variable>
 #include <coroutine>
+#include <cstdint>
 #include <execution>
 #include <expected>
 #include <format>
@@ -52,11 +53,67 @@ concept MotifConcept = requires(T t) {
   { t.score3 } -> std::convertible_to<double>;
 };
 
+// Reference lengths of the original assay; other lengths are supported
 inline constexpr size_t CHIP_SEQ_LENGTH = 40;
 inline constexpr size_t MOTIF_LENGTH = 8;
+inline constexpr size_t MAX_MOTIF_LENGTH = 64;
 inline constexpr size_t IUPAC_CODE_SIZE = 15;
 inline constexpr std::string_view VALID_DNA_NUCLEOTIDES = "ATGC";
 inline constexpr std::string_view IUPAC_CODES = "ATGCWSRYMKBDHVN";
+inline constexpr size_t NUCLEOTIDE_CODE_BITS = 2;
+inline constexpr size_t WINDOW_CODE_LENGTH = MOTIF_LENGTH;
+inline constexpr size_t WINDOW_CODE_SPACE = 1uz
+                                            << (NUCLEOTIDE_CODE_BITS *
+                                                WINDOW_CODE_LENGTH);
+
+/**
+ * @brief Encode a nucleotide as a 2-bit code
+ *
+ * Uses ((c >> 1) & 3), which maps A=0, C=1, T=2, G=3 for both cases
+ * and keeps the complement of a code at (code ^ 2).
+ * The result is meaningless for characters other than A/C/G/T.
+ */
+[[nodiscard]] constexpr uint8_t encodeNucleotide(char nucleotide) noexcept {
+  return static_cast<uint8_t>((static_cast<unsigned char>(nucleotide) >> 1) &
+                              3u);
+}
+
+/**
+ * @brief Check whether a character is one of A/C/G/T (any case)
+ */
+[[nodiscard]] constexpr bool isNucleotide(char nucleotide) noexcept {
+  const char lower = static_cast<char>(nucleotide | 0x20);
+  return lower == 'a' || lower == 'c' || lower == 'g' || lower == 't';
+}
+
+/**
+ * @brief Spell out a window code (see SequenceStore::buildWindowCodes)
+ * @param code Window code below WINDOW_CODE_SPACE
+ * @return WINDOW_CODE_LENGTH upper-case nucleotides
+ */
+[[nodiscard]] inline std::string decodeWindowCode(size_t code) {
+  std::string kmer(WINDOW_CODE_LENGTH, 'A');
+  for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+    kmer[WINDOW_CODE_LENGTH - 1 - p] =
+        "ACTG"[(code >> (NUCLEOTIDE_CODE_BITS * p)) & 3];
+  }
+  return kmer;
+}
+
+/**
+ * @brief SplitMix64 finalizer: a bijective, well-mixed hash of a 64-bit id
+ * @param x Value to hash
+ * @return Hashed value
+ */
+[[nodiscard]] constexpr uint64_t mixBits(uint64_t x) noexcept {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+/// Sums a count buffer over all processes in place
+using CountReduction = std::function<void(std::span<uint64_t>)>;
 
 struct ChIPSequence {
   std::string id;
@@ -88,8 +145,7 @@ struct ChIPSequence {
   }
 
   bool isValid() const noexcept {
-    return !id.empty() && !sequence.empty() &&
-           sequence.size() == CHIP_SEQ_LENGTH;
+    return !id.empty() && !sequence.empty();
   }
 };
 
@@ -137,17 +193,31 @@ struct Motif {
   }
 
   bool isValid() const noexcept {
-    return !pattern.empty() && pattern.size() == MOTIF_LENGTH;
+    return !pattern.empty() && pattern.size() <= MAX_MOTIF_LENGTH;
   }
 };
 
+/**
+ * @brief DNA strand a motif hit was found on
+ */
+enum class Strand : uint8_t {
+  Forward, ///< Motif pattern as given
+  Reverse, ///< Reverse complement of the pattern
+  Both     ///< Both patterns match the window
+};
+
 struct MotifMatch {
   size_t sequence_index;
   size_t position;
   std::string matched_sequence;
+  Strand strand = Strand::Forward;
+  uint8_t mismatches = 0;
 
-  MotifMatch(size_t seq_idx, size_t pos, std::string_view matched)
-      : sequence_index(seq_idx), position(pos), matched_sequence(matched) {}
+  MotifMatch(size_t seq_idx, size_t pos, std::string_view matched,
+             Strand match_strand = Strand::Forward,
+             uint8_t match_mismatches = 0)
+      : sequence_index(seq_idx), position(pos), matched_sequence(matched),
+        strand(match_strand), mismatches(match_mismatches) {}
 
   MotifMatch() = default;
 
@@ -162,7 +232,8 @@ struct MotifMatch {
   bool operator==(const MotifMatch &other) const noexcept {
     return sequence_index == other.sequence_index &&
            position == other.position &&
-           matched_sequence == other.matched_sequence;
+           matched_sequence == other.matched_sequence &&
+           strand == other.strand && mismatches == other.mismatches;
   }
 
   auto operator<=>(const MotifMatch &other) const noexcept {
@@ -170,7 +241,11 @@ struct MotifMatch {
       return cmp;
     if (auto cmp = position <=> other.position; cmp != 0)
       return cmp;
-    return matched_sequence <=> other.matched_sequence;
+    if (auto cmp = matched_sequence <=> other.matched_sequence; cmp != 0)
+      return cmp;
+    if (auto cmp = strand <=> other.strand; cmp != 0)
+      return cmp;
+    return mismatches <=> other.mismatches;
   }
 
   std::span<const char> getMatchedSequenceSpan() const noexcept {
@@ -184,6 +259,8 @@ struct MotifResult {
   size_t match_count;
   double frequency;
   std::vector<MotifMatch> matches;
+  // Sequences whose best hit has k mismatches, empty for exact scans
+  std::vector<size_t> mismatch_counts;
 
   MotifResult() : match_count(0), frequency(0.0) {}
 
@@ -203,7 +280,7 @@ struct MotifResult {
            match_count == other.match_count &&
            std::abs(frequency - other.frequency) <
                std::numeric_limits<double>::epsilon() &&
-           matches == other.matches;
+           matches == other.matches && mismatch_counts == other.mismatch_counts;
   }
 
   std::partial_ordering operator<=>(const MotifResult &other) const noexcept {
@@ -213,7 +290,9 @@ struct MotifResult {
       return cmp;
     if (auto cmp = frequency <=> other.frequency; cmp != 0)
       return cmp;
-    return matches <=> other.matches;
+    if (auto cmp = matches <=> other.matches; cmp != 0)
+      return cmp;
+    return mismatch_counts <=> other.mismatch_counts;
   }
 
   std::span<const MotifMatch> getMatchesSpan() const noexcept {
@@ -221,7 +300,8 @@ struct MotifResult {
   }
 
   bool isValid() const noexcept {
-    return !motif_pattern.empty() && motif_pattern.size() == MOTIF_LENGTH;
+    return !motif_pattern.empty() &&
+           motif_pattern.size() <= MAX_MOTIF_LENGTH;
   }
 
   void calculateFrequency(size_t total_sequences) noexcept {
@@ -234,6 +314,46 @@ struct MotifResult {
   }
 };
 
+/**
+ * @brief Per-motif hit counts by window offset within the sequences
+ */
+struct PositionHistogram {
+  size_t motif_count = 0;
+  size_t offset_count = 0;      ///< Offsets per motif, 0 to offset_count - 1
+  std::vector<uint64_t> counts; ///< [motif * offset_count + offset]
+
+  PositionHistogram() = default;
+
+  PositionHistogram(size_t motifs, size_t offsets)
+      : motif_count(motifs), offset_count(offsets),
+        counts(motifs * offsets, 0) {}
+
+  bool operator==(const PositionHistogram &other) const = default;
+
+  std::span<uint64_t> row(size_t motif) noexcept {
+    return std::span<uint64_t>(counts).subspan(motif * offset_count,
+                                               offset_count);
+  }
+
+  std::span<const uint64_t> row(size_t motif) const noexcept {
+    return std::span<const uint64_t>(counts).subspan(motif * offset_count,
+                                                     offset_count);
+  }
+
+  // Resize every row to offsets, padding new offsets with zeros
+  void resizeOffsets(size_t offsets) {
+    if (offsets == offset_count) {
+      return;
+    }
+    PositionHistogram resized(motif_count, offsets);
+    const size_t kept = std::min(offsets, offset_count);
+    for (size_t m = 0; m < motif_count; ++m) {
+      std::ranges::copy(row(m).first(kept), resized.row(m).begin());
+    }
+    *this = std::move(resized);
+  }
+};
+
 [[nodiscard]] std::string trim(std::string_view str);
 [[nodiscard]] std::vector<std::string> split(std::string_view str,
                                              char delimiter);
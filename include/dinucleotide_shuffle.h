@@ -0,0 +1,113 @@
+#pragma once
+
+#include "common.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Word of a counter-based random stream
+ *
+ * SplitMix64 output number counter of the generator seeded with key. Any
+ * word can be computed on its own, so threads and processes draw from
+ * independent streams without sharing state, and a batch of words is a
+ * plain element-wise loop the compiler vectorizes.
+ *
+ * @param key Stream key
+ * @param counter Word index within the stream
+ * @return Uniform 64-bit word
+ */
+[[nodiscard]] constexpr uint64_t counterRandom(uint64_t key,
+                                               uint64_t counter) noexcept {
+  return mixBits(key + counter * 0x9E3779B97F4A7C15ull);
+}
+
+/**
+ * @brief Shuffle 2-bit nucleotide codes preserving dinucleotide counts
+ *
+ * Altschul-Erickson shuffle as an Euler walk: every dinucleotide is an edge
+ * between its bases, a random arborescence of last edges towards the final
+ * base is drawn with Wilson's algorithm, the other edges of each base are
+ * permuted, and the walk from the first base replays the edges in that
+ * order. Every sequence with the same first base and dinucleotide counts
+ * is equally likely.
+ *
+ * @param codes Codes 0-3 (see encodeNucleotide)
+ * @param key Random stream key (see counterRandom)
+ * @param shuffled Output, same size as codes
+ */
+void shuffleDinucleotides(std::span<const uint8_t> codes, uint64_t key,
+                          std::span<uint8_t> shuffled);
+
+/**
+ * @brief Shuffle a sequence preserving dinucleotide counts
+ *
+ * Characters other than A/C/G/T stay in place and split the sequence into
+ * runs that are shuffled separately with shuffleDinucleotides().
+ *
+ * @param sequence Nucleotides, any case
+ * @param key Random stream key
+ * @return Shuffled sequence, A/C/G/T upper-case
+ */
+[[nodiscard]] std::string shuffleSequence(std::string_view sequence,
+                                          uint64_t key);
+
+/**
+ * @brief Empirical p-value of an observed count against shuffled counts
+ * @param observed Count in the real sequences
+ * @param shuffled Count in each shuffled replicate
+ * @return (1 + replicates reaching observed) / (1 + replicates)
+ */
+[[nodiscard]] double empiricalPValue(uint64_t observed,
+                                     std::span<const uint64_t> shuffled);
+
+/**
+ * @brief Generates dinucleotide-shuffled replicates of a sequence store
+ *
+ * Items are numbered replicate-major: item t is replicate t / size() of
+ * sequence t % size(). Each item draws from its own stream keyed by the
+ * seed, the replicate and the global sequence id first_id + t % size(), so
+ * the output does not depend on how items are split over processes, blocks
+ * or threads, and replicates never need to be stored as a whole.
+ *
+ * Clean sequences are shuffled straight from the store's 2-bit codes;
+ * others go through shuffleSequence(). The store must outlive the shuffler.
+ */
+class DinucleotideShuffler {
+public:
+  /**
+   * @brief Construct a shuffler
+   * @param store Sequences to shuffle
+   * @param seed Seed shared by every process
+   * @param first_id Global id of the store's first sequence
+   */
+  DinucleotideShuffler(const SequenceStore &store, uint64_t seed,
+                       size_t first_id = 0)
+      : store_(store), seed_(seed), first_id_(first_id) {}
+
+  /**
+   * @brief Get the number of sequences per replicate
+   * @return Sequences in the store
+   */
+  [[nodiscard]] size_t size() const noexcept { return store_.size(); }
+
+  /**
+   * @brief Shuffle a range of items in parallel
+   *
+   * Reuses the strings already in out, so a buffer passed block after block
+   * stops allocating once it has grown.
+   *
+   * @param first First item
+   * @param last One past the last item
+   * @param out Set to last - first shuffled sequences, ids kept
+   */
+  void generate(size_t first, size_t last,
+                std::vector<ChIPSequence> &out) const;
+
+private:
+  const SequenceStore &store_;
+  uint64_t seed_;
+  size_t first_id_;
+};
+
+} // namespace dna_motif
@@ -20,6 +20,14 @@ enum class ParseError {
 
 template <typename T> using ParseResult = std::expected<T, ParseError>;
 
+/**
+ * @brief Nucleotide count matrix of a motif, e.g. from JASPAR or MEME
+ */
+struct CountMatrix {
+  std::string name;                          ///< Matrix id
+  std::vector<std::array<double, 4>> counts; ///< Per position, A C G T
+};
+
 /**
  * @brief Parser for ChIP-seq data files
  *
@@ -55,6 +63,22 @@ public:
   [[nodiscard]] ParseResult<std::vector<Motif>>
   parseMotifs(std::string_view filename);
 
+  /**
+   * @brief Parse nucleotide count matrices
+   *
+   * Reads JASPAR files, a '>' header followed by four rows of counts that
+   * may be labelled as in "A [ 3 0 12 ]" (unlabelled rows are A, C, G, T),
+   * and MEME motif files, whose letter-probability matrices are scaled to
+   * counts by their nsites (20 when absent). Files with a "MOTIF" line are
+   * read as MEME.
+   *
+   * @param filename Path to matrix file
+   * @return Expected matrices or error, ParseError::InvalidFormat for rows
+   *         that are not numbers or matrices with missing rows or columns
+   */
+  [[nodiscard]] ParseResult<std::vector<CountMatrix>>
+  parseCountMatrices(std::string_view filename);
+
   /**
    * @brief Validate a DNA sequence
    * @param sequence Sequence to validate
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief FM-index over the concatenated nucleotide runs of a store
+ *
+ * The indexed text is every run of A/C/G/T of every sequence, each
+ * followed by a separator, so no occurrence spans a sequence end or another
+ * character. Its suffix array is built by prefix doubling, starting from
+ * WINDOW_CODE_LENGTH-symbol keys, with chunked parallel sorts. The index
+ * keeps the BWT as one bit-vector per nucleotide in blocks of BLOCK_ROWS
+ * rows with cumulative counts (the occurrence table), plus the sequence id
+ * of every suffix array row so occurrences map back to sequences.
+ *
+ * A degenerate pattern is searched backwards, branching over the bases its
+ * IUPAC code accepts and pruning empty intervals. A saved index is mapped
+ * read-only with mmap() on load; nothing is copied or rebuilt.
+ */
+class FmIndex {
+public:
+  /// Leading bytes of a saved index
+  static constexpr std::string_view FILE_MAGIC = "DMFMIDX1";
+
+  /// Rows per occurrence table block
+  static constexpr size_t BLOCK_ROWS = 64;
+
+  FmIndex() = default;
+  ~FmIndex() = default;
+
+  // Spans point into the owned buffer or the mapping, which move along
+  FmIndex(const FmIndex &) = delete;
+  FmIndex &operator=(const FmIndex &) = delete;
+  FmIndex(FmIndex &&) = default;
+  FmIndex &operator=(FmIndex &&) = default;
+
+  /**
+   * @brief Index the nucleotide runs of every sequence of a store
+   * @param store Pre-decoded sequences
+   * @return Index over the store
+   * @throws std::length_error if the indexed text reaches 2^32 - 1 symbols
+   */
+  [[nodiscard]] static FmIndex build(const SequenceStore &store);
+
+  /**
+   * @brief Map an index saved with save()
+   * @param path Index file path
+   * @return Index reading from the mapped file
+   * @throws std::runtime_error if the file cannot be mapped, is not an
+   *         FM-index, or its occurrence table or sequence ids are corrupt
+   */
+  [[nodiscard]] static FmIndex load(const std::string &path);
+
+  /**
+   * @brief Save the index in binary form
+   * @param path Index file path
+   * @throws std::runtime_error if the file cannot be written
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * @brief Check whether the index was built from the given sequences
+   * @param store Sequences
+   * @return true if the sequence count and KmerIndex::fingerprint() agree
+   */
+  [[nodiscard]] bool matches(const SequenceStore &store) const;
+
+  /**
+   * @brief Count the occurrences of an IUPAC pattern
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @return Matching text positions, 0 for empty or invalid patterns
+   */
+  [[nodiscard]] size_t countOccurrences(std::string_view pattern,
+                                        const IUPACCodes &iupac_codes) const;
+
+  /**
+   * @brief Mark the sequences containing an IUPAC pattern
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @param bits Bitset over sequences to update, sequence s at bit s % 64
+   *             of word s / 64
+   */
+  void markSequences(std::string_view pattern, const IUPACCodes &iupac_codes,
+                     std::span<uint64_t> bits) const;
+
+  /**
+   * @brief Count the sequences containing a pattern
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @param both_strands Also count sequences containing the reverse
+   *                     complement
+   * @return Number of distinct sequences with an occurrence
+   */
+  [[nodiscard]] size_t countSequences(std::string_view pattern,
+                                      const IUPACCodes &iupac_codes,
+                                      bool both_strands = false) const;
+
+  /**
+   * @brief Get number of indexed text symbols, separators included
+   * @return Suffix array length
+   */
+  [[nodiscard]] size_t length() const noexcept { return length_; }
+
+  /**
+   * @brief Get number of indexed sequences
+   * @return Sequence count
+   */
+  [[nodiscard]] size_t sequenceCount() const noexcept {
+    return sequence_count_;
+  }
+
+  /**
+   * @brief Check whether the index reads from a mapped file
+   * @return true if created by load()
+   */
+  [[nodiscard]] bool isMapped() const noexcept { return mapping_ != nullptr; }
+
+private:
+  // Suffix array interval [low, high)
+  struct Interval {
+    size_t low;
+    size_t high;
+  };
+
+  // Words per block: one mask per nucleotide, then 4 packed uint32 counts
+  static constexpr size_t BLOCK_WORDS = 6;
+
+  size_t length_ = 0;
+  size_t sequence_count_ = 0;
+  uint64_t fingerprint_ = 0;
+  std::array<uint64_t, 5> first_rows_{}; // Rows before each symbol, $ first
+  std::span<const uint64_t> blocks_;
+  std::span<const uint32_t> documents_; // Sequence id of each row
+  std::vector<uint64_t> buffer_;        // Blocks then documents when built
+  std::shared_ptr<const void> mapping_;
+
+  /**
+   * @brief Count a nucleotide in the BWT before a row
+   * @param code Nucleotide code (see encodeNucleotide)
+   * @param row Row, at most length()
+   * @return Occurrences in rows [0, row)
+   */
+  [[nodiscard]] size_t occurrences(uint8_t code, size_t row) const noexcept;
+
+  /**
+   * @brief Backtrack a pattern over its accepted bases
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @return Non-empty suffix array intervals of its expansions
+   */
+  [[nodiscard]] std::vector<Interval>
+  search(std::string_view pattern, const IUPACCodes &iupac_codes) const;
+
+  /**
+   * @brief Point the spans at a body laid out as blocks then documents
+   * @param body Body words
+   */
+  void attach(std::span<const uint64_t> body) noexcept;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+#include "motif_kernels.h"
+#include <functional>
+#include <istream>
+
+namespace dna_motif {
+
+/**
+ * @brief Options of GenomeScanner
+ */
+struct GenomeScanOptions {
+  /// Genomic bin width in bases
+  size_t bin_size = 1000;
+
+  /// Window starts scanned by one thread at a time; rounded up to a multiple
+  /// of bin_size so every bin is owned by exactly one block
+  size_t block_size = 1uz << 20;
+
+  /// Also count reverse-complement hits; a site matching both strands is
+  /// counted once
+  bool both_strands = false;
+};
+
+/**
+ * @brief Per-motif hit counts of one genomic bin
+ */
+struct GenomeBin {
+  std::string_view record_id;
+  size_t start = 0; ///< First base of the bin
+  size_t end = 0;   ///< One past the last base of the bin
+  std::span<const uint32_t> counts; ///< Hits starting in the bin, motif order
+};
+
+/**
+ * @brief Streaming motif scanner for chromosome-sized records
+ *
+ * Reads FASTA input in fixed-size blocks, not lines, and scans records in
+ * chunks of one block per OpenMP thread instead of materializing whole
+ * records. Consecutive chunks overlap by the longest motif length minus
+ * one, so windows spanning a chunk boundary are scanned exactly once. Every
+ * motif occurrence is counted (not only the first per record) in the bin
+ * containing its start; memory stays bounded by the chunk size regardless
+ * of record and line length.
+ *
+ * Windows containing characters other than A/C/G/T never match.
+ */
+class GenomeScanner {
+public:
+  /// Receives completed bins in genomic order
+  using BinSink = std::function<void(const GenomeBin &)>;
+
+  /**
+   * @brief Compile motifs for streaming
+   * @param iupac_codes IUPAC code table
+   * @param motifs Motifs to count, any mix of lengths
+   * @param options Bin, block and strand options
+   * @throws std::invalid_argument for an empty motif set, invalid motifs or a
+   *         zero bin or block size
+   */
+  GenomeScanner(const IUPACCodes &iupac_codes, std::span<const Motif> motifs,
+                const GenomeScanOptions &options = {});
+  ~GenomeScanner() = default;
+
+  GenomeScanner(const GenomeScanner &) = delete;
+  GenomeScanner &operator=(const GenomeScanner &) = delete;
+  GenomeScanner(GenomeScanner &&) = default;
+  GenomeScanner &operator=(GenomeScanner &&) = default;
+
+  /**
+   * @brief Scan every record of a FASTA stream
+   * @param input Stream of '>' headed records; the record id is the first
+   *              word of the header, text before the first header is
+   *              ignored
+   * @param sink Called once per bin, records in input order
+   */
+  void scan(std::istream &input, const BinSink &sink) const;
+
+  /**
+   * @brief Scan one in-memory record
+   * @param id Record id passed through to the bins
+   * @param sequence Record nucleotides
+   * @param sink Called once per bin in genomic order
+   */
+  void scanRecord(std::string_view id, std::string_view sequence,
+                  const BinSink &sink) const;
+
+  /**
+   * @brief Get number of motifs counted per bin
+   * @return Motif count
+   */
+  [[nodiscard]] size_t motifCount() const noexcept { return motif_count_; }
+
+  /**
+   * @brief Get the effective block size
+   * @return Window starts per block, a multiple of the bin size
+   */
+  [[nodiscard]] size_t blockSize() const noexcept { return block_size_; }
+
+  /**
+   * @brief Get the overlap carried between chunks
+   * @return Longest motif length minus one
+   */
+  [[nodiscard]] size_t overlap() const noexcept { return max_length_ - 1; }
+
+private:
+  // Motifs of one length, evaluated together
+  struct PanelGroup {
+    MotifPanel panel;
+    std::vector<size_t> motif_indices;
+  };
+
+  std::vector<PanelGroup> groups_;
+  size_t motif_count_ = 0;
+  size_t max_length_ = 0;
+  size_t bin_size_ = 0;
+  size_t block_size_ = 0;
+
+  /**
+   * @brief Get number of window starts handled per chunk
+   * @return One block per OpenMP thread
+   */
+  [[nodiscard]] size_t chunkSize() const noexcept;
+
+  /**
+   * @brief Count hits of window starts [0, windows) of a chunk and emit bins
+   * @param id Record id
+   * @param text Chunk nucleotides, with the overlap unless final
+   * @param offset Genomic position of text[0], a multiple of the bin size
+   * @param windows Window starts to scan
+   * @param final true for the last chunk of the record
+   * @param sink Bin receiver
+   */
+  void scanChunk(std::string_view id, std::string_view text, size_t offset,
+                 size_t windows, bool final, const BinSink &sink) const;
+
+  /**
+   * @brief Count hits of window starts [first, last) of a chunk
+   * @param text Chunk nucleotides
+   * @param first First window start
+   * @param last One past the last window start
+   * @param counts Bin-major counts of the chunk
+   */
+  void scanBlock(std::string_view text, size_t first, size_t last,
+                 std::span<uint32_t> counts) const;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "common.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Pairwise counts of sequences hit by two motifs
+ */
+struct CooccurrenceMatrix {
+  size_t motif_count = 0;
+  std::vector<uint64_t> counts; ///< Symmetric, [a * motif_count + b]
+
+  CooccurrenceMatrix() = default;
+
+  explicit CooccurrenceMatrix(size_t motifs)
+      : motif_count(motifs), counts(motifs * motifs, 0) {}
+
+  bool operator==(const CooccurrenceMatrix &other) const = default;
+
+  /**
+   * @brief Get the number of sequences hit by two motifs
+   * @param a First motif index
+   * @param b Second motif index
+   * @return Sequences hit by both, the hit count of a when a == b
+   */
+  [[nodiscard]] uint64_t at(size_t a, size_t b) const noexcept {
+    return counts[a * motif_count + b];
+  }
+
+  /**
+   * @brief Get the Jaccard similarity of the hit sets of two motifs
+   * @param a First motif index
+   * @param b Second motif index
+   * @return Shared sequences over sequences hit by either, 0 if neither
+   *         hits any
+   */
+  [[nodiscard]] double jaccard(size_t a, size_t b) const noexcept {
+    const uint64_t either = at(a, a) + at(b, b) - at(a, b);
+    return either > 0 ? static_cast<double>(at(a, b)) /
+                            static_cast<double>(either)
+                      : 0.0;
+  }
+};
+
+/**
+ * @brief One bitset over sequences per motif
+ *
+ * Bit s of row m is set when motif m hits sequence s. Rows are padded to
+ * whole 64-bit words with zero bits, so set operations and popcounts can
+ * run over full words.
+ */
+class HitBitsets {
+public:
+  /// Motifs per tile of the co-occurrence computation
+  static constexpr size_t TILE_MOTIFS = 16;
+
+  /// Words of each row processed per tile step; two tiles stay in L1
+  static constexpr size_t TILE_WORDS = 64;
+
+  HitBitsets() = default;
+
+  /**
+   * @brief Create empty bitsets
+   * @param motif_count Number of rows
+   * @param sequence_count Bits per row
+   */
+  HitBitsets(size_t motif_count, size_t sequence_count);
+
+  /**
+   * @brief Collect the hit sequences of scan results
+   * @param results One result per motif
+   * @param sequence_count Number of sequences scanned
+   * @return Bitsets with row m set at the sequences of results[m].matches
+   */
+  [[nodiscard]] static HitBitsets
+  fromResults(std::span<const MotifResult> results, size_t sequence_count);
+
+  /**
+   * @brief Mark a sequence as hit by a motif
+   * @param motif Motif index
+   * @param sequence Sequence index
+   */
+  void set(size_t motif, size_t sequence) noexcept {
+    words_[motif * word_count_ + sequence / 64] |= 1ull << (sequence % 64);
+  }
+
+  /**
+   * @brief Check whether a motif hits a sequence
+   * @param motif Motif index
+   * @param sequence Sequence index
+   * @return true if the bit is set
+   */
+  [[nodiscard]] bool test(size_t motif, size_t sequence) const noexcept {
+    return (words_[motif * word_count_ + sequence / 64] >> (sequence % 64)) &
+           1u;
+  }
+
+  /**
+   * @brief Get the bitset of a motif
+   * @param motif Motif index
+   * @return wordCount() words, sequence s at bit s % 64 of word s / 64
+   */
+  [[nodiscard]] std::span<const uint64_t> row(size_t motif) const noexcept {
+    return std::span<const uint64_t>(words_).subspan(motif * word_count_,
+                                                     word_count_);
+  }
+
+  /**
+   * @brief Count the sequences hit by a motif
+   * @param motif Motif index
+   * @return Set bits of the row
+   */
+  [[nodiscard]] size_t count(size_t motif) const noexcept;
+
+  /**
+   * @brief Count the sequences of a range hit by a motif
+   * @param motif Motif index
+   * @param first First sequence of the range
+   * @param last Sequence past the range, at most sequenceCount()
+   * @return Set bits of the row in [first, last)
+   */
+  [[nodiscard]] size_t count(size_t motif, size_t first,
+                             size_t last) const noexcept;
+
+  /**
+   * @brief Compute the sequences shared by every pair of motifs
+   *
+   * Evaluates TILE_MOTIFS x TILE_MOTIFS tiles of the upper triangle in
+   * parallel, each over TILE_WORDS-word slices of the rows, with AND and
+   * popcount (a nibble-table popcount under AVX2).
+   *
+   * @return Symmetric matrix with hit counts on the diagonal
+   */
+  [[nodiscard]] CooccurrenceMatrix cooccurrence() const;
+
+  /**
+   * @brief Get number of rows
+   * @return Motif count
+   */
+  [[nodiscard]] size_t motifCount() const noexcept { return motif_count_; }
+
+  /**
+   * @brief Get number of bits per row
+   * @return Sequence count
+   */
+  [[nodiscard]] size_t sequenceCount() const noexcept {
+    return sequence_count_;
+  }
+
+  /**
+   * @brief Get number of words per row
+   * @return Sequence count rounded up to whole words
+   */
+  [[nodiscard]] size_t wordCount() const noexcept { return word_count_; }
+
+private:
+  size_t motif_count_ = 0;
+  size_t sequence_count_ = 0;
+  size_t word_count_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+} // namespace dna_motif
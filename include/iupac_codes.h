@@ -89,6 +89,35 @@ public:
            nucleotides.end();
   }
 
+  /**
+   * @brief Get the set of nucleotides an IUPAC code accepts as a bitmask
+   * @param code IUPAC code character
+   * @return Bit encodeNucleotide(n) is set for every accepted nucleotide n,
+   *         0 for invalid codes
+   */
+  [[nodiscard]] uint8_t getBaseMask(char code) const noexcept {
+    return base_masks_[static_cast<unsigned char>(std::toupper(code))];
+  }
+
+  /**
+   * @brief Get the IUPAC code accepting the complementary nucleotides
+   * @param code IUPAC code character
+   * @return Complement code (e.g. R for Y), the input for invalid codes
+   */
+  [[nodiscard]] char getComplement(char code) const noexcept {
+    const char complement =
+        complements_[static_cast<unsigned char>(std::toupper(code))];
+    return complement != '\0' ? complement : code;
+  }
+
+  /**
+   * @brief Get the reverse complement of a motif pattern
+   * @param motif Motif pattern with IUPAC codes
+   * @return Pattern matching the opposite strand of every window matched by
+   *         motif
+   */
+  [[nodiscard]] std::string reverseComplement(std::string_view motif) const;
+
   /**
    * @brief Check if a DNA sequence matches a motif pattern
    * @param sequence DNA sequence to check
@@ -100,6 +129,18 @@ public:
                                   std::string_view motif,
                                   size_t start_pos) const noexcept;
 
+  /**
+   * @brief Count motif positions a sequence segment does not match
+   * @param sequence DNA sequence to check
+   * @param motif Motif pattern with IUPAC codes
+   * @param start_pos Starting position in sequence
+   * @return Number of mismatching positions, motif length if the motif does
+   *         not fit at start_pos
+   */
+  [[nodiscard]] size_t countMismatches(std::string_view sequence,
+                                       std::string_view motif,
+                                       size_t start_pos) const noexcept;
+
   /**
    * @brief Find all matches of a motif in a sequences
    * @param sequence DNA sequence to search
@@ -147,6 +188,8 @@ public:
 private:
   iupac_map_type iupac_map_;
   std::array<bool, 256> valid_codes_;
+  std::array<uint8_t, 256> base_masks_;
+  std::array<char, 256> complements_;
 
   constexpr void initializeIUPACMap() noexcept;
   constexpr void addMapping(char iupac_code,
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "common.h"
+#include "motif_kernels.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Inverted index from every WINDOW_CODE_LENGTH-mer to the sequences
+ *        containing it
+ *
+ * Each window code owns a posting list of sequence ids in one of two
+ * containers, whichever is smaller: delta-encoded LEB128 varints for sparse
+ * lists, or a bitset over all sequences for dense ones. A degenerate motif
+ * of WINDOW_CODE_LENGTH is answered from its KmerTable as the union of the
+ * postings of the accepted codes: varint lists are scattered into a bitset
+ * over sequences and bitset containers are OR-ed into it a word at a time,
+ * so the cost follows the posting sizes rather than the sequence lengths.
+ *
+ * Windows spanning a non-nucleotide are not indexed. The index records a
+ * fingerprint of the sequences it was built from so a saved index can be
+ * checked against the dataset before it is reused.
+ */
+class KmerIndex {
+public:
+  /// Leading bytes of a saved index
+  static constexpr std::string_view FILE_MAGIC = "DMKXIDX1";
+
+  KmerIndex() = default;
+
+  /**
+   * @brief Index the windows of every sequence of a store
+   *
+   * Threads collect the distinct codes of contiguous sequence blocks, then
+   * scatter their ids into code order and encode the postings code by code.
+   *
+   * @param store Pre-decoded sequences
+   * @return Index over the store
+   * @throws std::length_error if the store holds 2^32 or more sequences
+   */
+  [[nodiscard]] static KmerIndex build(const SequenceStore &store);
+
+  /**
+   * @brief Load an index saved with save()
+   * @param path Index file path
+   * @return Loaded index
+   * @throws std::runtime_error if the file cannot be read, is not an index
+   *         or any container does not hold the ascending sequence ids its
+   *         count promises
+   */
+  [[nodiscard]] static KmerIndex load(const std::string &path);
+
+  /**
+   * @brief Save the index in binary form
+   * @param path Index file path
+   * @throws std::runtime_error if the file cannot be written
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * @brief Compute the dataset fingerprint stored by build()
+   * @param store Sequences
+   * @return FNV-1a hash over the sequence lengths and characters
+   */
+  [[nodiscard]] static uint64_t fingerprint(const SequenceStore &store);
+
+  /**
+   * @brief Check whether the index was built from the given sequences
+   * @param store Sequences
+   * @return true if the sequence count and fingerprint agree
+   */
+  [[nodiscard]] bool matches(const SequenceStore &store) const {
+    return sequence_count_ == store.size() &&
+           fingerprint_ == fingerprint(store);
+  }
+
+  /**
+   * @brief Get the sequences containing a window code
+   * @param code Window code (see SequenceStore::buildWindowCodes())
+   * @return Sorted distinct sequence ids
+   */
+  [[nodiscard]] std::vector<uint32_t> posting(uint16_t code) const;
+
+  /**
+   * @brief Get the length of a posting list
+   * @param code Window code
+   * @return Number of sequences containing the code
+   */
+  [[nodiscard]] uint32_t postingSize(uint16_t code) const noexcept {
+    return counts_[code];
+  }
+
+  /**
+   * @brief Check whether a posting is stored as a bitset
+   * @param code Window code
+   * @return true for a bitset container, false for delta varints
+   */
+  [[nodiscard]] bool isDense(uint16_t code) const noexcept {
+    return dense_[code] != 0;
+  }
+
+  /**
+   * @brief Collect the sequences containing any code accepted by a table
+   * @param table Accepted window codes, e.g. a motif merged with its
+   *              reverse complement
+   * @return Bitset over sequences, sequence s at bit s % 64 of word s / 64
+   */
+  [[nodiscard]] std::vector<uint64_t> lookup(const KmerTable &table) const;
+
+  /**
+   * @brief Count the sequences containing any code accepted by a table
+   * @param table Accepted window codes
+   * @return Cardinality of the union of their postings
+   */
+  [[nodiscard]] size_t count(const KmerTable &table) const;
+
+  /**
+   * @brief Count the sequences containing any of a few codes
+   *
+   * Without bitset containers among the codes only the touched words of the
+   * scratch bitset are written and cleared again, so the cost follows the
+   * posting sizes alone.
+   *
+   * @param codes Window codes
+   * @param scratch Zeroed bitset of (sequenceCount() + 63) / 64 words, zero
+   *                again on return
+   * @return Cardinality of the union of their postings
+   */
+  [[nodiscard]] size_t countUnion(std::span<const uint16_t> codes,
+                                  std::span<uint64_t> scratch) const noexcept;
+
+  /**
+   * @brief Get number of indexed sequences
+   * @return Sequence count
+   */
+  [[nodiscard]] size_t sequenceCount() const noexcept {
+    return sequence_count_;
+  }
+
+  /**
+   * @brief Get size of the encoded postings
+   * @return Bytes of both container kinds
+   */
+  [[nodiscard]] size_t encodedBytes() const noexcept { return data_.size(); }
+
+private:
+  size_t sequence_count_ = 0;
+  uint64_t fingerprint_ = 0;
+  std::vector<uint32_t> counts_;  // Posting length per code
+  std::vector<uint8_t> dense_;    // 1 for bitset containers
+  std::vector<uint64_t> offsets_; // Start of each posting in data_, +1 end
+  std::vector<uint8_t> data_;
+
+  /**
+   * @brief Get number of words of a bitset over the indexed sequences
+   * @return Sequence count rounded up to whole words
+   */
+  [[nodiscard]] size_t wordCount() const noexcept {
+    return (sequence_count_ + 63) / 64;
+  }
+
+  /**
+   * @brief OR the posting of a code into a bitset over sequences
+   * @param code Window code
+   * @param bits wordCount() words
+   */
+  void orPosting(uint16_t code, std::span<uint64_t> bits) const noexcept;
+};
+
+} // namespace dna_motif
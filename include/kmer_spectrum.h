@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Counts of every WINDOW_CODE_LENGTH-mer over a set of sequences
+ *
+ * Indexed by window code (see SequenceStore::buildWindowCodes). Windows
+ * overlapping a character other than A/C/G/T are not counted. Both count
+ * arrays live in one buffer so a single reduction sums them across
+ * processes.
+ */
+struct KmerSpectrum {
+  uint64_t sequence_count = 0; ///< Sequences the spectrum was counted over
+  /// Occurrences of code c at [c], sequences containing it at
+  /// [WINDOW_CODE_SPACE + c]
+  std::vector<uint64_t> counts =
+      std::vector<uint64_t>(2 * WINDOW_CODE_SPACE, 0);
+
+  bool operator==(const KmerSpectrum &other) const = default;
+
+  /**
+   * @brief Count the spectrum of a store
+   *
+   * Every thread counts a contiguous range of sequences, balanced by bases,
+   * into a private table with the two 32-bit counters and the last-seen
+   * sequence stamp of a code side by side, so a window touches one cache
+   * line. Tables are flushed into 64-bit thread counts before they can
+   * wrap, and the thread counts are summed in parallel over codes.
+   *
+   * @param store Pre-decoded sequences; window codes are used when built
+   * @param part Contiguous part of the sequences to count, below parts
+   * @param parts Number of parts the sequences are split into
+   * @return Spectrum of the part's sequences
+   */
+  [[nodiscard]] static KmerSpectrum
+  count(const SequenceStore &store, size_t part = 0, size_t parts = 1);
+
+  /**
+   * @brief Get the occurrence count of every code
+   * @return WINDOW_CODE_SPACE counts
+   */
+  [[nodiscard]] std::span<const uint64_t> occurrences() const noexcept {
+    return std::span<const uint64_t>(counts).first(WINDOW_CODE_SPACE);
+  }
+
+  /**
+   * @brief Get the number of sequences containing every code
+   * @return WINDOW_CODE_SPACE counts
+   */
+  [[nodiscard]] std::span<const uint64_t> sequences() const noexcept {
+    return std::span<const uint64_t>(counts).last(WINDOW_CODE_SPACE);
+  }
+
+  /**
+   * @brief Get the number of counted windows
+   * @return Sum of occurrences()
+   */
+  [[nodiscard]] uint64_t windowCount() const noexcept;
+};
+
+} // namespace dna_motif
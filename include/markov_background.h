@@ -0,0 +1,166 @@
+#pragma once
+
+#include "common.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Order-k Markov model of a dataset for analytical motif statistics
+ *
+ * Fitted from the (k + 1)-mer counts of the sequences, skipping words that
+ * overlap a character other than A/C/G/T, with one pseudocount per word.
+ * Contexts are the k preceding bases coded like window codes (first base
+ * in the most significant bits); a sequence starts with a context drawn
+ * from the k-mer frequencies and continues with the transition
+ * probabilities.
+ *
+ * Motif statistics are exact under the model:
+ *  - windowProbability() runs a forward pass over the motif's IUPAC
+ *    position sets, carrying the probability of every context;
+ *  - presenceProbability() tracks the partial matches of the motif as a
+ *    Shift-And automaton state next to the context, so overlapping and
+ *    self-similar windows are neither double-counted nor treated as
+ *    independent. Each step drops the probability mass that completes a
+ *    match, and the remaining mass after l steps is P(no hit in l bases),
+ *    so one pass answers every sequence length at once. Patterns with
+ *    more partial-match states than MAX_TRACKED_STATES allows (e.g. long
+ *    runs of N between specific bases) fall back to treating windows as
+ *    independent: P(no hit) = (1 - windowProbability())^windows.
+ *
+ * Gapped patterns and invalid codes have no statistics (std::nullopt).
+ */
+class MarkovBackground {
+public:
+  /// Highest supported order
+  static constexpr size_t MAX_ORDER = 3;
+
+  /// Sequence lengths counted exactly; longer sequences are pooled and
+  /// evaluated at their mean length, extrapolating the geometric decay of
+  /// P(no hit) from this length on
+  static constexpr size_t MAX_EXACT_LENGTH = 1024;
+
+  /// Largest number of (automaton state, context) pairs presence
+  /// statistics carry per base; bounds their memory and time
+  static constexpr size_t MAX_TRACKED_STATES = 1uz << 16;
+
+  /**
+   * @brief Fit a model to a store
+   *
+   * Words and lengths are counted in parallel and summed with reduce (e.g.
+   * over processes) before fitting, so every caller gets the same model.
+   *
+   * @param store Pre-decoded sequences
+   * @param order Context length, at most MAX_ORDER
+   * @param reduce Sums the count buffer in place, if set
+   * @throws std::invalid_argument if order exceeds MAX_ORDER
+   */
+  MarkovBackground(const SequenceStore &store, size_t order,
+                   CountReduction reduce = {});
+
+  /**
+   * @brief Get the model order
+   * @return Bases in a context
+   */
+  [[nodiscard]] size_t order() const noexcept { return order_; }
+
+  /**
+   * @brief Get the number of sequences the model was fitted to
+   * @return Sequences over every reduced part
+   */
+  [[nodiscard]] uint64_t sequenceCount() const noexcept {
+    return sequence_count_;
+  }
+
+  /**
+   * @brief Get the probability of a starting context
+   * @param context Code of k bases below 4^order
+   * @return Frequency of the k-mer
+   */
+  [[nodiscard]] double contextProbability(size_t context) const noexcept {
+    return initial_[context];
+  }
+
+  /**
+   * @brief Get the probability of a base after a context
+   * @param context Code of the k preceding bases
+   * @param base Code of the next base (see encodeNucleotide)
+   * @return P(base | context)
+   */
+  [[nodiscard]] double transition(size_t context,
+                                  uint8_t base) const noexcept {
+    return transitions_[context * 4 + base];
+  }
+
+  /**
+   * @brief Get the probability that a window matches a motif
+   * @param pattern Motif pattern of IUPAC codes
+   * @param both_strands Also accept the reverse complement
+   * @return Match probability of a window after a k-mer context
+   */
+  [[nodiscard]] std::optional<double>
+  windowProbability(std::string_view pattern, bool both_strands) const;
+
+  /**
+   * @brief Get the probability that a sequence contains a motif
+   * @param pattern Motif pattern of IUPAC codes
+   * @param length Sequence length
+   * @param both_strands Also accept the reverse complement
+   * @return P(at least one hit among the length - |pattern| + 1 windows)
+   */
+  [[nodiscard]] std::optional<double>
+  presenceProbability(std::string_view pattern, size_t length,
+                      bool both_strands) const;
+
+  /**
+   * @brief Get the expected number of fitted sequences containing a motif
+   * @param pattern Motif pattern of IUPAC codes
+   * @param both_strands Also accept the reverse complement
+   * @return Sum of presenceProbability() over the sequence lengths
+   */
+  [[nodiscard]] std::optional<double>
+  expectedSequences(std::string_view pattern, bool both_strands) const;
+
+private:
+  using Masks = std::vector<uint8_t>;
+
+  size_t order_;
+  size_t contexts_;
+  uint64_t sequence_count_ = 0;
+  std::vector<double> initial_;     ///< Probability of each context
+  std::vector<double> transitions_; ///< P(base | context) at [context*4+base]
+  std::vector<double> by_base_;     ///< Same at [base*4^order+context]
+  std::vector<uint64_t> lengths_;   ///< Sequences of each exact length
+  uint64_t long_sequences_ = 0;     ///< Sequences of MAX_EXACT_LENGTH or more
+  uint64_t long_bases_ = 0;         ///< Bases of those sequences
+
+  /**
+   * @brief Convert a pattern to base masks
+   * @param pattern Motif pattern
+   * @return One mask per position, std::nullopt for unsupported patterns
+   */
+  [[nodiscard]] static std::optional<Masks> masks(std::string_view pattern);
+
+  /**
+   * @brief Get the probability that a window matches motif masks
+   * @param forward Motif masks
+   * @param both_strands Also accept the reverse complement
+   * @return Match probability of a window after a k-mer context
+   */
+  [[nodiscard]] double windowProbability(const Masks &forward,
+                                         bool both_strands) const;
+
+  /**
+   * @brief Get P(no hit in the first l bases) for l up to a length
+   * @param masks Motif masks
+   * @param both_strands Also accept the reverse complement
+   * @param length Longest sequence length needed
+   * @return length + 1 survival probabilities, approximated from the
+   *         window probability beyond MAX_TRACKED_STATES
+   */
+  [[nodiscard]] std::vector<double> survival(const Masks &masks,
+                                             bool both_strands,
+                                             size_t length) const;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "hit_bitsets.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Bootstrap confidence interval of a motif frequency
+ */
+struct FrequencyInterval {
+  double frequency = 0.0; ///< Frequency in the sequences themselves
+  double lower = 0.0;     ///< Lower percentile over the replicates
+  double upper = 0.0;     ///< Upper percentile over the replicates
+
+  bool operator==(const FrequencyInterval &other) const = default;
+};
+
+/**
+ * @brief Weighted motif hit counts of Poisson bootstrap replicates
+ *
+ * A replicate gives every sequence an independent Poisson(1) weight, the
+ * number of times it would be drawn when resampling with replacement, so
+ * weights come from a counter-based random stream keyed by the replicate
+ * and the global sequence index instead of a shared multinomial draw.
+ * Processes weight their own sequences and the counts simply add up, with
+ * the same replicates for any split of the input.
+ *
+ * The weighted hit count of a motif is a weighted popcount of its hit
+ * bitset, taken for a group of replicates at once: every set bit adds the
+ * group's byte weights of that sequence to one lane per replicate.
+ */
+struct MotifBootstrap {
+  /// Largest weight; P(Poisson(1) > 15) is about 1e-13
+  static constexpr uint32_t MAX_WEIGHT = 15;
+
+  /// Replicates sharing one pass over each tile of the hit bitsets
+  static constexpr size_t TILE_REPLICATES = 32;
+
+  /// Words of the hit bitsets per tile; the weights of a group over a
+  /// tile stay in L1
+  static constexpr size_t TILE_WORDS = 16;
+
+  size_t motif_count = 0;
+  size_t replicates = 0;
+  /// Row r = 0 holds the unweighted counts, row r > 0 replicate r - 1:
+  /// weighted hits of motif m at [r * (motif_count + 1) + m], total weight
+  /// at [r * (motif_count + 1) + motif_count]
+  std::vector<uint64_t> counts;
+
+  MotifBootstrap() = default;
+
+  MotifBootstrap(size_t motifs, size_t replicate_count)
+      : motif_count(motifs), replicates(replicate_count),
+        counts((replicate_count + 1) * (motifs + 1), 0) {}
+
+  bool operator==(const MotifBootstrap &other) const = default;
+
+  /**
+   * @brief Count the weighted hits of bootstrap replicates
+   *
+   * Replicates are processed in parallel in groups of TILE_REPLICATES; a
+   * group draws its weights for TILE_WORDS words of sequences at a time
+   * and runs every motif row of that tile against all of them. Rows
+   * hitting most sequences of a tile sum the weights of the sequences
+   * they miss and subtract them from the total.
+   *
+   * @param bitsets Hit bitsets of a scan
+   * @param replicate_count Number of replicates
+   * @param seed Random seed
+   * @param first_id Global index of the first sequence of the bitsets
+   * @return Counts of the sequences of the bitsets
+   */
+  [[nodiscard]] static MotifBootstrap count(const HitBitsets &bitsets,
+                                            size_t replicate_count,
+                                            uint64_t seed,
+                                            uint64_t first_id = 0);
+
+  /**
+   * @brief Get the weighted hit count of a motif
+   * @param row 0 for the sequences themselves, r + 1 for replicate r
+   * @param motif Motif index
+   * @return Sum of the weights of the sequences the motif hits
+   */
+  [[nodiscard]] uint64_t weighted(size_t row, size_t motif) const noexcept {
+    return counts[row * (motif_count + 1) + motif];
+  }
+
+  /**
+   * @brief Get the total weight of a row
+   * @param row 0 for the sequences themselves, r + 1 for replicate r
+   * @return Sum of the weights of all sequences
+   */
+  [[nodiscard]] uint64_t total(size_t row) const noexcept {
+    return counts[row * (motif_count + 1) + motif_count];
+  }
+
+  /**
+   * @brief Get the weighted frequency of a motif
+   * @param row 0 for the sequences themselves, r + 1 for replicate r
+   * @param motif Motif index
+   * @return weighted() over total(), 0 if the total weight is 0
+   */
+  [[nodiscard]] double frequency(size_t row, size_t motif) const noexcept {
+    const uint64_t weight = total(row);
+    return weight > 0 ? static_cast<double>(weighted(row, motif)) /
+                            static_cast<double>(weight)
+                      : 0.0;
+  }
+
+  /**
+   * @brief Compute percentile confidence intervals of the frequencies
+   * @param confidence Coverage of the interval, in (0, 1)
+   * @return One interval per motif, interpolated between the order
+   *         statistics of the replicate frequencies
+   * @throws std::invalid_argument for a confidence outside (0, 1) or no
+   *         replicates
+   */
+  [[nodiscard]] std::vector<FrequencyInterval>
+  intervals(double confidence) const;
+};
+
+/**
+ * @brief Draw a Poisson(1) bootstrap weight
+ * @param random Uniform 32-bit word
+ * @return Inverse CDF of Poisson(1) at random / 2^32, at most
+ *         MotifBootstrap::MAX_WEIGHT
+ */
+[[nodiscard]] uint32_t poissonWeight(uint32_t random) noexcept;
+
+} // namespace dna_motif
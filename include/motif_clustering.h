@@ -0,0 +1,140 @@
+#pragma once
+
+#include "common.h"
+#include "hit_bitsets.h"
+
+namespace dna_motif {
+
+/**
+ * @brief MinHash signatures of motif hit sets
+ *
+ * Entry j of a motif's signature is the minimum of hash function j over the
+ * ids of the sequences it hits, so two motifs agree at j with probability
+ * equal to the Jaccard similarity of their hit sets. Comparing signatures
+ * costs hashCount() words per pair however many sequences were scanned, and
+ * signatures of disjoint sequence sets (e.g. of several processes) combine
+ * by element-wise minimum.
+ */
+class MinHashSketches {
+public:
+  /// Signature entry of a motif without hits
+  static constexpr uint64_t EMPTY = ~0ull;
+
+  MinHashSketches() = default;
+
+  /**
+   * @brief Create empty signatures
+   * @param motif_count Number of motifs
+   * @param hash_count Entries per signature
+   */
+  MinHashSketches(size_t motif_count, size_t hash_count);
+
+  /**
+   * @brief Compute the signatures of hit bitsets
+   * @param bitsets One row per motif
+   * @param hash_count Entries per signature, more for a finer estimate
+   * @param first_id Id of sequence 0, its index in the whole input so
+   *                 that merged signatures do not depend on the split
+   * @return Signatures, motifs in parallel
+   */
+  [[nodiscard]] static MinHashSketches
+  fromBitsets(const HitBitsets &bitsets, size_t hash_count,
+              uint64_t first_id = 0);
+
+  /**
+   * @brief Add the hit sets of other signatures
+   * @param other Signatures of the same shape over other sequences
+   */
+  void merge(const MinHashSketches &other);
+
+  /**
+   * @brief Estimate the Jaccard similarity of two motifs
+   * @param a First motif index
+   * @param b Second motif index
+   * @return Fraction of agreeing entries, 0 if either motif has no hits
+   */
+  [[nodiscard]] double similarity(size_t a, size_t b) const noexcept;
+
+  /**
+   * @brief Get the signature of a motif
+   * @param motif Motif index
+   * @return hashCount() entries
+   */
+  [[nodiscard]] std::span<const uint64_t>
+  signature(size_t motif) const noexcept {
+    return std::span<const uint64_t>(values_).subspan(motif * hash_count_,
+                                                      hash_count_);
+  }
+
+  /**
+   * @brief Get all signature entries, e.g. for reduction across processes
+   * @return [motif * hashCount() + j]
+   */
+  [[nodiscard]] std::vector<uint64_t> &values() noexcept { return values_; }
+  [[nodiscard]] const std::vector<uint64_t> &values() const noexcept {
+    return values_;
+  }
+
+  [[nodiscard]] size_t motifCount() const noexcept { return motif_count_; }
+  [[nodiscard]] size_t hashCount() const noexcept { return hash_count_; }
+
+private:
+  size_t motif_count_ = 0;
+  size_t hash_count_ = 0;
+  std::vector<uint64_t> values_;
+};
+
+/**
+ * @brief Single-linkage clusters of motifs
+ */
+struct MotifClusters {
+  std::vector<size_t> cluster_of;      ///< Cluster of every motif
+  std::vector<size_t> representatives; ///< Motif with most hits per cluster
+
+  /**
+   * @brief Get number of clusters
+   * @return Clusters, numbered by their lowest motif index
+   */
+  [[nodiscard]] size_t clusterCount() const noexcept {
+    return representatives.size();
+  }
+
+  /**
+   * @brief Get the motifs of a cluster
+   * @param cluster Cluster index
+   * @return Motif indices in increasing order
+   */
+  [[nodiscard]] std::vector<size_t> members(size_t cluster) const;
+};
+
+/**
+ * @brief Cluster motifs by exact Jaccard similarity of their hit sets
+ *
+ * Motifs are linked when CooccurrenceMatrix::jaccard() reaches the
+ * threshold and clusters are the connected components (single linkage).
+ *
+ * @param matrix Co-occurrence matrix with hit counts on the diagonal
+ * @param threshold Smallest linking similarity, in (0, 1]
+ * @return Clusters with the most frequent motif as representative
+ * @throws std::invalid_argument for thresholds outside (0, 1]
+ */
+[[nodiscard]] MotifClusters clusterMotifs(const CooccurrenceMatrix &matrix,
+                                          double threshold);
+
+/**
+ * @brief Cluster motifs by estimated Jaccard similarity
+ *
+ * Same linkage as the exact overload with MinHashSketches::similarity();
+ * pairs are compared in parallel.
+ *
+ * @param sketches Signatures of every motif
+ * @param hit_counts Sequences hit by every motif, to pick representatives
+ * @param threshold Smallest linking similarity, in (0, 1]
+ * @return Clusters with the most frequent motif as representative
+ * @throws std::invalid_argument for thresholds outside (0, 1]
+ */
+[[nodiscard]] MotifClusters clusterMotifs(const MinHashSketches &sketches,
+                                          std::span<const uint64_t> hit_counts,
+                                          double threshold);
+
+} // namespace dna_motif
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "common.h"
+#include "kmer_index.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Score ranking discovered motifs
+ */
+enum class DiscoveryObjective {
+  Frequency, ///< Fraction of sequences containing the motif
+  Enrichment ///< Observed over expected sequences under base composition
+};
+
+/**
+ * @brief Parse an objective name as accepted on the command line
+ * @param name frequency or enrichment
+ * @return Objective, or std::nullopt for unknown names
+ */
+[[nodiscard]] std::optional<DiscoveryObjective>
+parseDiscoveryObjective(std::string_view name);
+
+/**
+ * @brief Options of a de novo motif search
+ */
+struct DiscoveryOptions {
+  size_t top_k = 10; ///< Motifs to report
+
+  /// Positions allowed a code other than A/C/G/T
+  size_t max_degenerate = 2;
+
+  DiscoveryObjective objective = DiscoveryObjective::Enrichment;
+
+  /// Smallest fraction of sequences a reported motif must occur in
+  double min_frequency = 0.05;
+};
+
+/**
+ * @brief Motif found by MotifDiscovery
+ */
+struct DiscoveredMotif {
+  std::string pattern;
+  uint64_t sequences = 0; ///< Sequences containing the motif
+  double frequency = 0.0;
+  double expected = 0.0; ///< Sequences expected under base composition
+  double enrichment = 0.0;
+  double score = 0.0; ///< Value of the objective
+
+  bool operator==(const DiscoveredMotif &other) const = default;
+};
+
+/**
+ * @brief Branch-and-bound search for the best WINDOW_CODE_LENGTH-position
+ *        IUPAC motifs of a dataset
+ *
+ * Patterns are enumerated position by position, each position running from
+ * the specific bases to the degenerate codes, within the degenerate-position
+ * budget. A prefix bounds every pattern below it: the sequences holding an
+ * expansion of the prefix at a window start (summed from per-level prefix
+ * presence tables) cap the count of any completion. For enrichment, the
+ * best presence-to-probability ratio of the 8-mers below the prefix caps
+ * the ratio of any union of them, since expected counts are concave in the
+ * window probability. Children inherit the bounds of their parent.
+ * Subtrees whose bound falls below the current top-K score are pruned, and
+ * surviving patterns are counted exactly as the union of their expansions'
+ * postings in the KmerIndex.
+ *
+ * Expected counts assume independent positions with the dataset's base
+ * composition; a sequence with w windows contains a motif with per-window
+ * probability p with probability 1 - (1 - p)^w, taking w as the mean.
+ *
+ * Subtrees are distributed over parts (e.g. processes) round-robin and
+ * explored with OpenMP tasks, which idle threads take from the busy ones.
+ */
+class MotifDiscovery {
+public:
+  /**
+   * @brief Prepare the bound tables of a store
+   *
+   * The tables are sums over sequences, so callers may each count a part
+   * of the sequences and sum the counts with reduce (e.g. over processes);
+   * every caller then gets the tables of the whole store.
+   *
+   * @param store Pre-decoded sequences
+   * @param index Index built from the same store
+   * @param options Search options
+   * @param part Part of the sequences counted here, below parts
+   * @param parts Number of contiguous parts the sequences are split into
+   * @param reduce Sums the count buffer in place, if set
+   */
+  MotifDiscovery(const SequenceStore &store, const KmerIndex &index,
+                 const DiscoveryOptions &options, size_t part = 0,
+                 size_t parts = 1, CountReduction reduce = {});
+
+  /**
+   * @brief Search one part of the pattern space
+   * @param part Part to search, below parts
+   * @param parts Number of parts the space is split into
+   * @return Best options.top_k motifs of the part, best first
+   */
+  [[nodiscard]] std::vector<DiscoveredMotif> discover(size_t part = 0,
+                                                      size_t parts = 1) const;
+
+  /**
+   * @brief Encode a motif for transfer between processes
+   * @param pattern WINDOW_CODE_LENGTH valid IUPAC codes
+   * @return Base masks, the first position in the most significant nibble
+   */
+  [[nodiscard]] static uint32_t packPattern(std::string_view pattern);
+
+  /**
+   * @brief Score a packed pattern with a known sequence count
+   * @param packed Result of packPattern()
+   * @param sequences Sequences containing the pattern
+   * @return Motif with every field filled in
+   */
+  [[nodiscard]] DiscoveredMotif describe(uint32_t packed,
+                                         uint64_t sequences) const;
+
+  /**
+   * @brief Keep the best motifs of several searches
+   * @param motifs Motifs of every part
+   * @param top_k Motifs to keep
+   * @return Best motifs in the order used by discover()
+   */
+  [[nodiscard]] static std::vector<DiscoveredMotif>
+  best(std::vector<DiscoveredMotif> motifs, size_t top_k);
+
+  /**
+   * @brief Get number of search tree nodes visited by the last discover()
+   * @return Prefixes and patterns whose bound was computed
+   */
+  [[nodiscard]] uint64_t nodesVisited() const noexcept {
+    return nodes_visited_;
+  }
+
+  /**
+   * @brief Get number of patterns counted exactly by the last discover()
+   * @return Degenerate patterns whose postings were merged
+   */
+  [[nodiscard]] uint64_t patternsCounted() const noexcept {
+    return patterns_counted_;
+  }
+
+private:
+  // Pattern being extended; expansions are the concrete prefix codes
+  struct Node {
+    size_t depth = 0;
+    size_t degenerate = 0;
+    uint32_t packed = 0;
+    double probability = 1.0;
+    std::vector<uint16_t> expansions{0};
+    uint64_t count_bound = ~0ull; // Bounds of the parent, which hold here
+    double score_bound = std::numeric_limits<double>::infinity();
+  };
+
+  struct Search;
+
+  const KmerIndex &index_;
+  DiscoveryOptions options_;
+  uint64_t sequence_count_ = 0;
+  double mean_windows_ = 0.0;
+  std::array<double, 4> base_frequencies_{};
+  double rarest_base_ = 0.0;
+  /// Sequences with a window starting with each prefix, per prefix length
+  std::array<std::vector<uint64_t>, WINDOW_CODE_LENGTH + 1> prefix_presence_;
+  /// Largest presence over probability of the 8-mers below each prefix
+  std::array<std::vector<double>, WINDOW_CODE_LENGTH + 1> best_ratio_;
+  mutable uint64_t nodes_visited_ = 0;
+  mutable uint64_t patterns_counted_ = 0;
+
+  /**
+   * @brief Get the expected number of sequences containing a motif
+   * @param probability Per-window match probability
+   * @return Expected sequences
+   */
+  [[nodiscard]] double expectedSequences(double probability) const noexcept;
+
+  /**
+   * @brief Get the objective value of a count
+   * @param sequences Sequences containing the motif
+   * @param expected Expected sequences
+   * @return Score, higher is better
+   */
+  [[nodiscard]] double score(double sequences, double expected) const noexcept;
+
+  /**
+   * @brief Fix the next position of a pattern
+   * @param node Pattern prefix
+   * @param mask Base mask of the next position
+   * @return Prefix one position longer
+   */
+  [[nodiscard]] Node extend(const Node &node, uint8_t mask) const;
+
+  /**
+   * @brief Explore a subtree
+   * @param node Root of the subtree
+   * @param search Shared top-K state
+   */
+  void explore(const Node &node, Search &search) const;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "common.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Hit counts of a motif in foreground and background sequences
+ */
+struct MotifEnrichment {
+  std::string pattern;
+  uint64_t foreground_hits = 0; ///< Foreground sequences hit by the motif
+  uint64_t foreground_sequences = 0;
+  uint64_t background_hits = 0; ///< Background sequences hit by the motif
+  uint64_t background_sequences = 0;
+  double foreground_frequency = 0.0;
+  double background_frequency = 0.0;
+  /// Foreground over background frequency, infinite without background
+  /// hits, 0 without foreground hits
+  double fold_enrichment = 0.0;
+  /// Natural log of the one-sided Fisher exact test p-value
+  double log_p_value = 0.0;
+
+  bool operator==(const MotifEnrichment &other) const = default;
+
+  /**
+   * @brief Compute frequencies, fold enrichment and p-value of counts
+   * @param pattern Motif pattern
+   * @param foreground_hits Foreground sequences hit
+   * @param foreground_sequences Foreground sequences
+   * @param background_hits Background sequences hit
+   * @param background_sequences Background sequences
+   * @return Filled-in enrichment
+   */
+  [[nodiscard]] static MotifEnrichment
+  compute(std::string_view pattern, uint64_t foreground_hits,
+          uint64_t foreground_sequences, uint64_t background_hits,
+          uint64_t background_sequences);
+};
+
+/**
+ * @brief Log of the upper tail of a hypergeometric distribution
+ *
+ * P(X >= hits) for the hits among draws taken without replacement from
+ * population items of which successes are successes, i.e. the one-sided
+ * Fisher exact test of over-representation. Terms are summed in log space
+ * with the ratio of consecutive probabilities, starting from the log of
+ * the first term through lgamma, and stop once they no longer change the
+ * sum, so the result stays finite far below the smallest double.
+ *
+ * @param hits Observed successes among the draws
+ * @param draws Items drawn
+ * @param successes Successes in the population
+ * @param population Population size
+ * @return Natural log of the tail probability, 0 when hits is 0
+ */
+[[nodiscard]] double hypergeometricLogTail(uint64_t hits, uint64_t draws,
+                                           uint64_t successes,
+                                           uint64_t population) noexcept;
+
+/**
+ * @brief Format a probability given by its natural log
+ * @param log_probability Natural log of the probability
+ * @return Scientific notation such as 3.214e-512, without underflow
+ */
+[[nodiscard]] std::string formatLogProbability(double log_probability);
+
+} // namespace dna_motif
@@ -2,7 +2,10 @@
 
 #include "common.h"
 #include "concepts.h"
+#include "hit_bitsets.h"
 #include "iupac_codes.h"
+#include "motif_kernels.h"
+#include "sequence_store.h"
 #include <coroutine>
 #include <execution>
 #include <future>
@@ -48,6 +51,81 @@ template <typename T> struct Task {
   T get() { return std::move(handle.promise().result); }
 };
 
+/**
+ * @brief Scan kernel used by the SequenceStore overloads of MotifFinder
+ */
+enum class ScanKernel {
+  Auto,        ///< Pick a kernel from the panel size and store columns
+  Scalar,      ///< Character-by-character IUPAC matching
+  WindowCodes, ///< Window code lookups in a per-motif KmerTable
+  Prefilter,   ///< Selective-position PrefilterPlan, then verification
+  MotifMajor,  ///< Bit-sliced MotifPanel, every motif per window
+  Swar         ///< SwarMotif, 16 offsets per 64-bit step, no SIMD ISA
+};
+
+/**
+ * @brief Options of the SequenceStore overloads of MotifFinder
+ */
+struct ScanOptions {
+  /// Kernel to use; kernels a motif or store cannot support fall back to the
+  /// next simpler one
+  ScanKernel kernel = ScanKernel::Auto;
+
+  /// Also match the reverse complement of every motif; a sequence counts
+  /// once if either strand matches and each hit records its strand
+  bool both_strands = false;
+
+  /// Accept windows with up to this many mismatching positions (at most
+  /// MismatchMotif::MAX_MISMATCHES); above zero every motif is scanned with
+  /// the bit-sliced mismatch kernel and results carry per-level counts
+  size_t max_mismatches = 0;
+
+  /// Count every exact hit by window offset (see the PositionHistogram
+  /// overload of MotifFinder::findMotifs)
+  bool position_histogram = false;
+
+  /// Keep a bitset over sequences per motif after each store scan (see
+  /// MotifFinder::getHitBitsets); costs motifs x sequences bits, anything
+  /// built on top of it such as the co-occurrence matrix is opt-in
+  bool keep_hit_bitsets = false;
+
+  /// Build per-block window code presence maps (see
+  /// SequenceStore::buildZoneMaps) and skip blocks that cannot hold a hit
+  bool zone_maps = false;
+};
+
+/**
+ * @brief Sequence blocks tested against zone maps and skipped
+ */
+struct ZoneSkipStats {
+  size_t blocks_checked = 0; ///< Block tests, summed over motifs
+  size_t blocks_skipped = 0; ///< Tests sharing no window code with a motif
+
+  /**
+   * @brief Get the fraction of tested blocks that were skipped
+   * @return Skip rate, 0 if no block was tested
+   */
+  [[nodiscard]] double skipRate() const noexcept {
+    return blocks_checked > 0 ? static_cast<double>(blocks_skipped) /
+                                    static_cast<double>(blocks_checked)
+                              : 0.0;
+  }
+};
+
+/**
+ * @brief Parse a kernel name as accepted on the command line
+ * @param name One of auto, scalar, window-codes, prefilter, motif-major, swar
+ * @return Kernel, or std::nullopt for unknown names
+ */
+[[nodiscard]] std::optional<ScanKernel> parseScanKernel(std::string_view name);
+
+/**
+ * @brief Get the command line name of a kernel
+ * @param kernel Kernel
+ * @return Name accepted by parseScanKernel()
+ */
+[[nodiscard]] std::string_view scanKernelName(ScanKernel kernel) noexcept;
+
 /**
  * @brief Core motif finding algorithm
  *
@@ -64,6 +142,12 @@ public:
   MotifFinder(MotifFinder &&) = default;
   MotifFinder &operator=(MotifFinder &&) = default;
 
+  /// Smallest panel for which ScanKernel::Auto picks the motif-major kernel
+  static constexpr size_t MOTIF_MAJOR_MIN_PANEL = 16;
+
+  /// Largest prefilter pass rate for which ScanKernel::Auto prefilters
+  static constexpr double PREFILTER_MAX_PASS_RATE = 1.0 / 16.0;
+
   /**
    * @brief Find all motif matches in a set of sequences
    * @param sequences Vector of ChIP sequences to search
@@ -83,6 +167,60 @@ public:
   [[nodiscard]] MotifResult
   findSingleMotif(std::span<const ChIPSequence> sequences, const Motif &motif);
 
+  /**
+   * @brief Find all motif matches in a sequence store
+   *
+   * Panels of MOTIF_MAJOR_MIN_PANEL or more equal-length motifs are
+   * evaluated with the motif-major kernel in one pass over the sequences;
+   * smaller panels are scanned motif by motif. Both are parallelized with
+   * OpenMP and return results in motif order. Kernels are instantiated for
+   * common motif and sequence lengths (see withMotifLength() and
+   * withSequenceLength()) and fall back to runtime-length loops otherwise.
+   * Composite patterns such as TRTTKAC[2-6]HYTW are matched exactly with
+   * GappedMotif (see scanGapped()) and keep zero position histogram rows.
+   *
+   * @param store Pre-decoded sequences
+   * @param motifs Vector of motifs to find
+   * @return Vector of motif results with match counts and frequencies
+   */
+  [[nodiscard]] std::vector<MotifResult>
+  findMotifs(const SequenceStore &store, std::span<const Motif> motifs);
+
+  /**
+   * @brief Find all motif matches and count every hit by window offset
+   *
+   * Returns the same results as findMotifs(store, motifs). Motifs are
+   * grouped by length and each group is scanned with the motif-major
+   * kernel, which then visits every window instead of stopping at the first
+   * hit of each sequence; hits accumulate in per-thread counters that are
+   * summed at the end. A window matching on both strands counts once.
+   *
+   * @param store Pre-decoded sequences
+   * @param motifs Vector of motifs to find
+   * @param histogram Set to one row per motif over offsets 0 to longest
+   *                  sequence minus shortest motif length
+   * @return Vector of motif results with match counts and frequencies
+   * @throws std::invalid_argument with max_mismatches set; the histogram
+   *         counts exact hits only
+   */
+  [[nodiscard]] std::vector<MotifResult>
+  findMotifs(const SequenceStore &store, std::span<const Motif> motifs,
+             PositionHistogram &histogram);
+
+  /**
+   * @brief Find matches for a single motif in a sequence store
+   *
+   * Uses the window code column when it has been built, testing each
+   * window code against the motif's KmerTable instead of decoding the
+   * window characters.
+   *
+   * @param store Pre-decoded sequences
+   * @param motif Motif to find
+   * @return Motif result with matches
+   */
+  [[nodiscard]] MotifResult findSingleMotif(const SequenceStore &store,
+                                            const Motif &motif);
+
   /**
    * @brief Find matches for a single motif in a single sequence
    * @param sequence ChIP sequence to search
@@ -121,6 +259,77 @@ public:
    */
   void resetPerformanceStats() noexcept { performance_stats_.clear(); }
 
+  /**
+   * @brief Set the options used by the SequenceStore overloads
+   * @param options Scan options
+   */
+  void setScanOptions(const ScanOptions &options) noexcept {
+    options_ = options;
+  }
+
+  /**
+   * @brief Get the options used by the SequenceStore overloads
+   * @return Options set with setScanOptions()
+   */
+  [[nodiscard]] const ScanOptions &getScanOptions() const noexcept {
+    return options_;
+  }
+
+  /**
+   * @brief Select the kernel used by the SequenceStore overloads
+   * @param kernel Kernel to use; kernels a motif or store cannot support
+   *               fall back to the next simpler one
+   */
+  void setKernel(ScanKernel kernel) noexcept { options_.kernel = kernel; }
+
+  /**
+   * @brief Get the selected kernel
+   * @return Kernel set with setKernel()
+   */
+  [[nodiscard]] ScanKernel getKernel() const noexcept {
+    return options_.kernel;
+  }
+
+  /**
+   * @brief Get the hit bitsets of the last store scan
+   * @return One row per motif over the store's sequences, empty unless
+   *         ScanOptions::keep_hit_bitsets was set for that scan
+   */
+  [[nodiscard]] const HitBitsets &getHitBitsets() const noexcept {
+    return hit_bitsets_;
+  }
+
+  /**
+   * @brief Get the zone map statistics of the last store scan
+   * @return Blocks tested and skipped by findMotifs(store, motifs), all
+   *         zero unless ScanOptions::zone_maps was set
+   */
+  [[nodiscard]] const ZoneSkipStats &getZoneSkipStats() const noexcept {
+    return zone_stats_;
+  }
+
+  /**
+   * @brief Get the kernel an exact scan of one motif runs on
+   *
+   * Under ScanKernel::Auto, selective motifs and motifs without a window
+   * code table (other lengths than WINDOW_CODE_LENGTH) take the prefilter,
+   * or SWAR when built without AVX2; the others use window code lookups.
+   * Requested kernels a motif or store cannot support fall back as
+   * described in ScanOptions::kernel.
+   *
+   * @param store Store prepared with prepareStore()
+   * @param pattern Ungapped motif pattern
+   * @return Scalar, WindowCodes, Prefilter or Swar
+   */
+  [[nodiscard]] ScanKernel selectKernel(const SequenceStore &store,
+                                        std::string_view pattern) const;
+
+  /**
+   * @brief Build the store columns used by the selected kernel
+   * @param store Store to prepare
+   */
+  void prepareStore(SequenceStore &store) const;
+
   /**
    * @brief Find motifs asynchronously
    * @param sequences Vector of ChIP sequences
@@ -144,6 +353,17 @@ public:
 private:
   const IUPACCodes &iupac_codes_;
   std::unordered_map<std::string, double> performance_stats_;
+  ScanOptions options_;
+  HitBitsets hit_bitsets_;
+  mutable ZoneSkipStats zone_stats_; // Updated atomically by the scans
+
+  /**
+   * @brief Record the hit bitsets of a store scan if requested
+   * @param results Scan results, one per motif
+   * @param sequence_count Number of sequences scanned
+   */
+  void keepHitBitsets(std::span<const MotifResult> results,
+                      size_t sequence_count);
 
   /**
    * @brief Check if a sequence segment matches a motif
@@ -164,6 +384,180 @@ private:
   void updatePerformanceStats(std::string_view operation,
                               double time_seconds) noexcept;
 
+  /**
+   * @brief Scan a store for one motif without touching statistics
+   *
+   * Gapped motifs and mismatch scans use their own kernels, everything
+   * else the kernel picked by selectKernel().
+   *
+   * @param store Pre-decoded sequences
+   * @param motif Motif to find
+   * @return Motif result with first match per sequence
+   */
+  [[nodiscard]] MotifResult scanSingleMotif(const SequenceStore &store,
+                                            const Motif &motif) const;
+
+  /**
+   * @brief Compile the window code table of a motif
+   * @param pattern Motif pattern
+   * @param reverse Reverse complement of pattern, empty for forward only
+   * @return Table accepting windows of either strand, or std::nullopt if
+   *         a strand has no table (see KmerTable::compile)
+   */
+  [[nodiscard]] std::optional<KmerTable>
+  windowTable(std::string_view pattern, std::string_view reverse) const;
+
+  /**
+   * @brief Find the zone map blocks that may hold a hit of a motif
+   *
+   * Every hit starts with a window accepted by the KmerTable of the first
+   * WINDOW_CODE_LENGTH positions of the motif (or of its reverse
+   * complement), so a block whose zone map shares no code with that table
+   * is skipped. Adds the tests to the zone skip statistics.
+   *
+   * @param store Pre-decoded sequences
+   * @param pattern Motif pattern
+   * @param reverse Reverse complement of pattern, empty for forward only
+   * @return One flag per block, nonzero if the block may hold a hit; empty
+   *         if the store has no zone maps or the motif is too short
+   */
+  [[nodiscard]] std::vector<uint8_t>
+  liveZones(const SequenceStore &store, std::string_view pattern,
+            std::string_view reverse) const;
+
+  /**
+   * @brief Scan a store for one motif with a prefilter plan
+   * @param store Pre-decoded sequences
+   * @param motif Motif to find
+   * @param plan Prefilter plan compiled from motif
+   * @param reverse Plan compiled from the reverse complement, nullptr to
+   *                scan the forward strand only
+   * @param live Result of liveZones(); clean sequences of other blocks are
+   *             skipped
+   * @return Motif result with first match per sequence
+   */
+  [[nodiscard]] MotifResult
+  scanPrefiltered(const SequenceStore &store, const Motif &motif,
+                  const PrefilterPlan &plan, const PrefilterPlan *reverse,
+                  std::span<const uint8_t> live) const;
+
+  /**
+   * @brief Scan a store for one motif with the SWAR kernel
+   * @param store Pre-decoded sequences with the nibble column built
+   * @param motif Motif to find
+   * @param swar SWAR form of motif
+   * @param reverse SWAR form of the reverse complement, nullptr to scan the
+   *                forward strand only
+   * @param live Result of liveZones(); clean sequences of other blocks are
+   *             skipped
+   * @return Motif result with first match per sequence
+   * @tparam Length Motif length, or DYNAMIC_LENGTH
+   * @tparam SequenceLength Common sequence length, or DYNAMIC_LENGTH
+   */
+  template <size_t Length, size_t SequenceLength>
+  [[nodiscard]] MotifResult scanSwar(const SequenceStore &store,
+                                     const Motif &motif, const SwarMotif &swar,
+                                     const SwarMotif *reverse,
+                                     std::span<const uint8_t> live) const;
+
+  /**
+   * @brief Scan a store for one composite motif
+   *
+   * Sequences are split into runs of A/C/G/T, since no window spanning
+   * another character can match, and each run is matched with
+   * GappedMotif::matchRun().
+   *
+   * @param store Pre-decoded sequences
+   * @param motif Motif to find
+   * @param gapped Compiled form of motif
+   * @param reverse Compiled opposite strand, nullptr to scan the forward
+   *                strand only
+   * @return Motif result with first match per sequence, the matched text
+   *         including the spacer
+   */
+  [[nodiscard]] MotifResult scanGapped(const SequenceStore &store,
+                                       const Motif &motif,
+                                       const GappedMotif &gapped,
+                                       const GappedMotif *reverse) const;
+
+  /**
+   * @brief Scan a store for one motif allowing mismatches
+   *
+   * Reports the first window with the fewest mismatches per sequence and
+   * counts sequences per best mismatch level.
+   *
+   * @param store Pre-decoded sequences
+   * @param motif Motif to find
+   * @param counter Mismatch form of motif
+   * @param reverse Mismatch form of the reverse complement, nullptr to scan
+   *                the forward strand only
+   * @return Motif result with best match per sequence
+   * @tparam Length Motif length, or DYNAMIC_LENGTH
+   */
+  template <size_t Length>
+  [[nodiscard]] MotifResult scanMismatches(const SequenceStore &store,
+                                           const Motif &motif,
+                                           const MismatchMotif &counter,
+                                           const MismatchMotif *reverse) const;
+
+  /**
+   * @brief Scan a store for every motif of a panel in one pass
+   * @param store Pre-decoded sequences
+   * @param motifs Motifs compiled into panel
+   * @param panel Motif-major layout of motifs, with the reverse strand when
+   *              both strands are scanned
+   * @param histogram If set, every window is scanned and each hit of motif
+   *                  m is added to histogram row rows[m]
+   * @param rows Histogram row of each motif
+   * @return Motif results in motif order
+   * @tparam Length Motif length, or DYNAMIC_LENGTH
+   * @tparam SequenceLength Common sequence length, or DYNAMIC_LENGTH
+   */
+  template <size_t Length, size_t SequenceLength>
+  [[nodiscard]] std::vector<MotifResult>
+  scanMotifMajor(const SequenceStore &store, std::span<const Motif> motifs,
+                 const MotifPanel &panel,
+                 PositionHistogram *histogram = nullptr,
+                 std::span<const size_t> rows = {}) const;
+
+  /**
+   * @brief Count every character-path hit of each motif by offset
+   * @param text Sequence characters
+   * @param motifs Motifs to match
+   * @param reverse_patterns Reverse complement of each motif, empty for the
+   *                         forward strand only
+   * @param positions Counts as [motif * offsets + offset]
+   * @param offsets Offsets per motif, at least the window count of text
+   */
+  void countPositions(std::string_view text, std::span<const Motif> motifs,
+                      std::span<const std::string> reverse_patterns,
+                      std::span<uint64_t> positions, size_t offsets) const;
+
+  /**
+   * @brief Append the first character-path match of a motif, if any
+   * @param result Result to update
+   * @param sequence Sequence to search
+   * @param pattern Motif pattern
+   * @param reverse Reverse complement of pattern, empty to search the
+   *                forward strand only
+   * @param sequence_index Index of sequence in the collection
+   */
+  void appendFirstMatch(MotifResult &result, const ChIPSequence &sequence,
+                        std::string_view pattern, std::string_view reverse,
+                        size_t sequence_index) const;
+
+  /**
+   * @brief Determine the strand of a hit found by a both-strand kernel
+   * @param text Sequence text
+   * @param pattern Motif pattern
+   * @param reverse Reverse complement of pattern, empty for forward only
+   * @param position Window start
+   * @return Strand(s) whose pattern matches the window
+   */
+  [[nodiscard]] Strand strandAt(std::string_view text, std::string_view pattern,
+                                std::string_view reverse,
+                                size_t position) const noexcept;
+
   /**
    * @brief Process a single motif with timing
    * @param sequences Sequences to search
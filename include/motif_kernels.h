@@ -0,0 +1,629 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dna_motif {
+
+/// Template argument selecting the runtime-length form of a kernel
+inline constexpr size_t DYNAMIC_LENGTH = 0;
+
+/**
+ * @brief Call a kernel with its motif length as a compile-time constant
+ *
+ * Lengths with a dedicated instantiation (6, 8, 10, 12, 16 and 20) are
+ * passed as std::integral_constant so loops over motif positions unroll
+ * completely; every other length gets DYNAMIC_LENGTH.
+ *
+ * @param length Motif length
+ * @param kernel Callable taking a std::integral_constant<size_t, N>
+ * @return Result of kernel
+ */
+template <typename Kernel>
+decltype(auto) withMotifLength(size_t length, Kernel &&kernel) {
+  switch (length) {
+  case 6:
+    return kernel(std::integral_constant<size_t, 6>{});
+  case 8:
+    return kernel(std::integral_constant<size_t, 8>{});
+  case 10:
+    return kernel(std::integral_constant<size_t, 10>{});
+  case 12:
+    return kernel(std::integral_constant<size_t, 12>{});
+  case 16:
+    return kernel(std::integral_constant<size_t, 16>{});
+  case 20:
+    return kernel(std::integral_constant<size_t, 20>{});
+  default:
+    return kernel(std::integral_constant<size_t, DYNAMIC_LENGTH>{});
+  }
+}
+
+/**
+ * @brief Call a kernel with the common sequence length as a constant
+ *
+ * Fixed-length peak sets (40, 100, 200 and 500 bp) get a constant window
+ * count per sequence; mixed or other lengths get DYNAMIC_LENGTH.
+ *
+ * @param length Length shared by every sequence, 0 if they differ
+ * @param kernel Callable taking a std::integral_constant<size_t, N>
+ * @return Result of kernel
+ */
+template <typename Kernel>
+decltype(auto) withSequenceLength(size_t length, Kernel &&kernel) {
+  switch (length) {
+  case 40:
+    return kernel(std::integral_constant<size_t, 40>{});
+  case 100:
+    return kernel(std::integral_constant<size_t, 100>{});
+  case 200:
+    return kernel(std::integral_constant<size_t, 200>{});
+  case 500:
+    return kernel(std::integral_constant<size_t, 500>{});
+  default:
+    return kernel(std::integral_constant<size_t, DYNAMIC_LENGTH>{});
+  }
+}
+
+/**
+ * @brief Build a pshufb lookup table for a nucleotide mask
+ * @param mask Accepted nucleotides, bit encodeNucleotide(n) per nucleotide
+ * @return Byte b is 0xFF when nucleotide code b is accepted
+ */
+[[nodiscard]] constexpr uint64_t acceptLut(uint8_t mask) noexcept {
+  uint64_t lut = 0;
+  for (unsigned base = 0; base < 4; ++base) {
+    if ((mask >> base) & 1u) {
+      lut |= 0xFFull << (8 * base);
+    }
+  }
+  return lut;
+}
+
+/**
+ * @brief Evaluate a nucleotide mask at 64 consecutive positions
+ * @param column Nucleotide codes, 64 readable
+ * @param mask Accepted nucleotides
+ * @param lut acceptLut(mask)
+ * @return Bit t set when column[t] is accepted
+ */
+[[nodiscard]] inline uint64_t acceptedOffsets(const uint8_t *column,
+                                              uint8_t mask,
+                                              uint64_t lut) noexcept {
+#if defined(__AVX2__)
+  (void)mask;
+  const __m256i table = _mm256_broadcastsi128_si256(
+      _mm_cvtsi64_si128(static_cast<long long>(lut)));
+  const auto lookup = [&](const uint8_t *at) {
+    const __m256i codes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+    return static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_shuffle_epi8(table, codes)));
+  };
+  return static_cast<uint64_t>(lookup(column)) |
+         (static_cast<uint64_t>(lookup(column + 32)) << 32);
+#else
+  (void)lut;
+  uint64_t accepted = 0;
+  for (size_t t = 0; t < 64; ++t) {
+    accepted |= static_cast<uint64_t>((mask >> column[t]) & 1u) << t;
+  }
+  return accepted;
+#endif
+}
+
+/**
+ * @brief Membership table over all WINDOW_CODE_LENGTH-mer window codes
+ *
+ * One bit per possible window code (see SequenceStore::buildWindowCodes),
+ * set when the window is accepted by the motif it was compiled from.
+ */
+class KmerTable {
+public:
+  KmerTable() : bits_(WINDOW_CODE_SPACE / 64, 0) {}
+
+  /**
+   * @brief Compile a motif pattern into a membership table
+   * @param pattern Motif pattern of length WINDOW_CODE_LENGTH
+   * @param iupac_codes IUPAC code table
+   * @return Table, or std::nullopt if the pattern has the wrong length or
+   *         contains invalid IUPAC codes
+   */
+  [[nodiscard]] static std::optional<KmerTable>
+  compile(std::string_view pattern, const IUPACCodes &iupac_codes);
+
+  /**
+   * @brief Check whether a window code is accepted
+   * @param code Window code
+   * @return true if the window matches the motif
+   */
+  [[nodiscard]] bool contains(uint16_t code) const noexcept {
+    return (bits_[code >> 6] >> (code & 63)) & 1u;
+  }
+
+  /**
+   * @brief Accept every window accepted by another table as well
+   * @param other Table to merge, e.g. compiled from the reverse complement
+   */
+  void merge(const KmerTable &other) noexcept {
+    std::ranges::transform(bits_, other.bits_, bits_.begin(), std::bit_or<>());
+  }
+
+  /**
+   * @brief Get number of accepted window codes
+   * @return Number of set bits
+   */
+  [[nodiscard]] size_t cardinality() const noexcept;
+
+  /**
+   * @brief Get raw table words
+   * @return WINDOW_CODE_SPACE / 64 words, bit (code & 63) of word code >> 6
+   */
+  [[nodiscard]] std::span<const uint64_t> words() const noexcept {
+    return bits_;
+  }
+
+private:
+  std::vector<uint64_t> bits_;
+};
+
+/**
+ * @brief Motif-major layout of a panel of equal-length motifs
+ *
+ * For every motif position p and nucleotide code b the panel keeps a row of
+ * bits over motifs: bit i of row (p, b) is set when motif i accepts b at p.
+ * A window is then evaluated against every motif at once by AND-ing the
+ * rows selected by its nucleotides, i.e. one 64-bit AND covers 64 motifs and
+ * one AVX2 AND covers 256.
+ *
+ * A panel compiled for both strands carries a second bitset over the
+ * reverse complements of the motifs, laid out directly after the forward
+ * one in every row, so both strands are evaluated by the same ANDs.
+ */
+class MotifPanel {
+public:
+  MotifPanel() = default;
+
+  /**
+   * @brief Compile motifs into the motif-major layout
+   * @param motifs Motifs sharing one pattern length
+   * @param iupac_codes IUPAC code table
+   * @param both_strands Also compile the reverse complement of every motif
+   * @return Panel, or std::nullopt if the motifs are empty, differ in
+   *         length or contain invalid IUPAC codes
+   */
+  [[nodiscard]] static std::optional<MotifPanel>
+  compile(std::span<const Motif> motifs, const IUPACCodes &iupac_codes,
+          bool both_strands = false);
+
+  /**
+   * @brief Get number of motifs in the panel
+   * @return Motif count
+   */
+  [[nodiscard]] size_t motifCount() const noexcept { return motif_count_; }
+
+  /**
+   * @brief Get common pattern length
+   * @return Motif length
+   */
+  [[nodiscard]] size_t motifLength() const noexcept { return motif_length_; }
+
+  /**
+   * @brief Get number of 64-bit words in a motif bitset
+   * @return Words per strand
+   */
+  [[nodiscard]] size_t wordCount() const noexcept { return word_count_; }
+
+  /**
+   * @brief Get number of strands compiled into the panel
+   * @return 2 if compiled for both strands, 1 otherwise
+   */
+  [[nodiscard]] size_t strandCount() const noexcept { return strand_count_; }
+
+  /**
+   * @brief Evaluate one window against every motif
+   * @param bases Nucleotide codes starting at the window, at least
+   *              motifLength() long
+   * @param hits Output bitsets over motifs, wordCount() words per strand,
+   *             forward strand first
+   * @tparam Length motifLength() as a constant, or DYNAMIC_LENGTH
+   */
+  template <size_t Length = DYNAMIC_LENGTH>
+  void matchWindow(const uint8_t *bases, uint64_t *hits) const noexcept {
+    const size_t length = Length == DYNAMIC_LENGTH ? motif_length_ : Length;
+    const size_t row_words = word_count_ * strand_count_;
+    const uint64_t *first = row(0, bases[0]);
+    size_t k = 0;
+#if defined(__AVX2__)
+    for (; k + 4 <= row_words; k += 4) {
+      __m256i acc =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + k));
+      for (size_t p = 1; p < length; ++p) {
+        acc = _mm256_and_si256(
+            acc, _mm256_loadu_si256(
+                     reinterpret_cast<const __m256i *>(row(p, bases[p]) + k)));
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(hits + k), acc);
+    }
+#endif
+    for (; k < row_words; ++k) {
+      uint64_t acc = first[k];
+      for (size_t p = 1; p < length; ++p) {
+        acc &= row(p, bases[p])[k];
+      }
+      hits[k] = acc;
+    }
+  }
+
+private:
+  size_t motif_count_ = 0;
+  size_t motif_length_ = 0;
+  size_t word_count_ = 0;
+  size_t strand_count_ = 1;
+  std::vector<uint64_t> rows_;
+
+  [[nodiscard]] const uint64_t *row(size_t position,
+                                    uint8_t base) const noexcept {
+    return rows_.data() + (position * 4 + base) * word_count_ * strand_count_;
+  }
+};
+
+/**
+ * @brief Two-stage evaluation plan for one motif
+ *
+ * The one or two most selective positions (fewest accepted nucleotides) form
+ * a prefilter that is evaluated for 64 consecutive offsets at once; the
+ * surviving candidates are verified on the remaining positions in
+ * increasing selectivity order, so most windows are rejected early.
+ */
+class PrefilterPlan {
+public:
+  PrefilterPlan() = default;
+
+  /**
+   * @brief Compile a motif into a prefilter plan
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @return Plan, or std::nullopt for empty, invalid or patterns longer
+   *         than MAX_MOTIF_LENGTH
+   */
+  [[nodiscard]] static std::optional<PrefilterPlan>
+  compile(std::string_view pattern, const IUPACCodes &iupac_codes);
+
+  /**
+   * @brief Get motif length
+   * @return Pattern length the plan was compiled from
+   */
+  [[nodiscard]] size_t motifLength() const noexcept { return masks_.size(); }
+
+  /**
+   * @brief Get the positions checked by the prefilter
+   * @return One or two motif positions
+   */
+  [[nodiscard]] std::span<const uint8_t> filterPositions() const noexcept {
+    return {order_.data(), filter_count_};
+  }
+
+  /**
+   * @brief Get the fraction of uniform random windows passing the prefilter
+   * @return Product of accepted-nucleotide fractions at filter positions
+   */
+  [[nodiscard]] double passRate() const noexcept;
+
+  /**
+   * @brief Evaluate the prefilter at 64 consecutive offsets
+   * @param bases Nucleotide codes; 64 + motifLength() - 1 codes readable
+   * @return Bit t set when offset t passes the prefilter
+   */
+  [[nodiscard]] uint64_t candidates(const uint8_t *bases) const noexcept;
+
+  /**
+   * @brief Check the non-filter positions of a candidate window
+   * @param bases Nucleotide codes starting at the window
+   * @return true if the whole window matches the motif
+   */
+  [[nodiscard]] bool verify(const uint8_t *bases) const noexcept {
+    for (size_t k = filter_count_; k < order_.size(); ++k) {
+      const size_t p = order_[k];
+      if (((masks_[p] >> bases[p]) & 1u) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> masks_;
+  std::vector<uint8_t> order_;
+  size_t filter_count_ = 0;
+  std::array<uint64_t, 2> filter_luts_{};
+};
+
+/**
+ * @brief SIMD-within-a-register form of a motif
+ *
+ * Evaluates a motif at 16 consecutive offsets per step using only 64-bit
+ * integer shifts and ANDs over the one-hot nibble column
+ * (SequenceStore::buildBaseNibbles). Each motif position's nucleotide mask
+ * is replicated into all 16 nibbles; a window survives a position when its
+ * nibble of (nucleotides & mask) is non-zero.
+ */
+class SwarMotif {
+public:
+  /// Offsets evaluated per matchBlock() call
+  static constexpr size_t LANES = 16;
+
+  SwarMotif() = default;
+
+  /**
+   * @brief Compile a motif into its SWAR form
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @return SWAR motif, or std::nullopt for empty or invalid patterns
+   */
+  [[nodiscard]] static std::optional<SwarMotif>
+  compile(std::string_view pattern, const IUPACCodes &iupac_codes);
+
+  /**
+   * @brief Get motif length
+   * @return Pattern length the motif was compiled from
+   */
+  [[nodiscard]] size_t motifLength() const noexcept {
+    return replicated_.size();
+  }
+
+  /**
+   * @brief Evaluate windows [first, first + LANES) of a sequence
+   * @param words One-hot nibble words of the sequence
+   * @param first First window offset
+   * @return Bit t set when the window at first + t matches
+   * @tparam Length motifLength() as a constant, or DYNAMIC_LENGTH
+   */
+  template <size_t Length = DYNAMIC_LENGTH>
+  [[nodiscard]] uint16_t matchBlock(std::span<const uint64_t> words,
+                                    size_t first) const noexcept {
+    constexpr uint64_t nibble_lsb = 0x1111111111111111ull;
+    const size_t length =
+        Length == DYNAMIC_LENGTH ? replicated_.size() : Length;
+    uint64_t alive = nibble_lsb;
+
+    for (size_t p = 0; p < length && alive != 0; ++p) {
+      // Nibbles of nucleotides first + p .. first + p + 15
+      const size_t start = first + p;
+      const size_t word = start / 16;
+      const unsigned shift = static_cast<unsigned>(4 * (start % 16));
+      const uint64_t lo = word < words.size() ? words[word] : 0;
+      const uint64_t hi = word + 1 < words.size() ? words[word + 1] : 0;
+      const uint64_t lanes =
+          shift == 0 ? lo : (lo >> shift) | (hi << (64 - shift));
+
+      const uint64_t accepted = lanes & replicated_[p];
+      alive &=
+          (accepted | (accepted >> 1) | (accepted >> 2) | (accepted >> 3)) &
+          nibble_lsb;
+    }
+
+    return compressNibbles(alive);
+  }
+
+private:
+  std::vector<uint64_t> replicated_;
+
+  /**
+   * @brief Gather bit 0 of every nibble into 16 consecutive bits
+   * @param alive Word with only nibble bit 0 set
+   * @return Bit t set when nibble t was set
+   */
+  [[nodiscard]] static uint16_t compressNibbles(uint64_t alive) noexcept;
+};
+
+/**
+ * @brief Bit-parallel k-mismatch form of a motif
+ *
+ * Counts mismatching positions for 64 consecutive offsets at once: every
+ * motif position contributes a 64-bit mismatch mask that is added into
+ * bit-sliced counters (one bit plane per counter bit) with half-adder
+ * logic, so no neighbour patterns are ever enumerated.
+ */
+class MismatchMotif {
+public:
+  /// Largest supported mismatch budget
+  static constexpr size_t MAX_MISMATCHES = 2;
+
+  /// Bit t of entry k is set when offset t has at most k mismatches
+  using Levels = std::array<uint64_t, MAX_MISMATCHES + 1>;
+
+  MismatchMotif() = default;
+
+  /**
+   * @brief Compile a motif for mismatch counting
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @param max_mismatches Mismatch budget, at most MAX_MISMATCHES
+   * @return Compiled motif, or std::nullopt for empty, invalid or patterns
+   *         longer than MAX_MOTIF_LENGTH and budgets above MAX_MISMATCHES
+   */
+  [[nodiscard]] static std::optional<MismatchMotif>
+  compile(std::string_view pattern, const IUPACCodes &iupac_codes,
+          size_t max_mismatches);
+
+  /**
+   * @brief Get motif length
+   * @return Pattern length the motif was compiled from
+   */
+  [[nodiscard]] size_t motifLength() const noexcept { return masks_.size(); }
+
+  /**
+   * @brief Get the mismatch budget
+   * @return Largest mismatch count reported by countMismatches()
+   */
+  [[nodiscard]] size_t maxMismatches() const noexcept {
+    return max_mismatches_;
+  }
+
+  /**
+   * @brief Count mismatches at 64 consecutive offsets
+   * @param bases Nucleotide codes; 64 + motifLength() - 1 codes readable
+   * @return Offsets within each mismatch level up to maxMismatches(); higher
+   *         levels are left empty
+   * @tparam Length motifLength() as a constant, or DYNAMIC_LENGTH
+   */
+  template <size_t Length = DYNAMIC_LENGTH>
+  [[nodiscard]] Levels countMismatches(const uint8_t *bases) const noexcept {
+    const size_t length = Length == DYNAMIC_LENGTH ? masks_.size() : Length;
+
+    // Saturating bit-sliced counter per offset: value ones + 2 * twos, with
+    // four or more mismatches collapsed into many
+    uint64_t ones = 0;
+    uint64_t twos = 0;
+    uint64_t many = 0;
+
+    for (size_t p = 0; p < length; ++p) {
+      const uint64_t mismatch =
+          ~acceptedOffsets(bases + p, masks_[p], luts_[p]);
+
+      const uint64_t carry = ones & mismatch;
+      ones ^= mismatch;
+      many |= twos & carry;
+      twos ^= carry;
+
+      // Stop once every offset exceeds the mismatch budget
+      if (overBudget(ones, twos, many) == ~0ull) {
+        break;
+      }
+    }
+
+    return levels(ones, twos, many);
+  }
+
+private:
+  std::vector<uint8_t> masks_;
+  std::vector<uint64_t> luts_;
+  size_t max_mismatches_ = 0;
+
+  /**
+   * @brief Get the offsets whose counter exceeds the mismatch budget
+   * @param ones Counter bit plane of weight 1
+   * @param twos Counter bit plane of weight 2
+   * @param many Offsets with four or more mismatches
+   * @return Bit t set when offset t has more than maxMismatches()
+   */
+  [[nodiscard]] uint64_t overBudget(uint64_t ones, uint64_t twos,
+                                    uint64_t many) const noexcept {
+    switch (max_mismatches_) {
+    case 0:
+      return ones | twos | many;
+    case 1:
+      return twos | many;
+    default:
+      return (ones & twos) | many;
+    }
+  }
+
+  /**
+   * @brief Convert counter bit planes into cumulative mismatch levels
+   * @param ones Counter bit plane of weight 1
+   * @param twos Counter bit plane of weight 2
+   * @param many Offsets with four or more mismatches
+   * @return Offsets within each level up to maxMismatches()
+   */
+  [[nodiscard]] Levels levels(uint64_t ones, uint64_t twos,
+                              uint64_t many) const noexcept;
+};
+
+/**
+ * @brief Composite motif of two half-sites separated by a variable spacer
+ *
+ * Written LEFT[min-max]RIGHT or LEFT[n]RIGHT, e.g. TRTTKAC[2-6]HYTW for a
+ * dimer: a window matches when LEFT matches at its start and RIGHT matches
+ * after min to max arbitrary nucleotides. Each half-site is evaluated once
+ * per run of nucleotides into a hit mask over offsets, and the composite
+ * mask is the left mask ANDed with the right mask shifted by every allowed
+ * spacer, so the spacer range is never expanded into fixed-length motifs.
+ */
+class GappedMotif {
+public:
+  /// Longest spacer accepted by compile()
+  static constexpr size_t MAX_SPACER = 64;
+
+  GappedMotif() = default;
+
+  /**
+   * @brief Check whether a pattern uses the composite syntax
+   * @param pattern Motif pattern
+   * @return true if the pattern contains a spacer
+   */
+  [[nodiscard]] static bool isGapped(std::string_view pattern) noexcept {
+    return pattern.find('[') != std::string_view::npos;
+  }
+
+  /**
+   * @brief Compile a composite pattern
+   * @param pattern LEFT[min-max]RIGHT or LEFT[n]RIGHT
+   * @param iupac_codes IUPAC code table
+   * @return Compiled motif, or std::nullopt for malformed patterns, invalid
+   *         codes, empty or over-long half-sites and spacers above
+   *         MAX_SPACER
+   */
+  [[nodiscard]] static std::optional<GappedMotif>
+  compile(std::string_view pattern, const IUPACCodes &iupac_codes);
+
+  /**
+   * @brief Get the composite pattern of the opposite strand
+   * @param iupac_codes IUPAC code table
+   * @return Reverse complement of RIGHT, the spacer, then of LEFT
+   */
+  [[nodiscard]] std::string
+  reverseComplement(const IUPACCodes &iupac_codes) const;
+
+  /**
+   * @brief Get the length of the shortest composite window
+   * @return Both half-sites plus the shortest spacer
+   */
+  [[nodiscard]] size_t minLength() const noexcept {
+    return left_.size() + min_spacer_ + right_.size();
+  }
+
+  /**
+   * @brief Get the spacer range
+   * @return Shortest and longest spacer
+   */
+  [[nodiscard]] std::pair<size_t, size_t> spacer() const noexcept {
+    return {min_spacer_, max_spacer_};
+  }
+
+  /**
+   * @brief Find every composite window in a run of nucleotide codes
+   * @param bases Codes of the run; 64 + longest half-site - 1 codes
+   *              readable past every offset of the run
+   * @param length Run length
+   * @param hits Set to one bit per offset, bit t of word t / 64 set when a
+   *             composite window starts at t and fits in the run
+   * @param scratch Buffer reused for the right half-site mask
+   */
+  void matchRun(const uint8_t *bases, size_t length,
+                std::vector<uint64_t> &hits,
+                std::vector<uint64_t> &scratch) const;
+
+  /**
+   * @brief Get the spacer of a composite window
+   * @param bases Nucleotide codes starting at the window
+   * @return Shortest spacer after which RIGHT matches
+   */
+  [[nodiscard]] size_t spacerAt(const uint8_t *bases) const noexcept;
+
+private:
+  std::string left_;
+  std::string right_;
+  size_t min_spacer_ = 0;
+  size_t max_spacer_ = 0;
+  std::vector<uint8_t> right_masks_;
+  MismatchMotif left_counter_;  // Exact: no mismatch budget
+  MismatchMotif right_counter_; // Exact: no mismatch budget
+};
+
+} // namespace dna_motif
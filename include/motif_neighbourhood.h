@@ -0,0 +1,152 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Options of the single-position neighbourhood of input motifs
+ */
+struct NeighbourhoodOptions {
+  bool enabled = false;
+
+  /// Hill-climbing moves per motif, 0 to only evaluate the seed's
+  /// neighbours
+  size_t max_steps = 0;
+
+  /// Smallest fraction of sequences a hill-climbing move may lead to
+  double min_frequency = 0.05;
+
+  /// Count a sequence if either strand contains the variant
+  bool both_strands = false;
+};
+
+/**
+ * @brief Motif differing from a seed in at most one position
+ */
+struct MotifVariant {
+  std::string pattern;
+  size_t position = 0; ///< Changed position
+  char from = 0;       ///< Code replaced at position, 0 for the seed itself
+  char to = 0;         ///< Code put at position, 0 for the seed itself
+  uint64_t sequences = 0;
+  double expected = 0.0; ///< Sequences expected under base composition
+  double enrichment = 0.0;
+
+  bool operator==(const MotifVariant &other) const = default;
+};
+
+/**
+ * @brief Neighbourhood and hill-climbing trail of one input motif
+ */
+struct MotifRefinement {
+  std::string seed;
+  /// Every neighbour of the seed, by position then added or removed base;
+  /// empty for patterns that cannot be refined
+  std::vector<MotifVariant> neighbours;
+  /// Seed, then every move, ending at a local optimum of the enrichment or
+  /// after NeighbourhoodOptions::max_steps moves
+  std::vector<MotifVariant> trail;
+};
+
+/**
+ * @brief Counts of every single-position variant of motifs in one scan
+ *
+ * The neighbours of a motif relax or tighten one position by adding a base
+ * to its IUPAC code or removing one. Every sequence is turned once into
+ * per-base position bitsets; a motif's per-position acceptance masks are
+ * word-shifted out of them for 64 window offsets at a time, and prefix and
+ * suffix ANDs give, for each position, the windows whose other positions
+ * all match. The bases seen at the position in those windows form a 4-bit
+ * mask, and a variant is in the sequence exactly when its code shares a
+ * base with that mask, so a 16-bin histogram per position yields the
+ * count of every variant of the position. All motifs share the per-base
+ * bitsets of a sequence, and hill climbing rescans only the motifs still
+ * moving.
+ *
+ * Expected counts assume independent positions with the base composition
+ * of the sequences, and a sequence with w windows containing a motif of
+ * per-window probability p with probability 1 - (1 - p)^w, taking w as
+ * the mean (see MotifDiscovery).
+ */
+class MotifNeighbourhood {
+public:
+  /**
+   * @brief Count the background of a store
+   * @param store Pre-decoded sequences, e.g. the local share of a process
+   * @param iupac_codes IUPAC code table
+   * @param options Neighbourhood options
+   * @param reduce Sums counts of every process, none for a single store;
+   *               called the same number of times on every process
+   */
+  MotifNeighbourhood(const SequenceStore &store, const IUPACCodes &iupac_codes,
+                     const NeighbourhoodOptions &options,
+                     CountReduction reduce = {});
+
+  /**
+   * @brief Evaluate the neighbours of every motif and climb from it
+   * @param motifs Seed motifs; gapped, empty, over-long or invalid patterns
+   *               get an empty refinement
+   * @return One refinement per motif, in motif order
+   */
+  [[nodiscard]] std::vector<MotifRefinement>
+  refine(std::span<const Motif> motifs) const;
+
+  /**
+   * @brief Get number of sequences of all processes
+   * @return Sequences the counts are taken over
+   */
+  [[nodiscard]] uint64_t sequenceCount() const noexcept {
+    return sequence_count_;
+  }
+
+  /**
+   * @brief Get number of passes over the sequences by the last refine()
+   * @return One for the seeds plus one per round of moves
+   */
+  [[nodiscard]] size_t scans() const noexcept { return scans_; }
+
+private:
+  // Per-position base masks of a pattern
+  using Masks = std::vector<uint8_t>;
+
+  const SequenceStore &store_;
+  const IUPACCodes &iupac_codes_;
+  NeighbourhoodOptions options_;
+  CountReduction reduce_;
+  uint64_t sequence_count_ = 0;
+  std::array<double, 4> base_frequencies_{};
+  std::array<char, 16> codes_{}; ///< IUPAC code of every base mask
+  /// Windows of A/C/G/T only of every motif length, summed over sequences
+  std::array<uint64_t, MAX_MOTIF_LENGTH + 1> windows_{};
+  mutable size_t scans_ = 0;
+
+  /**
+   * @brief Count the seen-base histograms of several patterns in one pass
+   * @param patterns Non-empty masks of each pattern
+   * @return Per pattern, [position * 16 + seen] sequence counts summed over
+   *         all processes, back to back
+   */
+  [[nodiscard]] std::vector<uint64_t>
+  countSeen(std::span<const Masks> patterns) const;
+
+  /**
+   * @brief Describe a pattern with its count
+   * @param masks Pattern masks
+   * @param sequences Sequences containing the pattern
+   * @return Variant with pattern, counts and enrichment filled in
+   */
+  [[nodiscard]] MotifVariant describe(const Masks &masks,
+                                      uint64_t sequences) const;
+
+  /**
+   * @brief Get the expected number of sequences containing a pattern
+   * @param masks Pattern masks
+   * @return Expected sequences
+   */
+  [[nodiscard]] double expectedSequences(const Masks &masks) const noexcept;
+};
+
+} // namespace dna_motif
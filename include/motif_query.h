@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common.h"
+#include "hit_bitsets.h"
+#include <expected>
+
+namespace dna_motif {
+
+/**
+ * @brief Syntax error in a motif query
+ */
+struct QueryError {
+  size_t position = 0; ///< Offset of the offending token in the expression
+  std::string message;
+};
+
+/**
+ * @brief Boolean expression over motif hit bitsets
+ *
+ * Grammar, loosest binding first:
+ *
+ *     expr   := term { (OR | '|') term }
+ *     term   := factor { (AND | '&') factor }
+ *     factor := (NOT | '!' | '~') factor | '(' expr ')' | name | '#' index
+ *
+ * Keywords are case-insensitive. A name refers to the first motif with that
+ * name (the pattern, on the command line); '#' index refers to a motif by
+ * position, for names that collide with keywords. For example
+ * "(FOXA AND NOT HNF4) OR GATA".
+ *
+ * The expression compiles to a postfix program of bitwise operations that
+ * is evaluated over BLOCK_WORDS-word slices of the bitsets, slices in
+ * parallel, so a query costs a few passes over the bitsets and never a
+ * rescan of the sequences.
+ */
+class MotifQuery {
+public:
+  /// Words of each bitset evaluated per step; the stack stays in L1
+  static constexpr size_t BLOCK_WORDS = 64;
+
+  MotifQuery() = default;
+
+  /**
+   * @brief Compile a query expression
+   * @param expression Query text
+   * @param names Name of every motif, in HitBitsets row order
+   * @return Query, or the first syntax error
+   */
+  [[nodiscard]] static std::expected<MotifQuery, QueryError>
+  parse(std::string_view expression, std::span<const std::string> names);
+
+  /**
+   * @brief Evaluate the query over hit bitsets
+   * @param bitsets Bitsets with at least as many rows as names given to
+   *                parse()
+   * @return Bitset over sequences matching the query, bitsets.wordCount()
+   *         words with zero padding bits
+   */
+  [[nodiscard]] std::vector<uint64_t>
+  evaluate(const HitBitsets &bitsets) const;
+
+  /**
+   * @brief Count the sequences matching the query
+   * @param bitsets Bitsets the query is evaluated over
+   * @return Set bits of evaluate()
+   */
+  [[nodiscard]] size_t count(const HitBitsets &bitsets) const;
+
+  /**
+   * @brief Get the query text
+   * @return Expression given to parse()
+   */
+  [[nodiscard]] const std::string &expression() const noexcept {
+    return expression_;
+  }
+
+private:
+  enum class OpCode : uint8_t { Load, Not, And, Or };
+
+  struct Instruction {
+    OpCode op;
+    size_t motif; // Row loaded by OpCode::Load
+  };
+
+  std::string expression_;
+  std::vector<Instruction> program_; // Postfix order
+  size_t max_depth_ = 0;             // Stack slots the program needs
+
+  class Parser;
+};
+
+} // namespace dna_motif
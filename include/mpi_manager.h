@@ -69,6 +69,59 @@ public:
   std::vector<MotifResult>
   gatherResults(const std::vector<MotifResult> &local_results);
 
+  /// Elements per MPI call; MPI counts are int, so the reductions below
+  /// split longer arrays into chunks of this size
+  static constexpr size_t MAX_MESSAGE_ELEMENTS =
+      std::numeric_limits<int>::max();
+
+  /**
+   * @brief Sum count arrays of all processes on the master
+   * @param local_counts Counts of current process, same length everywhere
+   * @return Element-wise sum over all processes on the master, the local
+   *         counts elsewhere
+   */
+  std::vector<uint64_t> reduceCounts(std::span<const uint64_t> local_counts);
+
+  /**
+   * @brief Sum count arrays of all processes on every process
+   * @param local_counts Counts of current process, same length everywhere
+   * @return Element-wise sum over all processes
+   */
+  std::vector<uint64_t>
+  allreduceCounts(std::span<const uint64_t> local_counts);
+
+  /**
+   * @brief Concatenate arrays of all processes on the master
+   * @param local_values Values of current process, any length
+   * @return Values of every process in rank order on the master, empty
+   *         elsewhere
+   * @throws std::length_error if the values of all processes exceed
+   *         MAX_MESSAGE_ELEMENTS
+   */
+  std::vector<uint64_t> gatherCounts(std::span<const uint64_t> local_values);
+
+  /**
+   * @brief Take the element-wise minimum of arrays of all processes on the
+   *        master
+   * @param local_values Values of current process, same length everywhere
+   * @return Element-wise minimum over all processes on the master, the local
+   *         values elsewhere
+   */
+  std::vector<uint64_t>
+  reduceMinimum(std::span<const uint64_t> local_values);
+
+  /**
+   * @brief Sum position histograms of all processes on the master
+   *
+   * Every process must pass the same number of motifs; rows are padded to
+   * the longest offset range of any process before MPI_Reduce.
+   *
+   * @param local_histogram Histogram of current process
+   * @return Sum over all processes on the master, the padded local
+   *         histogram elsewhere
+   */
+  PositionHistogram reduceHistogram(const PositionHistogram &local_histogram);
+
   /**
    * @brief Synchronize all processes
    */
@@ -1,11 +1,29 @@
 #pragma once
 
 #include "common.h"
+#include "fm_index.h"
+#include "kmer_index.h"
+#include "kmer_spectrum.h"
+#include "markov_background.h"
+#include "motif_bootstrap.h"
 #include "motif_finder.h"
+#include "motif_clustering.h"
+#include "motif_discovery.h"
+#include "motif_enrichment.h"
+#include "motif_neighbourhood.h"
 #include "mpi_manager.h"
+#include "spacing_analyzer.h"
 
 namespace dna_motif {
 
+/**
+ * @brief Index answering motif counts in ParallelProcessor::processIndexed()
+ */
+enum class IndexEngine {
+  Kmer, ///< KmerIndex, motifs of WINDOW_CODE_LENGTH
+  Fm    ///< FmIndex, motifs of any length
+};
+
 /**
  * @brief Main parallel processor coordinating MPI and OpenMP
  *
@@ -35,6 +53,135 @@ public:
   std::vector<MotifResult> processMotifs(const std::string &chip_seq_file,
                                          const std::string &motifs_file);
 
+  /**
+   * @brief Stream a genome FASTA file and count motif hits per bin
+   *
+   * Runs on the master process with all of its OpenMP threads; records are
+   * never loaded whole (see GenomeScanner). Other processes return
+   * immediately.
+   *
+   * @param genome_file Path to FASTA file with chromosome-sized records
+   * @param motifs_file Path to motifs file
+   * @param bin_size Bin width in bases
+   * @param output_file Output table path, stdout if empty
+   */
+  void processGenome(const std::string &genome_file,
+                     const std::string &motifs_file, size_t bin_size,
+                     const std::string &output_file);
+
+  /**
+   * @brief Score every sequence against the motifs as PWMs
+   *
+   * Motifs become log-odds matrices via PositionWeightMatrix::fromPattern,
+   * or via fromCounts when the motifs file holds JASPAR or MEME count
+   * matrices. Sequences are split over the processes as in processMotifs;
+   * the master gathers the scores, writes the best score per sequence and
+   * matrix (NA below the threshold) and prints hits per matrix.
+   *
+   * @param chip_seq_file Path to ChIP-seq sequences file
+   * @param motifs_file Path to motifs or count matrices file
+   * @param relative_threshold Hit threshold as a fraction of the score range
+   * @param count_matrices Read motifs_file with DNAParser::parseCountMatrices
+   * @param output_file Output table path, stdout if empty
+   * @throws std::runtime_error for unreadable input or invalid matrices
+   */
+  void processPwm(const std::string &chip_seq_file,
+                  const std::string &motifs_file, double relative_threshold,
+                  bool count_matrices, const std::string &output_file);
+
+  /**
+   * @brief Count motif hits from a persistent sequence index
+   *
+   * Runs on the master process. The index is loaded from index_file when
+   * it was built from the same sequences, otherwise it is rebuilt with all
+   * OpenMP threads and saved there. Motifs the engine supports are then
+   * counted from the index in parallel: a KmerIndex answers motifs of
+   * WINDOW_CODE_LENGTH from their postings, an FmIndex (mapped with mmap)
+   * answers any plain IUPAC motif by backtracking. Other motifs, and every
+   * motif when mismatches are allowed, are scanned as usual. Indexed
+   * results carry counts and frequencies but no matches. Other processes
+   * return an empty vector.
+   *
+   * @param chip_seq_file Path to ChIP-seq sequences file
+   * @param motifs_file Path to motifs file
+   * @param index_file Path of the saved index
+   * @param engine Index type
+   * @return Motif results in motif order (master only)
+   */
+  std::vector<MotifResult>
+  processIndexed(const std::string &chip_seq_file,
+                 const std::string &motifs_file, const std::string &index_file,
+                 IndexEngine engine = IndexEngine::Kmer);
+
+  /**
+   * @brief Discover the best IUPAC motifs of the sequences de novo
+   *
+   * Must be called on every process. Exact counts need the postings of all
+   * sequences, so each process parses the whole input and builds the full
+   * KmerIndex; this part does not scale with processes. The bound tables
+   * are counted over a contiguous share of the sequences and summed. Each
+   * process then searches its round-robin share of the MotifDiscovery
+   * subtrees with all OpenMP threads, and the master merges the
+   * per-process top lists. Writes the motifs with their counts, expected
+   * counts and enrichment.
+   *
+   * @param chip_seq_file Path to ChIP-seq sequences file
+   * @param options Search options
+   * @param output_file Output table path, stdout if empty
+   * @return Best motifs, best first (master only)
+   */
+  std::vector<DiscoveredMotif>
+  discoverMotifs(const std::string &chip_seq_file,
+                 const DiscoveryOptions &options,
+                 const std::string &output_file);
+
+  /**
+   * @brief Compare motif hits in foreground and background sequences
+   *
+   * Must be called on every process. The background sequences are appended
+   * to the foreground ones and the combined list is distributed and scanned
+   * once with the scan options, so both sets share the compiled motifs and
+   * the thread schedule. Per-process hit counts of each set are summed on
+   * the master, which writes frequencies, fold enrichment and the one-sided
+   * Fisher exact test p-value of every motif.
+   *
+   * @param chip_seq_file Path to foreground sequences file
+   * @param background_file Path to background sequences file
+   * @param motifs_file Path to motifs file
+   * @param output_file Output table path, stdout if empty
+   * @return Enrichment per motif in motif order (master only)
+   */
+  std::vector<MotifEnrichment>
+  processEnrichment(const std::string &chip_seq_file,
+                    const std::string &background_file,
+                    const std::string &motifs_file,
+                    const std::string &output_file);
+
+  /**
+   * @brief Compare motif hits with dinucleotide-shuffled replicates
+   *
+   * Must be called on every process. Each process scans its sequences, then
+   * generates the shuffled replicates of them (see DinucleotideShuffler)
+   * block by block and scans each block right away, so only one block of
+   * shuffled sequences exists at a time. Per-replicate hit counts are summed
+   * on the master, which writes the observed frequency, the mean shuffled
+   * frequency, fold enrichment and the empirical p-value of every motif.
+   * Replicates depend on the seed only, not on the process count.
+   *
+   * @param chip_seq_file Path to ChIP-seq sequences file
+   * @param motifs_file Path to motifs file
+   * @param replicates Shuffled copies of the sequences, at least 1
+   * @param seed Random seed
+   * @param output_file Output table path, stdout if empty
+   * @return Enrichment per motif in motif order, the replicates pooled as
+   *         background and log_p_value holding the log of the empirical
+   *         p-value (master only)
+   */
+  std::vector<MotifEnrichment>
+  processShuffled(const std::string &chip_seq_file,
+                  const std::string &motifs_file, size_t replicates,
+                  uint64_t seed, const std::string &output_file);
+
   /**
    * @brief Print results to console
    * @param results Motif results to print
@@ -49,6 +196,245 @@ public:
   void saveResults(const std::vector<MotifResult> &results,
                    const std::string &output_file) const;
 
+  /**
+   * @brief Save the position histogram of the last processMotifs() call
+   *
+   * One row per motif with hit counts at offsets 0, 1, ... of the sequences,
+   * summed over all processes. Requires ScanOptions::position_histogram.
+   *
+   * @param output_file Output file path
+   */
+  void savePositionHistogram(const std::string &output_file) const;
+
+  /**
+   * @brief Get the position histogram of the last processMotifs() call
+   * @return Histogram summed over all processes (master only), empty unless
+   *         ScanOptions::position_histogram is set
+   */
+  const PositionHistogram &getPositionHistogram() const noexcept {
+    return position_histogram_;
+  }
+
+  /**
+   * @brief Enable computing the motif co-occurrence matrix in
+   *        processMotifs()
+   * @param enabled Compute the M x M matrix from the hit bitsets and sum it
+   *                on the master; needs ScanOptions::keep_hit_bitsets.
+   *                Queries, MinHash clustering and the bootstrap use the
+   *                bitsets alone and do not need it.
+   */
+  void setCooccurrenceEnabled(bool enabled) {
+    cooccurrence_enabled_ = enabled;
+  }
+
+  /**
+   * @brief Save the motif co-occurrence matrix of the last processMotifs()
+   *
+   * Cell (a, b) is the number of sequences hit by both motifs, summed over
+   * all processes; the diagonal holds the match counts. Requires
+   * setCooccurrenceEnabled() and ScanOptions::keep_hit_bitsets.
+   *
+   * @param output_file Output file path
+   */
+  void saveCooccurrence(const std::string &output_file) const;
+
+  /**
+   * @brief Get the co-occurrence matrix of the last processMotifs() call
+   * @return Matrix summed over all processes (master only), empty unless
+   *         setCooccurrenceEnabled() was called with
+   *         ScanOptions::keep_hit_bitsets set
+   */
+  const CooccurrenceMatrix &getCooccurrence() const noexcept {
+    return cooccurrence_;
+  }
+
+  /**
+   * @brief Save the motif-pair spacing histogram of the last processMotifs()
+   *
+   * One row per pair and orientation with hit pair counts at distances
+   * -max_distance to max_distance, summed over all processes. Requires
+   * spacing options with a maximum distance (see setSpacingOptions()).
+   *
+   * @param output_file Output file path
+   */
+  void saveSpacing(const std::string &output_file) const;
+
+  /**
+   * @brief Get the spacing histogram of the last processMotifs() call
+   * @return Histogram summed over all processes (master only), empty unless
+   *         spacing options are set
+   */
+  const SpacingHistogram &getSpacingHistogram() const noexcept {
+    return spacing_histogram_;
+  }
+
+  /**
+   * @brief Enable counting the 8-mer spectrum in processMotifs()
+   * @param enabled Count the spectrum of the local sequences and sum it over
+   *                all processes with MPI_Allreduce
+   */
+  void setSpectrumEnabled(bool enabled) { spectrum_enabled_ = enabled; }
+
+  /**
+   * @brief Save the 8-mer spectrum of the last processMotifs() call
+   *
+   * One row per k-mer in window code order with its occurrences, the
+   * sequences containing it and its frequency among all counted windows.
+   * Requires setSpectrumEnabled().
+   *
+   * @param output_file Output file path
+   */
+  void saveSpectrum(const std::string &output_file) const;
+
+  /**
+   * @brief Get the 8-mer spectrum of the last processMotifs() call
+   * @return Spectrum summed over all processes (every process), empty
+   *         unless setSpectrumEnabled() was called
+   */
+  const KmerSpectrum &getSpectrum() const noexcept { return spectrum_; }
+
+  /**
+   * @brief Enable fitting a Markov background model in processMotifs()
+   * @param order Model order (at most MarkovBackground::MAX_ORDER), or
+   *              std::nullopt to disable; words are counted on the local
+   *              sequences and summed over all processes with MPI_Allreduce
+   */
+  void setMarkovOrder(std::optional<size_t> order) { markov_order_ = order; }
+
+  /**
+   * @brief Save expected motif frequencies under the Markov background
+   *
+   * One row per motif with its sequence count and frequency summed over
+   * the per-process blocks of results, the per-window match probability,
+   * the expected number and fraction of sequences containing it and the
+   * observed over expected ratio; NA for gapped motifs. Motifs are
+   * evaluated in parallel with OpenMP. Requires setMarkovOrder() before
+   * processMotifs().
+   *
+   * @param results Results of the last processMotifs() call
+   * @param output_file Output file path
+   */
+  void saveExpected(const std::vector<MotifResult> &results,
+                    const std::string &output_file) const;
+
+  /**
+   * @brief Set the motif-pair spacing analysis run by processMotifs()
+   * @param options Maximum distance (0 disables) and pairs; the strands
+   *                follow ScanOptions::both_strands
+   */
+  void setSpacingOptions(const SpacingOptions &options) {
+    spacing_options_ = options;
+  }
+
+  /**
+   * @brief Set the neighbourhood exploration run by processMotifs()
+   * @param options Hill-climbing moves and their minimum frequency; the
+   *                strands follow ScanOptions::both_strands
+   */
+  void setNeighbourhoodOptions(const NeighbourhoodOptions &options) {
+    neighbourhood_options_ = options;
+  }
+
+  /**
+   * @brief Save the motif neighbourhoods of the last processMotifs() call
+   *
+   * Per motif, one row for the seed, one per single-position neighbour and
+   * one per hill-climbing move, each with its sequence count, expected
+   * count and enrichment over all processes. Requires neighbourhood
+   * options with enabled set.
+   *
+   * @param output_file Output file path
+   */
+  void saveNeighbourhood(const std::string &output_file) const;
+
+  /**
+   * @brief Get the motif refinements of the last processMotifs() call
+   * @return One refinement per motif (every process), empty unless
+   *         neighbourhood options are enabled
+   */
+  const std::vector<MotifRefinement> &getRefinements() const noexcept {
+    return refinements_;
+  }
+
+  /**
+   * @brief Evaluate boolean motif queries over the last scan's hit bitsets
+   *
+   * Must be called on every process after processMotifs() with
+   * ScanOptions::keep_hit_bitsets set. Queries name motifs by pattern (see
+   * MotifQuery); per-process counts are summed on the master.
+   *
+   * @param expressions Query expressions
+   * @return One result per query, the expression as pattern (master only)
+   * @throws std::invalid_argument for a malformed query
+   * @throws std::runtime_error if no hit bitsets were kept
+   */
+  std::vector<MotifResult>
+  evaluateQueries(const std::vector<std::string> &expressions);
+
+  /**
+   * @brief Print query results to console
+   * @param results Results of evaluateQueries()
+   */
+  void printQueryResults(const std::vector<MotifResult> &results) const;
+
+  /**
+   * @brief Cluster motifs by the Jaccard similarity of their hit sets
+   *
+   * Must be called on every process after processMotifs() with
+   * ScanOptions::keep_hit_bitsets set. Exact similarities come from the
+   * co-occurrence matrix (see setCooccurrenceEnabled()); with MinHash,
+   * per-process signatures over global sequence ids are merged on the
+   * master instead, giving the same clusters for any number of processes.
+   *
+   * @param threshold Smallest linking similarity, in (0, 1]
+   * @param minhash_hashes Signature entries, 0 for exact similarities
+   * @return Single-linkage clusters (master only)
+   * @throws std::invalid_argument for thresholds outside (0, 1]
+   * @throws std::runtime_error if no hit bitsets were kept, or for exact
+   *         similarities without the co-occurrence matrix
+   */
+  MotifClusters clusterMotifs(double threshold, size_t minhash_hashes = 0);
+
+  /**
+   * @brief Print motif clusters to console
+   * @param clusters Result of clusterMotifs()
+   */
+  void printClusters(const MotifClusters &clusters) const;
+
+  /**
+   * @brief Bootstrap confidence intervals of the motif frequencies
+   *
+   * Must be called on every process after processMotifs() with
+   * ScanOptions::keep_hit_bitsets set. Replicates weight each local
+   * sequence by its index in the input file (see MotifBootstrap), so the
+   * intervals do not depend on the number of processes; weighted counts
+   * are summed on the master. The co-occurrence matrix is not needed.
+   *
+   * @param replicates Bootstrap replicates
+   * @param seed Random seed
+   * @param confidence Interval coverage, in (0, 1)
+   * @return One interval per motif (master only)
+   * @throws std::invalid_argument for a confidence outside (0, 1) or no
+   *         replicates
+   * @throws std::runtime_error if no hit bitsets were kept
+   */
+  std::vector<FrequencyInterval>
+  bootstrapFrequencies(size_t replicates, uint64_t seed, double confidence);
+
+  /**
+   * @brief Print bootstrap confidence intervals to console
+   * @param intervals Result of bootstrapFrequencies()
+   * @param confidence Coverage the intervals were computed for
+   */
+  void printBootstrap(const std::vector<FrequencyInterval> &intervals,
+                      double confidence) const;
+
+  /**
+   * @brief Set the motif scanning options
+   * @param options Kernel and strand options used for the local sequences
+   */
+  void setScanOptions(const ScanOptions &options);
+
   /**
    * @brief Get performance statistics
    * @return Map with performance metrics
@@ -65,6 +451,19 @@ private:
   std::unique_ptr<MotifFinder> motif_finder_;
   std::unique_ptr<IUPACCodes> iupac_codes_;
   std::unordered_map<std::string, double> performance_stats_;
+  PositionHistogram position_histogram_;
+  std::vector<std::string> motif_patterns_;
+  size_t first_sequence_id_ = 0; ///< Input index of the first local sequence
+  bool cooccurrence_enabled_ = false;
+  CooccurrenceMatrix cooccurrence_;
+  SpacingOptions spacing_options_;
+  SpacingHistogram spacing_histogram_;
+  NeighbourhoodOptions neighbourhood_options_;
+  std::vector<MotifRefinement> refinements_;
+  bool spectrum_enabled_ = false;
+  KmerSpectrum spectrum_;
+  std::optional<size_t> markov_order_;
+  std::optional<MarkovBackground> markov_background_;
   bool initialized_;
 
   /**
@@ -79,12 +478,12 @@ private:
 
   /**
    * @brief Process motifs in parallel using OpenMP
-   * @param sequences Sequences to process
+   * @param store Pre-decoded local sequences
    * @param motifs Motifs to find
    * @return Local results from current process
    */
   std::vector<MotifResult>
-  processMotifsParallel(const std::vector<ChIPSequence> &sequences,
+  processMotifsParallel(const SequenceStore &store,
                         const std::vector<Motif> &motifs);
 
   /**
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+#include "sequence_store.h"
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dna_motif {
+
+/// Best score of a sequence in which no window reaches the threshold
+inline constexpr float NO_PWM_HIT = -std::numeric_limits<float>::infinity();
+
+/**
+ * @brief Log-odds position weight matrix
+ *
+ * Weights are log2(p / PositionWeightMatrix::BACKGROUND) per position and
+ * nucleotide, stored as [position * 4 + code] with codes of
+ * encodeNucleotide(). A window scores the sum of its weights.
+ */
+class PositionWeightMatrix {
+public:
+  /// Uniform background probability of each nucleotide
+  static constexpr double BACKGROUND = 0.25;
+
+  PositionWeightMatrix() = default;
+
+  /**
+   * @brief Derive a matrix from an IUPAC pattern
+   *
+   * Every position spreads 1 - pseudocount evenly over its accepted
+   * nucleotides and pseudocount over the rejected ones, so a fully
+   * degenerate position (N) scores 0 for every nucleotide.
+   *
+   * @param pattern Motif pattern
+   * @param iupac_codes IUPAC code table
+   * @param pseudocount Probability mass of rejected nucleotides, in (0, 1)
+   * @return Matrix, or std::nullopt for empty, invalid or patterns longer
+   *         than MAX_MOTIF_LENGTH
+   */
+  [[nodiscard]] static std::optional<PositionWeightMatrix>
+  fromPattern(std::string_view pattern, const IUPACCodes &iupac_codes,
+              double pseudocount = 0.01);
+
+  /**
+   * @brief Build a matrix from nucleotide counts (e.g. a JASPAR matrix)
+   * @param counts One row per position, columns in A, C, G, T order
+   * @param pseudocount Added to every count
+   * @return Matrix, or std::nullopt for empty, oversized or rows without
+   *         positive mass
+   */
+  [[nodiscard]] static std::optional<PositionWeightMatrix>
+  fromCounts(std::span<const std::array<double, 4>> counts,
+             double pseudocount = 0.25);
+
+  /**
+   * @brief Get motif length
+   * @return Number of positions
+   */
+  [[nodiscard]] size_t length() const noexcept { return weights_.size() / 4; }
+
+  /**
+   * @brief Get the weight of a nucleotide at a position
+   * @param position Motif position
+   * @param code Nucleotide code
+   * @return Log-odds weight
+   */
+  [[nodiscard]] float weight(size_t position, uint8_t code) const noexcept {
+    return weights_[position * 4 + code];
+  }
+
+  /**
+   * @brief Get all weights
+   * @return Weights as [position * 4 + code]
+   */
+  [[nodiscard]] std::span<const float> weights() const noexcept {
+    return weights_;
+  }
+
+  /**
+   * @brief Get the lowest achievable window score
+   * @return Sum of the per-position minimum weights
+   */
+  [[nodiscard]] float minScore() const noexcept { return min_score_; }
+
+  /**
+   * @brief Get the highest achievable window score
+   * @return Sum of the per-position maximum weights
+   */
+  [[nodiscard]] float maxScore() const noexcept { return max_score_; }
+
+  /**
+   * @brief Score one window
+   * @param bases Nucleotide codes, length() readable
+   * @return Window score
+   */
+  [[nodiscard]] float score(const uint8_t *bases) const noexcept;
+
+private:
+  std::vector<float> weights_;
+  float min_score_ = 0.0f;
+  float max_score_ = 0.0f;
+
+  /**
+   * @brief Build a matrix from per-position probabilities
+   * @param probabilities [position * 4 + code], rows summing to 1
+   */
+  explicit PositionWeightMatrix(std::span<const double> probabilities);
+};
+
+/**
+ * @brief Best PWM score of every sequence for every matrix
+ */
+struct PwmScores {
+  size_t sequence_count = 0;
+  std::vector<float> best;        ///< [matrix * sequence_count + sequence]
+  std::vector<size_t> hit_counts; ///< Sequences with a hit, per matrix
+
+  /**
+   * @brief Get the best scores of one matrix
+   * @param matrix Matrix index
+   * @return One score per sequence, NO_PWM_HIT below the threshold
+   */
+  [[nodiscard]] std::span<const float>
+  bestScores(size_t matrix) const noexcept {
+    return std::span<const float>(best).subspan(matrix * sequence_count,
+                                                sequence_count);
+  }
+};
+
+/**
+ * @brief Batch scorer of position weight matrices
+ *
+ * Scores eight consecutive offsets at once (AVX2 permutes the four weights
+ * of a position by the nucleotide codes) and abandons a group of windows as
+ * soon as no window can still reach the bound: the threshold or the best
+ * score found so far, whichever is higher. Positions are evaluated in
+ * decreasing order of weight spread, and the bound test adds the maximum
+ * remaining score of the positions not yet evaluated, so it never discards
+ * a window that could qualify.
+ */
+class PwmScorer {
+public:
+  /**
+   * @brief Compile matrices for scoring
+   * @param matrices Matrices to score
+   * @param relative_threshold Hit threshold as a fraction of each matrix
+   *        score range: minScore() + t * (maxScore() - minScore())
+   * @throws std::invalid_argument for an empty matrix set or a threshold
+   *         outside [0, 1]
+   */
+  explicit PwmScorer(std::span<const PositionWeightMatrix> matrices,
+                     double relative_threshold = 0.8);
+
+  /**
+   * @brief Score every sequence of a store against every matrix
+   *
+   * Sequences are distributed over OpenMP threads; windows containing
+   * characters other than A/C/G/T are not scored.
+   *
+   * @param store Sequence store
+   * @return Per-sequence best scores
+   */
+  [[nodiscard]] PwmScores scoreBest(const SequenceStore &store) const;
+
+  /**
+   * @brief Find the best window score of a clean nucleotide run
+   * @param matrix Matrix index
+   * @param bases Nucleotide codes
+   * @return Best score, NO_PWM_HIT if no window reaches the threshold
+   */
+  [[nodiscard]] float bestScore(size_t matrix,
+                                std::span<const uint8_t> bases) const noexcept;
+
+  /**
+   * @brief Get number of matrices
+   * @return Matrix count
+   */
+  [[nodiscard]] size_t matrixCount() const noexcept {
+    return matrices_.size();
+  }
+
+  /**
+   * @brief Get the absolute hit threshold of a matrix
+   * @param matrix Matrix index
+   * @return Minimum score of a hit
+   */
+  [[nodiscard]] float threshold(size_t matrix) const noexcept {
+    return matrices_[matrix].threshold;
+  }
+
+private:
+  // One matrix with positions in evaluation order
+  struct CompiledMatrix {
+    std::vector<uint8_t> order;   // Motif position of each evaluation step
+    std::vector<float> weights;   // [step * 4 + code]
+    std::vector<float> remaining; // Maximum score of steps k.., length + 1
+    float threshold = 0.0f;
+  };
+
+  std::vector<CompiledMatrix> matrices_;
+
+  /**
+   * @brief Score windows one at a time
+   * @param matrix Compiled matrix
+   * @param bases Nucleotide codes
+   * @param first First window start
+   * @param last One past the last window start
+   * @param best Best hit so far, NO_PWM_HIT if none; raised in place
+   */
+  static void scoreWindows(const CompiledMatrix &matrix, const uint8_t *bases,
+                           size_t first, size_t last, float &best) noexcept;
+};
+
+} // namespace dna_motif
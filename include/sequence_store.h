@@ -0,0 +1,284 @@
+#pragma once
+
+#include "common.h"
+
+namespace dna_motif {
+
+/**
+ * @brief Columnar store of pre-decoded ChIP sequences
+ *
+ * Decodes every nucleotide to its 2-bit code (see encodeNucleotide) once at
+ * load time, so motif kernels never re-read the raw characters. Optionally
+ * precomputes the rolling WINDOW_CODE_LENGTH-mer code of every window, which
+ * turns a motif scan into table lookups.
+ *
+ * The store does not own the sequences it was built from; they must outlive
+ * it. Sequences containing characters other than A/C/G/T are kept but marked
+ * as not clean, and callers must use the character path for them.
+ */
+class SequenceStore {
+public:
+  /// Readable zero bytes after the last nucleotide code
+  static constexpr size_t BASE_PADDING = 128;
+
+  /// Default number of sequences summarized by one zone map
+  static constexpr size_t ZONE_BLOCK_SEQUENCES = 256;
+
+  /// Words of one zone map, one bit per window code
+  static constexpr size_t ZONE_MAP_WORDS = WINDOW_CODE_SPACE / 64;
+
+  SequenceStore() = default;
+  explicit SequenceStore(std::span<const ChIPSequence> sequences);
+  ~SequenceStore() = default;
+
+  SequenceStore(const SequenceStore &) = default;
+  SequenceStore &operator=(const SequenceStore &) = default;
+  SequenceStore(SequenceStore &&) = default;
+  SequenceStore &operator=(SequenceStore &&) = default;
+
+  /**
+   * @brief Precompute the window code column
+   *
+   * Code of window w is sum(base[w + p] << 2 * (WINDOW_CODE_LENGTH - 1 - p)),
+   * so the first base of the window occupies the most significant bits.
+   */
+  void buildWindowCodes();
+
+  /**
+   * @brief Precompute the one-hot nibble column
+   *
+   * Packs 16 nucleotides per 64-bit word as 4-bit masks (1 << code), the
+   * first nucleotide in the lowest nibble. Each sequence is followed by one
+   * zero word so kernels can read across word boundaries.
+   */
+  void buildBaseNibbles();
+
+  /**
+   * @brief Precompute a window code presence map per block of sequences
+   *
+   * Bit c of the map of block b is set when some clean sequence in
+   * [b * block_sequences, (b + 1) * block_sequences) contains the window
+   * with code c (same code as buildWindowCodes()). Sequences that are not
+   * clean are left out; callers scan them with the character path anyway.
+   *
+   * @param block_sequences Sequences per block, at least 1
+   */
+  void buildZoneMaps(size_t block_sequences = ZONE_BLOCK_SEQUENCES);
+
+  /**
+   * @brief Check if the zone maps have been built
+   * @return true if buildZoneMaps() has been called
+   */
+  [[nodiscard]] bool hasZoneMaps() const noexcept {
+    return zone_block_size_ != 0;
+  }
+
+  /**
+   * @brief Get number of sequences per zone map block
+   * @return Block size, 0 if the zone maps were not built
+   */
+  [[nodiscard]] size_t zoneBlockSize() const noexcept {
+    return zone_block_size_;
+  }
+
+  /**
+   * @brief Get number of zone map blocks
+   * @return Blocks covering every sequence, 0 if the maps were not built
+   */
+  [[nodiscard]] size_t zoneCount() const noexcept {
+    return hasZoneMaps() ? zone_maps_.size() / ZONE_MAP_WORDS : 0;
+  }
+
+  /**
+   * @brief Get the window code presence map of a block
+   * @param block Block index
+   * @return ZONE_MAP_WORDS words, code c at bit c & 63 of word c >> 6
+   */
+  [[nodiscard]] std::span<const uint64_t>
+  zoneMap(size_t block) const noexcept {
+    return std::span<const uint64_t>(zone_maps_).subspan(
+        block * ZONE_MAP_WORDS, ZONE_MAP_WORDS);
+  }
+
+  /**
+   * @brief Check if the one-hot nibble column has been built
+   * @return true if buildBaseNibbles() has been called
+   */
+  [[nodiscard]] bool hasBaseNibbles() const noexcept {
+    return !nibble_offsets_.empty();
+  }
+
+  /**
+   * @brief Check if the window code column has been built
+   * @return true if buildWindowCodes() has been called
+   */
+  [[nodiscard]] bool hasWindowCodes() const noexcept {
+    return !window_offsets_.empty();
+  }
+
+  /**
+   * @brief Get number of sequences in the store
+   * @return Number of sequences
+   */
+  [[nodiscard]] size_t size() const noexcept { return sequences_.size(); }
+
+  /**
+   * @brief Check if the store holds no sequences
+   * @return true if empty
+   */
+  [[nodiscard]] bool empty() const noexcept { return sequences_.empty(); }
+
+  /**
+   * @brief Get the length shared by every sequence
+   * @return Common sequence length, 0 if lengths differ or the store is empty
+   */
+  [[nodiscard]] size_t uniformLength() const noexcept {
+    return uniform_length_;
+  }
+
+  /**
+   * @brief Get the source sequences
+   * @return Span over the sequences the store was built from
+   */
+  [[nodiscard]] std::span<const ChIPSequence> sequences() const noexcept {
+    return sequences_;
+  }
+
+  /**
+   * @brief Get a source sequence
+   * @param index Sequence index
+   * @return Sequence at index
+   */
+  [[nodiscard]] const ChIPSequence &sequence(size_t index) const noexcept {
+    return sequences_[index];
+  }
+
+  /**
+   * @brief Get the 2-bit nucleotide codes of a sequence
+   * @param index Sequence index
+   * @return One code per nucleotide
+   */
+  [[nodiscard]] std::span<const uint8_t> bases(size_t index) const noexcept {
+    return {bases_.data() + base_offsets_[index],
+            base_offsets_[index + 1] - base_offsets_[index]};
+  }
+
+  /**
+   * @brief Get the 2-bit nucleotide codes of all sequences, back to back
+   *
+   * At least BASE_PADDING zero bytes follow the last code, so kernels may
+   * read a fixed-width block starting at any position.
+   *
+   * @return Concatenated nucleotide codes
+   */
+  [[nodiscard]] std::span<const uint8_t> flatBases() const noexcept {
+    return {bases_.data(), base_offsets_.back()};
+  }
+
+  /**
+   * @brief Get the position of a sequence within flatBases()
+   * @param index Sequence index, size() for the end of the last sequence
+   * @return Offset of the first nucleotide code
+   */
+  [[nodiscard]] size_t baseOffset(size_t index) const noexcept {
+    return base_offsets_[index];
+  }
+
+  /**
+   * @brief Get the window codes of a sequence
+   * @param index Sequence index
+   * @return One code per window, empty if the column was not built
+   */
+  [[nodiscard]] std::span<const uint16_t>
+  windowCodes(size_t index) const noexcept {
+    if (!hasWindowCodes()) {
+      return {};
+    }
+    return {window_codes_.data() + window_offsets_[index],
+            window_offsets_[index + 1] - window_offsets_[index]};
+  }
+
+  /**
+   * @brief Call a function with the code of every window of A/C/G/T only
+   *
+   * Reads the window code column for clean sequences when it was built and
+   * rolls the codes from the nucleotide column otherwise, restarting after
+   * every other character.
+   *
+   * @param index Sequence index
+   * @param fn Called with each window code (as size_t) in window order
+   */
+  template <typename Fn>
+  void forEachWindowCode(size_t index, Fn &&fn) const {
+    if (isClean(index) && hasWindowCodes()) {
+      for (const uint16_t code : windowCodes(index)) {
+        fn(static_cast<size_t>(code));
+      }
+      return;
+    }
+
+    const std::string_view text = sequences_[index].sequence;
+    const std::span<const uint8_t> codes = bases(index);
+    const bool clean = isClean(index);
+    size_t code = 0;
+    size_t run = 0;
+    for (size_t i = 0; i < codes.size(); ++i) {
+      if (!clean && !isNucleotide(text[i])) {
+        run = 0;
+        continue;
+      }
+      code = ((code << NUCLEOTIDE_CODE_BITS) | codes[i]) &
+             (WINDOW_CODE_SPACE - 1);
+      if (++run >= WINDOW_CODE_LENGTH) {
+        fn(code);
+      }
+    }
+  }
+
+  /**
+   * @brief Get the one-hot nibble words of a sequence
+   * @param index Sequence index
+   * @return Packed words including the trailing zero word, empty if the
+   *         column was not built
+   */
+  [[nodiscard]] std::span<const uint64_t>
+  baseNibbles(size_t index) const noexcept {
+    if (!hasBaseNibbles()) {
+      return {};
+    }
+    return {nibbles_.data() + nibble_offsets_[index],
+            nibble_offsets_[index + 1] - nibble_offsets_[index]};
+  }
+
+  /**
+   * @brief Check if a sequence consists of A/C/G/T only
+   * @param index Sequence index
+   * @return true if the decoded columns are exact for this sequence
+   */
+  [[nodiscard]] bool isClean(size_t index) const noexcept {
+    return clean_[index] != 0;
+  }
+
+  /**
+   * @brief Get number of sequences containing non-ACGT characters
+   * @return Count of sequences that are not clean
+   */
+  [[nodiscard]] size_t dirtyCount() const noexcept {
+    return static_cast<size_t>(std::ranges::count(clean_, uint8_t{0}));
+  }
+
+private:
+  std::span<const ChIPSequence> sequences_;
+  std::vector<uint8_t> bases_ = std::vector<uint8_t>(BASE_PADDING, 0);
+  std::vector<size_t> base_offsets_{0};
+  std::vector<uint8_t> clean_;
+  size_t uniform_length_ = 0;
+  std::vector<uint16_t> window_codes_;
+  std::vector<size_t> window_offsets_;
+  std::vector<uint64_t> nibbles_;
+  std::vector<size_t> nibble_offsets_;
+  std::vector<uint64_t> zone_maps_;
+  size_t zone_block_size_ = 0;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "common.h"
+#include "iupac_codes.h"
+#include "motif_kernels.h"
+#include "sequence_store.h"
+
+namespace dna_motif {
+
+/// Strands of a hit pair, first motif then second, by orientation index
+inline constexpr std::array<std::string_view, 4> PAIR_ORIENTATIONS = {
+    "++", "+-", "-+", "--"};
+
+/**
+ * @brief Options of the motif-pair spacing analysis
+ */
+struct SpacingOptions {
+  /// Largest offset difference counted in either direction, 0 disables
+  size_t max_distance = 0;
+
+  /// Also count reverse-strand hits, splitting pairs into the four
+  /// PAIR_ORIENTATIONS; otherwise only "++" is counted
+  bool both_strands = false;
+
+  /// Motif index pairs to analyze, every pair a < b when empty
+  std::vector<std::pair<size_t, size_t>> pairs;
+};
+
+/**
+ * @brief Hit pair counts by spacing and orientation
+ *
+ * For pair (a, b), a hit of a at offset i and a hit of b at offset j of the
+ * same sequence with |j - i| <= max_distance add one to distance j - i.
+ */
+struct SpacingHistogram {
+  size_t max_distance = 0;
+  size_t orientation_count = 0; ///< 1, or 4 when both strands are counted
+  std::vector<std::pair<size_t, size_t>> pairs;
+  /// [(pair * orientation_count + orientation) * binCount() + distance +
+  /// max_distance]
+  std::vector<uint64_t> counts;
+
+  SpacingHistogram() = default;
+
+  SpacingHistogram(std::vector<std::pair<size_t, size_t>> motif_pairs,
+                   size_t orientations, size_t distance)
+      : max_distance(distance), orientation_count(orientations),
+        pairs(std::move(motif_pairs)),
+        counts(pairs.size() * orientations * binCount(), 0) {}
+
+  bool operator==(const SpacingHistogram &other) const = default;
+
+  /**
+   * @brief Get number of distances per row
+   * @return Distances -max_distance to max_distance
+   */
+  [[nodiscard]] size_t binCount() const noexcept {
+    return 2 * max_distance + 1;
+  }
+
+  std::span<uint64_t> row(size_t pair, size_t orientation) noexcept {
+    return std::span<uint64_t>(counts).subspan(
+        (pair * orientation_count + orientation) * binCount(), binCount());
+  }
+
+  std::span<const uint64_t> row(size_t pair,
+                                size_t orientation) const noexcept {
+    return std::span<const uint64_t>(counts).subspan(
+        (pair * orientation_count + orientation) * binCount(), binCount());
+  }
+
+  /**
+   * @brief Get the count of one spacing
+   * @param pair Pair index
+   * @param orientation Index into PAIR_ORIENTATIONS
+   * @param distance Offset of the second hit minus offset of the first
+   * @return Hit pairs at that spacing
+   */
+  [[nodiscard]] uint64_t at(size_t pair, size_t orientation,
+                            ptrdiff_t distance) const noexcept {
+    return row(pair, orientation)[static_cast<size_t>(
+        distance + static_cast<ptrdiff_t>(max_distance))];
+  }
+};
+
+/**
+ * @brief Spacing and orientation distribution of motif hit pairs
+ *
+ * Every sequence is turned into one hit mask over offsets per motif and
+ * strand, 64 offsets per step with the exact bit-parallel counter of
+ * MismatchMotif (GappedMotif for composite patterns). Each pair then walks
+ * the set bits of its first mask and extracts the +/- max_distance window
+ * of the second mask a word at a time, so the cost follows the hits rather
+ * than the sequence length and no match list is ever built. Sequences are
+ * processed in parallel with per-thread accumulators.
+ */
+class SpacingAnalyzer {
+public:
+  /**
+   * @brief Compile the motifs of the selected pairs
+   * @param motifs Motifs; invalid patterns never hit
+   * @param iupac_codes IUPAC code table
+   * @param options Spacing options
+   * @throws std::invalid_argument if max_distance is 0 or a pair refers to
+   *         a motif outside motifs
+   */
+  SpacingAnalyzer(std::span<const Motif> motifs,
+                  const IUPACCodes &iupac_codes, const SpacingOptions &options);
+
+  /**
+   * @brief Count hit pair spacings over a store
+   * @param store Pre-decoded sequences
+   * @return Histogram over the analyzed pairs
+   */
+  [[nodiscard]] SpacingHistogram analyze(const SequenceStore &store) const;
+
+  /**
+   * @brief Get the analyzed pairs
+   * @return Pairs given in the options, or every pair a < b
+   */
+  [[nodiscard]] const std::vector<std::pair<size_t, size_t>> &
+  pairs() const noexcept {
+    return pairs_;
+  }
+
+private:
+  // One strand of a motif; neither form set for patterns that never hit
+  struct CompiledStrand {
+    std::optional<MismatchMotif> exact;
+    std::optional<GappedMotif> gapped;
+  };
+
+  size_t motif_count_ = 0;
+  size_t strand_count_ = 1;
+  size_t max_distance_ = 0;
+  std::vector<std::pair<size_t, size_t>> pairs_;
+  std::vector<CompiledStrand> strands_; // [motif * strand_count_ + strand]
+  std::vector<bool> used_;              // Motifs that appear in a pair
+
+  /**
+   * @brief Compute the hit mask of one motif strand over a nucleotide run
+   * @param strand Compiled strand
+   * @param bases Codes of the run, flatBases() padding past its end
+   * @param length Run length
+   * @param hits Set to one bit per offset of the run
+   * @param scratch Buffer for GappedMotif::matchRun()
+   */
+  static void matchRun(const CompiledStrand &strand, const uint8_t *bases,
+                       size_t length, std::vector<uint64_t> &hits,
+                       std::vector<uint64_t> &scratch);
+
+  /**
+   * @brief Add the spacings between two hit masks of a sequence
+   * @param first Hit mask of the first motif
+   * @param second Hit mask of the second motif
+   * @param length Sequence length
+   * @param row Histogram row to update
+   * @param skip_self Do not pair a hit with itself
+   */
+  void countPairs(std::span<const uint64_t> first,
+                  std::span<const uint64_t> second, size_t length,
+                  std::span<uint64_t> row, bool skip_self) const noexcept;
+};
+
+} // namespace dna_motif
@@ -0,0 +1,182 @@
+#include "dinucleotide_shuffle.h"
+
+namespace dna_motif {
+
+namespace {
+
+constexpr size_t BASE_COUNT = 4;
+
+struct ShuffleScratch {
+  std::vector<uint32_t> random;  ///< One permutation draw per edge
+  std::vector<uint8_t> targets;  ///< Edges grouped by their first base
+  std::vector<uint8_t> shuffled; ///< Walk output
+};
+
+// Uniform value below bound from 32 random bits, without a division
+constexpr uint32_t boundedRandom(uint32_t random, uint32_t bound) noexcept {
+  return static_cast<uint32_t>((static_cast<uint64_t>(random) * bound) >>
+                               32);
+}
+
+void shuffleCodes(std::span<const uint8_t> codes, uint64_t key,
+                  std::span<uint8_t> shuffled, ShuffleScratch &scratch) {
+  const size_t length = codes.size();
+  if (length < 3) {
+    std::ranges::copy(codes, shuffled.begin());
+    return;
+  }
+  const size_t edges = length - 1;
+
+  // Edges as a compressed adjacency list: targets of base u occupy
+  // [start[u], start[u] + degree[u])
+  std::array<uint32_t, BASE_COUNT> degree{};
+  for (size_t i = 0; i < edges; ++i) {
+    ++degree[codes[i]];
+  }
+  std::array<uint32_t, BASE_COUNT> start{};
+  for (size_t u = 1; u < BASE_COUNT; ++u) {
+    start[u] = start[u - 1] + degree[u - 1];
+  }
+  std::array<uint32_t, BASE_COUNT> fill = start;
+  scratch.targets.resize(edges);
+  for (size_t i = 0; i < edges; ++i) {
+    scratch.targets[fill[codes[i]]++] = codes[i + 1];
+  }
+
+  // Permutation draws in one batch; a pure function of the index, so the
+  // loop vectorizes
+  scratch.random.resize(edges);
+  uint32_t *random = scratch.random.data();
+  for (size_t i = 0; i < edges; ++i) {
+    random[i] = static_cast<uint32_t>(counterRandom(key, i) >> 32);
+  }
+
+  // Wilson's algorithm: loop-erased random walks pick each base's last edge
+  // so that the last edges form a tree towards the final base
+  const uint8_t final_base = codes[edges];
+  std::array<bool, BASE_COUNT> in_tree{};
+  in_tree[final_base] = true;
+  std::array<uint32_t, BASE_COUNT> last_edge{};
+  uint64_t counter = edges;
+  for (size_t v = 0; v < BASE_COUNT; ++v) {
+    if (degree[v] == 0) {
+      continue;
+    }
+    for (size_t u = v; !in_tree[u];
+         u = scratch.targets[start[u] + last_edge[u]]) {
+      last_edge[u] = boundedRandom(
+          static_cast<uint32_t>(counterRandom(key, counter++) >> 32),
+          degree[u]);
+    }
+    for (size_t u = v; !in_tree[u];
+         u = scratch.targets[start[u] + last_edge[u]]) {
+      in_tree[u] = true;
+    }
+  }
+
+  // Move each tree edge to the end of its list and permute the rest
+  for (size_t u = 0; u < BASE_COUNT; ++u) {
+    if (degree[u] == 0) {
+      continue;
+    }
+    uint8_t *list = scratch.targets.data() + start[u];
+    uint32_t free_edges = degree[u];
+    if (u != final_base) {
+      std::swap(list[last_edge[u]], list[free_edges - 1]);
+      --free_edges;
+    }
+    for (uint32_t j = free_edges; j > 1; --j) {
+      std::swap(list[j - 1], list[boundedRandom(random[start[u] + j - 1], j)]);
+    }
+  }
+
+  std::array<uint32_t, BASE_COUNT> next = start;
+  shuffled[0] = codes[0];
+  for (size_t i = 1; i < length; ++i) {
+    shuffled[i] = scratch.targets[next[shuffled[i - 1]]++];
+  }
+}
+
+void shuffleCharacters(std::string_view sequence, uint64_t key,
+                       std::string &out, ShuffleScratch &scratch) {
+  out.resize(sequence.size());
+  std::vector<uint8_t> codes;
+  size_t begin = 0;
+  while (begin < sequence.size()) {
+    if (!isNucleotide(sequence[begin])) {
+      out[begin] = sequence[begin];
+      ++begin;
+      continue;
+    }
+    size_t end = begin;
+    codes.clear();
+    while (end < sequence.size() && isNucleotide(sequence[end])) {
+      codes.push_back(encodeNucleotide(sequence[end++]));
+    }
+    scratch.shuffled.resize(codes.size());
+    shuffleCodes(codes, key ^ begin, scratch.shuffled, scratch);
+    for (size_t p = 0; p < codes.size(); ++p) {
+      out[begin + p] = "ACTG"[scratch.shuffled[p]];
+    }
+    begin = end;
+  }
+}
+
+} // namespace
+
+void shuffleDinucleotides(std::span<const uint8_t> codes, uint64_t key,
+                          std::span<uint8_t> shuffled) {
+  ShuffleScratch scratch;
+  shuffleCodes(codes, key, shuffled, scratch);
+}
+
+std::string shuffleSequence(std::string_view sequence, uint64_t key) {
+  ShuffleScratch scratch;
+  std::string shuffled;
+  shuffleCharacters(sequence, key, shuffled, scratch);
+  return shuffled;
+}
+
+double empiricalPValue(uint64_t observed, std::span<const uint64_t> shuffled) {
+  const auto reached = std::ranges::count_if(
+      shuffled, [observed](uint64_t count) { return count >= observed; });
+  return static_cast<double>(reached + 1) /
+         static_cast<double>(shuffled.size() + 1);
+}
+
+void DinucleotideShuffler::generate(size_t first, size_t last,
+                                    std::vector<ChIPSequence> &out) const {
+  out.resize(last - first);
+  const size_t sequences = store_.size();
+  if (sequences == 0) {
+    return;
+  }
+
+#pragma omp parallel
+  {
+    ShuffleScratch scratch;
+#pragma omp for schedule(dynamic, 64)
+    for (size_t item = first; item < last; ++item) {
+      const size_t replicate = item / sequences;
+      const size_t index = item % sequences;
+      const uint64_t key =
+          mixBits(mixBits(seed_ + mixBits(replicate)) + first_id_ + index);
+      const ChIPSequence &source = store_.sequence(index);
+      ChIPSequence &target = out[item - first];
+      target.id = source.id;
+      if (!store_.isClean(index)) {
+        shuffleCharacters(source.sequence, key, target.sequence, scratch);
+        continue;
+      }
+      const auto codes = store_.bases(index);
+      scratch.shuffled.resize(codes.size());
+      shuffleCodes(codes, key, scratch.shuffled, scratch);
+      target.sequence.resize(codes.size());
+      for (size_t p = 0; p < codes.size(); ++p) {
+        target.sequence[p] = "ACTG"[scratch.shuffled[p]];
+      }
+    }
+  }
+}
+
+} // namespace dna_motif
@@ -1,5 +1,6 @@
 #include "dna_parser.h"
 #include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <format>
 #include <iomanip>
@@ -9,6 +10,89 @@
 
 namespace dna_motif {
 
+namespace {
+
+// MEME sites per matrix when the header gives no nsites
+constexpr double MEME_DEFAULT_SITES = 20.0;
+
+// Numbers of a matrix row, ignoring brackets; a leading A/C/G/T word is
+// stored in label (0 if there is none)
+std::optional<std::vector<double>> parseMatrixRow(std::string_view line,
+                                                  char &label) {
+  label = 0;
+  std::vector<double> values;
+  size_t i = 0;
+  while (i < line.size()) {
+    const char c = line[i];
+    if (std::isspace(static_cast<unsigned char>(c)) || c == '[' || c == ']') {
+      ++i;
+      continue;
+    }
+    const bool word_end =
+        i + 1 == line.size() ||
+        !std::isalnum(static_cast<unsigned char>(line[i + 1]));
+    if (i == line.find_first_not_of(" \t") && word_end &&
+        std::string_view("ACGTacgt").find(c) != std::string_view::npos) {
+      label = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+      ++i;
+      continue;
+    }
+    double value = 0.0;
+    const auto [end, error] =
+        std::from_chars(line.data() + i, line.data() + line.size(), value);
+    if (error != std::errc()) {
+      return std::nullopt;
+    }
+    values.push_back(value);
+    i = static_cast<size_t>(end - line.data());
+  }
+  return values;
+}
+
+// Value of "key= v" in a MEME matrix header, if present
+std::optional<double> headerValue(std::string_view line,
+                                  std::string_view key) {
+  size_t at = line.find(key);
+  while (at != std::string_view::npos && at > 0 && line[at - 1] != ' ') {
+    at = line.find(key, at + 1);
+  }
+  if (at == std::string_view::npos) {
+    return std::nullopt;
+  }
+  const size_t first = line.find_first_not_of(' ', at + key.size());
+  double value = 0.0;
+  if (first == std::string_view::npos ||
+      std::from_chars(line.data() + first, line.data() + line.size(), value)
+              .ec != std::errc()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// Four labelled or unlabelled JASPAR rows as per-position A C G T counts
+std::optional<std::vector<std::array<double, 4>>>
+transposeRows(std::span<const std::pair<char, std::vector<double>>> rows) {
+  static constexpr std::string_view COLUMNS = "ACGT";
+  const size_t positions = rows[0].second.size();
+  std::vector<std::array<double, 4>> counts(positions);
+  std::array<bool, 4> seen{};
+  for (size_t r = 0; r < rows.size(); ++r) {
+    const auto &[label, values] = rows[r];
+    const size_t column = label == 0 ? r : COLUMNS.find(label);
+    if (values.size() != positions || positions == 0 || seen[column] ||
+        (label == 0) != (rows[0].first == 0)) {
+      return std::nullopt;
+    }
+    seen[column] = true;
+    for (size_t p = 0; p < positions; ++p) {
+      counts[p][column] = values[p];
+    }
+  }
+  return counts;
+}
+
+} // namespace
+
 ParseResult<std::vector<ChIPSequence>>
 DNAParser::parseChIPSequences(std::string_view filename) {
   if (!isFileReadable(filename)) {
@@ -123,6 +207,112 @@ DNAParser::parseMotifs(std::string_view filename) {
   return motifs;
 }
 
+ParseResult<std::vector<CountMatrix>>
+DNAParser::parseCountMatrices(std::string_view filename) {
+  if (!isFileReadable(filename)) {
+    return std::unexpected(ParseError::FileNotFound);
+  }
+
+  auto file_content = readFile(filename);
+  if (!file_content) {
+    return std::unexpected(file_content.error());
+  }
+
+  updateStats("files_opened");
+
+  auto lines = splitLines(*file_content);
+  const bool meme = std::ranges::any_of(lines, [](const std::string &line) {
+    return trim(line).starts_with("MOTIF");
+  });
+
+  std::vector<CountMatrix> matrices;
+  std::string name;
+  std::vector<std::pair<char, std::vector<double>>> rows; // JASPAR
+  size_t remaining = 0;                                   // MEME rows left
+  double sites = MEME_DEFAULT_SITES;
+  std::vector<std::array<double, 4>> counts;
+
+  for (const auto &line : lines) {
+    const auto trimmed_line = trim(line);
+    if (trimmed_line.empty() || trimmed_line[0] == '#') {
+      continue;
+    }
+
+    if (meme) {
+      if (trimmed_line.starts_with("MOTIF")) {
+        if (remaining > 0) {
+          return std::unexpected(ParseError::InvalidFormat);
+        }
+        const auto words = split(trim(trimmed_line.substr(5)), ' ');
+        name = words.empty() ? std::string() : words[0];
+      } else if (trimmed_line.starts_with("letter-probability matrix")) {
+        const auto width = headerValue(trimmed_line, "w=");
+        const auto alphabet = headerValue(trimmed_line, "alength=");
+        if (!width || !(*width >= 1.0) || (alphabet && *alphabet != 4.0)) {
+          return std::unexpected(ParseError::InvalidFormat);
+        }
+        remaining = static_cast<size_t>(*width);
+        sites = headerValue(trimmed_line, "nsites=").value_or(
+            MEME_DEFAULT_SITES);
+        counts.clear();
+      } else if (remaining > 0) {
+        char label = 0;
+        const auto values = parseMatrixRow(trimmed_line, label);
+        if (!values || values->size() != 4 || label != 0) {
+          return std::unexpected(ParseError::InvalidFormat);
+        }
+        counts.push_back({(*values)[0] * sites, (*values)[1] * sites,
+                          (*values)[2] * sites, (*values)[3] * sites});
+        if (--remaining == 0) {
+          matrices.push_back({name, std::move(counts)});
+          counts.clear();
+          updateStats("matrices_parsed");
+        }
+      }
+      continue;
+    }
+
+    if (trimmed_line[0] == '>') {
+      if (!rows.empty()) {
+        return std::unexpected(ParseError::InvalidFormat);
+      }
+      const auto words = split(trim(trimmed_line.substr(1)), ' ');
+      name = words.empty() ? std::string() : split(words[0], '\t')[0];
+      continue;
+    }
+    char label = 0;
+    auto values = parseMatrixRow(trimmed_line, label);
+    if (!values) {
+      return std::unexpected(ParseError::InvalidFormat);
+    }
+    rows.emplace_back(label, std::move(*values));
+    if (rows.size() == 4) {
+      auto matrix = transposeRows(rows);
+      if (!matrix) {
+        return std::unexpected(ParseError::InvalidFormat);
+      }
+      matrices.push_back({std::exchange(name, {}), std::move(*matrix)});
+      rows.clear();
+      updateStats("matrices_parsed");
+    }
+  }
+
+  if (!rows.empty() || remaining > 0) {
+    return std::unexpected(ParseError::InvalidFormat);
+  }
+
+  // Unnamed matrices are numbered in file order
+  for (size_t i = 0; i < matrices.size(); ++i) {
+    if (matrices[i].name.empty()) {
+      matrices[i].name = std::format("matrix{}", i + 1);
+    }
+  }
+
+  updateStats("files_closed");
+
+  return matrices;
+}
+
 bool DNAParser::validateSequence(std::string_view sequence) const noexcept {
   if (sequence.empty()) {
     return false;
@@ -0,0 +1,401 @@
+#include "fm_index.h"
+#include "kmer_index.h"
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dna_motif {
+
+namespace {
+
+constexpr uint64_t FILE_VERSION = 1;
+constexpr uint8_t SEPARATOR = 0;
+constexpr uint64_t ALPHABET = 5; // Separator and four nucleotides
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint64_t version;
+  uint64_t length;
+  uint64_t sequence_count;
+  uint64_t fingerprint;
+  std::array<uint64_t, 5> first_rows;
+  uint64_t body_words;
+};
+
+// Sort in per-thread chunks, then merge neighbouring chunks pairwise
+template <typename T> void parallelSort(std::vector<T> &values) {
+  const auto chunks = static_cast<size_t>(omp_get_max_threads());
+  std::vector<size_t> bounds(chunks + 1);
+  for (size_t c = 0; c <= chunks; ++c) {
+    bounds[c] = values.size() * c / chunks;
+  }
+
+#pragma omp parallel for schedule(static, 1)
+  for (size_t c = 0; c < chunks; ++c) {
+    std::sort(values.begin() + static_cast<ptrdiff_t>(bounds[c]),
+              values.begin() + static_cast<ptrdiff_t>(bounds[c + 1]));
+  }
+  for (size_t width = 1; width < chunks; width *= 2) {
+#pragma omp parallel for schedule(static, 1)
+    for (size_t c = 0; c < chunks; c += 2 * width) {
+      const size_t middle = std::min(c + width, chunks);
+      const size_t last = std::min(c + 2 * width, chunks);
+      std::inplace_merge(
+          values.begin() + static_cast<ptrdiff_t>(bounds[c]),
+          values.begin() + static_cast<ptrdiff_t>(bounds[middle]),
+          values.begin() + static_cast<ptrdiff_t>(bounds[last]));
+    }
+  }
+}
+
+// Whether every block's cumulative counts are the counts of the blocks
+// before it, no row carries two symbols or lies past the text, and the
+// rows before each symbol follow from the totals; occurrences() then stays
+// within each symbol's rows
+bool validBlocks(std::span<const uint64_t> blocks, size_t words,
+                 size_t length,
+                 const std::array<uint64_t, 5> &first_rows) noexcept {
+  constexpr size_t block_rows = FmIndex::BLOCK_ROWS;
+  std::array<uint64_t, 4> totals{};
+  for (size_t b = 0; b * words < blocks.size(); ++b) {
+    const uint64_t *block = blocks.data() + b * words;
+    if (block[4] != (totals[0] | (totals[1] << 32)) ||
+        block[5] != (totals[2] | (totals[3] << 32))) {
+      return false;
+    }
+    const size_t rows = std::min(block_rows, length - b * block_rows);
+    const uint64_t inside = rows == block_rows ? ~0ull : (1ull << rows) - 1;
+    uint64_t seen = 0;
+    for (size_t code = 0; code < 4; ++code) {
+      if ((block[code] & (seen | ~inside)) != 0) {
+        return false;
+      }
+      seen |= block[code];
+      totals[code] += static_cast<uint64_t>(std::popcount(block[code]));
+    }
+  }
+
+  const uint64_t symbols = totals[0] + totals[1] + totals[2] + totals[3];
+  if (first_rows[0] != 0 || first_rows[1] != length - symbols) {
+    return false;
+  }
+  for (size_t code = 1; code < 4; ++code) {
+    if (first_rows[code + 1] != first_rows[code] + totals[code - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+FmIndex FmIndex::build(const SequenceStore &store) {
+  // Nucleotide runs as symbols code + 1, each closed by one separator
+  std::vector<uint8_t> text;
+  std::vector<uint32_t> owners;
+  text.reserve(store.flatBases().size() + store.size());
+  owners.reserve(text.capacity());
+  for (size_t s = 0; s < store.size(); ++s) {
+    const std::string_view characters = store.sequence(s).sequence;
+    const std::span<const uint8_t> bases = store.bases(s);
+    const bool clean = store.isClean(s);
+    for (size_t i = 0; i <= bases.size(); ++i) {
+      const bool nucleotide =
+          i < bases.size() && (clean || isNucleotide(characters[i]));
+      if (nucleotide) {
+        text.push_back(static_cast<uint8_t>(bases[i] + 1));
+      } else if (!text.empty() && text.back() != SEPARATOR) {
+        text.push_back(SEPARATOR);
+      } else {
+        continue;
+      }
+      owners.push_back(static_cast<uint32_t>(s));
+    }
+  }
+  if (text.size() >= std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error("FM-index text exceeds 2^32 - 2 symbols");
+  }
+
+  FmIndex index;
+  const size_t n = text.size();
+  index.length_ = n;
+  index.sequence_count_ = store.size();
+  index.fingerprint_ = KmerIndex::fingerprint(store);
+
+  // Prefix doubling: sort by the first WINDOW_CODE_LENGTH symbols, then by
+  // (rank of suffix i, rank of suffix i + span) with span doubling until
+  // every rank is distinct; rank 0 stands for past the end
+  std::vector<std::pair<uint64_t, uint32_t>> keys(n);
+#pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t key = 0;
+    for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+      key = key * ALPHABET + (i + p < n ? text[i + p] : 0);
+    }
+    keys[i] = {key, static_cast<uint32_t>(i)};
+  }
+  parallelSort(keys);
+
+  std::vector<uint32_t> ranks(n);
+  for (size_t span = WINDOW_CODE_LENGTH;; span *= 2) {
+    size_t distinct = 0;
+    uint32_t rank = 0;
+    for (size_t j = 0; j < n; ++j) {
+      if (j == 0 || keys[j].first != keys[j - 1].first) {
+        rank = static_cast<uint32_t>(j + 1);
+        ++distinct;
+      }
+      ranks[keys[j].second] = rank;
+    }
+    if (distinct == n) {
+      break;
+    }
+
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+      keys[i] = {(static_cast<uint64_t>(ranks[i]) << 32) |
+                     (i + span < n ? ranks[i + span] : 0),
+                 static_cast<uint32_t>(i)};
+    }
+    parallelSort(keys);
+  }
+
+  // Occurrence table blocks, documents packed two per word after them
+  const size_t block_count = n / BLOCK_ROWS + 1;
+  index.buffer_.assign(block_count * BLOCK_WORDS + (n + 1) / 2, 0);
+  uint64_t *blocks = index.buffer_.data();
+  auto *documents =
+      reinterpret_cast<uint32_t *>(blocks + block_count * BLOCK_WORDS);
+
+#pragma omp parallel for schedule(static)
+  for (size_t row = 0; row < n; ++row) {
+    const uint32_t suffix = keys[row].second;
+    documents[row] = owners[suffix];
+  }
+#pragma omp parallel for schedule(static)
+  for (size_t b = 0; b < block_count; ++b) {
+    uint64_t *block = blocks + b * BLOCK_WORDS;
+    for (size_t row = b * BLOCK_ROWS; row < std::min(n, (b + 1) * BLOCK_ROWS);
+         ++row) {
+      const uint32_t suffix = keys[row].second;
+      const uint8_t previous = suffix == 0 ? SEPARATOR : text[suffix - 1];
+      if (previous != SEPARATOR) {
+        block[previous - 1] |= 1ull << (row % BLOCK_ROWS);
+      }
+    }
+  }
+
+  // Cumulative counts before each block, and rows before each symbol
+  std::array<uint64_t, 4> totals{};
+  for (size_t b = 0; b < block_count; ++b) {
+    uint64_t *block = blocks + b * BLOCK_WORDS;
+    block[4] = totals[0] | (totals[1] << 32);
+    block[5] = totals[2] | (totals[3] << 32);
+    for (size_t code = 0; code < 4; ++code) {
+      totals[code] += static_cast<uint64_t>(std::popcount(block[code]));
+    }
+  }
+  index.first_rows_[1] = n - (totals[0] + totals[1] + totals[2] + totals[3]);
+  for (size_t code = 1; code < 4; ++code) {
+    index.first_rows_[code + 1] = index.first_rows_[code] + totals[code - 1];
+  }
+
+  index.attach(index.buffer_);
+  return index;
+}
+
+FmIndex FmIndex::load(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open FM-index file: " + path);
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    throw std::runtime_error("Not an FM-index file: " + path);
+  }
+  const auto size = static_cast<size_t>(info.st_size);
+  void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    throw std::runtime_error("Cannot map FM-index file: " + path);
+  }
+
+  FmIndex index;
+  index.mapping_ = std::shared_ptr<const void>(address, [size](const void *p) {
+    ::munmap(const_cast<void *>(p), size);
+  });
+
+  FileHeader header;
+  std::memcpy(&header, address, sizeof(header));
+  if (std::string_view(header.magic.data(), header.magic.size()) !=
+          FILE_MAGIC ||
+      header.version != FILE_VERSION) {
+    throw std::runtime_error("Not an FM-index file: " + path);
+  }
+  // build() keeps the text and sequence ids below 2^32, so the body size
+  // cannot overflow once both are checked
+  const size_t block_count = header.length / BLOCK_ROWS + 1;
+  if (header.length >= std::numeric_limits<uint32_t>::max() ||
+      header.sequence_count > std::numeric_limits<uint32_t>::max() ||
+      header.body_words !=
+          block_count * BLOCK_WORDS + (header.length + 1) / 2 ||
+      header.body_words > (size - sizeof(header)) / sizeof(uint64_t)) {
+    throw std::runtime_error("Truncated or corrupt FM-index: " + path);
+  }
+
+  index.length_ = header.length;
+  index.sequence_count_ = header.sequence_count;
+  index.fingerprint_ = header.fingerprint;
+  index.first_rows_ = header.first_rows;
+  index.attach({reinterpret_cast<const uint64_t *>(
+                    static_cast<const char *>(address) + sizeof(header)),
+                header.body_words});
+
+  // Searches trust the occurrence table and the sequence ids, so both are
+  // checked once here
+  bool valid = validBlocks(index.blocks_, BLOCK_WORDS, index.length_,
+                           index.first_rows_);
+  const std::span<const uint32_t> documents = index.documents_;
+  const uint64_t sequence_count = index.sequence_count_;
+#pragma omp parallel for schedule(static) reduction(&& : valid)
+  for (size_t row = 0; row < documents.size(); ++row) {
+    valid = documents[row] < sequence_count && valid;
+  }
+  if (!valid) {
+    throw std::runtime_error("Corrupt FM-index: " + path);
+  }
+  return index;
+}
+
+void FmIndex::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    throw std::runtime_error("Cannot open FM-index file: " + path);
+  }
+
+  FileHeader header{};
+  std::ranges::copy(FILE_MAGIC, header.magic.begin());
+  header.version = FILE_VERSION;
+  header.length = length_;
+  header.sequence_count = sequence_count_;
+  header.fingerprint = fingerprint_;
+  header.first_rows = first_rows_;
+  header.body_words = blocks_.size() + (documents_.size() + 1) / 2;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(blocks_.data()),
+            static_cast<std::streamsize>(blocks_.size_bytes()));
+  out.write(reinterpret_cast<const char *>(documents_.data()),
+            static_cast<std::streamsize>(documents_.size_bytes()));
+  if (documents_.size() % 2 != 0) {
+    const uint32_t padding = 0;
+    out.write(reinterpret_cast<const char *>(&padding), sizeof(padding));
+  }
+  if (!out) {
+    throw std::runtime_error("Cannot write FM-index file: " + path);
+  }
+}
+
+bool FmIndex::matches(const SequenceStore &store) const {
+  return sequence_count_ == store.size() &&
+         fingerprint_ == KmerIndex::fingerprint(store);
+}
+
+size_t FmIndex::occurrences(uint8_t code, size_t row) const noexcept {
+  const uint64_t *block = blocks_.data() + row / BLOCK_ROWS * BLOCK_WORDS;
+  const uint64_t before = (block[4 + code / 2] >> (32 * (code % 2))) &
+                          std::numeric_limits<uint32_t>::max();
+  const uint64_t below = (1ull << (row % BLOCK_ROWS)) - 1;
+  return static_cast<size_t>(before) +
+         static_cast<size_t>(std::popcount(block[code] & below));
+}
+
+std::vector<FmIndex::Interval>
+FmIndex::search(std::string_view pattern,
+                const IUPACCodes &iupac_codes) const {
+  std::vector<uint8_t> masks;
+  for (char code : pattern) {
+    masks.push_back(iupac_codes.getBaseMask(code));
+    if (masks.back() == 0) {
+      return {};
+    }
+  }
+  if (masks.empty() || length_ == 0) {
+    return {};
+  }
+
+  // Depth-first over the last unmatched position, right to left
+  struct Frame {
+    Interval interval;
+    size_t remaining;
+  };
+  std::vector<Interval> found;
+  std::vector<Frame> stack = {{{0, length_}, masks.size()}};
+  while (!stack.empty()) {
+    const Frame frame = stack.back();
+    stack.pop_back();
+    if (frame.remaining == 0) {
+      found.push_back(frame.interval);
+      continue;
+    }
+    const uint8_t mask = masks[frame.remaining - 1];
+    for (uint8_t code = 0; code < 4; ++code) {
+      if ((mask & (1u << code)) == 0) {
+        continue;
+      }
+      const size_t first = first_rows_[code + 1];
+      const Interval next = {first + occurrences(code, frame.interval.low),
+                             first + occurrences(code, frame.interval.high)};
+      if (next.low < next.high) {
+        stack.push_back({next, frame.remaining - 1});
+      }
+    }
+  }
+  return found;
+}
+
+size_t FmIndex::countOccurrences(std::string_view pattern,
+                                 const IUPACCodes &iupac_codes) const {
+  size_t count = 0;
+  for (const auto &interval : search(pattern, iupac_codes)) {
+    count += interval.high - interval.low;
+  }
+  return count;
+}
+
+void FmIndex::markSequences(std::string_view pattern,
+                            const IUPACCodes &iupac_codes,
+                            std::span<uint64_t> bits) const {
+  for (const auto &interval : search(pattern, iupac_codes)) {
+    for (size_t row = interval.low; row < interval.high; ++row) {
+      const uint32_t sequence = documents_[row];
+      bits[sequence / 64] |= 1ull << (sequence % 64);
+    }
+  }
+}
+
+size_t FmIndex::countSequences(std::string_view pattern,
+                               const IUPACCodes &iupac_codes,
+                               bool both_strands) const {
+  std::vector<uint64_t> bits((sequence_count_ + 63) / 64, 0);
+  markSequences(pattern, iupac_codes, bits);
+  if (both_strands) {
+    markSequences(iupac_codes.reverseComplement(pattern), iupac_codes, bits);
+  }
+  return std::transform_reduce(
+      bits.begin(), bits.end(), 0uz, std::plus<>(),
+      [](uint64_t word) { return static_cast<size_t>(std::popcount(word)); });
+}
+
+void FmIndex::attach(std::span<const uint64_t> body) noexcept {
+  const size_t block_words = (length_ / BLOCK_ROWS + 1) * BLOCK_WORDS;
+  blocks_ = body.first(block_words);
+  documents_ = {reinterpret_cast<const uint32_t *>(body.data() + block_words),
+                length_};
+}
+
+} // namespace dna_motif
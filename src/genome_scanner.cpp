@@ -0,0 +1,207 @@
+#include "genome_scanner.h"
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+// Bytes read from the stream at a time
+constexpr size_t READ_SIZE = 1uz << 16;
+
+} // namespace
+
+GenomeScanner::GenomeScanner(const IUPACCodes &iupac_codes,
+                             std::span<const Motif> motifs,
+                             const GenomeScanOptions &options)
+    : motif_count_(motifs.size()), bin_size_(options.bin_size) {
+  if (motifs.empty()) {
+    throw std::invalid_argument("GenomeScanner needs at least one motif");
+  }
+  if (options.bin_size == 0 || options.block_size == 0) {
+    throw std::invalid_argument("Bin and block sizes must be positive");
+  }
+
+  block_size_ =
+      (options.block_size + bin_size_ - 1) / bin_size_ * bin_size_;
+
+  std::map<size_t, std::vector<size_t>> by_length;
+  for (size_t i = 0; i < motifs.size(); ++i) {
+    by_length[motifs[i].pattern.size()].push_back(i);
+  }
+
+  for (auto &[length, indices] : by_length) {
+    std::vector<Motif> group_motifs;
+    group_motifs.reserve(indices.size());
+    for (size_t i : indices) {
+      group_motifs.push_back(motifs[i]);
+    }
+
+    auto panel =
+        MotifPanel::compile(group_motifs, iupac_codes, options.both_strands);
+    if (!panel) {
+      throw std::invalid_argument(
+          std::format("Invalid motif of length {}", length));
+    }
+    groups_.push_back({std::move(*panel), std::move(indices)});
+    max_length_ = std::max(max_length_, length);
+  }
+}
+
+void GenomeScanner::scan(std::istream &input, const BinSink &sink) const {
+  const size_t chunk = chunkSize();
+  std::string id;
+  std::string buffer;
+  size_t offset = 0;
+  bool in_record = false;
+  bool in_header = false; // Inside a '>' line
+  bool in_id = false;     // Still in the first word of that line
+  bool line_start = true;
+
+  // Fixed-size reads rather than lines: a chromosome may be one line
+  std::vector<char> block(READ_SIZE);
+  while (input.read(block.data(), static_cast<std::streamsize>(block.size())) ||
+         input.gcount() > 0) {
+    const auto size = static_cast<size_t>(input.gcount());
+    for (size_t i = 0; i < size; ++i) {
+      const char c = block[i];
+      if (in_header) {
+        in_header = c != '\n';
+        in_id = in_id && in_header && c != ' ' && c != '\t' && c != '\r';
+        if (in_id) {
+          id += c;
+        }
+        line_start = !in_header;
+        continue;
+      }
+      if (line_start && c == '>') {
+        if (in_record) {
+          scanChunk(id, buffer, offset, buffer.size(), true, sink);
+        }
+        id.clear();
+        buffer.clear();
+        offset = 0;
+        in_record = true;
+        in_header = true;
+        in_id = true;
+        continue;
+      }
+      line_start = c == '\n';
+      if (in_record && !std::isspace(static_cast<unsigned char>(c))) {
+        buffer += c;
+      }
+    }
+
+    // Keep the overlap so windows crossing the chunk end are seen next time
+    while (buffer.size() >= chunk + overlap()) {
+      scanChunk(id, buffer, offset, chunk, false, sink);
+      buffer.erase(0, chunk);
+      offset += chunk;
+    }
+  }
+
+  if (in_record) {
+    scanChunk(id, buffer, offset, buffer.size(), true, sink);
+  }
+}
+
+void GenomeScanner::scanRecord(std::string_view id, std::string_view sequence,
+                               const BinSink &sink) const {
+  const size_t chunk = chunkSize();
+  size_t offset = 0;
+  while (sequence.size() - offset >= chunk + overlap()) {
+    scanChunk(id, sequence.substr(offset, chunk + overlap()), offset, chunk,
+              false, sink);
+    offset += chunk;
+  }
+
+  const std::string_view tail = sequence.substr(offset);
+  scanChunk(id, tail, offset, tail.size(), true, sink);
+}
+
+size_t GenomeScanner::chunkSize() const noexcept {
+  return block_size_ * static_cast<size_t>(omp_get_max_threads());
+}
+
+void GenomeScanner::scanChunk(std::string_view id, std::string_view text,
+                              size_t offset, size_t windows, bool final,
+                              const BinSink &sink) const {
+  // Non-final chunks cover whole blocks, hence whole bins
+  const size_t bins =
+      final ? (text.size() + bin_size_ - 1) / bin_size_ : windows / bin_size_;
+  std::vector<uint32_t> counts(bins * motif_count_, 0);
+
+  // Blocks are bin-aligned, so no two threads update the same bin
+  const size_t blocks = (windows + block_size_ - 1) / block_size_;
+#pragma omp parallel for schedule(dynamic)
+  for (size_t b = 0; b < blocks; ++b) {
+    scanBlock(text, b * block_size_, std::min(windows, (b + 1) * block_size_),
+              counts);
+  }
+
+  const size_t text_end = offset + text.size();
+  for (size_t k = 0; k < bins; ++k) {
+    const size_t start = offset + k * bin_size_;
+    sink(GenomeBin{
+        id, start, std::min(start + bin_size_, text_end),
+        std::span<const uint32_t>(counts).subspan(k * motif_count_,
+                                                  motif_count_)});
+  }
+}
+
+void GenomeScanner::scanBlock(std::string_view text, size_t first,
+                              size_t last, std::span<uint32_t> counts) const {
+  const size_t end = std::min(text.size(), last + max_length_ - 1);
+  if (first >= end) {
+    return;
+  }
+  const size_t n = end - first;
+
+  // 2-bit codes of the block and, per position, the next non-ACGT position
+  std::vector<uint8_t> codes(n);
+  std::vector<uint32_t> next_invalid(n + 1);
+  next_invalid[n] = static_cast<uint32_t>(n);
+  for (size_t i = n; i-- > 0;) {
+    const char c = text[first + i];
+    codes[i] = encodeNucleotide(c);
+    next_invalid[i] = isNucleotide(c) ? next_invalid[i + 1]
+                                      : static_cast<uint32_t>(i);
+  }
+
+  const size_t window_count = last - first;
+  for (const auto &group : groups_) {
+    const MotifPanel &panel = group.panel;
+    const size_t length = panel.motifLength();
+    const size_t words = panel.wordCount();
+    const bool both_strands = panel.strandCount() == 2;
+    std::vector<uint64_t> hits(words * panel.strandCount());
+
+    withMotifLength(length, [&](auto constant) {
+      constexpr size_t Length = decltype(constant)::value;
+      size_t w = 0;
+      while (w < window_count && w + length <= n) {
+        if (next_invalid[w] < w + length) {
+          w = next_invalid[w] + 1;
+          continue;
+        }
+
+        panel.matchWindow<Length>(codes.data() + w, hits.data());
+
+        uint32_t *row =
+            counts.data() + (first + w) / bin_size_ * motif_count_;
+        for (size_t k = 0; k < words; ++k) {
+          uint64_t found = hits[k] | (both_strands ? hits[words + k] : 0);
+          for (; found != 0; found &= found - 1) {
+            const size_t m =
+                k * 64 + static_cast<size_t>(std::countr_zero(found));
+            row[group.motif_indices[m]]++;
+          }
+        }
+        ++w;
+      }
+    });
+  }
+}
+
+} // namespace dna_motif
@@ -0,0 +1,128 @@
+#include "hit_bitsets.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dna_motif {
+
+namespace {
+
+// Set bits of a[i] & b[i] over count words
+uint64_t andPopcount(const uint64_t *a, const uint64_t *b,
+                     size_t count) noexcept {
+  uint64_t total = 0;
+  size_t i = 0;
+#if defined(__AVX2__)
+  // Per-nibble table lookups, summed per 64-bit lane with SAD
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                         2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+  __m256i sums = _mm256_setzero_si256();
+  for (; i + 4 <= count; i += 4) {
+    const __m256i v = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    const __m256i low = _mm256_and_si256(v, low_nibbles);
+    const __m256i high =
+        _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+    const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, low),
+                                          _mm256_shuffle_epi8(table, high));
+    sums = _mm256_add_epi64(sums,
+                            _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+  alignas(32) std::array<uint64_t, 4> lanes;
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes.data()), sums);
+  total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+  for (; i < count; ++i) {
+    total += static_cast<uint64_t>(std::popcount(a[i] & b[i]));
+  }
+  return total;
+}
+
+} // namespace
+
+HitBitsets::HitBitsets(size_t motif_count, size_t sequence_count)
+    : motif_count_(motif_count), sequence_count_(sequence_count),
+      word_count_((sequence_count + 63) / 64),
+      words_(motif_count * word_count_, 0) {}
+
+HitBitsets HitBitsets::fromResults(std::span<const MotifResult> results,
+                                   size_t sequence_count) {
+  HitBitsets bitsets(results.size(), sequence_count);
+  for (size_t m = 0; m < results.size(); ++m) {
+    for (const auto &match : results[m].matches) {
+      bitsets.set(m, match.sequence_index);
+    }
+  }
+  return bitsets;
+}
+
+size_t HitBitsets::count(size_t motif) const noexcept {
+  const auto bits = row(motif);
+  return static_cast<size_t>(andPopcount(bits.data(), bits.data(),
+                                         bits.size()));
+}
+
+size_t HitBitsets::count(size_t motif, size_t first,
+                         size_t last) const noexcept {
+  if (first >= last) {
+    return 0;
+  }
+  const auto bits = row(motif);
+  const size_t first_word = first / 64;
+  const size_t last_word = (last - 1) / 64;
+  const uint64_t head = ~0ull << (first % 64);
+  const uint64_t tail = ~0ull >> (63 - (last - 1) % 64);
+  if (first_word == last_word) {
+    return static_cast<size_t>(std::popcount(bits[first_word] & head & tail));
+  }
+  size_t total = static_cast<size_t>(std::popcount(bits[first_word] & head) +
+                                     std::popcount(bits[last_word] & tail));
+  for (size_t w = first_word + 1; w < last_word; ++w) {
+    total += static_cast<size_t>(std::popcount(bits[w]));
+  }
+  return total;
+}
+
+CooccurrenceMatrix HitBitsets::cooccurrence() const {
+  CooccurrenceMatrix matrix(motif_count_);
+  const size_t tiles = (motif_count_ + TILE_MOTIFS - 1) / TILE_MOTIFS;
+
+  // Upper triangle of tile pairs; each pair owns its matrix cells
+  std::vector<std::pair<size_t, size_t>> pairs;
+  for (size_t ta = 0; ta < tiles; ++ta) {
+    for (size_t tb = ta; tb < tiles; ++tb) {
+      pairs.emplace_back(ta, tb);
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (size_t p = 0; p < pairs.size(); ++p) {
+    const auto [ta, tb] = pairs[p];
+    const size_t a_end = std::min(motif_count_, (ta + 1) * TILE_MOTIFS);
+    const size_t b_end = std::min(motif_count_, (tb + 1) * TILE_MOTIFS);
+
+    for (size_t w = 0; w < word_count_; w += TILE_WORDS) {
+      const size_t words = std::min(TILE_WORDS, word_count_ - w);
+      for (size_t a = ta * TILE_MOTIFS; a < a_end; ++a) {
+        const uint64_t *row_a = words_.data() + a * word_count_ + w;
+        for (size_t b = std::max(a, tb * TILE_MOTIFS); b < b_end; ++b) {
+          matrix.counts[a * motif_count_ + b] +=
+              andPopcount(row_a, words_.data() + b * word_count_ + w, words);
+        }
+      }
+    }
+  }
+
+  for (size_t a = 0; a < motif_count_; ++a) {
+    for (size_t b = a + 1; b < motif_count_; ++b) {
+      matrix.counts[b * motif_count_ + a] = matrix.counts[a * motif_count_ + b];
+    }
+  }
+  return matrix;
+}
+
+} // namespace dna_motif
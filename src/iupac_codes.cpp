@@ -11,6 +11,8 @@ IUPACCodes::IUPACCodes() { initializeIUPACMap(); }
 constexpr void IUPACCodes::initializeIUPACMap() noexcept {
   iupac_map_.fill(nucleotide_set{});
   valid_codes_.fill(false);
+  base_masks_.fill(0);
+  complements_.fill('\0');
 
   // Standard nucleotides
   addMapping('A', {'A'});
@@ -34,6 +36,18 @@ constexpr void IUPACCodes::initializeIUPACMap() noexcept {
 
   // Four-way ambiguity
   addMapping('N', {'A', 'T', 'G', 'C'}); // aNy nucleotide
+
+  // Complementing swaps A<->T and C<->G, i.e. mask bits 0<->2 and 1<->3
+  for (char code : IUPAC_CODES) {
+    const uint8_t mask = base_masks_[static_cast<unsigned char>(code)];
+    const auto complement =
+        static_cast<uint8_t>(((mask << 2) | (mask >> 2)) & 0xF);
+    for (char other : IUPAC_CODES) {
+      if (base_masks_[static_cast<unsigned char>(other)] == complement) {
+        complements_[static_cast<unsigned char>(code)] = other;
+      }
+    }
+  }
 }
 
 constexpr void
@@ -47,6 +61,8 @@ IUPACCodes::addMapping(char iupac_code,
   for (const auto &nucleotide : nucleotides) {
     if (i < mapping.size()) {
       mapping[i++] = nucleotide;
+      base_masks_[index] |=
+          static_cast<uint8_t>(1u << encodeNucleotide(nucleotide));
     }
   }
 }
@@ -62,6 +78,25 @@ bool IUPACCodes::matchesMotif(std::string_view sequence, std::string_view motif,
       [&](size_t i) { return matches(sequence[start_pos + i], motif[i]); });
 }
 
+size_t IUPACCodes::countMismatches(std::string_view sequence,
+                                   std::string_view motif,
+                                   size_t start_pos) const noexcept {
+  if (start_pos + motif.length() > sequence.length()) {
+    return motif.length();
+  }
+
+  return static_cast<size_t>(std::ranges::count_if(
+      std::views::iota(0uz, motif.length()),
+      [&](size_t i) { return !matches(sequence[start_pos + i], motif[i]); }));
+}
+
+std::string IUPACCodes::reverseComplement(std::string_view motif) const {
+  std::string result(motif.rbegin(), motif.rend());
+  std::ranges::transform(result, result.begin(),
+                         [this](char code) { return getComplement(code); });
+  return result;
+}
+
 std::vector<size_t> IUPACCodes::findMotifMatches(std::string_view sequence,
                                                  std::string_view motif) const {
   if (sequence.length() < motif.length()) {
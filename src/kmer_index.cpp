@@ -0,0 +1,448 @@
+#include "kmer_index.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+constexpr uint32_t NOT_SEEN = ~0u;
+constexpr uint32_t FILE_VERSION = 1;
+
+uint64_t fnvBytes(uint64_t hash, const void *data, size_t size) noexcept {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+size_t varintSize(uint32_t value) noexcept {
+  return static_cast<size_t>(std::bit_width(value | 1u) + 6) / 7;
+}
+
+uint8_t *writeVarint(uint8_t *out, uint32_t value) noexcept {
+  while (value >= 0x80) {
+    *out++ = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(value);
+  return out;
+}
+
+// Unchecked; containers are validated by build() or load()
+const uint8_t *readVarint(const uint8_t *in, uint32_t &value) noexcept {
+  value = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const uint8_t byte = *in++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return in;
+    }
+  }
+}
+
+// Like readVarint, nullptr if the value runs past end or 32 bits
+const uint8_t *readVarint(const uint8_t *in, const uint8_t *end,
+                          uint32_t &value) noexcept {
+  value = 0;
+  for (unsigned shift = 0; shift < 32 && in < end; shift += 7) {
+    const uint8_t byte = *in++;
+    if (shift == 28 && (byte & 0x70) != 0) {
+      return nullptr;
+    }
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return in;
+    }
+  }
+  return nullptr;
+}
+
+// Whether a container holds count ascending ids below sequence_count: a
+// bitset of exactly the index's words, or varint deltas ending at its end
+bool validContainer(std::span<const uint8_t> bytes, bool dense,
+                    uint32_t count, uint64_t sequence_count) noexcept {
+  if (dense) {
+    if (bytes.size() != (sequence_count + 63) / 64 * sizeof(uint64_t)) {
+      return false;
+    }
+    uint64_t total = 0;
+    for (size_t byte = 0; byte < bytes.size(); ++byte) {
+      total += static_cast<uint64_t>(std::popcount(bytes[byte]));
+    }
+    // Padding bits past the last sequence stay clear
+    for (size_t id = sequence_count; id % 8 != 0; ++id) {
+      if ((bytes[id / 8] >> (id % 8)) & 1u) {
+        return false;
+      }
+    }
+    return total == count &&
+           std::all_of(bytes.begin() + static_cast<ptrdiff_t>(
+                                           (sequence_count + 7) / 8),
+                       bytes.end(), [](uint8_t byte) { return byte == 0; });
+  }
+
+  const uint8_t *in = bytes.data();
+  const uint8_t *end = in + bytes.size();
+  uint64_t id = 0;
+  uint64_t ids = 0;
+  while (in < end) {
+    uint32_t delta = 0;
+    in = readVarint(in, end, delta);
+    if (in == nullptr || (ids > 0 && delta == 0)) {
+      return false;
+    }
+    id += delta;
+    if (id >= sequence_count) {
+      return false;
+    }
+    ++ids;
+  }
+  return ids == count;
+}
+
+template <typename T, size_t Extent>
+void writeArray(std::ofstream &out, std::span<T, Extent> values) {
+  out.write(reinterpret_cast<const char *>(values.data()),
+            static_cast<std::streamsize>(values.size_bytes()));
+}
+
+template <typename T, size_t Extent>
+void readArray(std::ifstream &in, std::span<T, Extent> values) {
+  in.read(reinterpret_cast<char *>(values.data()),
+          static_cast<std::streamsize>(values.size_bytes()));
+}
+
+} // namespace
+
+KmerIndex KmerIndex::build(const SequenceStore &store) {
+  if (store.size() >= (1ull << 32)) {
+    throw std::length_error("K-mer index holds at most 2^32 - 1 sequences");
+  }
+
+  KmerIndex index;
+  index.sequence_count_ = store.size();
+  index.fingerprint_ = fingerprint(store);
+
+  // Distinct codes of each sequence with their sequence id, per thread over
+  // a contiguous block so every thread's ids ascend
+  const auto max_threads = static_cast<size_t>(omp_get_max_threads());
+  std::vector<std::vector<uint32_t>> cursors(max_threads);
+  std::vector<std::vector<uint16_t>> thread_codes(max_threads);
+  std::vector<std::vector<uint32_t>> thread_ids(max_threads);
+
+#pragma omp parallel
+  {
+    const auto t = static_cast<size_t>(omp_get_thread_num());
+    const auto threads = static_cast<size_t>(omp_get_num_threads());
+    auto &counts = cursors[t];
+    auto &codes = thread_codes[t];
+    auto &ids = thread_ids[t];
+    counts.assign(WINDOW_CODE_SPACE, 0);
+    std::vector<uint32_t> last_seen(WINDOW_CODE_SPACE, NOT_SEEN);
+
+    for (size_t s = store.size() * t / threads;
+         s < store.size() * (t + 1) / threads; ++s) {
+      const std::string_view text = store.sequence(s).sequence;
+      const std::span<const uint8_t> bases = store.bases(s);
+      const bool clean = store.isClean(s);
+      const auto id = static_cast<uint32_t>(s);
+      uint32_t code = 0;
+      size_t run = 0;
+      for (size_t i = 0; i < bases.size(); ++i) {
+        if (!clean && !isNucleotide(text[i])) {
+          run = 0;
+          continue;
+        }
+        code = ((code << NUCLEOTIDE_CODE_BITS) | bases[i]) &
+               static_cast<uint32_t>(WINDOW_CODE_SPACE - 1);
+        if (++run >= WINDOW_CODE_LENGTH && last_seen[code] != id) {
+          last_seen[code] = id;
+          codes.push_back(static_cast<uint16_t>(code));
+          ids.push_back(id);
+          counts[code]++;
+        }
+      }
+    }
+  }
+
+  // Turn per-thread counts into write cursors, code-major then thread
+  index.counts_.assign(WINDOW_CODE_SPACE, 0);
+  std::vector<size_t> begins(WINDOW_CODE_SPACE + 1, 0);
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    begins[code + 1] = begins[code];
+    for (auto &counts : cursors) {
+      if (counts.empty()) {
+        continue;
+      }
+      const uint32_t count = counts[code];
+      counts[code] = static_cast<uint32_t>(begins[code + 1]);
+      begins[code + 1] += count;
+      index.counts_[code] += count;
+    }
+  }
+
+  std::vector<uint32_t> sorted(begins.back());
+#pragma omp parallel for schedule(static, 1)
+  for (size_t t = 0; t < max_threads; ++t) {
+    for (size_t k = 0; k < thread_codes[t].size(); ++k) {
+      sorted[cursors[t][thread_codes[t][k]]++] = thread_ids[t][k];
+    }
+  }
+
+  // Pick the smaller container per code, then encode into place
+  const size_t bitset_bytes = index.wordCount() * sizeof(uint64_t);
+  index.dense_.assign(WINDOW_CODE_SPACE, 0);
+  index.offsets_.assign(WINDOW_CODE_SPACE + 1, 0);
+#pragma omp parallel for schedule(dynamic, 256)
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    size_t bytes = 0;
+    uint32_t previous = 0;
+    for (size_t k = begins[code]; k < begins[code + 1]; ++k) {
+      bytes += varintSize(sorted[k] - previous);
+      previous = sorted[k];
+    }
+    if (bytes > bitset_bytes) {
+      index.dense_[code] = 1;
+      bytes = bitset_bytes;
+    }
+    index.offsets_[code + 1] = bytes;
+  }
+  std::inclusive_scan(index.offsets_.begin(), index.offsets_.end(),
+                      index.offsets_.begin());
+
+  index.data_.assign(index.offsets_.back(), 0);
+#pragma omp parallel for schedule(dynamic, 256)
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    uint8_t *out = index.data_.data() + index.offsets_[code];
+    if (index.dense_[code]) {
+      for (size_t k = begins[code]; k < begins[code + 1]; ++k) {
+        out[sorted[k] / 8] |= static_cast<uint8_t>(1u << (sorted[k] % 8));
+      }
+      continue;
+    }
+    uint32_t previous = 0;
+    for (size_t k = begins[code]; k < begins[code + 1]; ++k) {
+      out = writeVarint(out, sorted[k] - previous);
+      previous = sorted[k];
+    }
+  }
+
+  return index;
+}
+
+KmerIndex KmerIndex::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    throw std::runtime_error("Cannot open index file: " + path);
+  }
+
+  std::array<char, FILE_MAGIC.size()> magic{};
+  uint32_t version = 0;
+  uint32_t code_length = 0;
+  uint64_t sequence_count = 0;
+  uint64_t data_size = 0;
+  KmerIndex index;
+  readArray(in, std::span(magic));
+  readArray(in, std::span(&version, 1));
+  readArray(in, std::span(&code_length, 1));
+  readArray(in, std::span(&sequence_count, 1));
+  readArray(in, std::span(&index.fingerprint_, 1));
+  readArray(in, std::span(&data_size, 1));
+  if (!in || std::string_view(magic.data(), magic.size()) != FILE_MAGIC ||
+      version != FILE_VERSION || code_length != WINDOW_CODE_LENGTH) {
+    throw std::runtime_error("Not a k-mer index file: " + path);
+  }
+
+  index.sequence_count_ = sequence_count;
+  index.counts_.resize(WINDOW_CODE_SPACE);
+  index.dense_.resize(WINDOW_CODE_SPACE);
+  index.offsets_.resize(WINDOW_CODE_SPACE + 1);
+  index.data_.resize(data_size);
+  readArray(in, std::span(index.counts_));
+  readArray(in, std::span(index.dense_));
+  readArray(in, std::span(index.offsets_));
+  readArray(in, std::span(index.data_));
+  if (!in || index.offsets_.front() != 0 ||
+      index.offsets_.back() != data_size ||
+      !std::ranges::is_sorted(index.offsets_) ||
+      sequence_count >= (1ull << 32)) {
+    throw std::runtime_error("Truncated or corrupt k-mer index: " + path);
+  }
+
+  // Queries trust the containers, so every one is checked once here
+  bool valid = true;
+#pragma omp parallel for schedule(dynamic, 256) reduction(&& : valid)
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    const std::span<const uint8_t> bytes(
+        index.data_.data() + index.offsets_[code],
+        index.offsets_[code + 1] - index.offsets_[code]);
+    valid = validContainer(bytes, index.dense_[code] != 0,
+                           index.counts_[code], sequence_count) &&
+            valid;
+  }
+  if (!valid) {
+    throw std::runtime_error("Corrupt k-mer index: " + path);
+  }
+  return index;
+}
+
+void KmerIndex::save(const std::string &path) const {
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    throw std::runtime_error("Cannot open index file: " + path);
+  }
+
+  const uint32_t version = FILE_VERSION;
+  const auto code_length = static_cast<uint32_t>(WINDOW_CODE_LENGTH);
+  const uint64_t sequence_count = sequence_count_;
+  const uint64_t data_size = data_.size();
+  writeArray(out, std::span(FILE_MAGIC));
+  writeArray(out, std::span(&version, 1));
+  writeArray(out, std::span(&code_length, 1));
+  writeArray(out, std::span(&sequence_count, 1));
+  writeArray(out, std::span(&fingerprint_, 1));
+  writeArray(out, std::span(&data_size, 1));
+  writeArray(out, std::span(counts_));
+  writeArray(out, std::span(dense_));
+  writeArray(out, std::span(offsets_));
+  writeArray(out, std::span(data_));
+  if (!out) {
+    throw std::runtime_error("Cannot write index file: " + path);
+  }
+}
+
+uint64_t KmerIndex::fingerprint(const SequenceStore &store) {
+  uint64_t hash = FNV_OFFSET;
+  for (const auto &sequence : store.sequences()) {
+    const uint64_t length = sequence.sequence.size();
+    hash = fnvBytes(hash, &length, sizeof(length));
+    hash = fnvBytes(hash, sequence.sequence.data(), sequence.sequence.size());
+  }
+  return hash;
+}
+
+std::vector<uint32_t> KmerIndex::posting(uint16_t code) const {
+  std::vector<uint32_t> ids;
+  ids.reserve(counts_[code]);
+  const uint8_t *in = data_.data() + offsets_[code];
+  const uint8_t *end = data_.data() + offsets_[code + 1];
+  if (isDense(code)) {
+    for (size_t byte = 0; in + byte < end; ++byte) {
+      for (uint32_t bits = in[byte]; bits != 0; bits &= bits - 1) {
+        ids.push_back(static_cast<uint32_t>(byte * 8) +
+                      static_cast<uint32_t>(std::countr_zero(bits)));
+      }
+    }
+    return ids;
+  }
+
+  uint32_t id = 0;
+  while (in < end) {
+    uint32_t delta = 0;
+    in = readVarint(in, delta);
+    id += delta;
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+void KmerIndex::orPosting(uint16_t code,
+                          std::span<uint64_t> bits) const noexcept {
+  const uint8_t *in = data_.data() + offsets_[code];
+  const uint8_t *end = data_.data() + offsets_[code + 1];
+  if (isDense(code)) {
+    // Bitset containers share the word layout; the loop vectorizes
+    for (size_t w = 0; w < bits.size(); ++w) {
+      uint64_t word;
+      std::memcpy(&word, in + w * sizeof(uint64_t), sizeof(word));
+      bits[w] |= word;
+    }
+    return;
+  }
+
+  uint32_t id = 0;
+  while (in < end) {
+    uint32_t delta = 0;
+    in = readVarint(in, delta);
+    id += delta;
+    bits[id / 64] |= 1ull << (id % 64);
+  }
+}
+
+std::vector<uint64_t> KmerIndex::lookup(const KmerTable &table) const {
+  std::vector<uint64_t> bits(wordCount(), 0);
+  if (counts_.empty()) {
+    return bits;
+  }
+  const auto words = table.words();
+  for (size_t w = 0; w < words.size(); ++w) {
+    for (uint64_t codes = words[w]; codes != 0; codes &= codes - 1) {
+      const auto code = static_cast<uint16_t>(
+          w * 64 + static_cast<size_t>(std::countr_zero(codes)));
+      if (counts_[code] != 0) {
+        orPosting(code, bits);
+      }
+    }
+  }
+  return bits;
+}
+
+size_t KmerIndex::count(const KmerTable &table) const {
+  const std::vector<uint64_t> bits = lookup(table);
+  return std::transform_reduce(
+      bits.begin(), bits.end(), 0uz, std::plus<>(),
+      [](uint64_t word) { return static_cast<size_t>(std::popcount(word)); });
+}
+
+size_t KmerIndex::countUnion(std::span<const uint16_t> codes,
+                             std::span<uint64_t> scratch) const noexcept {
+  if (counts_.empty()) {
+    return 0;
+  }
+  if (std::ranges::any_of(codes, [&](uint16_t code) {
+        return counts_[code] != 0 && isDense(code);
+      })) {
+    for (const uint16_t code : codes) {
+      orPosting(code, scratch);
+    }
+    size_t total = 0;
+    for (uint64_t &word : scratch) {
+      total += static_cast<size_t>(std::popcount(word));
+      word = 0;
+    }
+    return total;
+  }
+
+  size_t total = 0;
+  for (const uint16_t code : codes) {
+    const uint8_t *in = data_.data() + offsets_[code];
+    const uint8_t *end = data_.data() + offsets_[code + 1];
+    uint32_t id = 0;
+    while (in < end) {
+      uint32_t delta = 0;
+      in = readVarint(in, delta);
+      id += delta;
+      const uint64_t bit = 1ull << (id % 64);
+      total += (scratch[id / 64] & bit) == 0;
+      scratch[id / 64] |= bit;
+    }
+  }
+  for (const uint16_t code : codes) {
+    const uint8_t *in = data_.data() + offsets_[code];
+    const uint8_t *end = data_.data() + offsets_[code + 1];
+    uint32_t id = 0;
+    while (in < end) {
+      uint32_t delta = 0;
+      in = readVarint(in, delta);
+      id += delta;
+      scratch[id / 64] = 0;
+    }
+  }
+  return total;
+}
+
+} // namespace dna_motif
@@ -0,0 +1,95 @@
+#include "kmer_spectrum.h"
+#include <numeric>
+
+namespace dna_motif {
+
+namespace {
+
+// Bases per flush of the 32-bit slots into the 64-bit thread counts
+constexpr size_t CHUNK_BASES = 1uz << 31;
+
+// Counters of one code, kept together so a window touches one cache line
+struct Slot {
+  uint32_t occurrences;
+  uint32_t sequences;
+  uint32_t last_seen; // Chunk-relative sequence stamp, 0 for none
+};
+
+// First sequence of thread t when the bases of sequences [begin, end) are
+// split evenly between threads
+size_t firstSequence(const SequenceStore &store, size_t begin, size_t end,
+                     size_t t, size_t threads) {
+  if (t == threads) {
+    return end;
+  }
+  const size_t base = store.baseOffset(begin);
+  const size_t target = base + (store.baseOffset(end) - base) * t / threads;
+  return *std::ranges::partition_point(
+      std::views::iota(begin, end + 1),
+      [&](size_t s) { return store.baseOffset(s) < target; });
+}
+
+} // namespace
+
+KmerSpectrum KmerSpectrum::count(const SequenceStore &store, size_t part,
+                                 size_t parts) {
+  const size_t begin = store.size() * part / parts;
+  const size_t stop = store.size() * (part + 1) / parts;
+  const auto max_threads = static_cast<size_t>(omp_get_max_threads());
+  std::vector<std::vector<uint64_t>> partials(max_threads);
+
+#pragma omp parallel
+  {
+    const auto t = static_cast<size_t>(omp_get_thread_num());
+    const auto threads = static_cast<size_t>(omp_get_num_threads());
+    // Allocated by the thread that fills it
+    auto &local = partials[t];
+    local.assign(2 * WINDOW_CODE_SPACE, 0);
+    std::vector<Slot> slots(WINDOW_CODE_SPACE);
+
+    const size_t end = firstSequence(store, begin, stop, t + 1, threads);
+    size_t s = firstSequence(store, begin, stop, t, threads);
+    while (s < end) {
+      // Fewer than 2^32 windows and sequences per chunk, so no slot wraps
+      const size_t chunk_begin = s;
+      const size_t limit = store.baseOffset(s) + CHUNK_BASES;
+      std::ranges::fill(slots, Slot{0, 0, 0});
+      do {
+        const auto stamp = static_cast<uint32_t>(s - chunk_begin + 1);
+        store.forEachWindowCode(s, [&](size_t code) {
+          Slot &slot = slots[code];
+          slot.occurrences++;
+          slot.sequences += slot.last_seen != stamp;
+          slot.last_seen = stamp;
+        });
+      } while (++s < end && store.baseOffset(s + 1) <= limit &&
+               s - chunk_begin < CHUNK_BASES);
+
+      for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+        local[code] += slots[code].occurrences;
+        local[WINDOW_CODE_SPACE + code] += slots[code].sequences;
+      }
+    }
+  }
+
+  KmerSpectrum spectrum;
+  spectrum.sequence_count = stop - begin;
+#pragma omp parallel for schedule(static)
+  for (size_t c = 0; c < spectrum.counts.size(); ++c) {
+    uint64_t sum = 0;
+    for (const auto &local : partials) {
+      if (!local.empty()) {
+        sum += local[c];
+      }
+    }
+    spectrum.counts[c] = sum;
+  }
+  return spectrum;
+}
+
+uint64_t KmerSpectrum::windowCount() const noexcept {
+  const auto counted = occurrences();
+  return std::reduce(counted.begin(), counted.end(), uint64_t{0});
+}
+
+} // namespace dna_motif
@@ -8,6 +8,7 @@
 #include <ranges>
 #include <span>
 #include <string>
+#include <utility>
 
 using namespace dna_motif;
 
@@ -17,6 +18,31 @@ struct CommandLineArgs {
   std::string motifs_file;
   std::string output_file;
   int num_threads = 0;
+  ScanOptions scan_options;
+  size_t genome_bin_size = 0;
+  std::optional<double> pwm_threshold;
+  bool count_matrices = false;
+  std::string positions_file;
+  std::string cooccurrence_file;
+  std::vector<std::string> queries;
+  std::string spacing_file;
+  SpacingOptions spacing_options;
+  std::optional<double> cluster_threshold;
+  size_t minhash_hashes = 0;
+  std::string index_file;
+  std::string spectrum_file;
+  std::string background_file;
+  size_t shuffles = 0;
+  uint64_t seed = 1;
+  bool discover = false;
+  DiscoveryOptions discovery_options;
+  std::string neighbourhood_file;
+  NeighbourhoodOptions neighbourhood_options;
+  std::string expected_file;
+  size_t markov_order = 2;
+  size_t bootstrap_replicates = 0;
+  double confidence = 0.95;
+  IndexEngine index_engine = IndexEngine::Kmer;
   bool verbose = false;
   bool help = false;
 };
@@ -38,6 +64,110 @@ void printUsage(std::string_view program_name) {
   std::cout << "\nOptions:\n";
   std::cout << "  -t, --threads <num>    Number of OpenMP threads per process "
                "(default: auto)\n";
+  std::cout << "  -k, --kernel <name>    Scan kernel: auto, scalar, "
+               "window-codes, prefilter,\n"
+               "                         motif-major, swar (default: auto)\n";
+  std::cout << "  -b, --both-strands     Also match reverse complements of "
+               "motifs\n";
+  std::cout << "  -m, --max-mismatches <k>\n"
+               "                         Allow up to k (0-2) mismatching "
+               "positions\n";
+  std::cout << "  -g, --genome-bins <bp> Stream chip_seq_file as a genome and "
+               "count hits\n"
+               "                         per bin of <bp> bases (exact hits; "
+               "not with -m,\n"
+               "                         -k auto or motif-major only)\n";
+  std::cout << "  -p, --positions <file> Save per-offset hit counts of every "
+               "motif to <file>\n"
+               "                         (exact hits; not with -m)\n";
+  std::cout << "  -c, --cooccurrence <file>\n"
+               "                         Save the motif co-occurrence matrix "
+               "to <file>\n";
+  std::cout << "  -q, --query <expr>     Count sequences matching a boolean "
+               "motif query,\n"
+               "                         e.g. \"(TRTWKACH AND NOT RTTKACHY) "
+               "OR #3\"; repeatable\n";
+  std::cout << "  -s, --spacing <file>   Save hit spacing histograms of "
+               "motif pairs to <file>\n";
+  std::cout << "  --spacing-distance <bp>\n"
+               "                         Largest pair spacing counted "
+               "(default: 20)\n";
+  std::cout << "  --spacing-pair <i:j>   Analyze motifs i and j (0-based); "
+               "repeatable,\n"
+               "                         every pair when omitted\n";
+  std::cout << "  -j, --cluster <t>      Cluster motifs whose hit sets have "
+               "Jaccard similarity\n"
+               "                         of at least t (0-1), single "
+               "linkage\n";
+  std::cout << "  --minhash <k>          Estimate similarities for -j from "
+               "k-entry MinHash\n"
+               "                         signatures\n";
+  std::cout << "  -z, --zone-maps        Skip blocks of sequences whose 8-mer "
+               "summary rules out\n"
+               "                         a motif\n";
+  std::cout << "  -e, --spectrum <file>  Save occurrence and sequence counts "
+               "of every 8-mer\n";
+  std::cout << "  -x, --index <file>     Count motif hits from an 8-mer index "
+               "saved in <file>,\n"
+               "                         built first if missing or stale\n";
+  std::cout << "  -f, --fm-index <file>  Count motif hits of any length from "
+               "an FM-index\n"
+               "                         mapped from <file>, built first if "
+               "missing or stale\n";
+  std::cout << "  --background <file>    Compare motif frequencies with "
+               "background sequences\n"
+               "                         from <file>: fold enrichment and "
+               "Fisher p-value\n";
+  std::cout << "  --shuffles <N>         Without --background, compare with "
+               "N dinucleotide-\n"
+               "                         preserving shuffles of the "
+               "sequences: empirical p-value\n";
+  std::cout << "  --seed <s>             Seed of the shuffles and bootstrap "
+               "(default: 1)\n";
+  std::cout << "  -d, --discover <k>     Discover the k most enriched "
+               "8-position IUPAC motifs\n"
+               "                         instead of counting motifs; takes "
+               "<chip_seq_file>\n"
+               "                         [output_file] only; every process "
+               "parses and\n"
+               "                         indexes all sequences, only the "
+               "search is split\n";
+  std::cout << "  --max-degenerate <n>   Degenerate positions allowed in "
+               "discovered motifs\n"
+               "                         (default: 2)\n";
+  std::cout << "  --rank-by <name>       Rank discovered motifs by enrichment "
+               "or frequency\n";
+  std::cout << "  -n, --neighbourhood <file>\n"
+               "                         Save counts and enrichment of every "
+               "single-position\n"
+               "                         variant of each motif to <file>\n";
+  std::cout << "  --climb <steps>        Also move each motif to its most "
+               "enriched neighbour\n"
+               "                         up to <steps> times, reported with "
+               "-n\n";
+  std::cout << "  --min-frequency <f>    Smallest fraction of sequences a "
+               "discovered motif or\n"
+               "                         climbing move must occur in "
+               "(default: 0.05)\n";
+  std::cout << "  --expected <file>      Save expected motif frequencies "
+               "under a Markov\n"
+               "                         background fitted to the sequences "
+               "to <file>\n";
+  std::cout << "  --markov-order <k>     Order of the --expected background "
+               "(0-3, default: 2)\n";
+  std::cout << "  --bootstrap <B>        Print confidence intervals of the "
+               "motif frequencies\n"
+               "                         from B bootstrap replicates of the "
+               "sequences\n";
+  std::cout << "  --confidence <c>       Coverage of the --bootstrap "
+               "intervals (default: 0.95)\n";
+  std::cout << "  -w, --pwm-threshold <t>\n"
+               "                         Score motifs as PWMs; hits reach "
+               "fraction t (0-1)\n"
+               "                         of the score range\n";
+  std::cout << "  -M, --matrices         Read motifs_file as JASPAR or MEME "
+               "count matrices\n"
+               "                         (requires -w)\n";
   std::cout << "  -h, --help             Show this help message\n";
   std::cout << "  -v, --verbose          Enable verbose output\n";
   std::cout << "\nArguments:\n";
@@ -74,6 +204,333 @@ ParseResult parseArguments(std::span<const char *> args) {
       } else {
         return std::unexpected(ParseError::InvalidArgument);
       }
+    } else if (arg == "-k" || arg == "--kernel") {
+      if (i + 1 < args.size()) {
+        auto kernel = parseScanKernel(args[++i]);
+        if (!kernel) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+        result.scan_options.kernel = *kernel;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-b" || arg == "--both-strands") {
+      result.scan_options.both_strands = true;
+    } else if (arg == "-g" || arg == "--genome-bins") {
+      if (i + 1 < args.size()) {
+        try {
+          const int bin_size = std::stoi(std::string(args[++i]));
+          if (bin_size <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.genome_bin_size = static_cast<size_t>(bin_size);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-p" || arg == "--positions") {
+      if (i + 1 < args.size()) {
+        result.positions_file = args[++i];
+        result.scan_options.position_histogram = true;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-c" || arg == "--cooccurrence") {
+      if (i + 1 < args.size()) {
+        result.cooccurrence_file = args[++i];
+        result.scan_options.keep_hit_bitsets = true;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-q" || arg == "--query") {
+      if (i + 1 < args.size()) {
+        result.queries.emplace_back(args[++i]);
+        // Queries read the bitsets only, not the co-occurrence matrix
+        result.scan_options.keep_hit_bitsets = true;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-s" || arg == "--spacing") {
+      if (i + 1 < args.size()) {
+        result.spacing_file = args[++i];
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--spacing-distance") {
+      if (i + 1 < args.size()) {
+        try {
+          const int distance = std::stoi(std::string(args[++i]));
+          if (distance <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.spacing_options.max_distance = static_cast<size_t>(distance);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--spacing-pair") {
+      if (i + 1 < args.size()) {
+        const auto parts = split(args[++i], ':');
+        try {
+          if (parts.size() != 2) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          const int a = std::stoi(parts[0]);
+          const int b = std::stoi(parts[1]);
+          if (a < 0 || b < 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.spacing_options.pairs.emplace_back(static_cast<size_t>(a),
+                                                    static_cast<size_t>(b));
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-j" || arg == "--cluster") {
+      if (i + 1 < args.size()) {
+        try {
+          const double threshold = std::stod(std::string(args[++i]));
+          if (!(threshold > 0.0 && threshold <= 1.0)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.cluster_threshold = threshold;
+          result.scan_options.keep_hit_bitsets = true;
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--minhash") {
+      if (i + 1 < args.size()) {
+        try {
+          const int hashes = std::stoi(std::string(args[++i]));
+          if (hashes <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.minhash_hashes = static_cast<size_t>(hashes);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-z" || arg == "--zone-maps") {
+      result.scan_options.zone_maps = true;
+    } else if (arg == "-e" || arg == "--spectrum") {
+      if (i + 1 < args.size()) {
+        result.spectrum_file = args[++i];
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-x" || arg == "--index") {
+      if (i + 1 < args.size()) {
+        result.index_file = args[++i];
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-f" || arg == "--fm-index") {
+      if (i + 1 < args.size()) {
+        result.index_file = args[++i];
+        result.index_engine = IndexEngine::Fm;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--background") {
+      if (i + 1 < args.size()) {
+        result.background_file = args[++i];
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--shuffles") {
+      if (i + 1 < args.size()) {
+        try {
+          const int shuffles = std::stoi(std::string(args[++i]));
+          if (shuffles <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.shuffles = static_cast<size_t>(shuffles);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--seed") {
+      if (i + 1 < args.size()) {
+        try {
+          result.seed = std::stoull(std::string(args[++i]));
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-d" || arg == "--discover") {
+      if (i + 1 < args.size()) {
+        try {
+          const int top_k = std::stoi(std::string(args[++i]));
+          if (top_k <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.discover = true;
+          result.discovery_options.top_k = static_cast<size_t>(top_k);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--max-degenerate") {
+      if (i + 1 < args.size()) {
+        try {
+          const int degenerate = std::stoi(std::string(args[++i]));
+          if (degenerate < 0 ||
+              degenerate > static_cast<int>(WINDOW_CODE_LENGTH)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.discovery_options.max_degenerate =
+              static_cast<size_t>(degenerate);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--rank-by") {
+      if (i + 1 < args.size()) {
+        auto objective = parseDiscoveryObjective(args[++i]);
+        if (!objective) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+        result.discovery_options.objective = *objective;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-n" || arg == "--neighbourhood") {
+      if (i + 1 < args.size()) {
+        result.neighbourhood_file = args[++i];
+        result.neighbourhood_options.enabled = true;
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--climb") {
+      if (i + 1 < args.size()) {
+        try {
+          const int steps = std::stoi(std::string(args[++i]));
+          if (steps < 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.neighbourhood_options.max_steps = static_cast<size_t>(steps);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--min-frequency") {
+      if (i + 1 < args.size()) {
+        try {
+          const double frequency = std::stod(std::string(args[++i]));
+          if (!(frequency >= 0.0 && frequency <= 1.0)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.discovery_options.min_frequency = frequency;
+          result.neighbourhood_options.min_frequency = frequency;
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--expected") {
+      if (i + 1 < args.size()) {
+        result.expected_file = args[++i];
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--markov-order") {
+      if (i + 1 < args.size()) {
+        try {
+          const int order = std::stoi(std::string(args[++i]));
+          if (order < 0 ||
+              order > static_cast<int>(MarkovBackground::MAX_ORDER)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.markov_order = static_cast<size_t>(order);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--bootstrap") {
+      if (i + 1 < args.size()) {
+        try {
+          const int replicates = std::stoi(std::string(args[++i]));
+          if (replicates <= 0) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.bootstrap_replicates = static_cast<size_t>(replicates);
+          // Bitsets only; the co-occurrence matrix stays off
+          result.scan_options.keep_hit_bitsets = true;
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "--confidence") {
+      if (i + 1 < args.size()) {
+        try {
+          const double confidence = std::stod(std::string(args[++i]));
+          if (!(confidence > 0.0 && confidence < 1.0)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.confidence = confidence;
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-w" || arg == "--pwm-threshold") {
+      if (i + 1 < args.size()) {
+        try {
+          const double threshold = std::stod(std::string(args[++i]));
+          if (!(threshold >= 0.0 && threshold <= 1.0)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.pwm_threshold = threshold;
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
+    } else if (arg == "-M" || arg == "--matrices") {
+      result.count_matrices = true;
+    } else if (arg == "-m" || arg == "--max-mismatches") {
+      if (i + 1 < args.size()) {
+        try {
+          const int mismatches = std::stoi(std::string(args[++i]));
+          if (mismatches < 0 ||
+              mismatches > static_cast<int>(MismatchMotif::MAX_MISMATCHES)) {
+            return std::unexpected(ParseError::InvalidValue);
+          }
+          result.scan_options.max_mismatches = static_cast<size_t>(mismatches);
+        } catch (const std::exception &) {
+          return std::unexpected(ParseError::InvalidValue);
+        }
+      } else {
+        return std::unexpected(ParseError::InvalidArgument);
+      }
     } else if (arg[0] != '-') {
       if (result.chip_seq_file.empty()) {
         result.chip_seq_file = arg;
@@ -87,10 +544,44 @@ ParseResult parseArguments(std::span<const char *> args) {
     }
   }
 
-  if (result.chip_seq_file.empty() || result.motifs_file.empty()) {
+  // Discovery reads no motifs; the second positional names the output
+  if (result.discover) {
+    if (result.output_file.empty()) {
+      result.output_file = std::exchange(result.motifs_file, {});
+    } else {
+      return std::unexpected(ParseError::InvalidArgument);
+    }
+  }
+
+  if (result.chip_seq_file.empty() ||
+      (result.motifs_file.empty() && !result.discover)) {
     return std::unexpected(ParseError::MissingRequired);
   }
 
+  // The position histogram counts exact hits only
+  if (!result.positions_file.empty() &&
+      result.scan_options.max_mismatches > 0) {
+    return std::unexpected(ParseError::InvalidArgument);
+  }
+
+  // Count matrices are only scored as PWMs
+  if (result.count_matrices && !result.pwm_threshold) {
+    return std::unexpected(ParseError::InvalidArgument);
+  }
+
+  // The genome scanner counts exact hits with motif-major panels
+  const ScanKernel kernel = result.scan_options.kernel;
+  if (result.genome_bin_size > 0 &&
+      (result.scan_options.max_mismatches > 0 ||
+       (kernel != ScanKernel::Auto && kernel != ScanKernel::MotifMajor))) {
+    return std::unexpected(ParseError::InvalidArgument);
+  }
+
+  if (!result.spacing_file.empty() &&
+      result.spacing_options.max_distance == 0) {
+    result.spacing_options.max_distance = 20;
+  }
+
   return result;
 }
 
@@ -102,7 +593,14 @@ bool validateInputFiles(const CommandLineArgs &args) {
     return false;
   }
 
-  if (!std::filesystem::exists(args.motifs_file)) {
+  if (!args.background_file.empty() &&
+      !std::filesystem::exists(args.background_file)) {
+    std::cerr << std::format("Error: Background file '{}' does not exist\n",
+                             args.background_file);
+    return false;
+  }
+
+  if (!args.discover && !std::filesystem::exists(args.motifs_file)) {
     std::cerr << std::format("Error: Motifs file '{}' does not exist\n",
                              args.motifs_file);
     return false;
@@ -156,6 +654,69 @@ int main(int argc, char *argv[]) {
       std::cerr << "Failed to initialize parallel processor\n";
       return 1;
     }
+    processor.setScanOptions(args.scan_options);
+    if (!args.spacing_file.empty()) {
+      processor.setSpacingOptions(args.spacing_options);
+    }
+    processor.setNeighbourhoodOptions(args.neighbourhood_options);
+    processor.setSpectrumEnabled(!args.spectrum_file.empty());
+    // Only -c and exact clustering read the M x M matrix
+    processor.setCooccurrenceEnabled(
+        !args.cooccurrence_file.empty() ||
+        (args.cluster_threshold && args.minhash_hashes == 0));
+    if (!args.expected_file.empty()) {
+      processor.setMarkovOrder(args.markov_order);
+    }
+
+    if (args.discover) {
+      processor.discoverMotifs(args.chip_seq_file, args.discovery_options,
+                               args.output_file);
+      processor.finalize();
+      return 0;
+    }
+
+    if (!args.background_file.empty()) {
+      processor.processEnrichment(args.chip_seq_file, args.background_file,
+                                  args.motifs_file, args.output_file);
+      processor.finalize();
+      return 0;
+    }
+
+    if (args.shuffles > 0) {
+      processor.processShuffled(args.chip_seq_file, args.motifs_file,
+                                args.shuffles, args.seed,
+                                args.output_file);
+      processor.finalize();
+      return 0;
+    }
+
+    if (args.genome_bin_size > 0) {
+      processor.processGenome(args.chip_seq_file, args.motifs_file,
+                              args.genome_bin_size, args.output_file);
+      processor.finalize();
+      return 0;
+    }
+
+    if (args.pwm_threshold) {
+      processor.processPwm(args.chip_seq_file, args.motifs_file,
+                           *args.pwm_threshold, args.count_matrices,
+                           args.output_file);
+      processor.finalize();
+      return 0;
+    }
+
+    if (!args.index_file.empty()) {
+      auto results =
+          processor.processIndexed(args.chip_seq_file, args.motifs_file,
+                                   args.index_file, args.index_engine);
+      if (args.output_file.empty()) {
+        processor.printResults(results);
+      } else {
+        processor.saveResults(results, args.output_file);
+      }
+      processor.finalize();
+      return 0;
+    }
 
     auto results =
         processor.processMotifs(args.chip_seq_file, args.motifs_file);
@@ -166,6 +727,38 @@ int main(int argc, char *argv[]) {
       processor.saveResults(results, args.output_file);
     }
 
+    if (!args.positions_file.empty()) {
+      processor.savePositionHistogram(args.positions_file);
+    }
+    if (!args.cooccurrence_file.empty()) {
+      processor.saveCooccurrence(args.cooccurrence_file);
+    }
+    if (!args.spacing_file.empty()) {
+      processor.saveSpacing(args.spacing_file);
+    }
+    if (!args.spectrum_file.empty()) {
+      processor.saveSpectrum(args.spectrum_file);
+    }
+    if (!args.neighbourhood_file.empty()) {
+      processor.saveNeighbourhood(args.neighbourhood_file);
+    }
+    if (!args.expected_file.empty()) {
+      processor.saveExpected(results, args.expected_file);
+    }
+    if (args.cluster_threshold) {
+      processor.printClusters(processor.clusterMotifs(*args.cluster_threshold,
+                                                      args.minhash_hashes));
+    }
+    if (!args.queries.empty()) {
+      processor.printQueryResults(processor.evaluateQueries(args.queries));
+    }
+    if (args.bootstrap_replicates > 0) {
+      processor.printBootstrap(
+          processor.bootstrapFrequencies(args.bootstrap_replicates, args.seed,
+                                         args.confidence),
+          args.confidence);
+    }
+
     if (args.verbose) {
       auto stats = processor.getPerformanceStats();
       std::cout << "\n=== PERFORMANCE STATISTICS ===" << std::endl;
@@ -0,0 +1,395 @@
+#include "markov_background.h"
+#include "iupac_codes.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+// Added to every word count so unseen words keep a small probability
+constexpr double PSEUDOCOUNT = 1.0;
+
+constexpr uint8_t complementMask(uint8_t mask) noexcept {
+  return static_cast<uint8_t>(((mask & 3u) << 2) | ((mask & 12u) >> 2));
+}
+
+// Reachable Shift-And states of the forward and reverse motif with their
+// transitions, so the probability passes only index arrays
+class MotifAutomaton {
+public:
+  /// Transition target that completes a match
+  static constexpr int32_t HIT = -1;
+
+  // Explore the states breadth-first; std::nullopt once there are more than
+  // max_states, which spacers of k Ns reach with 2^k states
+  static std::optional<MotifAutomaton>
+  build(const std::array<uint64_t, 4> &forward,
+        const std::array<uint64_t, 4> &reverse, uint64_t hit_bit,
+        size_t max_states) {
+    MotifAutomaton automaton(forward, reverse, hit_bit);
+    automaton.state({0, 0});
+    for (size_t s = 0; s < automaton.keys_.size(); ++s) {
+      for (size_t base = 0; base < 4; ++base) {
+        const int32_t target = automaton.step(automaton.keys_[s], base);
+        automaton.next_[s * 4 + base] = target;
+      }
+      if (automaton.keys_.size() > max_states) {
+        return std::nullopt;
+      }
+    }
+    return automaton;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return keys_.size(); }
+
+  [[nodiscard]] int32_t next(size_t state, size_t base) const noexcept {
+    return next_[state * 4 + base];
+  }
+
+  // State reached from the start by the bases of a context, HIT if a match
+  // completes on the way
+  [[nodiscard]] int32_t walk(size_t context, size_t order) const {
+    int32_t current = 0;
+    for (size_t j = 0; j < order && current != HIT; ++j) {
+      current = next(static_cast<size_t>(current),
+                     (context >> (2 * (order - 1 - j))) & 3u);
+    }
+    return current;
+  }
+
+private:
+  using Key = std::pair<uint64_t, uint64_t>;
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const noexcept {
+      return mixBits(key.first ^ mixBits(key.second));
+    }
+  };
+
+  std::array<uint64_t, 4> forward_;
+  std::array<uint64_t, 4> reverse_;
+  uint64_t hit_bit_;
+  std::vector<Key> keys_;
+  std::vector<int32_t> next_;
+  std::unordered_map<Key, int32_t, KeyHash> index_;
+
+  MotifAutomaton(const std::array<uint64_t, 4> &forward,
+                 const std::array<uint64_t, 4> &reverse, uint64_t hit_bit)
+      : forward_(forward), reverse_(reverse), hit_bit_(hit_bit) {}
+
+  int32_t state(const Key &key) {
+    const auto [it, inserted] =
+        index_.try_emplace(key, static_cast<int32_t>(keys_.size()));
+    if (inserted) {
+      keys_.push_back(key);
+      next_.resize(next_.size() + 4, HIT);
+    }
+    return it->second;
+  }
+
+  int32_t step(const Key &key, size_t base) {
+    const Key target{((key.first << 1) | 1u) & forward_[base],
+                     ((key.second << 1) | 1u) & reverse_[base]};
+    if (((target.first | target.second) & hit_bit_) != 0) {
+      return HIT;
+    }
+    return state(target);
+  }
+};
+
+} // namespace
+
+MarkovBackground::MarkovBackground(const SequenceStore &store, size_t order,
+                                   CountReduction reduce)
+    : order_(order), contexts_(1uz << (2 * std::min(order, MAX_ORDER))) {
+  if (order > MAX_ORDER) {
+    throw std::invalid_argument("Markov order must be at most " +
+                                std::to_string(MAX_ORDER));
+  }
+
+  // Words, exact lengths, then long sequences, their bases and all
+  // sequences
+  const size_t words = contexts_ * 4;
+  const size_t long_slot = words + MAX_EXACT_LENGTH;
+  std::vector<uint64_t> counts(long_slot + 3, 0);
+#pragma omp parallel
+  {
+    std::vector<uint64_t> local(counts.size(), 0);
+#pragma omp for schedule(static)
+    for (size_t s = 0; s < store.size(); ++s) {
+      const std::string_view text = store.sequence(s).sequence;
+      const std::span<const uint8_t> bases = store.bases(s);
+      const bool clean = store.isClean(s);
+      size_t code = 0;
+      size_t run = 0;
+      for (size_t i = 0; i < bases.size(); ++i) {
+        if (!clean && !isNucleotide(text[i])) {
+          run = 0;
+          continue;
+        }
+        code = ((code << 2) | bases[i]) & (words - 1);
+        if (++run > order_) {
+          local[code]++;
+        }
+      }
+      if (bases.size() < MAX_EXACT_LENGTH) {
+        local[words + bases.size()]++;
+      } else {
+        local[long_slot]++;
+        local[long_slot + 1] += bases.size();
+      }
+    }
+#pragma omp critical
+    for (size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += local[i];
+    }
+  }
+  counts[long_slot + 2] = store.size();
+  if (reduce) {
+    reduce(counts);
+  }
+
+  uint64_t total = 0;
+  for (size_t word = 0; word < words; ++word) {
+    total += counts[word];
+  }
+  initial_.resize(contexts_);
+  transitions_.resize(words);
+  for (size_t context = 0; context < contexts_; ++context) {
+    uint64_t row = 0;
+    for (size_t base = 0; base < 4; ++base) {
+      row += counts[context * 4 + base];
+    }
+    const double row_total = static_cast<double>(row) + 4.0 * PSEUDOCOUNT;
+    initial_[context] =
+        row_total / (static_cast<double>(total) +
+                     static_cast<double>(words) * PSEUDOCOUNT);
+    for (size_t base = 0; base < 4; ++base) {
+      transitions_[context * 4 + base] =
+          (static_cast<double>(counts[context * 4 + base]) + PSEUDOCOUNT) /
+          row_total;
+    }
+  }
+  by_base_.resize(words);
+  for (size_t context = 0; context < contexts_; ++context) {
+    for (size_t base = 0; base < 4; ++base) {
+      by_base_[base * contexts_ + context] = transitions_[context * 4 + base];
+    }
+  }
+  lengths_.assign(counts.begin() + static_cast<ptrdiff_t>(words),
+                  counts.begin() + static_cast<ptrdiff_t>(long_slot));
+  long_sequences_ = counts[long_slot];
+  long_bases_ = counts[long_slot + 1];
+  sequence_count_ = counts[long_slot + 2];
+}
+
+std::optional<MarkovBackground::Masks>
+MarkovBackground::masks(std::string_view pattern) {
+  if (pattern.empty() || pattern.size() > MAX_MOTIF_LENGTH) {
+    return std::nullopt;
+  }
+  const IUPACCodes &iupac_codes = IUPACCodes::getInstance();
+  Masks masks;
+  for (const char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+    masks.push_back(mask);
+  }
+  return masks;
+}
+
+std::optional<double>
+MarkovBackground::windowProbability(std::string_view pattern,
+                                    bool both_strands) const {
+  const auto forward = masks(pattern);
+  if (!forward) {
+    return std::nullopt;
+  }
+  return windowProbability(*forward, both_strands);
+}
+
+double MarkovBackground::windowProbability(const Masks &forward,
+                                           bool both_strands) const {
+  const auto match = [&](const Masks &sets) {
+    std::vector<double> current = initial_;
+    std::vector<double> next(contexts_);
+    for (const uint8_t set : sets) {
+      std::ranges::fill(next, 0.0);
+      for (size_t context = 0; context < contexts_; ++context) {
+        for (uint8_t base = 0; base < 4; ++base) {
+          if ((set >> base) & 1u) {
+            next[((context << 2) | base) & (contexts_ - 1)] +=
+                current[context] * transition(context, base);
+          }
+        }
+      }
+      std::swap(current, next);
+    }
+    double probability = 0.0;
+    for (const double mass : current) {
+      probability += mass;
+    }
+    return probability;
+  };
+
+  double probability = match(forward);
+  if (!both_strands) {
+    return probability;
+  }
+  // P(forward) + P(reverse) - P(both in the same window)
+  Masks reverse(forward.rbegin(), forward.rend());
+  for (uint8_t &mask : reverse) {
+    mask = complementMask(mask);
+  }
+  probability += match(reverse);
+  Masks both(forward.size());
+  for (size_t p = 0; p < both.size(); ++p) {
+    both[p] = forward[p] & reverse[p];
+    if (both[p] == 0) {
+      return probability;
+    }
+  }
+  return probability - match(both);
+}
+
+std::vector<double> MarkovBackground::survival(const Masks &masks,
+                                               bool both_strands,
+                                               size_t length) const {
+  // Bit p of a state is set while the first p + 1 positions match the
+  // bases ending at the current one; reaching the last bit is a hit
+  const size_t motif_length = masks.size();
+  const uint64_t hit_bit = 1ull << (motif_length - 1);
+  std::array<uint64_t, 4> forward{};
+  std::array<uint64_t, 4> reverse{};
+  for (size_t p = 0; p < motif_length; ++p) {
+    const uint8_t reverse_mask =
+        complementMask(masks[motif_length - 1 - p]);
+    for (size_t base = 0; base < 4; ++base) {
+      forward[base] |= static_cast<uint64_t>((masks[p] >> base) & 1u) << p;
+      if (both_strands) {
+        reverse[base] |= static_cast<uint64_t>((reverse_mask >> base) & 1u)
+                         << p;
+      }
+    }
+  }
+  std::vector<double> survival(length + 1, 1.0);
+  const auto built = MotifAutomaton::build(forward, reverse, hit_bit,
+                                           MAX_TRACKED_STATES / contexts_);
+  if (!built) {
+    // Too many partial matches to track: independent windows
+    const double miss = 1.0 - windowProbability(masks, both_strands);
+    for (size_t l = motif_length; l <= length; ++l) {
+      survival[l] = std::pow(miss, static_cast<double>(l - motif_length + 1));
+    }
+    return survival;
+  }
+  const MotifAutomaton &automaton = *built;
+  const size_t states = automaton.size();
+
+  // The first k bases come from the context distribution
+  std::vector<double> current(states * contexts_, 0.0);
+  std::vector<double> prefix(order_ + 1, 0.0);
+  for (size_t context = 0; context < contexts_; ++context) {
+    for (size_t j = 1; j <= order_; ++j) {
+      if (automaton.walk(context >> (2 * (order_ - j)), j) !=
+          MotifAutomaton::HIT) {
+        prefix[j] += initial_[context];
+      }
+    }
+    const int32_t start = automaton.walk(context, order_);
+    if (start != MotifAutomaton::HIT) {
+      current[static_cast<size_t>(start) * contexts_ + context] +=
+          initial_[context];
+    }
+  }
+  for (size_t l = 1; l <= std::min(order_, length); ++l) {
+    survival[l] = prefix[l];
+  }
+
+  // Contexts differing only in their oldest base share a successor, so
+  // each base moves quarter-long contiguous runs of mass
+  std::vector<double> next(current.size());
+  const size_t quarter = std::max<size_t>(contexts_ / 4, 1);
+  const size_t sources = contexts_ / quarter;
+  std::array<double, (1uz << (2 * MAX_ORDER)) / 4> flow{};
+  for (size_t l = order_ + 1; l <= length; ++l) {
+    std::ranges::fill(next, 0.0);
+    for (size_t state = 0; state < states; ++state) {
+      const double *mass = current.data() + state * contexts_;
+      for (size_t base = 0; base < 4; ++base) {
+        const int32_t target = automaton.next(state, base);
+        if (target == MotifAutomaton::HIT) {
+          continue;
+        }
+        const double *probability = by_base_.data() + base * contexts_;
+        for (size_t rest = 0; rest < quarter; ++rest) {
+          flow[rest] = mass[rest] * probability[rest];
+        }
+        for (size_t oldest = 1; oldest < sources; ++oldest) {
+          const size_t offset = oldest * quarter;
+          for (size_t rest = 0; rest < quarter; ++rest) {
+            flow[rest] += mass[offset + rest] * probability[offset + rest];
+          }
+        }
+        double *to = next.data() + static_cast<size_t>(target) * contexts_;
+        for (size_t rest = 0; rest < quarter; ++rest) {
+          to[(rest * 4 + base) & (contexts_ - 1)] += flow[rest];
+        }
+      }
+    }
+    std::swap(current, next);
+    double remaining = 0.0;
+    for (const double mass : current) {
+      remaining += mass;
+    }
+    survival[l] = remaining;
+  }
+  return survival;
+}
+
+std::optional<double>
+MarkovBackground::presenceProbability(std::string_view pattern, size_t length,
+                                      bool both_strands) const {
+  const auto motif = masks(pattern);
+  if (!motif) {
+    return std::nullopt;
+  }
+  return 1.0 - survival(*motif, both_strands, length)[length];
+}
+
+std::optional<double>
+MarkovBackground::expectedSequences(std::string_view pattern,
+                                    bool both_strands) const {
+  const auto motif = masks(pattern);
+  if (!motif) {
+    return std::nullopt;
+  }
+  size_t longest = long_sequences_ > 0 ? MAX_EXACT_LENGTH - 1 : 0;
+  for (size_t l = 0; l < lengths_.size(); ++l) {
+    if (lengths_[l] > 0) {
+      longest = std::max(longest, l);
+    }
+  }
+  const auto none = survival(*motif, both_strands, longest);
+
+  double expected = 0.0;
+  for (size_t l = 0; l <= longest; ++l) {
+    expected += static_cast<double>(lengths_[l]) * (1.0 - none[l]);
+  }
+  if (long_sequences_ > 0) {
+    const size_t last = MAX_EXACT_LENGTH - 1;
+    const double decay = none[last - 1] > 0.0 ? none[last] / none[last - 1]
+                                              : 0.0;
+    const double mean = static_cast<double>(long_bases_) /
+                        static_cast<double>(long_sequences_);
+    expected += static_cast<double>(long_sequences_) *
+                (1.0 - none[last] *
+                           std::pow(decay, mean - static_cast<double>(last)));
+  }
+  return expected;
+}
+
+} // namespace dna_motif
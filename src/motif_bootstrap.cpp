@@ -0,0 +1,195 @@
+#include "motif_bootstrap.h"
+#include "dinucleotide_shuffle.h"
+
+namespace dna_motif {
+
+namespace {
+
+constexpr size_t TILE_REPLICATES = MotifBootstrap::TILE_REPLICATES;
+constexpr size_t TILE_WORDS = MotifBootstrap::TILE_WORDS;
+
+// Motifs per block of intervals(), one cache line of counts
+constexpr size_t INTERVAL_MOTIFS = 8;
+
+// Weight sums of a tile fit the 16-bit lanes of countTile()
+static_assert(MotifBootstrap::MAX_WEIGHT * 64 * TILE_WORDS <= UINT16_MAX);
+
+// floor(P(Poisson(1) <= k) * 2^32) for k < MAX_WEIGHT, at most 2^32 - 1
+constexpr std::array<uint32_t, MotifBootstrap::MAX_WEIGHT>
+    POISSON_THRESHOLDS = [] {
+      std::array<uint32_t, MotifBootstrap::MAX_WEIGHT> thresholds{};
+      double probability = 0.36787944117144233; // P(X = 0) = 1 / e
+      double cumulative = 0.0;
+      for (size_t k = 0; k < thresholds.size(); ++k) {
+        cumulative += probability;
+        probability /= static_cast<double>(k + 1);
+        thresholds[k] = static_cast<uint32_t>(
+            std::min(cumulative * 4294967296.0, 4294967295.0));
+      }
+      return thresholds;
+    }();
+
+// Thresholds up to the random word; branch-free so weight loops vectorize
+constexpr uint32_t drawWeight(uint32_t random) noexcept {
+  uint32_t weight = 0;
+  for (size_t k = 0; k < POISSON_THRESHOLDS.size(); ++k) {
+    weight += static_cast<uint32_t>(random >= POISSON_THRESHOLDS[k]);
+  }
+  return weight;
+}
+
+// Per-thread weights of a group of replicates over one tile of sequences
+struct WeightTile {
+  /// Weight of local sequence s in replicate r at [s * TILE_REPLICATES + r]
+  std::vector<uint8_t> bytes =
+      std::vector<uint8_t>(TILE_WORDS * 64 * TILE_REPLICATES);
+  std::array<uint16_t, TILE_REPLICATES> totals{}; ///< Weight sums
+};
+
+// Draw the weights of replicates [first, first + TILE_REPLICATES) for
+// sequences [first_sequence, first_sequence + sequences), zero the rest of
+// the tile
+void drawTile(uint64_t seed, size_t first, uint64_t first_sequence,
+              size_t sequences, WeightTile &tile) {
+  std::array<uint64_t, TILE_REPLICATES> keys;
+  for (size_t r = 0; r < TILE_REPLICATES; ++r) {
+    keys[r] = mixBits(seed + mixBits(first + r));
+  }
+
+  std::array<uint16_t, TILE_REPLICATES> totals{};
+  for (size_t s = 0; s < sequences; ++s) {
+    uint8_t *weights = &tile.bytes[s * TILE_REPLICATES];
+    // One stream per replicate; the lanes vectorize
+    for (size_t r = 0; r < TILE_REPLICATES; ++r) {
+      weights[r] = static_cast<uint8_t>(drawWeight(static_cast<uint32_t>(
+          counterRandom(keys[r], first_sequence + s) >> 32)));
+      totals[r] = static_cast<uint16_t>(totals[r] + weights[r]);
+    }
+  }
+  std::fill(tile.bytes.begin() +
+                static_cast<ptrdiff_t>(sequences * TILE_REPLICATES),
+            tile.bytes.end(), 0);
+  tile.totals = totals;
+}
+
+// Weighted popcount of a row tile for a whole replicate group: the weights
+// of each set bit are added to one 16-bit lane per replicate. Rows hitting
+// most sequences walk their clear bits and subtract from the totals
+// instead; bits past the last sequence weigh 0 either way.
+void countTile(const uint64_t *hits, size_t words, bool dense,
+               const WeightTile &tile, size_t size, uint64_t *rows,
+               size_t stride) {
+  const uint64_t flip = dense ? ~0ull : 0ull;
+  std::array<uint16_t, TILE_REPLICATES> weighted{};
+  for (size_t w = 0; w < words; ++w) {
+    for (uint64_t bits = hits[w] ^ flip; bits != 0; bits &= bits - 1) {
+      const size_t s = w * 64 + static_cast<size_t>(std::countr_zero(bits));
+      const uint8_t *weights = &tile.bytes[s * TILE_REPLICATES];
+      for (size_t r = 0; r < TILE_REPLICATES; ++r) {
+        weighted[r] = static_cast<uint16_t>(weighted[r] + weights[r]);
+      }
+    }
+  }
+  for (size_t r = 0; r < size; ++r) {
+    rows[r * stride] += dense ? tile.totals[r] - weighted[r] : weighted[r];
+  }
+}
+
+// Value at quantile q of values, interpolated between order statistics;
+// reorders values
+double quantile(std::span<double> values, double q) noexcept {
+  const double position = q * static_cast<double>(values.size() - 1);
+  const auto below = static_cast<size_t>(position);
+  const auto nth = values.begin() + static_cast<ptrdiff_t>(below);
+  std::nth_element(values.begin(), nth, values.end());
+  if (below + 1 >= values.size()) {
+    return *nth;
+  }
+  const double next = *std::min_element(nth + 1, values.end());
+  return *nth + (position - static_cast<double>(below)) * (next - *nth);
+}
+
+} // namespace
+
+uint32_t poissonWeight(uint32_t random) noexcept { return drawWeight(random); }
+
+MotifBootstrap MotifBootstrap::count(const HitBitsets &bitsets,
+                                     size_t replicate_count, uint64_t seed,
+                                     uint64_t first_id) {
+  const size_t motifs = bitsets.motifCount();
+  const size_t sequences = bitsets.sequenceCount();
+  const size_t stride = motifs + 1;
+  MotifBootstrap bootstrap(motifs, replicate_count);
+  for (size_t m = 0; m < motifs; ++m) {
+    bootstrap.counts[m] = bitsets.count(m);
+  }
+  bootstrap.counts[motifs] = sequences;
+
+  // Each group of replicates owns its rows of the counts
+  const size_t groups =
+      (replicate_count + TILE_REPLICATES - 1) / TILE_REPLICATES;
+#pragma omp parallel
+  {
+    WeightTile tile;
+#pragma omp for schedule(dynamic, 1)
+    for (size_t group = 0; group < groups; ++group) {
+      const size_t first = group * TILE_REPLICATES;
+      const size_t size = std::min(TILE_REPLICATES, replicate_count - first);
+      uint64_t *rows = bootstrap.counts.data() + (first + 1) * stride;
+      for (size_t word = 0; word < bitsets.wordCount(); word += TILE_WORDS) {
+        const size_t begin = word * 64;
+        const size_t end = std::min(sequences, begin + TILE_WORDS * 64);
+        const size_t tile_words = (end - begin + 63) / 64;
+        drawTile(seed, first, first_id + begin, end - begin, tile);
+        for (size_t r = 0; r < size; ++r) {
+          rows[r * stride + motifs] += tile.totals[r];
+        }
+        for (size_t m = 0; m < motifs; ++m) {
+          const bool dense = 2 * bitsets.count(m, begin, end) > end - begin;
+          countTile(bitsets.row(m).data() + word, tile_words, dense, tile,
+                    size, rows + m, stride);
+        }
+      }
+    }
+  }
+  return bootstrap;
+}
+
+std::vector<FrequencyInterval>
+MotifBootstrap::intervals(double confidence) const {
+  if (!(confidence > 0.0 && confidence < 1.0)) {
+    throw std::invalid_argument("Confidence must be in (0, 1)");
+  }
+  if (replicates == 0) {
+    throw std::invalid_argument("Bootstrap intervals need replicates");
+  }
+
+  // Blocks of motifs sharing cache lines of the counts; each block is
+  // copied out motif-major before selecting its quantiles
+  const double tail = (1.0 - confidence) / 2.0;
+  const size_t blocks = (motif_count + INTERVAL_MOTIFS - 1) / INTERVAL_MOTIFS;
+  std::vector<FrequencyInterval> result(motif_count);
+#pragma omp parallel
+  {
+    std::vector<double> frequencies(INTERVAL_MOTIFS * replicates);
+#pragma omp for schedule(static)
+    for (size_t block = 0; block < blocks; ++block) {
+      const size_t first = block * INTERVAL_MOTIFS;
+      const size_t size = std::min(INTERVAL_MOTIFS, motif_count - first);
+      for (size_t r = 0; r < replicates; ++r) {
+        for (size_t m = 0; m < size; ++m) {
+          frequencies[m * replicates + r] = frequency(r + 1, first + m);
+        }
+      }
+      for (size_t m = 0; m < size; ++m) {
+        const std::span<double> values(&frequencies[m * replicates],
+                                       replicates);
+        result[first + m] = {frequency(0, first + m), quantile(values, tail),
+                             quantile(values, 1.0 - tail)};
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace dna_motif
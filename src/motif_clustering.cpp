@@ -0,0 +1,167 @@
+#include "motif_clustering.h"
+#include <numeric>
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+void checkThreshold(double threshold) {
+  if (!(threshold > 0.0 && threshold <= 1.0)) {
+    throw std::invalid_argument("Clustering threshold must be in (0, 1]");
+  }
+}
+
+size_t findRoot(std::vector<size_t> &parent, size_t m) noexcept {
+  while (parent[m] != m) {
+    parent[m] = parent[parent[m]];
+    m = parent[m];
+  }
+  return m;
+}
+
+// Connected components of the linked pairs, numbered by lowest member
+MotifClusters
+buildClusters(size_t motif_count,
+              std::span<const std::pair<size_t, size_t>> links,
+              std::span<const uint64_t> hit_counts) {
+  std::vector<size_t> parent(motif_count);
+  std::iota(parent.begin(), parent.end(), 0uz);
+  for (const auto &[a, b] : links) {
+    const size_t root_a = findRoot(parent, a);
+    const size_t root_b = findRoot(parent, b);
+    parent[std::max(root_a, root_b)] = std::min(root_a, root_b);
+  }
+
+  MotifClusters clusters;
+  clusters.cluster_of.resize(motif_count);
+  std::vector<size_t> cluster_of_root(motif_count, 0);
+  for (size_t m = 0; m < motif_count; ++m) {
+    const size_t root = findRoot(parent, m);
+    if (root == m) {
+      cluster_of_root[m] = clusters.representatives.size();
+      clusters.representatives.push_back(m);
+    }
+    const size_t cluster = cluster_of_root[root];
+    clusters.cluster_of[m] = cluster;
+    size_t &representative = clusters.representatives[cluster];
+    if (hit_counts[m] > hit_counts[representative]) {
+      representative = m;
+    }
+  }
+  return clusters;
+}
+
+} // namespace
+
+MinHashSketches::MinHashSketches(size_t motif_count, size_t hash_count)
+    : motif_count_(motif_count), hash_count_(hash_count),
+      values_(motif_count * hash_count, EMPTY) {}
+
+MinHashSketches MinHashSketches::fromBitsets(const HitBitsets &bitsets,
+                                             size_t hash_count,
+                                             uint64_t first_id) {
+  MinHashSketches sketches(bitsets.motifCount(), hash_count);
+  std::vector<uint64_t> seeds(hash_count);
+  for (size_t j = 0; j < hash_count; ++j) {
+    seeds[j] = mixBits(j + 1);
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (size_t m = 0; m < bitsets.motifCount(); ++m) {
+    const auto row = bitsets.row(m);
+    uint64_t *signature = sketches.values_.data() + m * hash_count;
+    for (size_t w = 0; w < row.size(); ++w) {
+      for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1) {
+        const uint64_t id =
+            first_id + w * 64 + static_cast<uint64_t>(std::countr_zero(bits));
+        for (size_t j = 0; j < hash_count; ++j) {
+          signature[j] = std::min(signature[j], mixBits(id ^ seeds[j]));
+        }
+      }
+    }
+  }
+  return sketches;
+}
+
+void MinHashSketches::merge(const MinHashSketches &other) {
+  if (other.motif_count_ != motif_count_ ||
+      other.hash_count_ != hash_count_) {
+    throw std::invalid_argument("MinHash signatures differ in shape");
+  }
+  std::ranges::transform(values_, other.values_, values_.begin(),
+                         [](uint64_t a, uint64_t b) { return std::min(a, b); });
+}
+
+double MinHashSketches::similarity(size_t a, size_t b) const noexcept {
+  const auto first = signature(a);
+  const auto second = signature(b);
+  if (hash_count_ == 0 || first[0] == EMPTY || second[0] == EMPTY) {
+    return 0.0;
+  }
+  size_t agree = 0;
+  for (size_t j = 0; j < hash_count_; ++j) {
+    agree += first[j] == second[j];
+  }
+  return static_cast<double>(agree) / static_cast<double>(hash_count_);
+}
+
+std::vector<size_t> MotifClusters::members(size_t cluster) const {
+  std::vector<size_t> motifs;
+  for (size_t m = 0; m < cluster_of.size(); ++m) {
+    if (cluster_of[m] == cluster) {
+      motifs.push_back(m);
+    }
+  }
+  return motifs;
+}
+
+MotifClusters clusterMotifs(const CooccurrenceMatrix &matrix,
+                            double threshold) {
+  checkThreshold(threshold);
+
+  std::vector<std::pair<size_t, size_t>> links;
+  std::vector<uint64_t> hit_counts(matrix.motif_count);
+  for (size_t a = 0; a < matrix.motif_count; ++a) {
+    hit_counts[a] = matrix.at(a, a);
+    for (size_t b = a + 1; b < matrix.motif_count; ++b) {
+      if (matrix.jaccard(a, b) >= threshold) {
+        links.emplace_back(a, b);
+      }
+    }
+  }
+  return buildClusters(matrix.motif_count, links, hit_counts);
+}
+
+MotifClusters clusterMotifs(const MinHashSketches &sketches,
+                            std::span<const uint64_t> hit_counts,
+                            double threshold) {
+  checkThreshold(threshold);
+  const size_t motif_count = sketches.motifCount();
+
+  // Per-thread link lists, concatenated after the parallel region
+  std::vector<std::vector<std::pair<size_t, size_t>>> partials(
+      static_cast<size_t>(omp_get_max_threads()));
+
+#pragma omp parallel
+  {
+    auto &local = partials[static_cast<size_t>(omp_get_thread_num())];
+
+#pragma omp for schedule(dynamic)
+    for (size_t a = 0; a < motif_count; ++a) {
+      for (size_t b = a + 1; b < motif_count; ++b) {
+        if (sketches.similarity(a, b) >= threshold) {
+          local.emplace_back(a, b);
+        }
+      }
+    }
+  }
+
+  std::vector<std::pair<size_t, size_t>> links;
+  for (const auto &local : partials) {
+    links.insert(links.end(), local.begin(), local.end());
+  }
+  return buildClusters(motif_count, links, hit_counts);
+}
+
+} // namespace dna_motif
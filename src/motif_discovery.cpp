@@ -0,0 +1,440 @@
+#include "motif_discovery.h"
+#include "iupac_codes.h"
+#include "kmer_spectrum.h"
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+// Subtrees handed out to parts start at this depth
+constexpr size_t ROOT_DEPTH = 2;
+
+// Prefixes shorter than this are explored as separate tasks
+constexpr size_t TASK_DEPTH = 4;
+
+constexpr size_t MASK_BITS = 4;
+
+// Headroom of ratio bounds over rounding of probabilities multiplied in
+// another order
+constexpr double RATIO_SLACK = 1.0 + 1e-9;
+
+// Base masks over nucleotide codes, specific bases first
+constexpr std::array<uint8_t, 15> SYMBOLS = [] {
+  std::array<uint8_t, 15> symbols{};
+  size_t next = 0;
+  for (int bases = 1; bases <= 4; ++bases) {
+    for (uint8_t mask = 1; mask < 16; ++mask) {
+      if (std::popcount(mask) == bases) {
+        symbols[next++] = mask;
+      }
+    }
+  }
+  return symbols;
+}();
+
+// IUPAC code of every base mask
+std::array<char, 16> maskCodes() {
+  std::array<char, 16> codes{};
+  const IUPACCodes &iupac_codes = IUPACCodes::getInstance();
+  for (const char code : IUPAC_CODES) {
+    codes[iupac_codes.getBaseMask(code)] = code;
+  }
+  return codes;
+}
+
+uint8_t maskAt(uint32_t packed, size_t position) noexcept {
+  return static_cast<uint8_t>(
+      (packed >> (MASK_BITS * (WINDOW_CODE_LENGTH - 1 - position))) & 15u);
+}
+
+struct Candidate {
+  double score;
+  uint64_t sequences;
+  uint32_t packed;
+};
+
+// Higher score, then more sequences, then lower masks
+bool isBetter(const Candidate &a, const Candidate &b) noexcept {
+  if (a.score != b.score) {
+    return a.score > b.score;
+  }
+  if (a.sequences != b.sequences) {
+    return a.sequences > b.sequences;
+  }
+  return a.packed < b.packed;
+}
+
+} // namespace
+
+std::optional<DiscoveryObjective>
+parseDiscoveryObjective(std::string_view name) {
+  if (name == "frequency") {
+    return DiscoveryObjective::Frequency;
+  }
+  if (name == "enrichment") {
+    return DiscoveryObjective::Enrichment;
+  }
+  return std::nullopt;
+}
+
+struct MotifDiscovery::Search {
+  uint64_t min_sequences = 0;
+  std::mutex mutex;
+  std::vector<Candidate> heap; // Worst candidate on top
+  std::atomic<double> threshold{-std::numeric_limits<double>::infinity()};
+  std::atomic<uint64_t> nodes_visited{0};
+  std::atomic<uint64_t> patterns_counted{0};
+  std::vector<std::vector<uint64_t>> scratch; // Union bitset per thread
+
+  void offer(const Candidate &candidate, size_t top_k) {
+    std::lock_guard lock(mutex);
+    if (heap.size() == top_k) {
+      if (!isBetter(candidate, heap.front())) {
+        return;
+      }
+      std::ranges::pop_heap(heap, isBetter);
+      heap.pop_back();
+    }
+    heap.push_back(candidate);
+    std::ranges::push_heap(heap, isBetter);
+    if (heap.size() == top_k) {
+      threshold.store(heap.front().score, std::memory_order_relaxed);
+    }
+  }
+};
+
+MotifDiscovery::MotifDiscovery(const SequenceStore &store,
+                               const KmerIndex &index,
+                               const DiscoveryOptions &options, size_t part,
+                               size_t parts, CountReduction reduce)
+    : index_(index), options_(options), sequence_count_(store.size()) {
+  // Presence of every window prefix; full windows are the spectrum's
+  std::array<size_t, WINDOW_CODE_LENGTH + 1> offsets{};
+  for (size_t length = 1; length <= WINDOW_CODE_LENGTH; ++length) {
+    offsets[length] = offsets[length - 1] + (1uz << (2 * (length - 1)));
+  }
+  const size_t prefixes = offsets[WINDOW_CODE_LENGTH];
+  KmerSpectrum spectrum = KmerSpectrum::count(store, part, parts);
+  std::vector<uint64_t> presence(prefixes, 0);
+
+  const size_t first = store.size() * part / parts;
+  const size_t last = store.size() * (part + 1) / parts;
+#pragma omp parallel
+  {
+    std::vector<uint64_t> local(prefixes, 0);
+    std::vector<size_t> last_seen(prefixes, ~0uz);
+#pragma omp for schedule(static)
+    for (size_t s = first; s < last; ++s) {
+      store.forEachWindowCode(s, [&](size_t code) {
+        for (size_t length = 0; length < WINDOW_CODE_LENGTH; ++length) {
+          const size_t slot =
+              offsets[length] +
+              (code >> (NUCLEOTIDE_CODE_BITS * (WINDOW_CODE_LENGTH - length)));
+          local[slot] += last_seen[slot] != s;
+          last_seen[slot] = s;
+        }
+      });
+    }
+#pragma omp critical
+    for (size_t slot = 0; slot < prefixes; ++slot) {
+      presence[slot] += local[slot];
+    }
+  }
+
+  // Both tables are sums over sequences; parts add up to the whole store
+  if (reduce) {
+    presence.insert(presence.end(), spectrum.counts.begin(),
+                    spectrum.counts.end());
+    reduce(presence);
+    std::copy(presence.begin() + static_cast<std::ptrdiff_t>(prefixes),
+              presence.end(), spectrum.counts.begin());
+    presence.resize(prefixes);
+  }
+
+  const auto occurrences = spectrum.occurrences();
+  const uint64_t windows = spectrum.windowCount();
+  if (sequence_count_ > 0) {
+    mean_windows_ =
+        static_cast<double>(windows) / static_cast<double>(sequence_count_);
+  }
+
+  // Base composition over every position of every counted window
+  std::array<uint64_t, 4> bases{};
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+      bases[(code >> (NUCLEOTIDE_CODE_BITS * p)) & 3] += occurrences[code];
+    }
+  }
+  if (windows > 0) {
+    for (size_t b = 0; b < 4; ++b) {
+      base_frequencies_[b] =
+          static_cast<double>(bases[b]) /
+          static_cast<double>(windows * WINDOW_CODE_LENGTH);
+    }
+  }
+  rarest_base_ = std::ranges::min(base_frequencies_);
+
+  for (size_t length = 0; length < WINDOW_CODE_LENGTH; ++length) {
+    prefix_presence_[length].assign(
+        presence.begin() + static_cast<std::ptrdiff_t>(offsets[length]),
+        presence.begin() + static_cast<std::ptrdiff_t>(offsets[length + 1]));
+  }
+  const auto full = spectrum.sequences();
+  prefix_presence_[WINDOW_CODE_LENGTH].assign(full.begin(), full.end());
+
+  // Largest presence over window probability below every prefix
+  auto &ratios = best_ratio_[WINDOW_CODE_LENGTH];
+  ratios.assign(WINDOW_CODE_SPACE, 0.0);
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    double probability = 1.0;
+    for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+      probability *=
+          base_frequencies_[(code >> (NUCLEOTIDE_CODE_BITS * p)) & 3];
+    }
+    if (full[code] > 0) {
+      ratios[code] = static_cast<double>(full[code]) / probability;
+    }
+  }
+  for (size_t length = WINDOW_CODE_LENGTH; length-- > 0;) {
+    best_ratio_[length].assign(1uz << (NUCLEOTIDE_CODE_BITS * length), 0.0);
+    for (size_t prefix = 0; prefix < best_ratio_[length].size(); ++prefix) {
+      for (size_t b = 0; b < 4; ++b) {
+        const size_t child = (prefix << NUCLEOTIDE_CODE_BITS) | b;
+        best_ratio_[length][prefix] = std::max(best_ratio_[length][prefix],
+                                               best_ratio_[length + 1][child]);
+      }
+    }
+  }
+}
+
+std::vector<DiscoveredMotif> MotifDiscovery::discover(size_t part,
+                                                      size_t parts) const {
+  if (options_.top_k == 0 || sequence_count_ == 0 ||
+      prefix_presence_[0][0] == 0) {
+    return {};
+  }
+
+  Search search;
+  search.min_sequences = static_cast<uint64_t>(std::ceil(
+      options_.min_frequency * static_cast<double>(sequence_count_)));
+  search.scratch.resize(static_cast<size_t>(omp_get_max_threads()));
+
+  // Subtree roots in a fixed order, so every part sees the same numbering
+  std::vector<Node> roots{Node{}};
+  for (size_t depth = 0; depth < ROOT_DEPTH; ++depth) {
+    std::vector<Node> next;
+    for (const Node &node : roots) {
+      for (const uint8_t mask : SYMBOLS) {
+        const bool degenerate = std::popcount(mask) > 1;
+        if (node.degenerate + degenerate > options_.max_degenerate) {
+          break;
+        }
+        next.push_back(extend(node, mask));
+      }
+    }
+    roots = std::move(next);
+  }
+
+#pragma omp parallel
+#pragma omp single
+  for (size_t r = part; r < roots.size(); r += parts) {
+#pragma omp task shared(search, roots)
+    explore(roots[r], search);
+  }
+
+  nodes_visited_ = search.nodes_visited.load();
+  patterns_counted_ = search.patterns_counted.load();
+
+  std::ranges::sort(search.heap, isBetter);
+  std::vector<DiscoveredMotif> motifs;
+  for (const Candidate &candidate : search.heap) {
+    motifs.push_back(describe(candidate.packed, candidate.sequences));
+  }
+  return motifs;
+}
+
+MotifDiscovery::Node MotifDiscovery::extend(const Node &node,
+                                            uint8_t mask) const {
+  Node child;
+  child.depth = node.depth + 1;
+  child.degenerate = node.degenerate + (std::popcount(mask) > 1);
+  child.packed =
+      node.packed | static_cast<uint32_t>(mask)
+                        << (MASK_BITS * (WINDOW_CODE_LENGTH - child.depth));
+  child.expansions.clear();
+  double accepted = 0.0;
+  for (uint8_t b = 0; b < 4; ++b) {
+    if (mask & (1u << b)) {
+      accepted += base_frequencies_[b];
+      for (const uint16_t prefix : node.expansions) {
+        child.expansions.push_back(
+            static_cast<uint16_t>((prefix << NUCLEOTIDE_CODE_BITS) | b));
+      }
+    }
+  }
+  child.probability = node.probability * accepted;
+  return child;
+}
+
+void MotifDiscovery::explore(const Node &node, Search &search) const {
+  const size_t depth = node.depth;
+  search.nodes_visited.fetch_add(1, std::memory_order_relaxed);
+
+  // Bound every completion by the sequences holding the prefix
+  uint64_t bound = 0;
+  double best_ratio = 0.0;
+  for (const uint16_t prefix : node.expansions) {
+    bound += prefix_presence_[depth][prefix];
+    best_ratio = std::max(best_ratio, best_ratio_[depth][prefix]);
+  }
+  bound = std::min(bound, node.count_bound);
+  if (bound < search.min_sequences || bound == 0) {
+    return;
+  }
+
+  double score_bound = static_cast<double>(bound) /
+                       static_cast<double>(sequence_count_);
+  if (options_.objective == DiscoveryObjective::Enrichment) {
+    // count / E(p) <= max(presence / p) over 8-mers * p' / E(p') for the
+    // prefix probability p', as E(p) / p falls with p
+    const double least_likely =
+        node.probability *
+        std::pow(rarest_base_,
+                 static_cast<double>(WINDOW_CODE_LENGTH - depth));
+    const double ratio_bound = best_ratio * RATIO_SLACK * node.probability /
+                               expectedSequences(node.probability);
+    score_bound = std::min(
+        {node.score_bound,
+         score(static_cast<double>(bound), expectedSequences(least_likely)),
+         ratio_bound});
+  }
+  if (score_bound < search.threshold.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  if (depth == WINDOW_CODE_LENGTH) {
+    uint64_t sequences = bound;
+    if (node.expansions.size() > 1) {
+      auto &scratch =
+          search.scratch[static_cast<size_t>(omp_get_thread_num())];
+      scratch.resize((sequence_count_ + 63) / 64, 0);
+      sequences = index_.countUnion(node.expansions, scratch);
+      search.patterns_counted.fetch_add(1, std::memory_order_relaxed);
+      if (sequences < search.min_sequences) {
+        return;
+      }
+    }
+    search.offer(Candidate{score(static_cast<double>(sequences),
+                                 expectedSequences(node.probability)),
+                           sequences, node.packed},
+                 options_.top_k);
+    return;
+  }
+
+  for (const uint8_t mask : SYMBOLS) {
+    const bool degenerate = std::popcount(mask) > 1;
+    if (node.degenerate + degenerate > options_.max_degenerate) {
+      break;
+    }
+    Node child = extend(node, mask);
+    child.count_bound = bound;
+    child.score_bound = score_bound;
+    if (child.depth < TASK_DEPTH) {
+#pragma omp task firstprivate(child) shared(search)
+      explore(child, search);
+    } else {
+      explore(child, search);
+    }
+  }
+}
+
+uint32_t MotifDiscovery::packPattern(std::string_view pattern) {
+  if (pattern.size() != WINDOW_CODE_LENGTH) {
+    throw std::invalid_argument("Discovered motifs have " +
+                                std::to_string(WINDOW_CODE_LENGTH) +
+                                " positions");
+  }
+  const IUPACCodes &iupac_codes = IUPACCodes::getInstance();
+  uint32_t packed = 0;
+  for (const char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      throw std::invalid_argument("Invalid IUPAC code in pattern: " +
+                                  std::string(pattern));
+    }
+    packed = (packed << MASK_BITS) | mask;
+  }
+  return packed;
+}
+
+DiscoveredMotif MotifDiscovery::describe(uint32_t packed,
+                                         uint64_t sequences) const {
+  static const std::array<char, 16> codes = maskCodes();
+  DiscoveredMotif motif;
+  double probability = 1.0;
+  for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+    const uint8_t mask = maskAt(packed, p);
+    motif.pattern += codes[mask];
+    double accepted = 0.0;
+    for (uint8_t b = 0; b < 4; ++b) {
+      if (mask & (1u << b)) {
+        accepted += base_frequencies_[b];
+      }
+    }
+    probability *= accepted;
+  }
+  motif.sequences = sequences;
+  motif.frequency = sequence_count_ > 0
+                        ? static_cast<double>(sequences) /
+                              static_cast<double>(sequence_count_)
+                        : 0.0;
+  motif.expected = expectedSequences(probability);
+  motif.enrichment = motif.expected > 0.0
+                         ? static_cast<double>(sequences) / motif.expected
+                         : 0.0;
+  motif.score = score(static_cast<double>(sequences), motif.expected);
+  return motif;
+}
+
+std::vector<DiscoveredMotif>
+MotifDiscovery::best(std::vector<DiscoveredMotif> motifs, size_t top_k) {
+  std::vector<std::pair<Candidate, size_t>> order;
+  for (size_t i = 0; i < motifs.size(); ++i) {
+    order.emplace_back(Candidate{motifs[i].score, motifs[i].sequences,
+                                 packPattern(motifs[i].pattern)},
+                       i);
+  }
+  std::ranges::sort(order, [](const auto &a, const auto &b) {
+    return isBetter(a.first, b.first);
+  });
+
+  std::vector<DiscoveredMotif> kept;
+  for (size_t i = 0; i < std::min(top_k, order.size()); ++i) {
+    kept.push_back(std::move(motifs[order[i].second]));
+  }
+  return kept;
+}
+
+double MotifDiscovery::expectedSequences(double probability) const noexcept {
+  // 1 - (1 - p)^w without cancellation for small p
+  return static_cast<double>(sequence_count_) *
+         -std::expm1(mean_windows_ * std::log1p(-probability));
+}
+
+double MotifDiscovery::score(double sequences,
+                             double expected) const noexcept {
+  if (options_.objective == DiscoveryObjective::Frequency) {
+    return sequences / static_cast<double>(sequence_count_);
+  }
+  if (sequences == 0.0) {
+    return 0.0;
+  }
+  return expected > 0.0 ? sequences / expected
+                        : std::numeric_limits<double>::infinity();
+}
+
+} // namespace dna_motif
@@ -0,0 +1,119 @@
+#include "motif_enrichment.h"
+#include <cmath>
+#include <limits>
+
+namespace dna_motif {
+
+namespace {
+
+// Terms below this fraction of the running sum end a tail
+constexpr double NEGLIGIBLE_TERM = 1e-17;
+
+double logChoose(double n, double k) noexcept {
+  return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) -
+         std::lgamma(n - k + 1.0);
+}
+
+} // namespace
+
+double hypergeometricLogTail(uint64_t hits, uint64_t draws,
+                             uint64_t successes,
+                             uint64_t population) noexcept {
+  const auto n = static_cast<double>(draws);
+  const auto k = static_cast<double>(successes);
+  const auto total = static_cast<double>(population);
+  const uint64_t lowest =
+      draws + successes > population ? draws + successes - population : 0;
+  const uint64_t highest = std::min(draws, successes);
+  if (hits <= lowest) {
+    return 0.0;
+  }
+  if (hits > highest) {
+    return -std::numeric_limits<double>::infinity();
+  }
+
+  const auto log_term = [&](double x) {
+    return logChoose(k, x) + logChoose(total - k, n - x) -
+           logChoose(total, n);
+  };
+
+  // Sum away from the mode, where terms only shrink; above the mode that
+  // is the tail itself, below it the complementary lower tail
+  const auto mode = static_cast<uint64_t>(std::floor((n + 1.0) * (k + 1.0) /
+                                                     (total + 2.0)));
+  const bool upper = hits > mode;
+  const uint64_t start = upper ? hits : hits - 1;
+  const double log_first = log_term(static_cast<double>(start));
+  double relative = 1.0;
+  double sum = 1.0;
+  if (upper) {
+    for (uint64_t x = start; x < highest; ++x) {
+      const auto xd = static_cast<double>(x);
+      relative *=
+          (k - xd) * (n - xd) / ((xd + 1.0) * (total - k - n + xd + 1.0));
+      sum += relative;
+      if (relative < NEGLIGIBLE_TERM * sum) {
+        break;
+      }
+    }
+    return log_first + std::log(sum);
+  }
+  for (uint64_t x = start; x > lowest; --x) {
+    const auto xd = static_cast<double>(x);
+    relative *= xd * (total - k - n + xd) / ((k - xd + 1.0) * (n - xd + 1.0));
+    sum += relative;
+    if (relative < NEGLIGIBLE_TERM * sum) {
+      break;
+    }
+  }
+  return std::log1p(-std::min(1.0, std::exp(log_first + std::log(sum))));
+}
+
+std::string formatLogProbability(double log_probability) {
+  if (std::isinf(log_probability)) {
+    return "0.000e+00";
+  }
+  const double log10 = log_probability / std::numbers::ln10;
+  auto exponent = static_cast<long long>(std::floor(log10));
+  double mantissa = std::pow(10.0, log10 - static_cast<double>(exponent));
+  if (mantissa >= 9.9995) {
+    mantissa = 1.0;
+    ++exponent;
+  }
+  return std::format("{:.3f}e{:+03}", mantissa, exponent);
+}
+
+MotifEnrichment MotifEnrichment::compute(std::string_view pattern,
+                                         uint64_t foreground_hits,
+                                         uint64_t foreground_sequences,
+                                         uint64_t background_hits,
+                                         uint64_t background_sequences) {
+  MotifEnrichment enrichment;
+  enrichment.pattern = pattern;
+  enrichment.foreground_hits = foreground_hits;
+  enrichment.foreground_sequences = foreground_sequences;
+  enrichment.background_hits = background_hits;
+  enrichment.background_sequences = background_sequences;
+  if (foreground_sequences > 0) {
+    enrichment.foreground_frequency =
+        static_cast<double>(foreground_hits) /
+        static_cast<double>(foreground_sequences);
+  }
+  if (background_sequences > 0) {
+    enrichment.background_frequency =
+        static_cast<double>(background_hits) /
+        static_cast<double>(background_sequences);
+  }
+  if (enrichment.background_frequency > 0.0) {
+    enrichment.fold_enrichment =
+        enrichment.foreground_frequency / enrichment.background_frequency;
+  } else if (foreground_hits > 0) {
+    enrichment.fold_enrichment = std::numeric_limits<double>::infinity();
+  }
+  enrichment.log_p_value = hypergeometricLogTail(
+      foreground_hits, foreground_sequences, foreground_hits + background_hits,
+      foreground_sequences + background_sequences);
+  return enrichment;
+}
+
+} // namespace dna_motif
@@ -3,11 +3,23 @@
 #include <execution>
 #include <format>
 #include <iomanip>
+#include <map>
 #include <ranges>
 #include <set>
 
 namespace dna_motif {
 
+namespace {
+
+constexpr Strand strandOf(bool forward, bool reverse) noexcept {
+  if (forward) {
+    return reverse ? Strand::Both : Strand::Forward;
+  }
+  return Strand::Reverse;
+}
+
+} // namespace
+
 MotifFinder::MotifFinder(const IUPACCodes &iupac_codes)
     : iupac_codes_(iupac_codes) {}
 
@@ -56,6 +68,875 @@ MotifFinder::findSingleMotif(std::span<const ChIPSequence> sequences,
   return result;
 }
 
+std::vector<MotifResult>
+MotifFinder::findMotifs(const SequenceStore &store,
+                        std::span<const Motif> motifs) {
+  Timer timer;
+  zone_stats_ = {};
+
+  const ScanKernel kernel = options_.kernel;
+  const bool motif_major =
+      kernel == ScanKernel::MotifMajor ||
+      (kernel == ScanKernel::Auto && motifs.size() >= MOTIF_MAJOR_MIN_PANEL);
+  if (motif_major && options_.max_mismatches == 0) {
+    if (auto panel = MotifPanel::compile(motifs, iupac_codes_,
+                                         options_.both_strands)) {
+      auto results = withMotifLength(panel->motifLength(), [&](auto length) {
+        return withSequenceLength(store.uniformLength(), [&](auto sequence) {
+          return scanMotifMajor<decltype(length)::value,
+                                decltype(sequence)::value>(store, motifs,
+                                                           *panel);
+        });
+      });
+      keepHitBitsets(results, store.size());
+      updatePerformanceStats("find_motifs_total", timer.elapsed());
+      return results;
+    }
+  }
+
+  std::vector<MotifResult> results(motifs.size());
+
+#pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < motifs.size(); ++i) {
+    results[i] = scanSingleMotif(store, motifs[i]);
+  }
+  keepHitBitsets(results, store.size());
+
+  double total_time = timer.elapsed();
+  updatePerformanceStats("find_motifs_total", total_time);
+
+  return results;
+}
+
+std::vector<MotifResult>
+MotifFinder::findMotifs(const SequenceStore &store,
+                        std::span<const Motif> motifs,
+                        PositionHistogram &histogram) {
+  if (options_.max_mismatches > 0) {
+    throw std::invalid_argument(
+        "Position histograms count exact hits only");
+  }
+
+  Timer timer;
+  zone_stats_ = {};
+
+  size_t longest = 0;
+  for (const auto &sequence : store.sequences()) {
+    longest = std::max(longest, sequence.sequence.size());
+  }
+  size_t shortest = longest + 1;
+  for (const auto &motif : motifs) {
+    shortest = std::min(shortest, motif.pattern.size());
+  }
+  histogram = PositionHistogram(
+      motifs.size(), longest >= shortest ? longest - shortest + 1 : 0);
+
+  // Invalid codes never match, so those motifs keep zero histogram rows
+  std::vector<MotifResult> results(motifs.size());
+  std::map<size_t, std::vector<size_t>> by_length;
+  for (size_t i = 0; i < motifs.size(); ++i) {
+    const auto &pattern = motifs[i].pattern;
+    if (std::ranges::any_of(pattern, [&](char code) {
+          return iupac_codes_.getBaseMask(code) == 0;
+        })) {
+      results[i] = scanSingleMotif(store, motifs[i]);
+    } else {
+      by_length[pattern.size()].push_back(i);
+    }
+  }
+
+  for (const auto &[length, indices] : by_length) {
+    std::vector<Motif> group;
+    group.reserve(indices.size());
+    for (size_t i : indices) {
+      group.push_back(motifs[i]);
+    }
+
+    // Cannot fail: one length and valid codes only
+    const auto panel =
+        MotifPanel::compile(group, iupac_codes_, options_.both_strands);
+    auto group_results = withMotifLength(length, [&](auto motif_length) {
+      return withSequenceLength(store.uniformLength(), [&](auto sequence) {
+        return scanMotifMajor<decltype(motif_length)::value,
+                              decltype(sequence)::value>(
+            store, group, *panel, &histogram, indices);
+      });
+    });
+    for (size_t k = 0; k < indices.size(); ++k) {
+      results[indices[k]] = std::move(group_results[k]);
+    }
+  }
+
+  keepHitBitsets(results, store.size());
+
+  updatePerformanceStats("find_motifs_total", timer.elapsed());
+  return results;
+}
+
+MotifResult MotifFinder::findSingleMotif(const SequenceStore &store,
+                                         const Motif &motif) {
+  Timer timer;
+
+  MotifResult result = scanSingleMotif(store, motif);
+
+  double motif_time = timer.elapsed();
+  updatePerformanceStats("find_single_motif", motif_time);
+
+  return result;
+}
+
+std::optional<ScanKernel> parseScanKernel(std::string_view name) {
+  static constexpr std::array kernels = {
+      ScanKernel::Auto,      ScanKernel::Scalar,     ScanKernel::WindowCodes,
+      ScanKernel::Prefilter, ScanKernel::MotifMajor, ScanKernel::Swar};
+
+  for (ScanKernel kernel : kernels) {
+    if (scanKernelName(kernel) == name) {
+      return kernel;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string_view scanKernelName(ScanKernel kernel) noexcept {
+  switch (kernel) {
+  case ScanKernel::Auto:
+    return "auto";
+  case ScanKernel::Scalar:
+    return "scalar";
+  case ScanKernel::WindowCodes:
+    return "window-codes";
+  case ScanKernel::Prefilter:
+    return "prefilter";
+  case ScanKernel::MotifMajor:
+    return "motif-major";
+  case ScanKernel::Swar:
+    return "swar";
+  }
+  return "auto";
+}
+
+void MotifFinder::prepareStore(SequenceStore &store) const {
+  switch (options_.kernel) {
+  case ScanKernel::Scalar:
+  case ScanKernel::Prefilter:
+  case ScanKernel::MotifMajor:
+    break;
+  case ScanKernel::WindowCodes:
+    store.buildWindowCodes();
+    break;
+  case ScanKernel::Swar:
+    store.buildBaseNibbles();
+    break;
+  case ScanKernel::Auto:
+#if defined(__AVX2__)
+    store.buildWindowCodes();
+#else
+    store.buildBaseNibbles();
+#endif
+    break;
+  }
+  if (options_.zone_maps) {
+    store.buildZoneMaps();
+  }
+}
+
+std::vector<uint8_t> MotifFinder::liveZones(const SequenceStore &store,
+                                            std::string_view pattern,
+                                            std::string_view reverse) const {
+  if (!store.hasZoneMaps() || pattern.size() < WINDOW_CODE_LENGTH) {
+    return {};
+  }
+  auto table =
+      KmerTable::compile(pattern.substr(0, WINDOW_CODE_LENGTH), iupac_codes_);
+  if (!table) {
+    return {};
+  }
+  if (!reverse.empty()) {
+    auto reverse_table = KmerTable::compile(
+        reverse.substr(0, WINDOW_CODE_LENGTH), iupac_codes_);
+    if (!reverse_table) {
+      return {};
+    }
+    table->merge(*reverse_table);
+  }
+
+  const auto codes = table->words();
+  std::vector<uint8_t> live(store.zoneCount(), 0);
+  size_t skipped = 0;
+  for (size_t block = 0; block < live.size(); ++block) {
+    const auto map = store.zoneMap(block);
+    // OR-reduce 64 words at a time so the inner loop vectorizes
+    for (size_t w = 0; w < map.size() && !live[block]; w += 64) {
+      uint64_t shared = 0;
+      for (size_t k = w; k < w + 64; ++k) {
+        shared |= map[k] & codes[k];
+      }
+      live[block] = shared != 0;
+    }
+    skipped += !live[block];
+  }
+
+#pragma omp atomic
+  zone_stats_.blocks_checked += live.size();
+#pragma omp atomic
+  zone_stats_.blocks_skipped += skipped;
+  return live;
+}
+
+std::optional<KmerTable>
+MotifFinder::windowTable(std::string_view pattern,
+                         std::string_view reverse) const {
+  // Both strands share one table: a window is accepted if it matches the
+  // motif or its reverse complement
+  auto table = KmerTable::compile(pattern, iupac_codes_);
+  if (table && !reverse.empty()) {
+    auto reverse_table = KmerTable::compile(reverse, iupac_codes_);
+    if (!reverse_table) {
+      return std::nullopt;
+    }
+    table->merge(*reverse_table);
+  }
+  return table;
+}
+
+ScanKernel MotifFinder::selectKernel(const SequenceStore &store,
+                                     std::string_view pattern) const {
+  const ScanKernel kernel = options_.kernel;
+  const std::string reverse = options_.both_strands
+                                  ? iupac_codes_.reverseComplement(pattern)
+                                  : std::string();
+
+#if !defined(__AVX2__)
+  // Without AVX2 the prefilter has no vector lookup; SWAR is the fast path
+  const bool auto_swar = kernel == ScanKernel::Auto;
+#else
+  const bool auto_swar = false;
+#endif
+  if ((kernel == ScanKernel::Swar || auto_swar) && store.hasBaseNibbles() &&
+      SwarMotif::compile(pattern, iupac_codes_)) {
+    return ScanKernel::Swar;
+  }
+
+  const bool has_table = kernel != ScanKernel::Scalar &&
+                         store.hasWindowCodes() &&
+                         windowTable(pattern, reverse).has_value();
+  const bool want_prefilter = kernel == ScanKernel::Prefilter ||
+                              kernel == ScanKernel::Auto ||
+                              kernel == ScanKernel::MotifMajor;
+  if (want_prefilter) {
+    auto plan = PrefilterPlan::compile(pattern, iupac_codes_);
+    auto reverse_plan = options_.both_strands
+                            ? PrefilterPlan::compile(reverse, iupac_codes_)
+                            : std::nullopt;
+    // Either strand's candidates have to be verified; motifs without a
+    // window code table would otherwise take the character path
+    const double pass_rate =
+        plan ? plan->passRate() + (reverse_plan ? reverse_plan->passRate() : 0)
+             : 1.0;
+    if (plan && (kernel == ScanKernel::Prefilter || !has_table ||
+                 pass_rate <= PREFILTER_MAX_PASS_RATE)) {
+      return ScanKernel::Prefilter;
+    }
+  }
+  return has_table ? ScanKernel::WindowCodes : ScanKernel::Scalar;
+}
+
+MotifResult MotifFinder::scanSingleMotif(const SequenceStore &store,
+                                         const Motif &motif) const {
+  const std::string reverse =
+      options_.both_strands ? iupac_codes_.reverseComplement(motif.pattern)
+                            : std::string();
+
+  if (GappedMotif::isGapped(motif.pattern)) {
+    if (auto gapped = GappedMotif::compile(motif.pattern, iupac_codes_)) {
+      auto reverse_gapped =
+          options_.both_strands
+              ? GappedMotif::compile(gapped->reverseComplement(iupac_codes_),
+                                     iupac_codes_)
+              : std::nullopt;
+      return scanGapped(store, motif, *gapped,
+                        reverse_gapped ? &*reverse_gapped : nullptr);
+    }
+  }
+
+  if (options_.max_mismatches > 0) {
+    auto counter = MismatchMotif::compile(motif.pattern, iupac_codes_,
+                                          options_.max_mismatches);
+    auto reverse_counter =
+        options_.both_strands
+            ? MismatchMotif::compile(reverse, iupac_codes_,
+                                     options_.max_mismatches)
+            : std::nullopt;
+    if (counter) {
+      return withMotifLength(counter->motifLength(), [&](auto length) {
+        return scanMismatches<decltype(length)::value>(
+            store, motif, *counter,
+            reverse_counter ? &*reverse_counter : nullptr);
+      });
+    }
+  }
+
+  const std::vector<uint8_t> live = liveZones(store, motif.pattern, reverse);
+  const auto skipped = [&](size_t i) {
+    return !live.empty() && store.isClean(i) &&
+           !live[i / store.zoneBlockSize()];
+  };
+
+  const ScanKernel selected = selectKernel(store, motif.pattern);
+  if (selected == ScanKernel::Swar) {
+    auto swar = SwarMotif::compile(motif.pattern, iupac_codes_);
+    auto reverse_swar = options_.both_strands
+                            ? SwarMotif::compile(reverse, iupac_codes_)
+                            : std::nullopt;
+    return withMotifLength(swar->motifLength(), [&](auto length) {
+      return withSequenceLength(store.uniformLength(), [&](auto sequence) {
+        return scanSwar<decltype(length)::value, decltype(sequence)::value>(
+            store, motif, *swar, reverse_swar ? &*reverse_swar : nullptr,
+            live);
+      });
+    });
+  }
+  if (selected == ScanKernel::Prefilter) {
+    auto plan = PrefilterPlan::compile(motif.pattern, iupac_codes_);
+    auto reverse_plan = options_.both_strands
+                            ? PrefilterPlan::compile(reverse, iupac_codes_)
+                            : std::nullopt;
+    return scanPrefiltered(store, motif, *plan,
+                           reverse_plan ? &*reverse_plan : nullptr, live);
+  }
+
+  MotifResult result(motif.pattern);
+  auto table = selected == ScanKernel::WindowCodes
+                   ? windowTable(motif.pattern, reverse)
+                   : std::nullopt;
+
+  for (size_t i = 0; i < store.size(); ++i) {
+    if (skipped(i)) {
+      continue;
+    }
+    if (!table || !store.isClean(i)) {
+      appendFirstMatch(result, store.sequence(i), motif.pattern, reverse, i);
+      continue;
+    }
+
+    const auto codes = store.windowCodes(i);
+    const auto hit = std::ranges::find_if(
+        codes, [&](uint16_t code) { return table->contains(code); });
+    if (hit != codes.end()) {
+      const auto pos = static_cast<size_t>(hit - codes.begin());
+      const std::string_view text(store.sequence(i).sequence);
+      result.match_count++;
+      result.matches.emplace_back(i, pos,
+                                  text.substr(pos, motif.pattern.length()),
+                                  strandAt(text, motif.pattern, reverse, pos));
+    }
+  }
+
+  result.calculateFrequency(store.size());
+  return result;
+}
+
+MotifResult MotifFinder::scanPrefiltered(const SequenceStore &store,
+                                         const Motif &motif,
+                                         const PrefilterPlan &plan,
+                                         const PrefilterPlan *reverse,
+                                         std::span<const uint8_t> live) const {
+  MotifResult result(motif.pattern);
+  const size_t motif_length = plan.motifLength();
+  const auto bases = store.flatBases();
+
+  // Ranges of flatBases() covering runs of live zone blocks, or everything
+  std::vector<std::pair<size_t, size_t>> ranges;
+  if (live.empty()) {
+    ranges.emplace_back(0, bases.size());
+  }
+  const size_t zone = store.zoneBlockSize();
+  for (size_t block = 0; block < live.size(); ++block) {
+    if (!live[block]) {
+      continue;
+    }
+    const size_t first = store.baseOffset(block * zone);
+    const size_t last =
+        store.baseOffset(std::min(store.size(), (block + 1) * zone));
+    if (!ranges.empty() && ranges.back().second == first) {
+      ranges.back().second = last;
+    } else {
+      ranges.emplace_back(first, last);
+    }
+  }
+
+  // Candidates are produced for 64 offsets of the concatenated store at a
+  // time; offsets crossing a sequence end are discarded afterwards
+  size_t seq = 0;
+  size_t skip_until = 0;
+  for (const auto &[first, last] : ranges) {
+    for (size_t block = first / 64 * 64; block < last; block += 64) {
+      const uint64_t forward_candidates =
+          plan.candidates(bases.data() + block);
+      const uint64_t reverse_candidates =
+          reverse ? reverse->candidates(bases.data() + block) : 0;
+      uint64_t candidates = forward_candidates | reverse_candidates;
+
+      for (; candidates != 0; candidates &= candidates - 1) {
+        const auto offset = static_cast<size_t>(std::countr_zero(candidates));
+        const size_t pos = block + offset;
+        if (pos >= last) {
+          break;
+        }
+        if (pos < skip_until || pos < first) {
+          continue;
+        }
+
+        while (store.baseOffset(seq + 1) <= pos) {
+          ++seq;
+        }
+        const size_t begin = store.baseOffset(seq);
+        const size_t end = store.baseOffset(seq + 1);
+
+        if (!store.isClean(seq)) {
+          skip_until = end;
+          continue;
+        }
+        if (pos + motif_length > end) {
+          continue;
+        }
+
+        const bool forward = ((forward_candidates >> offset) & 1u) &&
+                             plan.verify(bases.data() + pos);
+        const bool backward = ((reverse_candidates >> offset) & 1u) &&
+                              reverse->verify(bases.data() + pos);
+        if (!forward && !backward) {
+          continue;
+        }
+
+        result.match_count++;
+        result.matches.emplace_back(
+            seq, pos - begin,
+            std::string_view(store.sequence(seq).sequence)
+                .substr(pos - begin, motif_length),
+            strandOf(forward, backward));
+        skip_until = end;
+      }
+    }
+  }
+
+  if (store.dirtyCount() > 0) {
+    const std::string reverse_pattern =
+        reverse ? iupac_codes_.reverseComplement(motif.pattern) : std::string();
+    for (size_t i = 0; i < store.size(); ++i) {
+      if (!store.isClean(i)) {
+        appendFirstMatch(result, store.sequence(i), motif.pattern,
+                         reverse_pattern, i);
+      }
+    }
+    std::ranges::sort(result.matches, {}, &MotifMatch::sequence_index);
+  }
+
+  result.calculateFrequency(store.size());
+  return result;
+}
+
+template <size_t Length, size_t SequenceLength>
+MotifResult MotifFinder::scanSwar(const SequenceStore &store,
+                                  const Motif &motif, const SwarMotif &swar,
+                                  const SwarMotif *reverse,
+                                  std::span<const uint8_t> live) const {
+  MotifResult result(motif.pattern);
+  const size_t motif_length =
+      Length == DYNAMIC_LENGTH ? swar.motifLength() : Length;
+  const std::string reverse_pattern =
+      reverse ? iupac_codes_.reverseComplement(motif.pattern) : std::string();
+
+  for (size_t i = 0; i < store.size(); ++i) {
+    const auto &sequence = store.sequence(i);
+    if (!store.isClean(i)) {
+      appendFirstMatch(result, sequence, motif.pattern, reverse_pattern, i);
+      continue;
+    }
+    if (!live.empty() && !live[i / store.zoneBlockSize()]) {
+      continue;
+    }
+    if (sequence.sequence.size() < motif_length) {
+      continue;
+    }
+
+    const auto words = store.baseNibbles(i);
+    const size_t sequence_length = SequenceLength == DYNAMIC_LENGTH
+                                       ? sequence.sequence.size()
+                                       : SequenceLength;
+    const size_t windows = sequence_length - motif_length + 1;
+    for (size_t first = 0; first < windows; first += SwarMotif::LANES) {
+      // Windows running past the end read zero nibbles and never match
+      const uint16_t forward = swar.matchBlock<Length>(words, first);
+      const uint16_t backward =
+          reverse ? reverse->matchBlock<Length>(words, first) : 0;
+      const auto hits = static_cast<uint16_t>(forward | backward);
+      if (hits != 0) {
+        const auto lane = static_cast<size_t>(std::countr_zero(hits));
+        const size_t pos = first + lane;
+        result.match_count++;
+        result.matches.emplace_back(
+            i, pos,
+            std::string_view(sequence.sequence).substr(pos, motif_length),
+            strandOf((forward >> lane) & 1u, (backward >> lane) & 1u));
+        break;
+      }
+    }
+  }
+
+  result.calculateFrequency(store.size());
+  return result;
+}
+
+MotifResult MotifFinder::scanGapped(const SequenceStore &store,
+                                    const Motif &motif,
+                                    const GappedMotif &gapped,
+                                    const GappedMotif *reverse) const {
+  MotifResult result(motif.pattern);
+  std::vector<uint64_t> forward_hits;
+  std::vector<uint64_t> reverse_hits;
+  std::vector<uint64_t> scratch;
+
+  for (size_t i = 0; i < store.size(); ++i) {
+    const std::string_view text = store.sequence(i).sequence;
+    const uint8_t *bases = store.bases(i).data();
+
+    size_t start = 0;
+    while (start < text.size()) {
+      const size_t end =
+          store.isClean(i)
+              ? text.size()
+              : static_cast<size_t>(std::find_if_not(text.begin() + start,
+                                                     text.end(),
+                                                     isNucleotide) -
+                                    text.begin());
+      gapped.matchRun(bases + start, end - start, forward_hits, scratch);
+      if (reverse) {
+        reverse->matchRun(bases + start, end - start, reverse_hits, scratch);
+      }
+
+      size_t w = 0;
+      while (w < forward_hits.size() &&
+             (forward_hits[w] | (reverse ? reverse_hits[w] : 0)) == 0) {
+        ++w;
+      }
+      if (w < forward_hits.size()) {
+        const uint64_t forward = forward_hits[w];
+        const uint64_t backward = reverse ? reverse_hits[w] : 0;
+        const auto offset =
+            static_cast<size_t>(std::countr_zero(forward | backward));
+        const size_t pos = start + w * 64 + offset;
+        const bool on_forward = (forward >> offset) & 1u;
+        const GappedMotif &hit = on_forward ? gapped : *reverse;
+        const size_t length = hit.minLength() - hit.spacer().first +
+                              hit.spacerAt(bases + pos);
+        result.match_count++;
+        result.matches.emplace_back(
+            i, pos, text.substr(pos, length),
+            strandOf(on_forward, (backward >> offset) & 1u));
+        break;
+      }
+      start = end + 1;
+    }
+  }
+
+  result.calculateFrequency(store.size());
+  return result;
+}
+
+template <size_t Length>
+MotifResult MotifFinder::scanMismatches(const SequenceStore &store,
+                                        const Motif &motif,
+                                        const MismatchMotif &counter,
+                                        const MismatchMotif *reverse) const {
+  const size_t motif_length = counter.motifLength();
+  const size_t max_mismatches = counter.maxMismatches();
+  const auto no_hit = static_cast<uint8_t>(max_mismatches + 1);
+  const auto bases = store.flatBases();
+
+  std::vector<uint8_t> best_level(store.size(), no_hit);
+  std::vector<size_t> best_position(store.size(), 0);
+  std::vector<Strand> best_strand(store.size(), Strand::Forward);
+
+  // Same flat 64-offset walk as scanPrefiltered; a sequence is skipped once
+  // an exact hit is known since no later window can improve on it
+  size_t seq = 0;
+  size_t skip_until = 0;
+  for (size_t block = 0; block < bases.size(); block += 64) {
+    const auto forward = counter.countMismatches<Length>(bases.data() + block);
+    const auto backward =
+        reverse ? reverse->countMismatches<Length>(bases.data() + block)
+                : MismatchMotif::Levels{};
+    uint64_t candidates = forward[max_mismatches] | backward[max_mismatches];
+
+    for (; candidates != 0; candidates &= candidates - 1) {
+      const auto offset = static_cast<size_t>(std::countr_zero(candidates));
+      const size_t pos = block + offset;
+      if (pos >= bases.size()) {
+        break;
+      }
+      if (pos < skip_until) {
+        continue;
+      }
+
+      while (store.baseOffset(seq + 1) <= pos) {
+        ++seq;
+      }
+      const size_t end = store.baseOffset(seq + 1);
+      if (!store.isClean(seq)) {
+        skip_until = end;
+        continue;
+      }
+      if (pos + motif_length > end) {
+        continue;
+      }
+
+      uint8_t level = 0;
+      while (!(((forward[level] | backward[level]) >> offset) & 1u)) {
+        ++level;
+      }
+      if (level < best_level[seq]) {
+        best_level[seq] = level;
+        best_position[seq] = pos - store.baseOffset(seq);
+        best_strand[seq] = strandOf((forward[level] >> offset) & 1u,
+                                    (backward[level] >> offset) & 1u);
+      }
+      if (level == 0) {
+        skip_until = end;
+      }
+    }
+  }
+
+  // Character path for sequences the nucleotide codes cannot represent
+  const std::string reverse_pattern =
+      reverse ? iupac_codes_.reverseComplement(motif.pattern) : std::string();
+  for (size_t i = 0; i < store.size() && store.dirtyCount() > 0; ++i) {
+    const std::string_view text(store.sequence(i).sequence);
+    if (store.isClean(i) || text.length() < motif_length) {
+      continue;
+    }
+    for (size_t pos = 0; pos + motif_length <= text.length(); ++pos) {
+      const size_t forward_mismatches =
+          iupac_codes_.countMismatches(text, motif.pattern, pos);
+      const size_t reverse_mismatches =
+          reverse ? iupac_codes_.countMismatches(text, reverse_pattern, pos)
+                  : motif_length;
+      const size_t level = std::min(forward_mismatches, reverse_mismatches);
+      if (level < best_level[i]) {
+        best_level[i] = static_cast<uint8_t>(level);
+        best_position[i] = pos;
+        best_strand[i] = strandOf(forward_mismatches == level,
+                                  reverse_mismatches == level);
+      }
+    }
+  }
+
+  MotifResult result(motif.pattern);
+  result.mismatch_counts.assign(max_mismatches + 1, 0);
+  for (size_t i = 0; i < store.size(); ++i) {
+    if (best_level[i] == no_hit) {
+      continue;
+    }
+    result.match_count++;
+    result.mismatch_counts[best_level[i]]++;
+    result.matches.emplace_back(
+        i, best_position[i],
+        std::string_view(store.sequence(i).sequence)
+            .substr(best_position[i], motif_length),
+        best_strand[i], best_level[i]);
+  }
+
+  result.calculateFrequency(store.size());
+  return result;
+}
+
+template <size_t Length, size_t SequenceLength>
+std::vector<MotifResult>
+MotifFinder::scanMotifMajor(const SequenceStore &store,
+                            std::span<const Motif> motifs,
+                            const MotifPanel &panel,
+                            PositionHistogram *histogram,
+                            std::span<const size_t> rows) const {
+  const size_t motif_length =
+      Length == DYNAMIC_LENGTH ? panel.motifLength() : Length;
+  const size_t words = panel.wordCount();
+  const bool both_strands = panel.strandCount() == 2;
+  const size_t offsets = histogram ? histogram->offset_count : 0;
+
+  std::vector<std::string> reverse_patterns(motifs.size());
+  if (both_strands) {
+    std::ranges::transform(motifs, reverse_patterns.begin(),
+                           [&](const Motif &motif) {
+                             return iupac_codes_.reverseComplement(
+                                 motif.pattern);
+                           });
+  }
+
+  // Per-thread partial results; static scheduling hands each thread one
+  // contiguous range, so concatenating in thread order keeps matches sorted
+  std::vector<std::vector<MotifResult>> partials(
+      static_cast<size_t>(omp_get_max_threads()));
+  // Per-thread histograms, [motif * offsets + offset]
+  std::vector<std::vector<uint64_t>> positions(partials.size());
+
+#pragma omp parallel
+  {
+    const auto thread = static_cast<size_t>(omp_get_thread_num());
+    auto &local = partials[thread];
+    local.resize(motifs.size());
+    auto &local_positions = positions[thread];
+    local_positions.assign(motifs.size() * offsets, 0);
+    std::vector<uint64_t> pending(words);
+    std::vector<uint64_t> hits(words * panel.strandCount());
+
+#pragma omp for schedule(static)
+    for (size_t i = 0; i < store.size(); ++i) {
+      const auto &sequence = store.sequence(i);
+
+      if (!store.isClean(i)) {
+        for (size_t m = 0; m < motifs.size(); ++m) {
+          appendFirstMatch(local[m], sequence, motifs[m].pattern,
+                           reverse_patterns[m], i);
+        }
+        if (histogram) {
+          countPositions(sequence.sequence, motifs, reverse_patterns,
+                         local_positions, offsets);
+        }
+        continue;
+      }
+
+      const auto bases = store.bases(i);
+      if (bases.size() < motif_length) {
+        continue;
+      }
+
+      std::ranges::fill(pending, ~0ull);
+      if (motifs.size() % 64 != 0) {
+        pending.back() = (1ull << (motifs.size() % 64)) - 1;
+      }
+
+      const size_t sequence_length =
+          SequenceLength == DYNAMIC_LENGTH ? bases.size() : SequenceLength;
+      const size_t windows = sequence_length - motif_length + 1;
+      for (size_t w = 0; w < windows; ++w) {
+        panel.matchWindow<Length>(bases.data() + w, hits.data());
+
+        uint64_t remaining = 0;
+        for (size_t k = 0; k < words; ++k) {
+          const uint64_t backward = both_strands ? hits[words + k] : 0;
+          const uint64_t found = hits[k] | backward;
+          uint64_t fresh = found & pending[k];
+          pending[k] &= ~fresh;
+          remaining |= pending[k];
+
+          if (histogram) {
+            for (uint64_t all = found; all != 0; all &= all - 1) {
+              const auto m =
+                  k * 64 + static_cast<size_t>(std::countr_zero(all));
+              local_positions[m * offsets + w]++;
+            }
+          }
+
+          for (; fresh != 0; fresh &= fresh - 1) {
+            const auto bit = static_cast<size_t>(std::countr_zero(fresh));
+            const size_t m = k * 64 + bit;
+            local[m].match_count++;
+            local[m].matches.emplace_back(
+                i, w,
+                std::string_view(sequence.sequence).substr(w, motif_length),
+                strandOf((hits[k] >> bit) & 1u, (backward >> bit) & 1u));
+          }
+        }
+
+        // The histogram needs every window, not only first hits
+        if (remaining == 0 && !histogram) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (histogram) {
+    for (const auto &local_positions : positions) {
+      for (size_t m = 0; m < motifs.size(); ++m) {
+        const auto row = histogram->row(rows[m]);
+        for (size_t w = 0; w < offsets; ++w) {
+          row[w] += local_positions[m * offsets + w];
+        }
+      }
+    }
+  }
+
+  std::vector<MotifResult> results;
+  results.reserve(motifs.size());
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    MotifResult result(motifs[m].pattern);
+    for (auto &local : partials) {
+      if (local.empty()) {
+        continue;
+      }
+      result.match_count += local[m].match_count;
+      std::ranges::move(local[m].matches, std::back_inserter(result.matches));
+    }
+    result.calculateFrequency(store.size());
+    results.push_back(std::move(result));
+  }
+
+  return results;
+}
+
+void MotifFinder::appendFirstMatch(MotifResult &result,
+                                   const ChIPSequence &sequence,
+                                   std::string_view pattern,
+                                   std::string_view reverse,
+                                   size_t sequence_index) const {
+  if (sequence.sequence.length() < pattern.length()) {
+    return;
+  }
+
+  const std::string_view text(sequence.sequence);
+  for (size_t pos = 0; pos + pattern.length() <= text.length(); ++pos) {
+    const bool forward = iupac_codes_.matchesMotif(text, pattern, pos);
+    const bool backward =
+        !reverse.empty() && iupac_codes_.matchesMotif(text, reverse, pos);
+    if (forward || backward) {
+      result.match_count++;
+      result.matches.emplace_back(sequence_index, pos,
+                                  text.substr(pos, pattern.length()),
+                                  strandOf(forward, backward));
+      return;
+    }
+  }
+}
+
+void MotifFinder::countPositions(std::string_view text,
+                                 std::span<const Motif> motifs,
+                                 std::span<const std::string> reverse_patterns,
+                                 std::span<uint64_t> positions,
+                                 size_t offsets) const {
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    const std::string_view pattern = motifs[m].pattern;
+    for (size_t pos = 0; pos + pattern.length() <= text.length(); ++pos) {
+      if (iupac_codes_.matchesMotif(text, pattern, pos) ||
+          (!reverse_patterns[m].empty() &&
+           iupac_codes_.matchesMotif(text, reverse_patterns[m], pos))) {
+        positions[m * offsets + pos]++;
+      }
+    }
+  }
+}
+
+Strand MotifFinder::strandAt(std::string_view text, std::string_view pattern,
+                             std::string_view reverse,
+                             size_t position) const noexcept {
+  if (reverse.empty()) {
+    return Strand::Forward;
+  }
+  return strandOf(iupac_codes_.matchesMotif(text, pattern, position),
+                  iupac_codes_.matchesMotif(text, reverse, position));
+}
+
 std::vector<MotifMatch>
 MotifFinder::findMotifInSequence(const ChIPSequence &sequence,
                                  const Motif &motif, size_t sequence_index) {
@@ -84,6 +965,13 @@ bool MotifFinder::matchesAtPosition(std::string_view sequence,
   return iupac_codes_.matchesMotif(sequence, motif, start_pos);
 }
 
+void MotifFinder::keepHitBitsets(std::span<const MotifResult> results,
+                                 size_t sequence_count) {
+  hit_bitsets_ = options_.keep_hit_bitsets
+                     ? HitBitsets::fromResults(results, sequence_count)
+                     : HitBitsets();
+}
+
 void MotifFinder::updatePerformanceStats(std::string_view operation,
                                          double time_seconds) noexcept {
   performance_stats_[std::string(operation)] = time_seconds;
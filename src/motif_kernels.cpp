@@ -0,0 +1,345 @@
+#include "motif_kernels.h"
+#include <algorithm>
+#include <charconv>
+#include <numeric>
+
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace dna_motif {
+
+std::optional<KmerTable> KmerTable::compile(std::string_view pattern,
+                                            const IUPACCodes &iupac_codes) {
+  if (pattern.size() != WINDOW_CODE_LENGTH) {
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> codes{0};
+  for (char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+
+    std::vector<uint32_t> extended;
+    extended.reserve(codes.size() * static_cast<size_t>(std::popcount(mask)));
+    for (uint32_t prefix : codes) {
+      for (uint32_t base = 0; base < 4; ++base) {
+        if (mask & (1u << base)) {
+          extended.push_back((prefix << NUCLEOTIDE_CODE_BITS) | base);
+        }
+      }
+    }
+    codes = std::move(extended);
+  }
+
+  KmerTable table;
+  for (uint32_t code : codes) {
+    table.bits_[code >> 6] |= 1ull << (code & 63);
+  }
+  return table;
+}
+
+size_t KmerTable::cardinality() const noexcept {
+  return std::transform_reduce(
+      bits_.begin(), bits_.end(), 0uz, std::plus<>(),
+      [](uint64_t word) { return static_cast<size_t>(std::popcount(word)); });
+}
+
+std::optional<MotifPanel>
+MotifPanel::compile(std::span<const Motif> motifs,
+                    const IUPACCodes &iupac_codes, bool both_strands) {
+  if (motifs.empty() || motifs.front().pattern.empty()) {
+    return std::nullopt;
+  }
+
+  MotifPanel panel;
+  panel.motif_count_ = motifs.size();
+  panel.motif_length_ = motifs.front().pattern.size();
+  panel.word_count_ = (motifs.size() + 63) / 64;
+  panel.strand_count_ = both_strands ? 2 : 1;
+
+  const size_t row_words = panel.word_count_ * panel.strand_count_;
+  panel.rows_.assign(panel.motif_length_ * 4 * row_words, 0);
+
+  for (size_t i = 0; i < motifs.size(); ++i) {
+    const auto &pattern = motifs[i].pattern;
+    if (pattern.size() != panel.motif_length_) {
+      return std::nullopt;
+    }
+
+    for (size_t p = 0; p < pattern.size(); ++p) {
+      const uint8_t mask = iupac_codes.getBaseMask(pattern[p]);
+      if (mask == 0) {
+        return std::nullopt;
+      }
+      for (uint8_t base = 0; base < 4; ++base) {
+        if (mask & (1u << base)) {
+          panel.rows_[(p * 4 + base) * row_words + i / 64] |= 1ull
+                                                              << (i % 64);
+        }
+        // Reverse strand: position p of the window pairs with motif
+        // position length - 1 - p, complemented (code ^ 2)
+        if (both_strands &&
+            (iupac_codes.getBaseMask(pattern[pattern.size() - 1 - p]) &
+             (1u << (base ^ 2u)))) {
+          panel.rows_[(p * 4 + base) * row_words + panel.word_count_ +
+                      i / 64] |= 1ull << (i % 64);
+        }
+      }
+    }
+  }
+
+  return panel;
+}
+
+std::optional<PrefilterPlan>
+PrefilterPlan::compile(std::string_view pattern,
+                       const IUPACCodes &iupac_codes) {
+  if (pattern.empty() || pattern.size() > MAX_MOTIF_LENGTH) {
+    return std::nullopt;
+  }
+
+  PrefilterPlan plan;
+  plan.masks_.reserve(pattern.size());
+  for (char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+    plan.masks_.push_back(mask);
+  }
+
+  plan.order_.resize(pattern.size());
+  std::iota(plan.order_.begin(), plan.order_.end(), uint8_t{0});
+  std::ranges::stable_sort(plan.order_, [&](uint8_t a, uint8_t b) {
+    return std::popcount(plan.masks_[a]) < std::popcount(plan.masks_[b]);
+  });
+
+  // A second filter position only pays off if it rejects something
+  plan.filter_count_ =
+      plan.order_.size() > 1 && std::popcount(plan.masks_[plan.order_[1]]) < 4
+          ? 2
+          : 1;
+
+  for (size_t k = 0; k < plan.filter_count_; ++k) {
+    plan.filter_luts_[k] = acceptLut(plan.masks_[plan.order_[k]]);
+  }
+
+  return plan;
+}
+
+double PrefilterPlan::passRate() const noexcept {
+  double rate = 1.0;
+  for (uint8_t p : filterPositions()) {
+    rate *= std::popcount(masks_[p]) / 4.0;
+  }
+  return rate;
+}
+
+uint64_t PrefilterPlan::candidates(const uint8_t *bases) const noexcept {
+  uint64_t result = ~0ull;
+
+  for (size_t k = 0; k < filter_count_; ++k) {
+    result &= acceptedOffsets(bases + order_[k], masks_[order_[k]],
+                              filter_luts_[k]);
+  }
+
+  return result;
+}
+
+std::optional<SwarMotif> SwarMotif::compile(std::string_view pattern,
+                                            const IUPACCodes &iupac_codes) {
+  if (pattern.empty()) {
+    return std::nullopt;
+  }
+
+  SwarMotif motif;
+  motif.replicated_.reserve(pattern.size());
+  for (char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+    motif.replicated_.push_back(mask * 0x1111111111111111ull);
+  }
+  return motif;
+}
+
+uint16_t SwarMotif::compressNibbles(uint64_t alive) noexcept {
+#if defined(__BMI2__)
+  return static_cast<uint16_t>(_pext_u64(alive, 0x1111111111111111ull));
+#else
+  alive = (alive | (alive >> 3)) & 0x0303030303030303ull;
+  alive = (alive | (alive >> 6)) & 0x000F000F000F000Full;
+  alive = (alive | (alive >> 12)) & 0x000000FF000000FFull;
+  alive = (alive | (alive >> 24)) & 0x000000000000FFFFull;
+  return static_cast<uint16_t>(alive);
+#endif
+}
+
+std::optional<MismatchMotif>
+MismatchMotif::compile(std::string_view pattern, const IUPACCodes &iupac_codes,
+                       size_t max_mismatches) {
+  if (pattern.empty() || pattern.size() > MAX_MOTIF_LENGTH ||
+      max_mismatches > MAX_MISMATCHES) {
+    return std::nullopt;
+  }
+
+  MismatchMotif motif;
+  motif.max_mismatches_ = max_mismatches;
+  motif.masks_.reserve(pattern.size());
+  motif.luts_.reserve(pattern.size());
+  for (char code : pattern) {
+    const uint8_t mask = iupac_codes.getBaseMask(code);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+    motif.masks_.push_back(mask);
+    motif.luts_.push_back(acceptLut(mask));
+  }
+  return motif;
+}
+
+MismatchMotif::Levels MismatchMotif::levels(uint64_t ones, uint64_t twos,
+                                             uint64_t many) const noexcept {
+  Levels within{};
+  const uint64_t valid = ~many;
+  within[0] = valid & ~ones & ~twos;
+  if (max_mismatches_ >= 1) {
+    within[1] = within[0] | (valid & ones & ~twos);
+  }
+  if (max_mismatches_ >= 2) {
+    within[2] = within[1] | (valid & ~ones & twos);
+  }
+  return within;
+}
+
+namespace {
+
+// Word w of a bitset shifted down by shift bits, zero past its end
+uint64_t shiftedWord(std::span<const uint64_t> bits, size_t w,
+                     size_t shift) noexcept {
+  const size_t q = w + shift / 64;
+  const size_t r = shift % 64;
+  const uint64_t low = q < bits.size() ? bits[q] >> r : 0;
+  const uint64_t high =
+      r != 0 && q + 1 < bits.size() ? bits[q + 1] << (64 - r) : 0;
+  return low | high;
+}
+
+// Parse a decimal spacer bound spanning all of text
+std::optional<size_t> parseSpacer(std::string_view text) noexcept {
+  size_t value = 0;
+  const auto [end, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (text.empty() || ec != std::errc() || end != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+} // namespace
+
+std::optional<GappedMotif>
+GappedMotif::compile(std::string_view pattern, const IUPACCodes &iupac_codes) {
+  const size_t open = pattern.find('[');
+  const size_t close = pattern.find(']', open);
+  if (open == std::string_view::npos || close == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  const std::string_view range = pattern.substr(open + 1, close - open - 1);
+  const size_t dash = range.find('-');
+  const auto min_spacer = parseSpacer(range.substr(0, dash));
+  const auto max_spacer = dash == std::string_view::npos
+                              ? min_spacer
+                              : parseSpacer(range.substr(dash + 1));
+  if (!min_spacer || !max_spacer || *min_spacer > *max_spacer ||
+      *max_spacer > MAX_SPACER) {
+    return std::nullopt;
+  }
+
+  GappedMotif motif;
+  motif.left_ = std::string(pattern.substr(0, open));
+  motif.right_ = std::string(pattern.substr(close + 1));
+  motif.min_spacer_ = *min_spacer;
+  motif.max_spacer_ = *max_spacer;
+  if (motif.left_.size() > MAX_MOTIF_LENGTH ||
+      motif.right_.size() > MAX_MOTIF_LENGTH) {
+    return std::nullopt;
+  }
+
+  // Empty half-sites and invalid codes, including a second spacer, fail here
+  auto left = MismatchMotif::compile(motif.left_, iupac_codes, 0);
+  auto right = MismatchMotif::compile(motif.right_, iupac_codes, 0);
+  if (!left || !right) {
+    return std::nullopt;
+  }
+  motif.left_counter_ = std::move(*left);
+  motif.right_counter_ = std::move(*right);
+  for (char code : motif.right_) {
+    motif.right_masks_.push_back(iupac_codes.getBaseMask(code));
+  }
+  return motif;
+}
+
+std::string
+GappedMotif::reverseComplement(const IUPACCodes &iupac_codes) const {
+  const std::string spacer =
+      min_spacer_ == max_spacer_
+          ? std::format("[{}]", min_spacer_)
+          : std::format("[{}-{}]", min_spacer_, max_spacer_);
+  return iupac_codes.reverseComplement(right_) + spacer +
+         iupac_codes.reverseComplement(left_);
+}
+
+void GappedMotif::matchRun(const uint8_t *bases, size_t length,
+                           std::vector<uint64_t> &hits,
+                           std::vector<uint64_t> &scratch) const {
+  const size_t words = (length + 63) / 64;
+  hits.assign(words, 0);
+  if (length < minLength()) {
+    return;
+  }
+
+  // Right half-site mask, cleared past the last offset where it fits
+  const size_t right_offsets = length - right_.size() + 1;
+  scratch.assign(words, 0);
+  for (size_t w = 0; w * 64 < right_offsets; ++w) {
+    scratch[w] = right_counter_.countMismatches(bases + w * 64)[0];
+  }
+  if (right_offsets % 64 != 0) {
+    scratch[right_offsets / 64] &= (1ull << (right_offsets % 64)) - 1;
+  }
+
+  // Offset t hits when LEFT matches at t and RIGHT at t + |LEFT| + spacer;
+  // offsets past the last composite window find no right hit
+  const size_t offsets = length - minLength() + 1;
+  for (size_t w = 0; w * 64 < offsets; ++w) {
+    uint64_t right = 0;
+    for (size_t gap = min_spacer_; gap <= max_spacer_; ++gap) {
+      right |= shiftedWord(scratch, w, left_.size() + gap);
+    }
+    if (right != 0) {
+      hits[w] = right & left_counter_.countMismatches(bases + w * 64)[0];
+    }
+  }
+}
+
+size_t GappedMotif::spacerAt(const uint8_t *bases) const noexcept {
+  for (size_t gap = min_spacer_; gap < max_spacer_; ++gap) {
+    const uint8_t *site = bases + left_.size() + gap;
+    bool match = true;
+    for (size_t p = 0; p < right_masks_.size() && match; ++p) {
+      match = ((right_masks_[p] >> site[p]) & 1u) != 0;
+    }
+    if (match) {
+      return gap;
+    }
+  }
+  return max_spacer_;
+}
+
+} // namespace dna_motif
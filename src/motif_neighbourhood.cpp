@@ -0,0 +1,378 @@
+#include "motif_neighbourhood.h"
+#include "motif_kernels.h"
+#include <cmath>
+#include <limits>
+
+namespace dna_motif {
+
+namespace {
+
+// Histogram bins per motif position, one per seen-base mask
+constexpr size_t SEEN_BINS = 16;
+
+// Base mask of the complementary bases: A <-> T, C <-> G
+constexpr uint8_t complementMask(uint8_t mask) noexcept {
+  return static_cast<uint8_t>(((mask & 0b0011u) << 2) |
+                              ((mask & 0b1100u) >> 2));
+}
+
+// 64 bits of a bitset starting at bit first; bits[first / 64 + 1] readable
+uint64_t extractWord(const uint64_t *bits, size_t first) noexcept {
+  const size_t q = first / 64;
+  const size_t r = first % 64;
+  return r == 0 ? bits[q] : (bits[q] >> r) | (bits[q + 1] << (64 - r));
+}
+
+// Sequences whose seen-base mask at a position shares a base with mask
+uint64_t sequencesWith(std::span<const uint64_t> histogram,
+                       uint8_t mask) noexcept {
+  uint64_t sequences = 0;
+  for (size_t seen = 1; seen < SEEN_BINS; ++seen) {
+    if ((seen & mask) != 0) {
+      sequences += histogram[seen];
+    }
+  }
+  return sequences;
+}
+
+// OR into seen[p] the bases found at position p of the windows where every
+// other position matches, for one strand of a motif. Entry
+// [(chunk * stride + p) * 4 + b] of shifted has bit t set when base b is at
+// position chunk * 64 + t + p.
+void collectSeen(std::span<const uint64_t> shifted, size_t stride,
+                 size_t offsets, std::span<const uint8_t> masks,
+                 std::span<uint8_t> seen) noexcept {
+  const size_t length = masks.size();
+  std::array<uint64_t, MAX_MOTIF_LENGTH + 1> prefix;
+  std::array<uint64_t, MAX_MOTIF_LENGTH + 1> suffix;
+  std::array<uint64_t, MAX_MOTIF_LENGTH> accepted;
+
+  for (size_t first = 0; first < offsets; first += 64) {
+    const uint64_t *at = shifted.data() + first / 64 * stride * 4;
+    for (size_t p = 0; p < length; ++p) {
+      accepted[p] = 0;
+      for (size_t b = 0; b < 4; ++b) {
+        accepted[p] |= (masks[p] >> b) & 1u ? at[p * 4 + b] : 0;
+      }
+    }
+
+    prefix[0] = offsets - first >= 64 ? ~0ull
+                                      : (1ull << (offsets - first)) - 1;
+    for (size_t p = 0; p < length; ++p) {
+      prefix[p + 1] = prefix[p] & accepted[p];
+    }
+    suffix[length] = ~0ull;
+    for (size_t p = length; p-- > 0;) {
+      suffix[p] = suffix[p + 1] & accepted[p];
+    }
+
+    // Windows off by at most one position; none means no variant matches
+    for (size_t p = 0; p < length; ++p) {
+      const uint64_t others = prefix[p] & suffix[p + 1];
+      if (others == 0) {
+        continue;
+      }
+      for (size_t b = 0; b < 4; ++b) {
+        if ((others & at[p * 4 + b]) != 0) {
+          seen[p] |= static_cast<uint8_t>(1u << b);
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+MotifNeighbourhood::MotifNeighbourhood(const SequenceStore &store,
+                                       const IUPACCodes &iupac_codes,
+                                       const NeighbourhoodOptions &options,
+                                       CountReduction reduce)
+    : store_(store), iupac_codes_(iupac_codes), options_(options),
+      reduce_(std::move(reduce)) {
+  for (const char code : IUPAC_CODES) {
+    codes_[iupac_codes_.getBaseMask(code)] = code;
+  }
+
+  // Base counts, sequence count, then windows of every motif length
+  constexpr size_t WINDOW_COUNTS = 5;
+  std::vector<uint64_t> counts(WINDOW_COUNTS + windows_.size(), 0);
+#pragma omp parallel
+  {
+    std::vector<uint64_t> local(counts.size(), 0);
+#pragma omp for schedule(static)
+    for (size_t s = 0; s < store_.size(); ++s) {
+      const std::string_view text = store_.sequence(s).sequence;
+      const std::span<const uint8_t> bases = store_.bases(s);
+      const bool clean = store_.isClean(s);
+      size_t run = 0;
+      for (size_t i = 0; i <= bases.size(); ++i) {
+        if (i < bases.size() && (clean || isNucleotide(text[i]))) {
+          local[bases[i]]++;
+          ++run;
+          continue;
+        }
+        for (size_t length = 1; length <= std::min(run, MAX_MOTIF_LENGTH);
+             ++length) {
+          local[WINDOW_COUNTS + length] += run - length + 1;
+        }
+        run = 0;
+      }
+    }
+#pragma omp critical
+    for (size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += local[i];
+    }
+  }
+  counts[4] = store_.size();
+  if (reduce_) {
+    reduce_(counts);
+  }
+
+  sequence_count_ = counts[4];
+  const uint64_t bases = counts[0] + counts[1] + counts[2] + counts[3];
+  for (size_t b = 0; b < 4 && bases > 0; ++b) {
+    base_frequencies_[b] =
+        static_cast<double>(counts[b]) / static_cast<double>(bases);
+  }
+  std::ranges::copy(std::span(counts).subspan(WINDOW_COUNTS),
+                    windows_.begin());
+}
+
+std::vector<MotifRefinement>
+MotifNeighbourhood::refine(std::span<const Motif> motifs) const {
+  scans_ = 0;
+  std::vector<MotifRefinement> refinements(motifs.size());
+  std::vector<Masks> current(motifs.size());
+  std::vector<size_t> active;
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    const std::string &pattern = motifs[m].pattern;
+    refinements[m].seed = pattern;
+    if (pattern.empty() || pattern.size() > MAX_MOTIF_LENGTH ||
+        GappedMotif::isGapped(pattern)) {
+      continue;
+    }
+    Masks masks;
+    for (const char code : pattern) {
+      masks.push_back(iupac_codes_.getBaseMask(code));
+    }
+    if (std::ranges::find(masks, uint8_t{0}) == masks.end()) {
+      current[m] = std::move(masks);
+      active.push_back(m);
+    }
+  }
+
+  const auto min_sequences = static_cast<uint64_t>(std::ceil(
+      options_.min_frequency * static_cast<double>(sequence_count_)));
+
+  // Seeds first, then the motifs that moved in the previous round
+  for (size_t step = 0; !active.empty(); ++step) {
+    std::vector<Masks> patterns;
+    for (const size_t m : active) {
+      patterns.push_back(current[m]);
+    }
+    const std::vector<uint64_t> counts = countSeen(patterns);
+
+    std::vector<size_t> moved;
+    size_t offset = 0;
+    for (const size_t m : active) {
+      Masks &masks = current[m];
+      const auto histogram =
+          std::span(counts).subspan(offset, masks.size() * SEEN_BINS);
+      offset += histogram.size();
+      const auto seen = [&](size_t p) {
+        return histogram.subspan(p * SEEN_BINS, SEEN_BINS);
+      };
+
+      MotifRefinement &refinement = refinements[m];
+      if (step == 0) {
+        refinement.trail.push_back(
+            describe(masks, sequencesWith(seen(0), masks[0])));
+      }
+
+      // Every relaxation and tightening of one position
+      std::vector<MotifVariant> neighbours;
+      for (size_t p = 0; p < masks.size(); ++p) {
+        const uint8_t from = masks[p];
+        for (size_t b = 0; b < 4; ++b) {
+          const auto to = static_cast<uint8_t>(from ^ (1u << b));
+          if (to == 0) {
+            continue;
+          }
+          masks[p] = to;
+          MotifVariant variant = describe(masks, sequencesWith(seen(p), to));
+          masks[p] = from;
+          variant.position = p;
+          variant.from = codes_[from];
+          variant.to = codes_[to];
+          neighbours.push_back(std::move(variant));
+        }
+      }
+
+      // Strictly better enrichment, ties to more sequences, then to order
+      const MotifVariant *best = nullptr;
+      for (const MotifVariant &variant : neighbours) {
+        if (variant.sequences >= min_sequences &&
+            (best == nullptr || variant.enrichment > best->enrichment ||
+             (variant.enrichment == best->enrichment &&
+              variant.sequences > best->sequences))) {
+          best = &variant;
+        }
+      }
+      if (step < options_.max_steps && best != nullptr &&
+          best->enrichment > refinement.trail.back().enrichment) {
+        masks[best->position] = iupac_codes_.getBaseMask(best->to);
+        refinement.trail.push_back(*best);
+        moved.push_back(m);
+      }
+      if (step == 0) {
+        refinement.neighbours = std::move(neighbours);
+      }
+    }
+
+    // The last move's count is known already; only further moves rescan
+    active = step + 1 < options_.max_steps ? std::move(moved)
+                                           : std::vector<size_t>{};
+  }
+  return refinements;
+}
+
+std::vector<uint64_t>
+MotifNeighbourhood::countSeen(std::span<const Masks> patterns) const {
+  std::vector<Masks> reverse;
+  std::vector<size_t> offsets;
+  size_t total = 0;
+  size_t max_length = 0;
+  for (const Masks &masks : patterns) {
+    offsets.push_back(total);
+    max_length = std::max(max_length, masks.size());
+    total += masks.size() * SEEN_BINS;
+    if (options_.both_strands) {
+      Masks complement(masks.size());
+      for (size_t p = 0; p < masks.size(); ++p) {
+        complement[masks.size() - 1 - p] = complementMask(masks[p]);
+      }
+      reverse.push_back(std::move(complement));
+    }
+  }
+
+  std::vector<uint64_t> counts(total, 0);
+#pragma omp parallel
+  {
+    std::vector<uint64_t> local(total, 0);
+    std::array<std::vector<uint64_t>, 4> base_bits;
+    std::vector<uint64_t> shifted;
+    std::array<uint8_t, MAX_MOTIF_LENGTH> seen;
+    std::array<uint8_t, MAX_MOTIF_LENGTH> seen_reverse;
+
+#pragma omp for schedule(dynamic, 64)
+    for (size_t s = 0; s < store_.size(); ++s) {
+      // One position bitset per base, then its word at every chunk and
+      // motif position, shared by every motif and strand
+      const std::string_view text = store_.sequence(s).sequence;
+      const std::span<const uint8_t> bases = store_.bases(s);
+      const bool clean = store_.isClean(s);
+      const size_t chunks = (bases.size() + 63) / 64;
+      for (auto &bits : base_bits) {
+        bits.assign(chunks + 2, 0);
+      }
+      for (size_t i = 0; i < bases.size(); ++i) {
+        if (clean || isNucleotide(text[i])) {
+          base_bits[bases[i]][i / 64] |= 1ull << (i % 64);
+        }
+      }
+      shifted.resize(chunks * max_length * 4);
+      for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        for (size_t p = 0; p < max_length; ++p) {
+          for (size_t b = 0; b < 4; ++b) {
+            shifted[(chunk * max_length + p) * 4 + b] =
+                extractWord(base_bits[b].data(), chunk * 64 + p);
+          }
+        }
+      }
+
+      for (size_t k = 0; k < patterns.size(); ++k) {
+        const Masks &masks = patterns[k];
+        const size_t length = masks.size();
+        std::fill_n(seen.begin(), length, uint8_t{0});
+        if (length <= bases.size()) {
+          const size_t windows = bases.size() - length + 1;
+          collectSeen(shifted, max_length, windows, masks, seen);
+          if (options_.both_strands) {
+            std::fill_n(seen_reverse.begin(), length, uint8_t{0});
+            collectSeen(shifted, max_length, windows, reverse[k],
+                        seen_reverse);
+            for (size_t p = 0; p < length; ++p) {
+              seen[p] |= complementMask(seen_reverse[length - 1 - p]);
+            }
+          }
+        }
+        for (size_t p = 0; p < length; ++p) {
+          local[offsets[k] + p * SEEN_BINS + seen[p]]++;
+        }
+      }
+    }
+#pragma omp critical
+    for (size_t i = 0; i < total; ++i) {
+      counts[i] += local[i];
+    }
+  }
+
+  if (reduce_) {
+    reduce_(counts);
+  }
+  ++scans_;
+  return counts;
+}
+
+MotifVariant MotifNeighbourhood::describe(const Masks &masks,
+                                          uint64_t sequences) const {
+  MotifVariant variant;
+  for (const uint8_t mask : masks) {
+    variant.pattern += codes_[mask];
+  }
+  variant.sequences = sequences;
+  variant.expected = expectedSequences(masks);
+  if (sequences > 0) {
+    variant.enrichment =
+        variant.expected > 0.0
+            ? static_cast<double>(sequences) / variant.expected
+            : std::numeric_limits<double>::infinity();
+  }
+  return variant;
+}
+
+double
+MotifNeighbourhood::expectedSequences(const Masks &masks) const noexcept {
+  const size_t length = masks.size();
+  if (sequence_count_ == 0 || windows_[length] == 0) {
+    return 0.0;
+  }
+  const auto accepted = [&](uint8_t mask) {
+    double probability = 0.0;
+    for (size_t b = 0; b < 4; ++b) {
+      probability += (mask >> b) & 1u ? base_frequencies_[b] : 0.0;
+    }
+    return probability;
+  };
+
+  // Either strand: P(forward) + P(reverse) - P(both in the same window)
+  double forward = 1.0;
+  double reverse = 1.0;
+  double both = 1.0;
+  for (size_t p = 0; p < length; ++p) {
+    const uint8_t opposite = complementMask(masks[length - 1 - p]);
+    forward *= accepted(masks[p]);
+    reverse *= accepted(opposite);
+    both *= accepted(masks[p] & opposite);
+  }
+  const double probability =
+      options_.both_strands ? std::min(1.0, forward + reverse - both)
+                            : forward;
+
+  const double mean_windows = static_cast<double>(windows_[length]) /
+                              static_cast<double>(sequence_count_);
+  return static_cast<double>(sequence_count_) *
+         -std::expm1(mean_windows * std::log1p(-probability));
+}
+
+} // namespace dna_motif
@@ -0,0 +1,235 @@
+#include "motif_query.h"
+#include <cctype>
+#include <charconv>
+#include <numeric>
+
+namespace dna_motif {
+
+// Recursive-descent parser emitting postfix instructions
+class MotifQuery::Parser {
+public:
+  Parser(std::string_view text, std::span<const std::string> names,
+         std::vector<Instruction> &program)
+      : text_(text), names_(names), program_(program) {}
+
+  std::optional<QueryError> run() {
+    if (auto error = parseExpr()) {
+      return error;
+    }
+    skipSpace();
+    if (pos_ < text_.size()) {
+      return QueryError{pos_, "Unexpected input"};
+    }
+    return std::nullopt;
+  }
+
+private:
+  std::string_view text_;
+  std::span<const std::string> names_;
+  std::vector<Instruction> &program_;
+  size_t pos_ = 0;
+
+  static bool isNameChar(char c) noexcept {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+           c == '-' || c == '.' || c == ':';
+  }
+
+  void skipSpace() noexcept {
+    while (pos_ < text_.size() &&
+           std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+      ++pos_;
+    }
+  }
+
+  // Consume a symbol or a case-insensitive keyword at the next token
+  bool accept(char symbol, std::string_view keyword) noexcept {
+    skipSpace();
+    if (pos_ < text_.size() && text_[pos_] == symbol) {
+      ++pos_;
+      return true;
+    }
+    if (keyword.empty()) {
+      return false;
+    }
+    const std::string_view rest = text_.substr(pos_);
+    if (rest.size() < keyword.size() ||
+        (rest.size() > keyword.size() && isNameChar(rest[keyword.size()]))) {
+      return false;
+    }
+    for (size_t i = 0; i < keyword.size(); ++i) {
+      if (std::toupper(static_cast<unsigned char>(rest[i])) != keyword[i]) {
+        return false;
+      }
+    }
+    pos_ += keyword.size();
+    return true;
+  }
+
+  std::optional<QueryError> parseExpr() {
+    if (auto error = parseTerm()) {
+      return error;
+    }
+    while (accept('|', "OR")) {
+      if (auto error = parseTerm()) {
+        return error;
+      }
+      program_.push_back({OpCode::Or, 0});
+    }
+    return std::nullopt;
+  }
+
+  std::optional<QueryError> parseTerm() {
+    if (auto error = parseFactor()) {
+      return error;
+    }
+    while (accept('&', "AND")) {
+      if (auto error = parseFactor()) {
+        return error;
+      }
+      program_.push_back({OpCode::And, 0});
+    }
+    return std::nullopt;
+  }
+
+  std::optional<QueryError> parseFactor() {
+    if (accept('!', "NOT") || accept('~', "")) {
+      if (auto error = parseFactor()) {
+        return error;
+      }
+      program_.push_back({OpCode::Not, 0});
+      return std::nullopt;
+    }
+    if (accept('(', "")) {
+      if (auto error = parseExpr()) {
+        return error;
+      }
+      if (!accept(')', "")) {
+        return QueryError{pos_, "Expected ')'"};
+      }
+      return std::nullopt;
+    }
+    if (accept('#', "")) {
+      return parseIndex();
+    }
+    return parseName();
+  }
+
+  std::optional<QueryError> parseIndex() {
+    size_t index = 0;
+    const char *first = text_.data() + pos_;
+    const char *last = text_.data() + text_.size();
+    const auto [end, ec] = std::from_chars(first, last, index);
+    if (ec != std::errc() || index >= names_.size()) {
+      return QueryError{pos_, "Expected a motif index below " +
+                                  std::to_string(names_.size())};
+    }
+    pos_ += static_cast<size_t>(end - first);
+    program_.push_back({OpCode::Load, index});
+    return std::nullopt;
+  }
+
+  std::optional<QueryError> parseName() {
+    skipSpace();
+    const size_t start = pos_;
+    while (pos_ < text_.size() && isNameChar(text_[pos_])) {
+      ++pos_;
+    }
+    if (pos_ == start) {
+      return QueryError{start, "Expected a motif name"};
+    }
+
+    const std::string_view name = text_.substr(start, pos_ - start);
+    const auto found = std::ranges::find(names_, name);
+    if (found == names_.end()) {
+      return QueryError{start, "Unknown motif '" + std::string(name) + "'"};
+    }
+    program_.push_back(
+        {OpCode::Load, static_cast<size_t>(found - names_.begin())});
+    return std::nullopt;
+  }
+};
+
+std::expected<MotifQuery, QueryError>
+MotifQuery::parse(std::string_view expression,
+                  std::span<const std::string> names) {
+  MotifQuery query;
+  query.expression_ = std::string(expression);
+
+  Parser parser(expression, names, query.program_);
+  if (auto error = parser.run()) {
+    return std::unexpected(std::move(*error));
+  }
+
+  size_t depth = 0;
+  for (const auto &instruction : query.program_) {
+    if (instruction.op == OpCode::Load) {
+      query.max_depth_ = std::max(query.max_depth_, ++depth);
+    } else if (instruction.op != OpCode::Not) {
+      --depth;
+    }
+  }
+  return query;
+}
+
+std::vector<uint64_t> MotifQuery::evaluate(const HitBitsets &bitsets) const {
+  const size_t word_count = bitsets.wordCount();
+  std::vector<uint64_t> result(word_count, 0);
+  const size_t blocks = (word_count + BLOCK_WORDS - 1) / BLOCK_WORDS;
+
+#pragma omp parallel
+  {
+    // Stack slot k holds words [k * BLOCK_WORDS, (k + 1) * BLOCK_WORDS)
+    std::vector<uint64_t> stack(max_depth_ * BLOCK_WORDS);
+
+#pragma omp for schedule(static)
+    for (size_t b = 0; b < blocks; ++b) {
+      const size_t first = b * BLOCK_WORDS;
+      const size_t words = std::min(BLOCK_WORDS, word_count - first);
+      size_t depth = 0;
+
+      for (const auto &instruction : program_) {
+        uint64_t *slot = stack.data() + depth * BLOCK_WORDS;
+        switch (instruction.op) {
+        case OpCode::Load:
+          std::ranges::copy(
+              bitsets.row(instruction.motif).subspan(first, words), slot);
+          ++depth;
+          break;
+        case OpCode::Not:
+          std::transform(slot - BLOCK_WORDS, slot - BLOCK_WORDS + words,
+                         slot - BLOCK_WORDS, std::bit_not<>());
+          break;
+        case OpCode::And:
+          std::transform(slot - 2 * BLOCK_WORDS,
+                         slot - 2 * BLOCK_WORDS + words, slot - BLOCK_WORDS,
+                         slot - 2 * BLOCK_WORDS, std::bit_and<>());
+          --depth;
+          break;
+        case OpCode::Or:
+          std::transform(slot - 2 * BLOCK_WORDS,
+                         slot - 2 * BLOCK_WORDS + words, slot - BLOCK_WORDS,
+                         slot - 2 * BLOCK_WORDS, std::bit_or<>());
+          --depth;
+          break;
+        }
+      }
+
+      std::copy_n(stack.data(), words, result.data() + first);
+    }
+  }
+
+  // NOT sets the padding bits past the last sequence
+  if (bitsets.sequenceCount() % 64 != 0) {
+    result.back() &= (1ull << (bitsets.sequenceCount() % 64)) - 1;
+  }
+  return result;
+}
+
+size_t MotifQuery::count(const HitBitsets &bitsets) const {
+  const auto words = evaluate(bitsets);
+  return std::transform_reduce(
+      words.begin(), words.end(), 0uz, std::plus<>(),
+      [](uint64_t word) { return static_cast<size_t>(std::popcount(word)); });
+}
+
+} // namespace dna_motif
@@ -3,6 +3,19 @@
 
 namespace dna_motif {
 
+namespace {
+
+// Run reduce(offset, count) over chunks of at most MAX_MESSAGE_ELEMENTS
+template <typename Reduce> void forEachChunk(size_t size, Reduce reduce) {
+  for (size_t offset = 0; offset < size;
+       offset += MPIManager::MAX_MESSAGE_ELEMENTS) {
+    reduce(offset, static_cast<int>(std::min(
+                       MPIManager::MAX_MESSAGE_ELEMENTS, size - offset)));
+  }
+}
+
+} // namespace
+
 MPIManager::MPIManager() : rank_(0), size_(1), initialized_(false) {}
 
 MPIManager::~MPIManager() {
@@ -238,6 +251,14 @@ MPIManager::gatherResults(const std::vector<MotifResult> &local_results) {
         MPI_Recv(&result.frequency, 1, MPI_DOUBLE, src, 4, MPI_COMM_WORLD,
                  MPI_STATUS_IGNORE);
 
+        // Receive per-mismatch-level counts
+        int level_count;
+        MPI_Recv(&level_count, 1, MPI_INT, src, 5, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+        result.mismatch_counts.resize(level_count);
+        MPI_Recv(result.mismatch_counts.data(), level_count, MPI_UNSIGNED_LONG,
+                 src, 6, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
         all_results.push_back(result);
       }
     }
@@ -256,6 +277,12 @@ MPIManager::gatherResults(const std::vector<MotifResult> &local_results) {
       // Send counts
       MPI_Send(&result.match_count, 1, MPI_UNSIGNED_LONG, 0, 3, MPI_COMM_WORLD);
       MPI_Send(&result.frequency, 1, MPI_DOUBLE, 0, 4, MPI_COMM_WORLD);
+
+      // Send per-mismatch-level counts
+      int level_count = static_cast<int>(result.mismatch_counts.size());
+      MPI_Send(&level_count, 1, MPI_INT, 0, 5, MPI_COMM_WORLD);
+      MPI_Send(result.mismatch_counts.data(), level_count, MPI_UNSIGNED_LONG,
+               0, 6, MPI_COMM_WORLD);
     }
   }
 
@@ -266,6 +293,112 @@ MPIManager::gatherResults(const std::vector<MotifResult> &local_results) {
   return all_results;
 }
 
+PositionHistogram
+MPIManager::reduceHistogram(const PositionHistogram &local_histogram) {
+  Timer timer;
+
+  unsigned long long offsets = local_histogram.offset_count;
+  MPI_Allreduce(MPI_IN_PLACE, &offsets, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+                MPI_COMM_WORLD);
+
+  PositionHistogram histogram = local_histogram;
+  histogram.resizeOffsets(static_cast<size_t>(offsets));
+  histogram.counts = reduceCounts(histogram.counts);
+
+  double comm_time = timer.elapsed();
+  updateCommStats("reduce_histogram",
+                  histogram.counts.size() * sizeof(uint64_t), comm_time);
+
+  return histogram;
+}
+
+std::vector<uint64_t>
+MPIManager::reduceCounts(std::span<const uint64_t> local_counts) {
+  Timer timer;
+  std::vector<uint64_t> total(local_counts.begin(), local_counts.end());
+
+  forEachChunk(total.size(), [&](size_t offset, int count) {
+    MPI_Reduce(isMaster() ? MPI_IN_PLACE : local_counts.data() + offset,
+               total.data() + offset, count, MPI_UINT64_T, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+  });
+
+  double comm_time = timer.elapsed();
+  updateCommStats("reduce_counts", local_counts.size() * sizeof(uint64_t),
+                  comm_time);
+
+  return total;
+}
+
+std::vector<uint64_t>
+MPIManager::allreduceCounts(std::span<const uint64_t> local_counts) {
+  Timer timer;
+  std::vector<uint64_t> total(local_counts.begin(), local_counts.end());
+
+  forEachChunk(total.size(), [&](size_t offset, int count) {
+    MPI_Allreduce(MPI_IN_PLACE, total.data() + offset, count, MPI_UINT64_T,
+                  MPI_SUM, MPI_COMM_WORLD);
+  });
+
+  double comm_time = timer.elapsed();
+  updateCommStats("allreduce_counts", local_counts.size() * sizeof(uint64_t),
+                  comm_time);
+
+  return total;
+}
+
+std::vector<uint64_t>
+MPIManager::gatherCounts(std::span<const uint64_t> local_values) {
+  Timer timer;
+  // Gatherv displacements are int as well; every process checks the total
+  unsigned long long total_count = local_values.size();
+  MPI_Allreduce(MPI_IN_PLACE, &total_count, 1, MPI_UNSIGNED_LONG_LONG,
+                MPI_SUM, MPI_COMM_WORLD);
+  if (total_count > MAX_MESSAGE_ELEMENTS) {
+    throw std::length_error("Gathered counts exceed the MPI message size");
+  }
+
+  const int local_count = static_cast<int>(local_values.size());
+  std::vector<int> counts(isMaster() ? size_ : 0);
+  MPI_Gather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0,
+             MPI_COMM_WORLD);
+
+  std::vector<int> displacements(counts.size(), 0);
+  for (size_t r = 1; r < counts.size(); ++r) {
+    displacements[r] = displacements[r - 1] + counts[r - 1];
+  }
+  std::vector<uint64_t> all(
+      counts.empty() ? 0 : static_cast<size_t>(displacements.back() +
+                                               counts.back()));
+  MPI_Gatherv(local_values.data(), local_count, MPI_UINT64_T, all.data(),
+              counts.data(), displacements.data(), MPI_UINT64_T, 0,
+              MPI_COMM_WORLD);
+
+  double comm_time = timer.elapsed();
+  updateCommStats("gather_counts", local_values.size() * sizeof(uint64_t),
+                  comm_time);
+
+  return all;
+}
+
+std::vector<uint64_t>
+MPIManager::reduceMinimum(std::span<const uint64_t> local_values) {
+  Timer timer;
+  std::vector<uint64_t> minimum(local_values.begin(), local_values.end());
+
+  forEachChunk(minimum.size(), [&](size_t offset, int count) {
+    MPI_Reduce(isMaster() ? MPI_IN_PLACE : local_values.data() + offset,
+               minimum.data() + offset, count, MPI_UINT64_T, MPI_MIN, 0,
+               MPI_COMM_WORLD);
+  });
+
+  double comm_time = timer.elapsed();
+  updateCommStats("reduce_minimum", local_values.size() * sizeof(uint64_t),
+                  comm_time);
+
+  return minimum;
+}
+
 void MPIManager::synchronize() { MPI_Barrier(MPI_COMM_WORLD); }
 
 std::unordered_map<std::string, double>
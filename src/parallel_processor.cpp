@@ -1,11 +1,42 @@
 #include "parallel_processor.h"
+#include "dinucleotide_shuffle.h"
 #include "dna_parser.h"
+#include "genome_scanner.h"
+#include "motif_query.h"
+#include "pwm_scorer.h"
+#include <bit>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <set>
 
 namespace dna_motif {
 
+namespace {
+
+// Shuffled sequences generated and scanned at a time by processShuffled()
+constexpr size_t SHUFFLE_BLOCK_SEQUENCES = 1uz << 15;
+
+// Load a saved index built from the store, or build and save a new one
+template <typename Index>
+Index loadOrBuild(const std::string &index_file, const SequenceStore &store) {
+  if (std::filesystem::exists(index_file)) {
+    Index index = Index::load(index_file);
+    if (index.matches(store)) {
+      return index;
+    }
+    std::cout << "Index " << index_file
+              << " was built from other sequences, rebuilding" << std::endl;
+  }
+  Index index = Index::build(store);
+  index.save(index_file);
+  std::cout << "Saved index to: " << index_file << std::endl;
+  return index;
+}
+
+} // namespace
+
 ParallelProcessor::ParallelProcessor() : initialized_(false) {}
 
 ParallelProcessor::~ParallelProcessor() { finalize(); }
@@ -60,14 +91,27 @@ ParallelProcessor::processMotifs(const std::string &chip_seq_file,
   std::vector<ChIPSequence> local_sequences =
       mpi_manager_->distributeSequences(sequences);
   std::vector<Motif> local_motifs = mpi_manager_->broadcastMotifs(motifs);
+  first_sequence_id_ = mpi_manager_->calculateWorkDistribution(
+                                        sequences.size(),
+                                        mpi_manager_->getRank(),
+                                        mpi_manager_->getSize())
+                           .first;
 
   if (mpi_manager_->isMaster()) {
     std::cout << "Work distributed. Processing motifs..." << std::endl;
   }
 
+  // Decode local sequences once into flat base codes, read by every kernel;
+  // prepareStore() adds the window codes, nibbles or zone maps the scan
+  // options need
+  Timer store_timer;
+  SequenceStore store(local_sequences);
+  motif_finder_->prepareStore(store);
+  updatePerformanceStats("sequence_store_build_time", store_timer.elapsed());
+
   // Process motifs in parallel using OpenMP
   std::vector<MotifResult> local_results =
-      processMotifsParallel(local_sequences, local_motifs);
+      processMotifsParallel(store, local_motifs);
 
   // Gather results from all processes
   std::vector<MotifResult> all_results =
@@ -84,21 +128,614 @@ ParallelProcessor::processMotifs(const std::string &chip_seq_file,
   return all_results;
 }
 
+void ParallelProcessor::processGenome(const std::string &genome_file,
+                                      const std::string &motifs_file,
+                                      size_t bin_size,
+                                      const std::string &output_file) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  Timer timer;
+
+  DNAParser parser;
+  auto motifs_result = parser.parseMotifs(motifs_file);
+  if (!motifs_result) {
+    throw std::runtime_error(
+        "Failed to parse motifs: " +
+        std::to_string(static_cast<int>(motifs_result.error())));
+  }
+  const auto &motifs = *motifs_result;
+
+  GenomeScanOptions options;
+  options.bin_size = bin_size;
+  options.both_strands = motif_finder_->getScanOptions().both_strands;
+  GenomeScanner scanner(*iupac_codes_, motifs, options);
+
+  std::ifstream genome(genome_file);
+  if (!genome.is_open()) {
+    throw std::runtime_error("Cannot open genome file: " + genome_file);
+  }
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Cannot open output file: " + output_file);
+    }
+  }
+  std::ostream &out = output_file.empty() ? std::cout : file;
+
+  out << "Record\tStart\tEnd";
+  for (const auto &motif : motifs) {
+    out << "\t" << motif.pattern;
+  }
+  out << "\n";
+
+  size_t bins = 0;
+  scanner.scan(genome, [&](const GenomeBin &bin) {
+    out << bin.record_id << "\t" << bin.start << "\t" << bin.end;
+    for (uint32_t count : bin.counts) {
+      out << "\t" << count;
+    }
+    out << "\n";
+    ++bins;
+  });
+
+  updatePerformanceStats("genome_scan_time", timer.elapsed());
+  std::cout << "Scanned " << bins << " bins of " << bin_size << " bp"
+            << std::endl;
+}
+
+void ParallelProcessor::processPwm(const std::string &chip_seq_file,
+                                   const std::string &motifs_file,
+                                   double relative_threshold,
+                                   bool count_matrices,
+                                   const std::string &output_file) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+
+  Timer timer;
+
+  DNAParser parser;
+  auto sequences_result = parser.parseChIPSequences(chip_seq_file);
+  if (!sequences_result) {
+    throw std::runtime_error(
+        "Failed to parse ChIP sequences: " +
+        std::to_string(static_cast<int>(sequences_result.error())));
+  }
+  const auto &sequences = *sequences_result;
+
+  // Every process builds the matrices from the motifs file; the sequences
+  // are split as in processMotifs
+  std::vector<std::string> names;
+  std::vector<PositionWeightMatrix> matrices;
+  if (count_matrices) {
+    auto counts_result = parser.parseCountMatrices(motifs_file);
+    if (!counts_result) {
+      throw std::runtime_error(
+          "Failed to parse count matrices: " +
+          std::to_string(static_cast<int>(counts_result.error())));
+    }
+    for (const auto &counts : *counts_result) {
+      auto matrix = PositionWeightMatrix::fromCounts(counts.counts);
+      if (!matrix) {
+        throw std::runtime_error("Invalid count matrix: " + counts.name);
+      }
+      names.push_back(counts.name);
+      matrices.push_back(std::move(*matrix));
+    }
+  } else {
+    auto motifs_result = parser.parseMotifs(motifs_file);
+    if (!motifs_result) {
+      throw std::runtime_error(
+          "Failed to parse motifs: " +
+          std::to_string(static_cast<int>(motifs_result.error())));
+    }
+    for (const auto &motif : *motifs_result) {
+      auto matrix =
+          PositionWeightMatrix::fromPattern(motif.pattern, *iupac_codes_);
+      if (!matrix) {
+        throw std::runtime_error("Invalid motif: " + motif.pattern);
+      }
+      names.push_back(motif.pattern);
+      matrices.push_back(std::move(*matrix));
+    }
+  }
+
+  const std::vector<ChIPSequence> local_sequences =
+      mpi_manager_->distributeSequences(sequences);
+  const PwmScorer scorer(matrices, relative_threshold);
+  const SequenceStore store(local_sequences);
+  const PwmScores scores = scorer.scoreBest(store);
+
+  // Best scores travel sequence-major as float bits, so the gathered
+  // values are already in input order
+  std::vector<uint64_t> packed;
+  packed.reserve(local_sequences.size() * matrices.size());
+  for (size_t s = 0; s < local_sequences.size(); ++s) {
+    for (size_t m = 0; m < matrices.size(); ++m) {
+      packed.push_back(std::bit_cast<uint32_t>(scores.bestScores(m)[s]));
+    }
+  }
+  const auto best = mpi_manager_->gatherCounts(packed);
+  const std::vector<uint64_t> local_hits(scores.hit_counts.begin(),
+                                         scores.hit_counts.end());
+  const auto hit_counts = mpi_manager_->reduceCounts(local_hits);
+  updatePerformanceStats("pwm_scan_time", timer.elapsed());
+
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Cannot open output file: " + output_file);
+    }
+  }
+  std::ostream &out = output_file.empty() ? std::cout : file;
+
+  out << "Sequence_ID";
+  for (const auto &name : names) {
+    out << "\t" << name;
+  }
+  out << "\n";
+  for (size_t s = 0; s < sequences.size(); ++s) {
+    out << sequences[s].id;
+    for (size_t m = 0; m < matrices.size(); ++m) {
+      const float score = std::bit_cast<float>(
+          static_cast<uint32_t>(best[s * matrices.size() + m]));
+      out << "\t"
+          << (score == NO_PWM_HIT ? std::string("NA")
+                                  : std::format("{:.3f}", score));
+    }
+    out << "\n";
+  }
+
+  std::cout << "\n=== PWM HITS ===" << std::endl;
+  std::cout << std::setw(20) << "Motif Pattern" << std::setw(15)
+            << "Threshold" << std::setw(15) << "Hit Count" << std::setw(15)
+            << "Frequency" << std::endl;
+  for (size_t m = 0; m < matrices.size(); ++m) {
+    std::cout << std::setw(20) << names[m] << std::setw(15)
+              << std::format("{:.3f}", scorer.threshold(m)) << std::setw(15)
+              << hit_counts[m] << std::setw(15)
+              << std::format("{:.6f}",
+                             sequences.empty()
+                                 ? 0.0
+                                 : static_cast<double>(hit_counts[m]) /
+                                       static_cast<double>(sequences.size()))
+              << std::endl;
+  }
+}
+
+std::vector<MotifResult>
+ParallelProcessor::processIndexed(const std::string &chip_seq_file,
+                                  const std::string &motifs_file,
+                                  const std::string &index_file,
+                                  IndexEngine engine) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+  if (!mpi_manager_->isMaster()) {
+    return {};
+  }
+
+  DNAParser parser;
+  auto sequences_result = parser.parseChIPSequences(chip_seq_file);
+  if (!sequences_result) {
+    throw std::runtime_error(
+        "Failed to parse ChIP sequences: " +
+        std::to_string(static_cast<int>(sequences_result.error())));
+  }
+  auto motifs_result = parser.parseMotifs(motifs_file);
+  if (!motifs_result) {
+    throw std::runtime_error(
+        "Failed to parse motifs: " +
+        std::to_string(static_cast<int>(motifs_result.error())));
+  }
+  const auto &sequences = *sequences_result;
+  const auto &motifs = *motifs_result;
+  SequenceStore store(sequences);
+
+  Timer index_timer;
+  std::optional<KmerIndex> kmer_index;
+  std::optional<FmIndex> fm_index;
+  if (engine == IndexEngine::Kmer) {
+    kmer_index = loadOrBuild<KmerIndex>(index_file, store);
+  } else {
+    fm_index = loadOrBuild<FmIndex>(index_file, store);
+  }
+  updatePerformanceStats("index_load_time", index_timer.elapsed());
+
+  // Motifs the index cannot answer exactly fall back to the scan kernels
+  Timer query_timer;
+  const ScanOptions &options = motif_finder_->getScanOptions();
+  std::vector<MotifResult> results(motifs.size());
+  std::vector<std::optional<KmerTable>> tables(motifs.size());
+  std::vector<uint8_t> indexed(motifs.size(), 0);
+  std::vector<Motif> scanned;
+  std::vector<size_t> scanned_at;
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    const std::string &pattern = motifs[m].pattern;
+    results[m] = MotifResult(pattern);
+    if (options.max_mismatches == 0 && kmer_index) {
+      tables[m] = KmerTable::compile(pattern, *iupac_codes_);
+      if (tables[m] && options.both_strands) {
+        tables[m]->merge(*KmerTable::compile(
+            iupac_codes_->reverseComplement(pattern), *iupac_codes_));
+      }
+      indexed[m] = tables[m].has_value();
+    } else if (options.max_mismatches == 0 && fm_index) {
+      indexed[m] = !GappedMotif::isGapped(pattern);
+    }
+    if (!indexed[m]) {
+      scanned.push_back(motifs[m]);
+      scanned_at.push_back(m);
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    if (!indexed[m]) {
+      continue;
+    }
+    results[m].match_count =
+        kmer_index ? kmer_index->count(*tables[m])
+                   : fm_index->countSequences(motifs[m].pattern,
+                                              *iupac_codes_,
+                                              options.both_strands);
+    results[m].frequency = MotifFinder::calculateFrequency(
+        results[m].match_count, sequences.size());
+  }
+
+  if (!scanned.empty()) {
+    motif_finder_->prepareStore(store);
+    auto scanned_results = motif_finder_->findMotifs(store, scanned);
+    for (size_t i = 0; i < scanned_at.size(); ++i) {
+      results[scanned_at[i]] = std::move(scanned_results[i]);
+    }
+  }
+  updatePerformanceStats("index_query_time", query_timer.elapsed());
+
+  std::cout << "Counted " << motifs.size() - scanned.size() << " of "
+            << motifs.size() << " motifs from the index" << std::endl;
+  return results;
+}
+
+std::vector<DiscoveredMotif>
+ParallelProcessor::discoverMotifs(const std::string &chip_seq_file,
+                                  const DiscoveryOptions &options,
+                                  const std::string &output_file) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+
+  Timer timer;
+
+  DNAParser parser;
+  auto sequences_result = parser.parseChIPSequences(chip_seq_file);
+  if (!sequences_result) {
+    throw std::runtime_error(
+        "Failed to parse ChIP sequences: " +
+        std::to_string(static_cast<int>(sequences_result.error())));
+  }
+  const auto &sequences = *sequences_result;
+
+  // Exact counts merge postings of all sequences, so every process parses
+  // and indexes the whole input; the bound tables are summed over a split
+  const auto rank = static_cast<size_t>(mpi_manager_->getRank());
+  const auto processes = static_cast<size_t>(mpi_manager_->getSize());
+  SequenceStore store(sequences);
+  store.buildWindowCodes();
+  const KmerIndex index = KmerIndex::build(store);
+  const MotifDiscovery discovery(
+      store, index, options, rank, processes,
+      [&](std::span<uint64_t> counts) {
+        const auto totals = mpi_manager_->allreduceCounts(counts);
+        std::ranges::copy(totals, counts.begin());
+      });
+  updatePerformanceStats("discovery_index_time", timer.elapsed());
+
+  Timer search_timer;
+  const auto local = discovery.discover(rank, processes);
+  std::vector<uint64_t> packed;
+  for (const auto &motif : local) {
+    packed.push_back(MotifDiscovery::packPattern(motif.pattern));
+    packed.push_back(motif.sequences);
+  }
+  const auto gathered = mpi_manager_->gatherCounts(packed);
+  const std::array<uint64_t, 2> local_stats = {discovery.nodesVisited(),
+                                               discovery.patternsCounted()};
+  const auto stats = mpi_manager_->reduceCounts(local_stats);
+  updatePerformanceStats("discovery_search_time", search_timer.elapsed());
+
+  if (!mpi_manager_->isMaster()) {
+    return {};
+  }
+
+  std::vector<DiscoveredMotif> candidates;
+  for (size_t i = 0; i + 1 < gathered.size(); i += 2) {
+    candidates.push_back(discovery.describe(
+        static_cast<uint32_t>(gathered[i]), gathered[i + 1]));
+  }
+  auto motifs = MotifDiscovery::best(std::move(candidates), options.top_k);
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Cannot open output file: " + output_file);
+    }
+  }
+  std::ostream &out = output_file.empty() ? std::cout : file;
+
+  out << "Motif_Pattern\tSequences\tFrequency\tExpected\tEnrichment\n";
+  for (const auto &motif : motifs) {
+    out << motif.pattern << "\t" << motif.sequences << "\t"
+        << std::format("{:.6f}\t{:.2f}\t{:.4f}", motif.frequency,
+                       motif.expected, motif.enrichment)
+        << "\n";
+  }
+
+  std::cout << "Discovered " << motifs.size() << " motifs from "
+            << sequences.size() << " sequences; visited " << stats[0]
+            << " search nodes and counted " << stats[1]
+            << " degenerate patterns exactly" << std::endl;
+  return motifs;
+}
+
+std::vector<MotifEnrichment>
+ParallelProcessor::processEnrichment(const std::string &chip_seq_file,
+                                     const std::string &background_file,
+                                     const std::string &motifs_file,
+                                     const std::string &output_file) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+
+  Timer total_timer;
+
+  auto [sequences, motifs] = loadInputFiles(chip_seq_file, motifs_file);
+  DNAParser parser;
+  auto background_result = parser.parseChIPSequences(background_file);
+  if (!background_result) {
+    throw std::runtime_error(
+        "Failed to parse background sequences: " +
+        std::to_string(static_cast<int>(background_result.error())));
+  }
+
+  // One sequence list, foreground first, so a single distribution and scan
+  // cover both sets with the same compiled motifs
+  const size_t foreground_count = sequences.size();
+  const size_t background_count = background_result->size();
+  sequences.insert(sequences.end(),
+                   std::make_move_iterator(background_result->begin()),
+                   std::make_move_iterator(background_result->end()));
+  if (mpi_manager_->isMaster()) {
+    std::cout << "Loaded " << foreground_count << " foreground and "
+              << background_count << " background sequences and "
+              << motifs.size() << " motifs" << std::endl;
+  }
+
+  const std::vector<ChIPSequence> local_sequences =
+      mpi_manager_->distributeSequences(sequences);
+  const std::vector<Motif> local_motifs = mpi_manager_->broadcastMotifs(motifs);
+  const size_t first = mpi_manager_->calculateWorkDistribution(
+                                        sequences.size(),
+                                        mpi_manager_->getRank(),
+                                        mpi_manager_->getSize())
+                           .first;
+  const size_t local_foreground =
+      std::clamp(foreground_count, first, first + local_sequences.size()) -
+      first;
+
+  Timer scan_timer;
+  SequenceStore store(local_sequences);
+  motif_finder_->prepareStore(store);
+  const auto results = motif_finder_->findMotifs(store, local_motifs);
+  const HitBitsets hits = HitBitsets::fromResults(results, store.size());
+  std::vector<uint64_t> counts(2 * local_motifs.size());
+  for (size_t m = 0; m < local_motifs.size(); ++m) {
+    counts[2 * m] = hits.count(m, 0, local_foreground);
+    counts[2 * m + 1] = hits.count(m, local_foreground, store.size());
+  }
+  counts = mpi_manager_->reduceCounts(counts);
+  updatePerformanceStats("enrichment_scan_time", scan_timer.elapsed());
+
+  if (!mpi_manager_->isMaster()) {
+    return {};
+  }
+
+  std::vector<MotifEnrichment> enrichments;
+  for (size_t m = 0; m < local_motifs.size(); ++m) {
+    enrichments.push_back(MotifEnrichment::compute(
+        local_motifs[m].pattern, counts[2 * m], foreground_count,
+        counts[2 * m + 1], background_count));
+  }
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Cannot open output file: " + output_file);
+    }
+  }
+  std::ostream &out = output_file.empty() ? std::cout : file;
+
+  out << "Motif_Pattern\tFG_Sequences\tFG_Frequency\tBG_Sequences\t"
+         "BG_Frequency\tFold_Enrichment\tP_Value\n";
+  for (const auto &enrichment : enrichments) {
+    out << enrichment.pattern << "\t" << enrichment.foreground_hits << "\t"
+        << std::format("{:.6f}", enrichment.foreground_frequency) << "\t"
+        << enrichment.background_hits << "\t"
+        << std::format("{:.6f}\t{:.4f}\t{}", enrichment.background_frequency,
+                       enrichment.fold_enrichment,
+                       formatLogProbability(enrichment.log_p_value))
+        << "\n";
+  }
+
+  const double total_time = total_timer.elapsed();
+  updatePerformanceStats("total_processing_time", total_time);
+  std::cout << "Enrichment of " << enrichments.size()
+            << " motifs computed in " << std::fixed << std::setprecision(2)
+            << total_time << " seconds" << std::endl;
+  return enrichments;
+}
+
+std::vector<MotifEnrichment>
+ParallelProcessor::processShuffled(const std::string &chip_seq_file,
+                                   const std::string &motifs_file,
+                                   size_t replicates, uint64_t seed,
+                                   const std::string &output_file) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+  if (replicates == 0) {
+    throw std::invalid_argument("At least one shuffled replicate is needed");
+  }
+
+  Timer total_timer;
+
+  auto [sequences, motifs] = loadInputFiles(chip_seq_file, motifs_file);
+  if (mpi_manager_->isMaster()) {
+    std::cout << "Loaded " << sequences.size() << " sequences and "
+              << motifs.size() << " motifs, " << replicates
+              << " shuffled replicates" << std::endl;
+  }
+
+  const std::vector<ChIPSequence> local_sequences =
+      mpi_manager_->distributeSequences(sequences);
+  const std::vector<Motif> local_motifs = mpi_manager_->broadcastMotifs(motifs);
+  const size_t first_id = mpi_manager_->calculateWorkDistribution(
+                                           sequences.size(),
+                                           mpi_manager_->getRank(),
+                                           mpi_manager_->getSize())
+                              .first;
+
+  // counts[0] holds the real sequences, counts[1 + r] replicate r
+  const size_t motif_count = local_motifs.size();
+  std::vector<uint64_t> counts((replicates + 1) * motif_count);
+
+  Timer scan_timer;
+  SequenceStore store(local_sequences);
+  motif_finder_->prepareStore(store);
+  const auto observed = motif_finder_->findMotifs(store, local_motifs);
+  for (size_t m = 0; m < motif_count; ++m) {
+    counts[m] = observed[m].match_count;
+  }
+
+  // Blocks run across replicate boundaries so small inputs still scan in
+  // large batches; hit bitsets split each block back into replicates
+  const DinucleotideShuffler shuffler(store, seed, first_id);
+  const size_t items = replicates * store.size();
+  std::vector<ChIPSequence> block;
+  for (size_t first = 0; first < items; first += SHUFFLE_BLOCK_SEQUENCES) {
+    const size_t last = std::min(items, first + SHUFFLE_BLOCK_SEQUENCES);
+    shuffler.generate(first, last, block);
+    SequenceStore block_store(block);
+    motif_finder_->prepareStore(block_store);
+    const HitBitsets hits = HitBitsets::fromResults(
+        motif_finder_->findMotifs(block_store, local_motifs),
+        block_store.size());
+    for (size_t begin = first; begin < last;) {
+      const size_t replicate = begin / store.size();
+      const size_t end = std::min(last, (replicate + 1) * store.size());
+      uint64_t *replicate_counts =
+          counts.data() + (replicate + 1) * motif_count;
+      for (size_t m = 0; m < motif_count; ++m) {
+        replicate_counts[m] += hits.count(m, begin - first, end - first);
+      }
+      begin = end;
+    }
+  }
+  counts = mpi_manager_->reduceCounts(counts);
+  updatePerformanceStats("shuffle_scan_time", scan_timer.elapsed());
+
+  if (!mpi_manager_->isMaster()) {
+    return {};
+  }
+
+  std::vector<MotifEnrichment> enrichments;
+  std::vector<uint64_t> shuffled(replicates);
+  for (size_t m = 0; m < motif_count; ++m) {
+    for (size_t r = 0; r < replicates; ++r) {
+      shuffled[r] = counts[(r + 1) * motif_count + m];
+    }
+    uint64_t pooled = 0;
+    for (const uint64_t count : shuffled) {
+      pooled += count;
+    }
+    MotifEnrichment enrichment = MotifEnrichment::compute(
+        local_motifs[m].pattern, counts[m], sequences.size(), pooled,
+        replicates * sequences.size());
+    enrichment.log_p_value = std::log(empiricalPValue(counts[m], shuffled));
+    enrichments.push_back(std::move(enrichment));
+  }
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file.is_open()) {
+      throw std::runtime_error("Cannot open output file: " + output_file);
+    }
+  }
+  std::ostream &out = output_file.empty() ? std::cout : file;
+
+  out << "Motif_Pattern\tSequences\tFrequency\tShuffled_Mean\t"
+         "Shuffled_Frequency\tFold_Enrichment\tEmpirical_P\n";
+  for (const auto &enrichment : enrichments) {
+    out << enrichment.pattern << "\t" << enrichment.foreground_hits << "\t"
+        << std::format("{:.6f}\t{:.2f}\t{:.6f}\t{:.4f}\t{:.6f}",
+                       enrichment.foreground_frequency,
+                       static_cast<double>(enrichment.background_hits) /
+                           static_cast<double>(replicates),
+                       enrichment.background_frequency,
+                       enrichment.fold_enrichment,
+                       std::exp(enrichment.log_p_value))
+        << "\n";
+  }
+
+  const double total_time = total_timer.elapsed();
+  updatePerformanceStats("total_processing_time", total_time);
+  std::cout << "Shuffled enrichment of " << enrichments.size()
+            << " motifs computed in " << std::fixed << std::setprecision(2)
+            << total_time << " seconds" << std::endl;
+  return enrichments;
+}
+
 void ParallelProcessor::printResults(
     const std::vector<MotifResult> &results) const {
   if (!mpi_manager_->isMaster()) {
     return;
   }
 
+  const size_t levels =
+      results.empty() ? 0 : results.front().mismatch_counts.size();
+
   std::cout << "\n=== MOTIF FINDING RESULTS ===" << std::endl;
   std::cout << std::setw(20) << "Motif Pattern" << std::setw(15)
-            << "Match Count" << std::setw(15) << "Frequency" << std::endl;
-  std::cout << std::string(50, '-') << std::endl;
+            << "Match Count" << std::setw(15) << "Frequency";
+  for (size_t k = 0; k < levels; ++k) {
+    std::cout << std::setw(15) << std::format("{} Mismatch", k);
+  }
+  std::cout << std::endl;
+  std::cout << std::string(50 + 15 * levels, '-') << std::endl;
 
   for (const auto &result : results) {
     std::cout << std::setw(20) << result.motif_pattern << std::setw(15)
               << result.match_count << std::setw(15) << std::fixed
-              << std::setprecision(4) << result.frequency << std::endl;
+              << std::setprecision(4) << result.frequency;
+    for (size_t count : result.mismatch_counts) {
+      std::cout << std::setw(15) << count;
+    }
+    std::cout << std::endl;
   }
 
   std::cout << std::endl;
@@ -116,11 +753,22 @@ void ParallelProcessor::saveResults(const std::vector<MotifResult> &results,
     return;
   }
 
-  file << "Motif_Pattern\tMatch_Count\tFrequency\n";
+  const size_t levels =
+      results.empty() ? 0 : results.front().mismatch_counts.size();
+
+  file << "Motif_Pattern\tMatch_Count\tFrequency";
+  for (size_t k = 0; k < levels; ++k) {
+    file << "\tMismatches_" << k;
+  }
+  file << "\n";
 
   for (const auto &result : results) {
     file << result.motif_pattern << "\t" << result.match_count << "\t"
-         << std::fixed << std::setprecision(6) << result.frequency << "\n";
+         << std::fixed << std::setprecision(6) << result.frequency;
+    for (size_t count : result.mismatch_counts) {
+      file << "\t" << count;
+    }
+    file << "\n";
   }
 
   file.close();
@@ -128,6 +776,422 @@ void ParallelProcessor::saveResults(const std::vector<MotifResult> &results,
   std::cout << "Results saved to: " << output_file << std::endl;
 }
 
+void ParallelProcessor::savePositionHistogram(
+    const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  file << "Motif_Pattern";
+  for (size_t offset = 0; offset < position_histogram_.offset_count;
+       ++offset) {
+    file << "\t" << offset;
+  }
+  file << "\n";
+
+  for (size_t m = 0; m < position_histogram_.motif_count; ++m) {
+    file << motif_patterns_[m];
+    for (uint64_t count : position_histogram_.row(m)) {
+      file << "\t" << count;
+    }
+    file << "\n";
+  }
+
+  std::cout << "Position histogram saved to: " << output_file << std::endl;
+}
+
+void ParallelProcessor::saveCooccurrence(
+    const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  file << "Motif_Pattern";
+  for (size_t b = 0; b < cooccurrence_.motif_count; ++b) {
+    file << "\t" << motif_patterns_[b];
+  }
+  file << "\n";
+
+  for (size_t a = 0; a < cooccurrence_.motif_count; ++a) {
+    file << motif_patterns_[a];
+    for (size_t b = 0; b < cooccurrence_.motif_count; ++b) {
+      file << "\t" << cooccurrence_.at(a, b);
+    }
+    file << "\n";
+  }
+
+  std::cout << "Co-occurrence matrix saved to: " << output_file << std::endl;
+}
+
+void ParallelProcessor::saveSpectrum(const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  const uint64_t windows = spectrum_.windowCount();
+  const auto occurrences = spectrum_.occurrences();
+  const auto sequences = spectrum_.sequences();
+  file << "Kmer\tOccurrences\tSequences\tFrequency\n";
+  for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+    const double frequency =
+        windows > 0 ? static_cast<double>(occurrences[code]) /
+                          static_cast<double>(windows)
+                    : 0.0;
+    file << decodeWindowCode(code) << "\t" << occurrences[code] << "\t"
+         << sequences[code] << "\t" << std::fixed << std::setprecision(8)
+         << frequency << "\n";
+  }
+
+  std::cout << "8-mer spectrum of " << windows << " windows saved to: "
+            << output_file << std::endl;
+}
+
+void ParallelProcessor::saveExpected(const std::vector<MotifResult> &results,
+                                     const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+  if (!markov_background_) {
+    std::cerr << "No Markov background was fitted" << std::endl;
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  // The gathered results hold one block of motifs per process
+  const size_t motif_count = motif_patterns_.size();
+  std::vector<uint64_t> observed(motif_count, 0);
+  for (size_t i = 0; i < results.size() && motif_count > 0; ++i) {
+    observed[i % motif_count] += results[i].match_count;
+  }
+
+  Timer timer;
+  const bool both_strands = motif_finder_->getScanOptions().both_strands;
+  const MarkovBackground &model = *markov_background_;
+  std::vector<std::optional<double>> probabilities(motif_count);
+  std::vector<std::optional<double>> expected(motif_count);
+#pragma omp parallel for schedule(dynamic)
+  for (size_t m = 0; m < motif_count; ++m) {
+    probabilities[m] =
+        model.windowProbability(motif_patterns_[m], both_strands);
+    expected[m] = model.expectedSequences(motif_patterns_[m], both_strands);
+  }
+
+  const auto sequences = static_cast<double>(model.sequenceCount());
+  file << "Motif_Pattern\tSequences\tFrequency\tWindow_Probability\t"
+          "Expected_Sequences\tExpected_Frequency\tEnrichment\n";
+  for (size_t m = 0; m < motif_count; ++m) {
+    file << motif_patterns_[m] << "\t" << observed[m] << "\t"
+         << std::format("{:.6f}",
+                        sequences > 0.0
+                            ? static_cast<double>(observed[m]) / sequences
+                            : 0.0);
+    if (!expected[m]) {
+      file << "\tNA\tNA\tNA\tNA\n";
+      continue;
+    }
+    const double enrichment =
+        *expected[m] > 0.0 ? static_cast<double>(observed[m]) / *expected[m]
+                           : 0.0;
+    file << std::format("\t{:.6e}\t{:.2f}\t{:.6f}\t{:.4f}\n",
+                        *probabilities[m], *expected[m],
+                        sequences > 0.0 ? *expected[m] / sequences : 0.0,
+                        enrichment);
+  }
+
+  std::cout << std::format("Expected frequencies of {} motifs under an "
+                           "order-{} Markov background computed in {:.3f} "
+                           "seconds, saved to: {}",
+                           motif_count, model.order(), timer.elapsed(),
+                           output_file)
+            << std::endl;
+}
+
+void ParallelProcessor::saveSpacing(const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  const auto max_distance =
+      static_cast<ptrdiff_t>(spacing_histogram_.max_distance);
+  file << "Motif_A\tMotif_B\tOrientation";
+  for (ptrdiff_t distance = -max_distance; distance <= max_distance;
+       ++distance) {
+    file << "\t" << distance;
+  }
+  file << "\n";
+
+  for (size_t p = 0; p < spacing_histogram_.pairs.size(); ++p) {
+    const auto [a, b] = spacing_histogram_.pairs[p];
+    for (size_t o = 0; o < spacing_histogram_.orientation_count; ++o) {
+      file << motif_patterns_[a] << "\t" << motif_patterns_[b] << "\t"
+           << PAIR_ORIENTATIONS[o];
+      for (uint64_t count : spacing_histogram_.row(p, o)) {
+        file << "\t" << count;
+      }
+      file << "\n";
+    }
+  }
+
+  std::cout << "Spacing histogram saved to: " << output_file << std::endl;
+}
+
+void ParallelProcessor::saveNeighbourhood(
+    const std::string &output_file) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::ofstream file(output_file);
+  if (!file.is_open()) {
+    std::cerr << "Cannot open output file: " << output_file << std::endl;
+    return;
+  }
+
+  const auto write = [&](const std::string &seed, std::string_view kind,
+                         const MotifVariant &variant) {
+    file << seed << "\t" << kind << "\t" << variant.pattern << "\t";
+    if (variant.from == 0) {
+      file << "-";
+    } else {
+      file << variant.position << ":" << variant.from << ">" << variant.to;
+    }
+    file << "\t" << variant.sequences << "\t" << std::fixed
+         << std::setprecision(2) << variant.expected << "\t"
+         << std::setprecision(4) << variant.enrichment << "\n";
+  };
+
+  file << "Motif_Pattern\tKind\tPattern\tChange\tSequences\tExpected\t"
+          "Enrichment\n";
+  for (const auto &refinement : refinements_) {
+    if (refinement.trail.empty()) {
+      continue;
+    }
+    write(refinement.seed, "seed", refinement.trail.front());
+    for (const auto &variant : refinement.neighbours) {
+      write(refinement.seed, "neighbour", variant);
+    }
+    for (const auto &variant : refinement.trail | std::views::drop(1)) {
+      write(refinement.seed, "step", variant);
+    }
+  }
+
+  std::cout << "Motif neighbourhoods saved to: " << output_file << std::endl;
+}
+
+std::vector<MotifResult> ParallelProcessor::evaluateQueries(
+    const std::vector<std::string> &expressions) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+
+  const HitBitsets &bitsets = motif_finder_->getHitBitsets();
+  if (bitsets.motifCount() != motif_patterns_.size()) {
+    throw std::runtime_error("Motif queries need the hit bitsets of a scan");
+  }
+
+  Timer timer;
+
+  // Query counts followed by the local sequence count, reduced together
+  std::vector<uint64_t> counts;
+  counts.reserve(expressions.size() + 1);
+  for (const auto &expression : expressions) {
+    auto query = MotifQuery::parse(expression, motif_patterns_);
+    if (!query) {
+      throw std::invalid_argument(
+          std::format("Invalid query '{}' at {}: {}", expression,
+                      query.error().position, query.error().message));
+    }
+    counts.push_back(query->count(bitsets));
+  }
+  counts.push_back(bitsets.sequenceCount());
+  counts = mpi_manager_->reduceCounts(counts);
+
+  std::vector<MotifResult> results;
+  results.reserve(expressions.size());
+  for (size_t q = 0; q < expressions.size(); ++q) {
+    MotifResult result(expressions[q]);
+    result.match_count = counts[q];
+    result.calculateFrequency(counts.back());
+    results.push_back(std::move(result));
+  }
+
+  updatePerformanceStats("query_time", timer.elapsed());
+  return results;
+}
+
+void ParallelProcessor::printQueryResults(
+    const std::vector<MotifResult> &results) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::cout << "\n=== QUERY RESULTS ===" << std::endl;
+  for (const auto &result : results) {
+    std::cout << std::setw(15) << result.match_count << std::setw(15)
+              << std::fixed << std::setprecision(4) << result.frequency
+              << "  " << result.motif_pattern << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+MotifClusters ParallelProcessor::clusterMotifs(double threshold,
+                                             size_t minhash_hashes) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+
+  const HitBitsets &bitsets = motif_finder_->getHitBitsets();
+  if (bitsets.motifCount() != motif_patterns_.size()) {
+    throw std::runtime_error("Motif clustering needs the hit bitsets of a "
+                             "scan");
+  }
+
+  Timer timer;
+  MotifClusters clusters;
+  if (minhash_hashes == 0) {
+    if (!cooccurrence_enabled_) {
+      throw std::runtime_error("Exact motif clustering needs the "
+                               "co-occurrence matrix");
+    }
+    // The co-occurrence matrix is already summed on the master
+    if (mpi_manager_->isMaster()) {
+      clusters = dna_motif::clusterMotifs(cooccurrence_, threshold);
+    }
+  } else {
+    // Global sequence ids, so the merged signatures and the clusters do
+    // not depend on the number of processes
+    MinHashSketches sketches = MinHashSketches::fromBitsets(
+        bitsets, minhash_hashes, first_sequence_id_);
+    sketches.values() = mpi_manager_->reduceMinimum(sketches.values());
+
+    std::vector<uint64_t> hit_counts(bitsets.motifCount());
+    for (size_t m = 0; m < hit_counts.size(); ++m) {
+      hit_counts[m] = bitsets.count(m);
+    }
+    hit_counts = mpi_manager_->reduceCounts(hit_counts);
+
+    if (mpi_manager_->isMaster()) {
+      clusters = dna_motif::clusterMotifs(sketches, hit_counts, threshold);
+    }
+  }
+
+  updatePerformanceStats("clustering_time", timer.elapsed());
+  return clusters;
+}
+
+void ParallelProcessor::printClusters(const MotifClusters &clusters) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::cout << "\n=== MOTIF CLUSTERS ===" << std::endl;
+  std::cout << clusters.clusterCount() << " clusters of "
+            << clusters.cluster_of.size() << " motifs" << std::endl;
+  for (size_t c = 0; c < clusters.clusterCount(); ++c) {
+    const auto members = clusters.members(c);
+    std::cout << std::setw(6) << c << std::setw(20)
+              << motif_patterns_[clusters.representatives[c]] << "  ("
+              << members.size() << ")";
+    for (size_t m : members) {
+      if (m != clusters.representatives[c]) {
+        std::cout << " " << motif_patterns_[m];
+      }
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+std::vector<FrequencyInterval>
+ParallelProcessor::bootstrapFrequencies(size_t replicates, uint64_t seed,
+                                        double confidence) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+  if (!(confidence > 0.0 && confidence < 1.0) || replicates == 0) {
+    throw std::invalid_argument("Bootstrap needs replicates and a "
+                                "confidence in (0, 1)");
+  }
+
+  const HitBitsets &bitsets = motif_finder_->getHitBitsets();
+  if (bitsets.motifCount() != motif_patterns_.size()) {
+    throw std::runtime_error("Motif bootstrap needs the hit bitsets of a "
+                             "scan");
+  }
+
+  Timer timer;
+  MotifBootstrap bootstrap =
+      MotifBootstrap::count(bitsets, replicates, seed, first_sequence_id_);
+  bootstrap.counts = mpi_manager_->reduceCounts(bootstrap.counts);
+
+  std::vector<FrequencyInterval> intervals;
+  if (mpi_manager_->isMaster()) {
+    intervals = bootstrap.intervals(confidence);
+  }
+
+  updatePerformanceStats("bootstrap_time", timer.elapsed());
+  return intervals;
+}
+
+void ParallelProcessor::printBootstrap(
+    const std::vector<FrequencyInterval> &intervals,
+    double confidence) const {
+  if (!mpi_manager_->isMaster()) {
+    return;
+  }
+
+  std::cout << "\n=== BOOTSTRAP CONFIDENCE INTERVALS ===" << std::endl;
+  std::cout << std::setw(20) << "Motif Pattern" << std::setw(15)
+            << "Frequency" << std::setw(15)
+            << std::format("{:g}% Lower", 100.0 * confidence)
+            << std::setw(15)
+            << std::format("{:g}% Upper", 100.0 * confidence) << std::endl;
+  std::cout << std::string(65, '-') << std::endl;
+  for (size_t m = 0; m < intervals.size(); ++m) {
+    std::cout << std::setw(20) << motif_patterns_[m] << std::fixed
+              << std::setprecision(4) << std::setw(15)
+              << intervals[m].frequency << std::setw(15) << intervals[m].lower
+              << std::setw(15) << intervals[m].upper << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+void ParallelProcessor::setScanOptions(const ScanOptions &options) {
+  if (!initialized_) {
+    throw std::runtime_error("ParallelProcessor not initialized");
+  }
+  motif_finder_->setScanOptions(options);
+}
+
 std::unordered_map<std::string, double>
 ParallelProcessor::getPerformanceStats() const {
   return performance_stats_;
@@ -187,32 +1251,105 @@ ParallelProcessor::loadInputFiles(const std::string &chip_seq_file,
   return {sequences, motifs};
 }
 
-std::vector<MotifResult> ParallelProcessor::processMotifsParallel(
-    const std::vector<ChIPSequence> &sequences,
-    const std::vector<Motif> &motifs) {
+std::vector<MotifResult>
+ParallelProcessor::processMotifsParallel(const SequenceStore &store,
+                                         const std::vector<Motif> &motifs) {
   Timer timer;
-  std::vector<MotifResult> results;
-  results.reserve(motifs.size());
 
-// Process motifs in parallel using OpenMP
-#pragma omp parallel
-  {
-    std::vector<MotifResult> local_results;
-    local_results.reserve(motifs.size());
+  // MotifFinder parallelizes over motifs for small panels and over
+  // sequences for motif-major panels and position histograms
+  motif_patterns_.clear();
+  for (const auto &motif : motifs) {
+    motif_patterns_.push_back(motif.pattern);
+  }
+
+  std::vector<MotifResult> results;
+  if (motif_finder_->getScanOptions().position_histogram) {
+    PositionHistogram histogram;
+    results = motif_finder_->findMotifs(store, motifs, histogram);
+    position_histogram_ = mpi_manager_->reduceHistogram(histogram);
+  } else {
+    results = motif_finder_->findMotifs(store, motifs);
+  }
 
-#pragma omp for schedule(dynamic)
-    for (size_t i = 0; i < motifs.size(); ++i) {
-      MotifResult result = motif_finder_->findSingleMotif(sequences, motifs[i]);
-      local_results.push_back(result);
+  if (motif_finder_->getScanOptions().zone_maps) {
+    const ZoneSkipStats &local = motif_finder_->getZoneSkipStats();
+    const std::array<uint64_t, 2> counts = {local.blocks_checked,
+                                            local.blocks_skipped};
+    const auto totals = mpi_manager_->reduceCounts(counts);
+    if (mpi_manager_->isMaster()) {
+      const ZoneSkipStats total{totals[0], totals[1]};
+      std::cout << std::format("Zone maps skipped {} of {} sequence blocks "
+                               "({:.1f}%)",
+                               total.blocks_skipped, total.blocks_checked,
+                               100.0 * total.skipRate())
+                << std::endl;
     }
+  }
+
+  if (cooccurrence_enabled_ &&
+      motif_finder_->getScanOptions().keep_hit_bitsets) {
+    Timer cooccurrence_timer;
+    cooccurrence_ = motif_finder_->getHitBitsets().cooccurrence();
+    cooccurrence_.counts = mpi_manager_->reduceCounts(cooccurrence_.counts);
+    updatePerformanceStats("cooccurrence_time", cooccurrence_timer.elapsed());
+  }
+
+  if (spacing_options_.max_distance > 0) {
+    Timer spacing_timer;
+    SpacingOptions options = spacing_options_;
+    options.both_strands = motif_finder_->getScanOptions().both_strands;
+    spacing_histogram_ =
+        SpacingAnalyzer(motifs, *iupac_codes_, options).analyze(store);
+    spacing_histogram_.counts =
+        mpi_manager_->reduceCounts(spacing_histogram_.counts);
+    updatePerformanceStats("spacing_time", spacing_timer.elapsed());
+  }
 
-// Merge results from all threads
-#pragma omp critical
-    {
-      results.insert(results.end(), local_results.begin(), local_results.end());
+  if (neighbourhood_options_.enabled) {
+    Timer neighbourhood_timer;
+    NeighbourhoodOptions options = neighbourhood_options_;
+    options.both_strands = motif_finder_->getScanOptions().both_strands;
+    const MotifNeighbourhood neighbourhood(
+        store, *iupac_codes_, options, [&](std::span<uint64_t> counts) {
+          const auto totals = mpi_manager_->allreduceCounts(counts);
+          std::ranges::copy(totals, counts.begin());
+        });
+    refinements_ = neighbourhood.refine(motifs);
+    updatePerformanceStats("neighbourhood_time",
+                           neighbourhood_timer.elapsed());
+    if (mpi_manager_->isMaster()) {
+      size_t moves = 0;
+      for (const auto &refinement : refinements_) {
+        moves += refinement.trail.empty() ? 0 : refinement.trail.size() - 1;
+      }
+      std::cout << std::format("Explored the neighbourhoods of {} motifs "
+                               "with {} hill-climbing moves in {} scans",
+                               refinements_.size(), moves,
+                               neighbourhood.scans())
+                << std::endl;
     }
   }
 
+  if (spectrum_enabled_) {
+    Timer spectrum_timer;
+    spectrum_ = KmerSpectrum::count(store);
+    spectrum_.counts = mpi_manager_->allreduceCounts(spectrum_.counts);
+    const std::array<uint64_t, 1> sequences = {spectrum_.sequence_count};
+    spectrum_.sequence_count = mpi_manager_->allreduceCounts(sequences)[0];
+    updatePerformanceStats("spectrum_time", spectrum_timer.elapsed());
+  }
+
+  if (markov_order_) {
+    Timer markov_timer;
+    markov_background_.emplace(
+        store, *markov_order_, [&](std::span<uint64_t> counts) {
+          const auto totals = mpi_manager_->allreduceCounts(counts);
+          std::ranges::copy(totals, counts.begin());
+        });
+    updatePerformanceStats("markov_fit_time", markov_timer.elapsed());
+  }
+
   double parallel_time = timer.elapsed();
   updatePerformanceStats("parallel_processing_time", parallel_time);
 
@@ -0,0 +1,243 @@
+#include "pwm_scorer.h"
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace dna_motif {
+
+PositionWeightMatrix::PositionWeightMatrix(
+    std::span<const double> probabilities)
+    : weights_(probabilities.size()) {
+  for (size_t p = 0; p < weights_.size() / 4; ++p) {
+    float low = std::numeric_limits<float>::max();
+    float high = std::numeric_limits<float>::lowest();
+    for (size_t code = 0; code < 4; ++code) {
+      const float weight = static_cast<float>(
+          std::log2(probabilities[p * 4 + code] / BACKGROUND));
+      weights_[p * 4 + code] = weight;
+      low = std::min(low, weight);
+      high = std::max(high, weight);
+    }
+    min_score_ += low;
+    max_score_ += high;
+  }
+}
+
+std::optional<PositionWeightMatrix>
+PositionWeightMatrix::fromPattern(std::string_view pattern,
+                                  const IUPACCodes &iupac_codes,
+                                  double pseudocount) {
+  if (pattern.empty() || pattern.size() > MAX_MOTIF_LENGTH ||
+      !(pseudocount > 0.0 && pseudocount < 1.0)) {
+    return std::nullopt;
+  }
+
+  std::vector<double> probabilities(pattern.size() * 4);
+  for (size_t p = 0; p < pattern.size(); ++p) {
+    const uint8_t mask = iupac_codes.getBaseMask(pattern[p]);
+    if (mask == 0) {
+      return std::nullopt;
+    }
+
+    const int accepted = std::popcount(mask);
+    for (uint8_t code = 0; code < 4; ++code) {
+      // All four accepted: no mass to move, every weight is 0
+      probabilities[p * 4 + code] =
+          accepted == 4              ? BACKGROUND
+          : ((mask >> code) & 1u) != 0 ? (1.0 - pseudocount) / accepted
+                                       : pseudocount / (4 - accepted);
+    }
+  }
+  return PositionWeightMatrix(probabilities);
+}
+
+std::optional<PositionWeightMatrix>
+PositionWeightMatrix::fromCounts(std::span<const std::array<double, 4>> counts,
+                                 double pseudocount) {
+  if (counts.empty() || counts.size() > MAX_MOTIF_LENGTH ||
+      pseudocount < 0.0) {
+    return std::nullopt;
+  }
+
+  static constexpr std::string_view COLUMNS = "ACGT";
+  std::vector<double> probabilities(counts.size() * 4);
+  for (size_t p = 0; p < counts.size(); ++p) {
+    const double total =
+        std::accumulate(counts[p].begin(), counts[p].end(), 4 * pseudocount);
+    if (!(total > 0.0) ||
+        std::ranges::any_of(counts[p], [](double c) { return c < 0.0; })) {
+      return std::nullopt;
+    }
+
+    for (size_t column = 0; column < 4; ++column) {
+      probabilities[p * 4 + encodeNucleotide(COLUMNS[column])] =
+          (counts[p][column] + pseudocount) / total;
+    }
+  }
+
+  // A zero probability would make its weight -inf and break the bounds
+  if (std::ranges::any_of(probabilities, [](double p) { return p <= 0.0; })) {
+    return std::nullopt;
+  }
+  return PositionWeightMatrix(probabilities);
+}
+
+float PositionWeightMatrix::score(const uint8_t *bases) const noexcept {
+  float total = 0.0f;
+  for (size_t p = 0; p < length(); ++p) {
+    total += weight(p, bases[p]);
+  }
+  return total;
+}
+
+PwmScorer::PwmScorer(std::span<const PositionWeightMatrix> matrices,
+                     double relative_threshold) {
+  if (matrices.empty()) {
+    throw std::invalid_argument("PwmScorer needs at least one matrix");
+  }
+  if (!(relative_threshold >= 0.0 && relative_threshold <= 1.0)) {
+    throw std::invalid_argument("Relative PWM threshold must be in [0, 1]");
+  }
+
+  matrices_.reserve(matrices.size());
+  for (const auto &pwm : matrices) {
+    const size_t length = pwm.length();
+    const auto spread = [&](size_t p) {
+      const auto row = pwm.weights().subspan(p * 4, 4);
+      return std::ranges::max(row) - std::ranges::min(row);
+    };
+
+    CompiledMatrix matrix;
+    matrix.order.resize(length);
+    std::iota(matrix.order.begin(), matrix.order.end(), uint8_t{0});
+    std::ranges::stable_sort(matrix.order, [&](uint8_t a, uint8_t b) {
+      return spread(a) > spread(b);
+    });
+
+    matrix.weights.resize(length * 4);
+    matrix.remaining.assign(length + 1, 0.0f);
+    for (size_t k = length; k-- > 0;) {
+      const auto row = pwm.weights().subspan(matrix.order[k] * 4uz, 4);
+      std::ranges::copy(row, matrix.weights.begin() + k * 4);
+      matrix.remaining[k] = matrix.remaining[k + 1] + std::ranges::max(row);
+    }
+
+    matrix.threshold = static_cast<float>(
+        pwm.minScore() +
+        relative_threshold * (pwm.maxScore() - pwm.minScore()));
+    matrices_.push_back(std::move(matrix));
+  }
+}
+
+PwmScores PwmScorer::scoreBest(const SequenceStore &store) const {
+  PwmScores scores;
+  scores.sequence_count = store.size();
+  scores.best.assign(matrices_.size() * store.size(), NO_PWM_HIT);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for (size_t s = 0; s < store.size(); ++s) {
+    const std::span<const uint8_t> bases = store.bases(s);
+    const std::string_view text = store.sequence(s).sequence;
+
+    for (size_t m = 0; m < matrices_.size(); ++m) {
+      float best = NO_PWM_HIT;
+      if (store.isClean(s)) {
+        best = bestScore(m, bases);
+      } else {
+        // Score each maximal A/C/G/T run separately
+        size_t start = 0;
+        while (start < text.size()) {
+          const auto run_end = std::find_if_not(
+              text.begin() + start, text.end(), isNucleotide);
+          const auto end = static_cast<size_t>(run_end - text.begin());
+          best =
+              std::max(best, bestScore(m, bases.subspan(start, end - start)));
+          start = end + 1;
+        }
+      }
+      scores.best[m * store.size() + s] = best;
+    }
+  }
+
+  scores.hit_counts.resize(matrices_.size());
+  for (size_t m = 0; m < matrices_.size(); ++m) {
+    scores.hit_counts[m] = static_cast<size_t>(std::ranges::count_if(
+        scores.bestScores(m), [](float best) { return best != NO_PWM_HIT; }));
+  }
+  return scores;
+}
+
+float PwmScorer::bestScore(size_t matrix_index,
+                           std::span<const uint8_t> bases) const noexcept {
+  const CompiledMatrix &matrix = matrices_[matrix_index];
+  const size_t length = matrix.order.size();
+  float best = NO_PWM_HIT;
+  if (bases.size() < length) {
+    return best;
+  }
+
+  const size_t windows = bases.size() - length + 1;
+  size_t w = 0;
+#if defined(__AVX2__)
+  // Eight windows per step; lane t of step k scores bases[w + t + order[k]]
+  for (; w + 8 <= windows; w += 8) {
+    const __m256 bound = _mm256_set1_ps(std::max(matrix.threshold, best));
+    __m256 acc = _mm256_setzero_ps();
+    bool alive = true;
+    for (size_t k = 0; k < length; ++k) {
+      const __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+          reinterpret_cast<const __m128i *>(bases.data() + w +
+                                            matrix.order[k])));
+      const __m256 row = _mm256_castps128_ps256(
+          _mm_loadu_ps(matrix.weights.data() + k * 4));
+      acc = _mm256_add_ps(acc, _mm256_permutevar8x32_ps(row, codes));
+
+      // Checked every fourth step: the compare costs about as much as a step
+      if ((k & 3) == 3 && k + 1 < length) {
+        const __m256 reach = _mm256_add_ps(
+            acc, _mm256_set1_ps(matrix.remaining[k + 1]));
+        if (_mm256_movemask_ps(_mm256_cmp_ps(reach, bound, _CMP_GE_OQ)) ==
+            0) {
+          alive = false;
+          break;
+        }
+      }
+    }
+    if (!alive) {
+      continue;
+    }
+
+    alignas(32) std::array<float, 8> lanes;
+    _mm256_store_ps(lanes.data(), acc);
+    for (float score : lanes) {
+      if (score >= matrix.threshold && score > best) {
+        best = score;
+      }
+    }
+  }
+#endif
+  scoreWindows(matrix, bases.data(), w, windows, best);
+  return best;
+}
+
+void PwmScorer::scoreWindows(const CompiledMatrix &matrix,
+                             const uint8_t *bases, size_t first, size_t last,
+                             float &best) noexcept {
+  const size_t length = matrix.order.size();
+  for (size_t w = first; w < last; ++w) {
+    const float bound = std::max(matrix.threshold, best);
+    float acc = 0.0f;
+    size_t k = 0;
+    for (; k < length; ++k) {
+      acc += matrix.weights[k * 4 + bases[w + matrix.order[k]]];
+      if (acc + matrix.remaining[k + 1] < bound) {
+        break;
+      }
+    }
+    if (k == length && acc > best) {
+      best = acc;
+    }
+  }
+}
+
+} // namespace dna_motif
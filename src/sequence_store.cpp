@@ -0,0 +1,168 @@
+#include "sequence_store.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dna_motif {
+
+namespace {
+
+constexpr size_t WINDOW_CODE_BITS = NUCLEOTIDE_CODE_BITS * WINDOW_CODE_LENGTH;
+
+void encodeWindowsScalar(const uint8_t *bases, size_t first_window,
+                         size_t window_count, uint16_t *codes) noexcept {
+  if (first_window >= window_count) {
+    return;
+  }
+
+  constexpr uint32_t code_mask = (1u << WINDOW_CODE_BITS) - 1;
+  uint32_t code = 0;
+  for (size_t p = 0; p + 1 < WINDOW_CODE_LENGTH; ++p) {
+    code = (code << NUCLEOTIDE_CODE_BITS) | bases[first_window + p];
+  }
+
+  for (size_t w = first_window; w < window_count; ++w) {
+    code = ((code << NUCLEOTIDE_CODE_BITS) |
+            bases[w + WINDOW_CODE_LENGTH - 1]) &
+           code_mask;
+    codes[w] = static_cast<uint16_t>(code);
+  }
+}
+
+#if defined(__AVX2__)
+// Encodes 16 windows per iteration: each of the WINDOW_CODE_LENGTH shifted
+// base loads is widened to 16-bit lanes and OR-ed into place.
+size_t encodeWindowsAVX2(const uint8_t *bases, size_t window_count,
+                         uint16_t *codes) noexcept {
+  constexpr size_t lanes = 16;
+  size_t w = 0;
+  for (; w + lanes <= window_count; w += lanes) {
+    __m256i code = _mm256_setzero_si256();
+    for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+      const __m128i raw = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(bases + w + p));
+      const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(
+          NUCLEOTIDE_CODE_BITS * (WINDOW_CODE_LENGTH - 1 - p)));
+      code = _mm256_or_si256(
+          code, _mm256_sll_epi16(_mm256_cvtepu8_epi16(raw), shift));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(codes + w), code);
+  }
+  return w;
+}
+#endif
+
+} // namespace
+
+SequenceStore::SequenceStore(std::span<const ChIPSequence> sequences)
+    : sequences_(sequences) {
+  size_t total_bases = 0;
+  for (const auto &seq : sequences_) {
+    total_bases += seq.sequence.size();
+  }
+
+  bases_.assign(total_bases + BASE_PADDING, 0);
+  base_offsets_.reserve(sequences_.size() + 1);
+  clean_.reserve(sequences_.size());
+
+  size_t offset = 0;
+  for (const auto &seq : sequences_) {
+    bool clean = true;
+    for (char c : seq.sequence) {
+      bases_[offset++] = encodeNucleotide(c);
+      clean &= isNucleotide(c);
+    }
+    base_offsets_.push_back(offset);
+    clean_.push_back(clean ? 1 : 0);
+  }
+
+  const auto differs = [&](const ChIPSequence &seq) {
+    return seq.sequence.size() != sequences_.front().sequence.size();
+  };
+  if (!sequences_.empty() && std::ranges::none_of(sequences_, differs)) {
+    uniform_length_ = sequences_.front().sequence.size();
+  }
+}
+
+void SequenceStore::buildWindowCodes() {
+  window_offsets_.assign(1, 0);
+  window_offsets_.reserve(sequences_.size() + 1);
+
+  for (size_t i = 0; i < sequences_.size(); ++i) {
+    const size_t length = base_offsets_[i + 1] - base_offsets_[i];
+    const size_t windows =
+        length >= WINDOW_CODE_LENGTH ? length - WINDOW_CODE_LENGTH + 1 : 0;
+    window_offsets_.push_back(window_offsets_.back() + windows);
+  }
+
+  window_codes_.resize(window_offsets_.back());
+
+#pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < sequences_.size(); ++i) {
+    const uint8_t *bases = bases_.data() + base_offsets_[i];
+    uint16_t *codes = window_codes_.data() + window_offsets_[i];
+    const size_t windows = window_offsets_[i + 1] - window_offsets_[i];
+
+    size_t done = 0;
+#if defined(__AVX2__)
+    done = encodeWindowsAVX2(bases, windows, codes);
+#endif
+    encodeWindowsScalar(bases, done, windows, codes);
+  }
+}
+
+void SequenceStore::buildBaseNibbles() {
+  nibble_offsets_.assign(1, 0);
+  nibble_offsets_.reserve(sequences_.size() + 1);
+
+  for (size_t i = 0; i < sequences_.size(); ++i) {
+    const size_t length = base_offsets_[i + 1] - base_offsets_[i];
+    nibble_offsets_.push_back(nibble_offsets_.back() + (length + 15) / 16 + 1);
+  }
+
+  nibbles_.assign(nibble_offsets_.back(), 0);
+
+#pragma omp parallel for schedule(static)
+  for (size_t i = 0; i < sequences_.size(); ++i) {
+    const uint8_t *bases = bases_.data() + base_offsets_[i];
+    uint64_t *words = nibbles_.data() + nibble_offsets_[i];
+    const size_t length = base_offsets_[i + 1] - base_offsets_[i];
+
+    for (size_t j = 0; j < length; ++j) {
+      words[j / 16] |= (1ull << bases[j]) << (4 * (j % 16));
+    }
+  }
+}
+
+void SequenceStore::buildZoneMaps(size_t block_sequences) {
+  zone_block_size_ = std::max<size_t>(block_sequences, 1);
+  const size_t blocks =
+      (sequences_.size() + zone_block_size_ - 1) / zone_block_size_;
+  zone_maps_.assign(blocks * ZONE_MAP_WORDS, 0);
+
+  constexpr uint32_t code_mask = (1u << WINDOW_CODE_BITS) - 1;
+#pragma omp parallel for schedule(dynamic)
+  for (size_t block = 0; block < blocks; ++block) {
+    uint64_t *map = zone_maps_.data() + block * ZONE_MAP_WORDS;
+    const size_t last =
+        std::min(sequences_.size(), (block + 1) * zone_block_size_);
+    for (size_t i = block * zone_block_size_; i < last; ++i) {
+      if (!clean_[i]) {
+        continue;
+      }
+      const uint8_t *bases = bases_.data() + base_offsets_[i];
+      const size_t length = base_offsets_[i + 1] - base_offsets_[i];
+      uint32_t code = 0;
+      for (size_t j = 0; j < length; ++j) {
+        code = ((code << NUCLEOTIDE_CODE_BITS) | bases[j]) & code_mask;
+        if (j + 1 >= WINDOW_CODE_LENGTH) {
+          map[code >> 6] |= 1ull << (code & 63);
+        }
+      }
+    }
+  }
+}
+
+} // namespace dna_motif
@@ -0,0 +1,200 @@
+#include "spacing_analyzer.h"
+#include <stdexcept>
+
+namespace dna_motif {
+
+namespace {
+
+// Extract count (at most 64) bits of a bitset starting at bit first, zero
+// past its end
+uint64_t extractBits(std::span<const uint64_t> bits, size_t first,
+                     size_t count) noexcept {
+  const size_t q = first / 64;
+  const size_t r = first % 64;
+  uint64_t word = q < bits.size() ? bits[q] >> r : 0;
+  if (r != 0 && q + 1 < bits.size()) {
+    word |= bits[q + 1] << (64 - r);
+  }
+  return count < 64 ? word & ((1ull << count) - 1) : word;
+}
+
+// OR a run-local mask into a sequence mask at bit offset shift
+void orShifted(std::span<uint64_t> target, std::span<const uint64_t> source,
+               size_t shift) noexcept {
+  const size_t q = shift / 64;
+  const size_t r = shift % 64;
+  for (size_t w = 0; w < source.size() && q + w < target.size(); ++w) {
+    target[q + w] |= source[w] << r;
+    if (r != 0 && q + w + 1 < target.size()) {
+      target[q + w + 1] |= source[w] >> (64 - r);
+    }
+  }
+}
+
+} // namespace
+
+SpacingAnalyzer::SpacingAnalyzer(std::span<const Motif> motifs,
+                                 const IUPACCodes &iupac_codes,
+                                 const SpacingOptions &options)
+    : motif_count_(motifs.size()), strand_count_(options.both_strands ? 2 : 1),
+      max_distance_(options.max_distance), pairs_(options.pairs),
+      used_(motifs.size(), false) {
+  if (max_distance_ == 0) {
+    throw std::invalid_argument("Spacing analysis needs a maximum distance");
+  }
+  if (pairs_.empty()) {
+    for (size_t a = 0; a < motifs.size(); ++a) {
+      for (size_t b = a + 1; b < motifs.size(); ++b) {
+        pairs_.emplace_back(a, b);
+      }
+    }
+  }
+  for (const auto &[a, b] : pairs_) {
+    if (a >= motifs.size() || b >= motifs.size()) {
+      throw std::invalid_argument("Spacing pair refers to an unknown motif");
+    }
+    used_[a] = true;
+    used_[b] = true;
+  }
+
+  strands_.resize(motifs.size() * strand_count_);
+  for (size_t m = 0; m < motifs.size(); ++m) {
+    if (!used_[m]) {
+      continue;
+    }
+    const std::string &pattern = motifs[m].pattern;
+    CompiledStrand &forward = strands_[m * strand_count_];
+    if (GappedMotif::isGapped(pattern)) {
+      forward.gapped = GappedMotif::compile(pattern, iupac_codes);
+      if (forward.gapped && options.both_strands) {
+        strands_[m * strand_count_ + 1].gapped = GappedMotif::compile(
+            forward.gapped->reverseComplement(iupac_codes), iupac_codes);
+      }
+    } else if (pattern.size() <= MAX_MOTIF_LENGTH) {
+      forward.exact = MismatchMotif::compile(pattern, iupac_codes, 0);
+      if (forward.exact && options.both_strands) {
+        strands_[m * strand_count_ + 1].exact = MismatchMotif::compile(
+            iupac_codes.reverseComplement(pattern), iupac_codes, 0);
+      }
+    }
+  }
+}
+
+SpacingHistogram SpacingAnalyzer::analyze(const SequenceStore &store) const {
+  SpacingHistogram histogram(pairs_, strand_count_ * strand_count_,
+                             max_distance_);
+
+  // Per-thread histograms, summed after the parallel region
+  std::vector<SpacingHistogram> partials(
+      static_cast<size_t>(omp_get_max_threads()));
+
+#pragma omp parallel
+  {
+    auto &local = partials[static_cast<size_t>(omp_get_thread_num())];
+    local = SpacingHistogram(pairs_, histogram.orientation_count,
+                             max_distance_);
+    std::vector<uint64_t> masks;
+    std::vector<uint64_t> run_hits;
+    std::vector<uint64_t> scratch;
+
+#pragma omp for schedule(dynamic, 64)
+    for (size_t s = 0; s < store.size(); ++s) {
+      const std::string_view text = store.sequence(s).sequence;
+      const uint8_t *bases = store.bases(s).data();
+      const size_t words = (text.size() + 63) / 64;
+      masks.assign(strands_.size() * words, 0);
+      const auto mask = [&](size_t motif, size_t strand) {
+        return std::span<uint64_t>(masks).subspan(
+            (motif * strand_count_ + strand) * words, words);
+      };
+
+      // No hit spans a non-nucleotide, so each run is matched on its own
+      size_t start = 0;
+      while (start < text.size()) {
+        const size_t end =
+            store.isClean(s)
+                ? text.size()
+                : static_cast<size_t>(std::find_if_not(text.begin() + start,
+                                                       text.end(),
+                                                       isNucleotide) -
+                                      text.begin());
+        for (size_t m = 0; m < motif_count_; ++m) {
+          if (!used_[m]) {
+            continue;
+          }
+          for (size_t k = 0; k < strand_count_; ++k) {
+            matchRun(strands_[m * strand_count_ + k], bases + start,
+                     end - start, run_hits, scratch);
+            orShifted(mask(m, k), run_hits, start);
+          }
+        }
+        start = end + 1;
+      }
+
+      for (size_t p = 0; p < pairs_.size(); ++p) {
+        const auto [a, b] = pairs_[p];
+        for (size_t ka = 0; ka < strand_count_; ++ka) {
+          for (size_t kb = 0; kb < strand_count_; ++kb) {
+            countPairs(mask(a, ka), mask(b, kb), text.size(),
+                       local.row(p, ka * 2 + kb), a == b && ka == kb);
+          }
+        }
+      }
+    }
+  }
+
+  for (const auto &local : partials) {
+    for (size_t i = 0; i < local.counts.size(); ++i) {
+      histogram.counts[i] += local.counts[i];
+    }
+  }
+  return histogram;
+}
+
+void SpacingAnalyzer::matchRun(const CompiledStrand &strand,
+                               const uint8_t *bases, size_t length,
+                               std::vector<uint64_t> &hits,
+                               std::vector<uint64_t> &scratch) {
+  if (strand.gapped) {
+    strand.gapped->matchRun(bases, length, hits, scratch);
+    return;
+  }
+
+  hits.assign((length + 63) / 64, 0);
+  if (!strand.exact || length < strand.exact->motifLength()) {
+    return;
+  }
+  const size_t offsets = length - strand.exact->motifLength() + 1;
+  for (size_t w = 0; w * 64 < offsets; ++w) {
+    hits[w] = strand.exact->countMismatches(bases + w * 64)[0];
+  }
+  if (offsets % 64 != 0) {
+    hits[offsets / 64] &= (1ull << (offsets % 64)) - 1;
+  }
+}
+
+void SpacingAnalyzer::countPairs(std::span<const uint64_t> first,
+                                 std::span<const uint64_t> second,
+                                 size_t length, std::span<uint64_t> row,
+                                 bool skip_self) const noexcept {
+  for (size_t w = 0; w < first.size(); ++w) {
+    for (uint64_t hits = first[w]; hits != 0; hits &= hits - 1) {
+      const size_t i = w * 64 + static_cast<size_t>(std::countr_zero(hits));
+      const size_t low = i >= max_distance_ ? i - max_distance_ : 0;
+      const size_t high = std::min(length - 1, i + max_distance_);
+
+      // Window [i - max_distance, i + max_distance] of the second mask
+      for (size_t chunk = low; chunk <= high; chunk += 64) {
+        uint64_t near = extractBits(second, chunk, high - chunk + 1);
+        for (; near != 0; near &= near - 1) {
+          const size_t j = chunk + static_cast<size_t>(std::countr_zero(near));
+          if (!(skip_self && j == i)) {
+            row[j + max_distance_ - i]++;
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace dna_motif
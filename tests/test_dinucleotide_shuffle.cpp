@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include "dinucleotide_shuffle.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class DinucleotideShuffleTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (int i = 0; i < 150; ++i) {
+            const int length = i % 30 == 0 ? 200 : static_cast<int>(rng.next() % 45);
+            std::string seq = randomSequence(rng, length, "AAACGTTTG");
+            if (i % 7 == 0 && length > 10) {
+                seq[static_cast<size_t>(rng.next() % length)] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+    }
+
+    static std::map<std::string, int> dinucleotides(const std::string& sequence) {
+        std::map<std::string, int> counts;
+        for (size_t i = 0; i + 1 < sequence.size(); ++i) {
+            ++counts[sequence.substr(i, 2)];
+        }
+        return counts;
+    }
+
+    std::vector<ChIPSequence> sequences;
+    TestRandom rng{29};
+};
+
+TEST_F(DinucleotideShuffleTest, PreservesDinucleotides) {
+    bool changed = false;
+    for (uint64_t key = 0; key < 20; ++key) {
+        for (const auto& sequence : sequences) {
+            if (sequence.sequence.find('N') != std::string::npos) {
+                continue;
+            }
+            std::vector<uint8_t> codes;
+            for (const char c : sequence.sequence) {
+                codes.push_back(encodeNucleotide(c));
+            }
+            std::vector<uint8_t> shuffled(codes.size());
+            shuffleDinucleotides(codes, key, shuffled);
+            std::string text;
+            for (const uint8_t code : shuffled) {
+                text += "ACTG"[code];
+            }
+            EXPECT_EQ(dinucleotides(text), dinucleotides(sequence.sequence)) << sequence.sequence;
+            if (!text.empty()) {
+                EXPECT_EQ(text.front(), sequence.sequence.front());
+                EXPECT_EQ(text.back(), sequence.sequence.back());
+            }
+            EXPECT_EQ(shuffleSequence(sequence.sequence, key), text);
+            changed |= text != sequence.sequence;
+        }
+    }
+    EXPECT_TRUE(changed);
+}
+
+TEST_F(DinucleotideShuffleTest, UniformOverArrangements) {
+    // Every arrangement of GATTACAGAT with the same first base and
+    // dinucleotide counts
+    const std::string original = "GATTACAGAT";
+    std::string permutation = original;
+    std::ranges::sort(permutation);
+    std::set<std::string> arrangements;
+    do {
+        if (permutation.front() == original.front() && dinucleotides(permutation) == dinucleotides(original)) {
+            arrangements.insert(permutation);
+        }
+    } while (std::ranges::next_permutation(permutation).found);
+    ASSERT_EQ(arrangements.size(), 12);
+
+    constexpr int draws = 24000;
+    std::map<std::string, int> seen;
+    for (uint64_t key = 0; key < draws; ++key) {
+        ++seen[shuffleSequence(original, mixBits(key))];
+    }
+    ASSERT_EQ(seen.size(), arrangements.size());
+    for (const auto& [arrangement, count] : seen) {
+        EXPECT_TRUE(arrangements.contains(arrangement)) << arrangement;
+        EXPECT_NEAR(count, draws / 12, 250) << arrangement;
+    }
+}
+
+TEST_F(DinucleotideShuffleTest, KeepsOtherCharactersInPlace) {
+    const std::string sequence = "ACGGTACNNTTGCAAGRCAT";
+    for (uint64_t key = 0; key < 50; ++key) {
+        const std::string shuffled = shuffleSequence(sequence, key);
+        ASSERT_EQ(shuffled.size(), sequence.size());
+        for (const size_t pos : {7, 8, 16}) {
+            EXPECT_EQ(shuffled[pos], sequence[pos]);
+        }
+        EXPECT_EQ(dinucleotides(shuffled.substr(0, 7)), dinucleotides(sequence.substr(0, 7)));
+        EXPECT_EQ(dinucleotides(shuffled.substr(9, 7)), dinucleotides(sequence.substr(9, 7)));
+        EXPECT_EQ(dinucleotides(shuffled.substr(17)), dinucleotides(sequence.substr(17)));
+    }
+    EXPECT_EQ(shuffleSequence("acgt", 3), "ACGT");
+}
+
+TEST_F(DinucleotideShuffleTest, ReplicatesIndependentOfSplit) {
+    const size_t replicates = 3;
+    const SequenceStore whole(sequences);
+    const DinucleotideShuffler shuffler(whole, 7);
+    std::vector<ChIPSequence> expected;
+    shuffler.generate(0, replicates * whole.size(), expected);
+    ASSERT_EQ(expected.size(), replicates * sequences.size());
+    for (size_t item = 0; item < expected.size(); ++item) {
+        const ChIPSequence& source = sequences[item % sequences.size()];
+        EXPECT_EQ(expected[item].id, source.id);
+        if (source.sequence.find('N') == std::string::npos) {
+            EXPECT_EQ(dinucleotides(expected[item].sequence), dinucleotides(source.sequence));
+        }
+    }
+    EXPECT_NE(expected[0].sequence, expected[sequences.size()].sequence);
+
+    // Small blocks reusing one buffer
+    std::vector<ChIPSequence> block;
+    for (size_t first = 0; first < expected.size(); first += 37) {
+        const size_t last = std::min(expected.size(), first + 37);
+        shuffler.generate(first, last, block);
+        for (size_t item = first; item < last; ++item) {
+            EXPECT_EQ(block[item - first], expected[item]);
+        }
+    }
+
+    // Two "processes" holding halves of the sequences
+    const size_t middle = 60;
+    const std::vector<ChIPSequence> head(sequences.begin(), sequences.begin() + middle);
+    const std::vector<ChIPSequence> tail(sequences.begin() + middle, sequences.end());
+    const SequenceStore head_store(head);
+    const SequenceStore tail_store(tail);
+    const DinucleotideShuffler head_shuffler(head_store, 7, 0);
+    const DinucleotideShuffler tail_shuffler(tail_store, 7, middle);
+    std::vector<ChIPSequence> head_out;
+    std::vector<ChIPSequence> tail_out;
+    head_shuffler.generate(0, replicates * head.size(), head_out);
+    tail_shuffler.generate(0, replicates * tail.size(), tail_out);
+    for (size_t r = 0; r < replicates; ++r) {
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            const ChIPSequence& actual = i < middle ? head_out[r * head.size() + i] : tail_out[r * tail.size() + i - middle];
+            EXPECT_EQ(actual, expected[r * sequences.size() + i]);
+        }
+    }
+}
+
+TEST_F(DinucleotideShuffleTest, EmpiricalPValue) {
+    const std::vector<uint64_t> shuffled = {3, 9, 5, 10, 2, 7, 1, 4, 8, 6};
+    EXPECT_DOUBLE_EQ(empiricalPValue(11, shuffled), 1.0 / 11.0);
+    EXPECT_DOUBLE_EQ(empiricalPValue(10, shuffled), 2.0 / 11.0);
+    EXPECT_DOUBLE_EQ(empiricalPValue(0, shuffled), 1.0);
+    EXPECT_DOUBLE_EQ(empiricalPValue(5, {}), 1.0);
+}
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <sstream>
 #include "dna_parser.h"
+#include "pwm_scorer.h"
 
 using namespace dna_motif;
 
@@ -185,3 +186,117 @@ TEST_F(DNAParserTest, EmptyFiles) {
     std::remove("empty_chip.fst");
     std::remove("empty_motifs.mot");
 }
+
+TEST_F(DNAParserTest, ParseJasparMatrices) {
+    std::ofstream file("test_matrices.jaspar");
+    file << ">MA0004.1\tArnt\n";
+    file << "A  [ 4 19  0  0  0  0 ]\n";
+    file << "C  [16  0 20  0  0  0 ]\n";
+    file << "G  [ 0  1  0 20  0 20 ]\n";
+    file << "T  [ 0  0  0  0 20  0 ]\n";
+    file << "\n";
+    // Unlabelled rows without a header are A, C, G, T
+    file << "1 2\n3 4\n5 6\n7 8\n";
+    file.close();
+
+    auto matrices_result = parser->parseCountMatrices("test_matrices.jaspar");
+    ASSERT_TRUE(matrices_result.has_value());
+    const auto& matrices = matrices_result.value();
+    ASSERT_EQ(matrices.size(), 2);
+
+    EXPECT_EQ(matrices[0].name, "MA0004.1");
+    ASSERT_EQ(matrices[0].counts.size(), 6);
+    EXPECT_EQ(matrices[0].counts[0], (std::array<double, 4>{4, 16, 0, 0}));
+    EXPECT_EQ(matrices[0].counts[1], (std::array<double, 4>{19, 0, 1, 0}));
+    EXPECT_EQ(matrices[0].counts[4], (std::array<double, 4>{0, 0, 0, 20}));
+
+    EXPECT_EQ(matrices[1].name, "matrix2");
+    ASSERT_EQ(matrices[1].counts.size(), 2);
+    EXPECT_EQ(matrices[1].counts[1], (std::array<double, 4>{2, 4, 6, 8}));
+
+    for (const auto& matrix : matrices) {
+        EXPECT_TRUE(PositionWeightMatrix::fromCounts(matrix.counts).has_value());
+    }
+
+    std::remove("test_matrices.jaspar");
+}
+
+TEST_F(DNAParserTest, ParseJasparRowsInAnyOrder) {
+    std::ofstream file("test_matrices.jaspar");
+    file << ">reordered\n";
+    file << "T [ 1 2 ]\nG [ 3 4 ]\nC [ 5 6 ]\nA [ 7 8 ]\n";
+    file.close();
+
+    auto matrices_result = parser->parseCountMatrices("test_matrices.jaspar");
+    ASSERT_TRUE(matrices_result.has_value());
+    ASSERT_EQ(matrices_result->size(), 1);
+    EXPECT_EQ((*matrices_result)[0].counts[0], (std::array<double, 4>{7, 5, 3, 1}));
+
+    std::remove("test_matrices.jaspar");
+}
+
+TEST_F(DNAParserTest, ParseMemeMatrices) {
+    std::ofstream file("test_matrices.meme");
+    file << "MEME version 4\n\n";
+    file << "ALPHABET= ACGT\n\n";
+    file << "Background letter frequencies\n";
+    file << "A 0.25 C 0.25 G 0.25 T 0.25\n\n";
+    file << "MOTIF MA0004.1 Arnt\n";
+    file << "letter-probability matrix: alength= 4 w= 2 nsites= 20 E= 0\n";
+    file << "  0.200000  0.800000  0.000000  0.000000\n";
+    file << "  0.950000  0.000000  0.050000  0.000000\n";
+    file << "URL http://example.org/MA0004.1\n\n";
+    file << "MOTIF second\n";
+    file << "letter-probability matrix: alength= 4 w= 1\n";
+    file << "0.5 0.5 0 0\n";
+    file.close();
+
+    auto matrices_result = parser->parseCountMatrices("test_matrices.meme");
+    ASSERT_TRUE(matrices_result.has_value());
+    const auto& matrices = matrices_result.value();
+    ASSERT_EQ(matrices.size(), 2);
+
+    EXPECT_EQ(matrices[0].name, "MA0004.1");
+    ASSERT_EQ(matrices[0].counts.size(), 2);
+    EXPECT_DOUBLE_EQ(matrices[0].counts[0][0], 4.0);
+    EXPECT_DOUBLE_EQ(matrices[0].counts[0][1], 16.0);
+    EXPECT_DOUBLE_EQ(matrices[0].counts[1][0], 19.0);
+    EXPECT_DOUBLE_EQ(matrices[0].counts[1][2], 1.0);
+
+    // Without nsites probabilities are scaled to 20 sites
+    EXPECT_EQ(matrices[1].name, "second");
+    ASSERT_EQ(matrices[1].counts.size(), 1);
+    EXPECT_DOUBLE_EQ(matrices[1].counts[0][0], 10.0);
+
+    std::remove("test_matrices.meme");
+}
+
+TEST_F(DNAParserTest, InvalidCountMatrices) {
+    const std::vector<std::string> invalid = {
+        // Rows of different length
+        ">m\nA [ 1 2 ]\nC [ 1 ]\nG [ 1 2 ]\nT [ 1 2 ]\n",
+        // Repeated row label
+        ">m\nA [ 1 ]\nA [ 1 ]\nG [ 1 ]\nT [ 1 ]\n",
+        // Missing rows
+        ">m\nA [ 1 ]\nC [ 1 ]\nG [ 1 ]\n",
+        // Not a number
+        ">m\nA [ 1 ]\nC [ x ]\nG [ 1 ]\nT [ 1 ]\n",
+        // MEME matrix shorter than its width
+        "MOTIF m\nletter-probability matrix: alength= 4 w= 2\n0.25 0.25 0.25 0.25\n",
+        // MEME row with three columns
+        "MOTIF m\nletter-probability matrix: alength= 4 w= 1\n0.5 0.25 0.25\n",
+    };
+    for (const auto& content : invalid) {
+        std::ofstream file("invalid_matrices.txt");
+        file << content;
+        file.close();
+
+        auto matrices_result = parser->parseCountMatrices("invalid_matrices.txt");
+        ASSERT_FALSE(matrices_result.has_value()) << content;
+        EXPECT_EQ(matrices_result.error(), ParseError::InvalidFormat) << content;
+    }
+    std::remove("invalid_matrices.txt");
+
+    EXPECT_EQ(parser->parseCountMatrices("nonexistent.jaspar").error(),
+              ParseError::FileNotFound);
+}
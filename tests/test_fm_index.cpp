@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "fm_index.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class FmIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+
+        for (int i = 0; i < 400; ++i) {
+            const int length = 1 + static_cast<int>(rng.next() % 120);
+            std::string seq = randomSequence(rng, length, "ACGTAAC");
+            if (i % 13 == 0) {
+                seq[seq.size() / 2] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+        // Long repeats need several doubling rounds
+        sequences.emplace_back("repeat", std::string(300, 'A') + "C" + std::string(300, 'A'));
+        sequences.emplace_back("runs", "NNACGTNNNACGTACGTNN");
+
+        const std::string codes = "ACGTRYSWKMBDHVN";
+        for (size_t length : {1, 2, 3, 5, 8, 9, 12, 20}) {
+            std::string pattern;
+            for (size_t j = 0; j < length; ++j) {
+                pattern += codes[rng.next() % 3 == 0 ? rng.next() % codes.size() : rng.next() % 4];
+            }
+            patterns.push_back(pattern);
+        }
+        patterns.push_back("AAAAAAAAAA");
+        patterns.push_back("ACGTACG");
+    }
+
+    // Occurrences over windows of A/C/G/T only
+    std::vector<size_t> referenceHits(const std::string& text, const std::string& pattern) const {
+        std::vector<size_t> hits;
+        for (size_t pos = 0; pos + pattern.size() <= text.size(); ++pos) {
+            const std::string_view window = std::string_view(text).substr(pos, pattern.size());
+            if (std::ranges::all_of(window, isNucleotide) &&
+                iupac_codes->matchesMotif(text, pattern, pos)) {
+                hits.push_back(pos);
+            }
+        }
+        return hits;
+    }
+
+    IUPACCodes* iupac_codes;
+    std::vector<ChIPSequence> sequences;
+    std::vector<std::string> patterns;
+    TestRandom rng{31};
+};
+
+TEST_F(FmIndexTest, CountsMatchScan) {
+    SequenceStore store(sequences);
+    const FmIndex index = FmIndex::build(store);
+    EXPECT_EQ(index.sequenceCount(), sequences.size());
+    EXPECT_FALSE(index.isMapped());
+
+    for (const auto& pattern : patterns) {
+        const std::string reverse = iupac_codes->reverseComplement(pattern);
+        size_t occurrences = 0;
+        size_t forward_sequences = 0;
+        size_t both_sequences = 0;
+        for (const auto& sequence : sequences) {
+            const size_t forward = referenceHits(sequence.sequence, pattern).size();
+            const size_t backward = referenceHits(sequence.sequence, reverse).size();
+            occurrences += forward;
+            forward_sequences += forward > 0;
+            both_sequences += forward + backward > 0;
+        }
+        EXPECT_EQ(index.countOccurrences(pattern, *iupac_codes), occurrences) << pattern;
+        EXPECT_EQ(index.countSequences(pattern, *iupac_codes), forward_sequences) << pattern;
+        EXPECT_EQ(index.countSequences(pattern, *iupac_codes, true), both_sequences) << pattern;
+    }
+
+    EXPECT_EQ(index.countOccurrences("A", *iupac_codes) + index.countOccurrences("C", *iupac_codes) +
+                  index.countOccurrences("G", *iupac_codes) + index.countOccurrences("T", *iupac_codes),
+              index.countOccurrences("N", *iupac_codes));
+    EXPECT_EQ(index.countOccurrences("AXA", *iupac_codes), 0);
+    EXPECT_EQ(index.countOccurrences("", *iupac_codes), 0);
+    // No occurrence spans a non-nucleotide or a sequence end
+    EXPECT_EQ(index.countOccurrences("ACGTNNNACGT", *iupac_codes), 0);
+    EXPECT_EQ(index.countOccurrences(std::string(301, 'A'), *iupac_codes), 0);
+    EXPECT_EQ(index.countOccurrences(std::string(300, 'A'), *iupac_codes), 2);
+}
+
+TEST_F(FmIndexTest, EmptyStore) {
+    const std::vector<ChIPSequence> none;
+    SequenceStore store(none);
+    const FmIndex index = FmIndex::build(store);
+    EXPECT_EQ(index.length(), 0);
+    EXPECT_EQ(index.countOccurrences("ACGT", *iupac_codes), 0);
+    EXPECT_EQ(index.countSequences("ACGT", *iupac_codes, true), 0);
+}
+
+TEST_F(FmIndexTest, SaveAndMap) {
+    SequenceStore store(sequences);
+    const FmIndex index = FmIndex::build(store);
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "fm_index_test.idx").string();
+    index.save(path);
+
+    {
+        const FmIndex mapped = FmIndex::load(path);
+        EXPECT_TRUE(mapped.isMapped());
+        EXPECT_TRUE(mapped.matches(store));
+        EXPECT_EQ(mapped.length(), index.length());
+        for (const auto& pattern : patterns) {
+            EXPECT_EQ(mapped.countOccurrences(pattern, *iupac_codes),
+                      index.countOccurrences(pattern, *iupac_codes)) << pattern;
+            EXPECT_EQ(mapped.countSequences(pattern, *iupac_codes, true),
+                      index.countSequences(pattern, *iupac_codes, true)) << pattern;
+        }
+
+        std::vector<ChIPSequence> changed = sequences;
+        changed.pop_back();
+        SequenceStore changed_store(changed);
+        EXPECT_FALSE(mapped.matches(changed_store));
+    }
+
+    // Headers and bodies that would search out of bounds are rejected at load
+    std::ifstream file(path, std::ios::binary);
+    const std::string original((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    const size_t length_at = FmIndex::FILE_MAGIC.size() + sizeof(uint64_t);
+    const size_t sequence_count_at = length_at + sizeof(uint64_t);
+    const size_t first_rows_at = sequence_count_at + 2 * sizeof(uint64_t);
+    const size_t body_words_at = first_rows_at + 5 * sizeof(uint64_t);
+    const size_t blocks_at = body_words_at + sizeof(uint64_t);
+    const size_t documents_at = blocks_at + (index.length() / FmIndex::BLOCK_ROWS + 1) * 6 * sizeof(uint64_t);
+    ASSERT_GT(index.length(), FmIndex::BLOCK_ROWS);
+    const auto expectCorrupt = [&](size_t at, char value) {
+        std::string bytes = original;
+        bytes[at] = value;
+        std::ofstream(path, std::ios::binary) << bytes;
+        EXPECT_THROW((void)FmIndex::load(path), std::runtime_error) << at;
+    };
+    // Text lengths and body sizes whose arithmetic would overflow
+    expectCorrupt(length_at + 7, 0x7F);
+    expectCorrupt(body_words_at + 7, 0x7F);
+    // Sequence ids beyond the sequence count
+    expectCorrupt(sequence_count_at, 1);
+    expectCorrupt(documents_at + 3, 0x7F);
+    // Rows before a symbol that disagree with the occurrence counts
+    expectCorrupt(first_rows_at + 2 * sizeof(uint64_t), static_cast<char>(original[first_rows_at + 2 * sizeof(uint64_t)] + 1));
+    // Cumulative counts of the second block, and occurrence bits of the
+    // first that disagree with them
+    expectCorrupt(blocks_at + 10 * sizeof(uint64_t), static_cast<char>(original[blocks_at + 10 * sizeof(uint64_t)] + 1));
+    expectCorrupt(blocks_at, static_cast<char>(~original[blocks_at]));
+    std::ofstream(path, std::ios::binary) << original;
+    EXPECT_NO_THROW((void)FmIndex::load(path));
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+    EXPECT_THROW((void)FmIndex::load(path), std::runtime_error);
+    std::filesystem::remove(path);
+    EXPECT_THROW((void)FmIndex::load(path), std::runtime_error);
+}
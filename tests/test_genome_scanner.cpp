@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "genome_scanner.h"
+#include "test_utils.h"
+#include <sstream>
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class GenomeScannerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+
+        TestRandom rng(2024);
+        for (int i = 0; i < 20000; ++i) {
+            // Occasional runs of N, as in assembly gaps
+            genome += rng.next() % 500 == 0 ? 'N' : "ACGT"[rng.next() % 4];
+        }
+
+        motifs = {
+            Motif("TGTTTAC", 0.0, 0.0, 0.0),
+            Motif("ATGCATGC", 0.0, 0.0, 0.0),
+            Motif("RYAAAYA", 0.0, 0.0, 0.0),
+            Motif("NNGCNN", 0.0, 0.0, 0.0)
+        };
+    }
+
+    // Brute-force per-bin counts of every occurrence
+    std::vector<std::vector<uint32_t>> referenceBins(std::string_view sequence, size_t bin_size,
+                                                     bool both_strands) const {
+        std::vector<std::vector<uint32_t>> bins((sequence.size() + bin_size - 1) / bin_size,
+                                                std::vector<uint32_t>(motifs.size(), 0));
+        for (size_t m = 0; m < motifs.size(); ++m) {
+            const std::string reverse = iupac_codes->reverseComplement(motifs[m].pattern);
+            for (size_t pos = 0; pos + motifs[m].pattern.size() <= sequence.size(); ++pos) {
+                if (iupac_codes->matchesMotif(sequence, motifs[m].pattern, pos) ||
+                    (both_strands && iupac_codes->matchesMotif(sequence, reverse, pos))) {
+                    bins[pos / bin_size][m]++;
+                }
+            }
+        }
+        return bins;
+    }
+
+    IUPACCodes* iupac_codes;
+    std::string genome;
+    std::vector<Motif> motifs;
+};
+
+TEST_F(GenomeScannerTest, RejectsInvalidOptions) {
+    EXPECT_THROW(GenomeScanner(*iupac_codes, std::span<const Motif>()), std::invalid_argument);
+
+    GenomeScanOptions options;
+    options.bin_size = 0;
+    EXPECT_THROW(GenomeScanner(*iupac_codes, motifs, options), std::invalid_argument);
+
+    std::vector<Motif> invalid = {Motif("ATGXATGC", 0.0, 0.0, 0.0)};
+    EXPECT_THROW(GenomeScanner(*iupac_codes, invalid), std::invalid_argument);
+}
+
+TEST_F(GenomeScannerTest, BinsMatchReferenceAcrossBlocks) {
+    for (bool both_strands : {false, true}) {
+        GenomeScanOptions options;
+        options.bin_size = 100;
+        options.block_size = 250;  // rounded up to 300, many chunk boundaries
+        options.both_strands = both_strands;
+        GenomeScanner scanner(*iupac_codes, motifs, options);
+        EXPECT_EQ(scanner.blockSize(), 300);
+        EXPECT_EQ(scanner.overlap(), 7);
+
+        const auto expected = referenceBins(genome, options.bin_size, both_strands);
+
+        size_t index = 0;
+        scanner.scanRecord("chrT", genome, [&](const GenomeBin &bin) {
+            ASSERT_LT(index, expected.size());
+            EXPECT_EQ(bin.record_id, "chrT");
+            EXPECT_EQ(bin.start, index * 100);
+            EXPECT_EQ(bin.end, std::min(genome.size(), (index + 1) * 100));
+            EXPECT_EQ(std::vector<uint32_t>(bin.counts.begin(), bin.counts.end()), expected[index])
+                << "bin " << index;
+            ++index;
+        });
+        EXPECT_EQ(index, expected.size());
+    }
+}
+
+TEST_F(GenomeScannerTest, StreamMatchesInMemoryRecords) {
+    GenomeScanOptions options;
+    options.bin_size = 64;
+    options.block_size = 128;
+    GenomeScanner scanner(*iupac_codes, motifs, options);
+
+    // Two records with wrapped lines, the second with a partial last bin
+    const std::string first = genome.substr(0, 12000);
+    const std::string second = genome.substr(12000, 5003);
+    std::ostringstream fasta;
+    fasta << ">chr1 first record\n";
+    for (size_t i = 0; i < first.size(); i += 60) {
+        fasta << first.substr(i, 60) << "\n";
+    }
+    fasta << ">chr2\n";
+    for (size_t i = 0; i < second.size(); i += 70) {
+        fasta << second.substr(i, 70) << "\r\n";
+    }
+
+    std::vector<std::tuple<std::string, size_t, size_t, std::vector<uint32_t>>> expected;
+    auto collect = [](auto &out) {
+        return [&out](const GenomeBin &bin) {
+            out.emplace_back(std::string(bin.record_id), bin.start, bin.end,
+                             std::vector<uint32_t>(bin.counts.begin(), bin.counts.end()));
+        };
+    };
+    scanner.scanRecord("chr1", first, collect(expected));
+    scanner.scanRecord("chr2", second, collect(expected));
+
+    std::vector<std::tuple<std::string, size_t, size_t, std::vector<uint32_t>>> streamed;
+    std::istringstream input(fasta.str());
+    scanner.scan(input, collect(streamed));
+
+    EXPECT_EQ(streamed.size(), (12000 + 63) / 64 + (5003 + 63) / 64);
+    EXPECT_EQ(streamed, expected);
+    EXPECT_EQ(std::get<2>(streamed.back()), 5003);
+}
+
+TEST_F(GenomeScannerTest, SingleLineRecordsStream) {
+    GenomeScanOptions options;
+    options.bin_size = 1000;
+    options.block_size = 4000;
+    GenomeScanner scanner(*iupac_codes, motifs, options);
+
+    // An unwrapped record several read sizes long, then one without a
+    // final newline
+    const std::string long_record = genome + genome + genome + genome + genome;
+    const std::string short_record = genome.substr(0, 777);
+    const std::string fasta = ">chrL unwrapped\n" + long_record + "\n>chrS\n" + short_record;
+
+    using Bins = std::vector<std::tuple<std::string, size_t, size_t, std::vector<uint32_t>>>;
+    auto collect = [](Bins &out) {
+        return [&out](const GenomeBin &bin) {
+            out.emplace_back(std::string(bin.record_id), bin.start, bin.end,
+                             std::vector<uint32_t>(bin.counts.begin(), bin.counts.end()));
+        };
+    };
+    Bins expected;
+    scanner.scanRecord("chrL", long_record, collect(expected));
+    scanner.scanRecord("chrS", short_record, collect(expected));
+
+    Bins streamed;
+    std::istringstream input(fasta);
+    scanner.scan(input, collect(streamed));
+    EXPECT_EQ(streamed.size(), 100 + 1);
+    EXPECT_EQ(streamed, expected);
+}
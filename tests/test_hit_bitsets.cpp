@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "hit_bitsets.h"
+#include "motif_finder.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class HitBitsetsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+    }
+
+    IUPACCodes* iupac_codes;
+    TestRandom rng{11};
+};
+
+TEST_F(HitBitsetsTest, SetTestAndCount) {
+    HitBitsets bitsets(3, 130);
+    EXPECT_EQ(bitsets.motifCount(), 3);
+    EXPECT_EQ(bitsets.sequenceCount(), 130);
+    EXPECT_EQ(bitsets.wordCount(), 3);
+
+    bitsets.set(1, 0);
+    bitsets.set(1, 64);
+    bitsets.set(1, 129);
+    bitsets.set(2, 5);
+
+    EXPECT_TRUE(bitsets.test(1, 64));
+    EXPECT_FALSE(bitsets.test(0, 64));
+    EXPECT_EQ(bitsets.count(0), 0);
+    EXPECT_EQ(bitsets.count(1), 3);
+    EXPECT_EQ(bitsets.count(2), 1);
+    EXPECT_EQ(bitsets.row(1)[2], 1ull << 1);
+
+    EXPECT_EQ(bitsets.count(1, 0, 130), 3);
+    EXPECT_EQ(bitsets.count(1, 1, 129), 1);
+    EXPECT_EQ(bitsets.count(1, 64, 65), 1);
+    EXPECT_EQ(bitsets.count(1, 65, 65), 0);
+    EXPECT_EQ(bitsets.count(1, 0, 64), 1);
+    EXPECT_EQ(bitsets.count(2, 5, 6), 1);
+}
+
+TEST_F(HitBitsetsTest, FromResults) {
+    std::vector<MotifResult> results(2);
+    results[0].matches.emplace_back(3, 0, "ACGT");
+    results[0].matches.emplace_back(7, 2, "ACGT");
+    results[1].matches.emplace_back(7, 1, "ACGT");
+
+    const HitBitsets bitsets = HitBitsets::fromResults(results, 10);
+    EXPECT_EQ(bitsets.motifCount(), 2);
+    EXPECT_TRUE(bitsets.test(0, 3));
+    EXPECT_TRUE(bitsets.test(0, 7));
+    EXPECT_TRUE(bitsets.test(1, 7));
+    EXPECT_EQ(bitsets.count(0), 2);
+    EXPECT_EQ(bitsets.count(1), 1);
+}
+
+TEST_F(HitBitsetsTest, CooccurrenceMatchesPairwiseCount) {
+    // Several tiles of motifs and several word slices of sequences
+    const size_t motifs = 2 * HitBitsets::TILE_MOTIFS + 5;
+    const size_t sequences = 64 * HitBitsets::TILE_WORDS * 2 + 37;
+    HitBitsets bitsets(motifs, sequences);
+    for (size_t m = 0; m < motifs; ++m) {
+        const size_t density = 1 + m % 7;
+        for (size_t s = 0; s < sequences; ++s) {
+            if (rng.next() % 8 < density) {
+                bitsets.set(m, s);
+            }
+        }
+    }
+
+    const CooccurrenceMatrix matrix = bitsets.cooccurrence();
+    ASSERT_EQ(matrix.motif_count, motifs);
+    for (size_t a = 0; a < motifs; ++a) {
+        EXPECT_EQ(matrix.at(a, a), bitsets.count(a));
+        for (size_t b = 0; b < motifs; ++b) {
+            uint64_t both = 0;
+            for (size_t s = 0; s < sequences; ++s) {
+                both += bitsets.test(a, s) && bitsets.test(b, s);
+            }
+            ASSERT_EQ(matrix.at(a, b), both) << a << " " << b;
+        }
+    }
+
+    EXPECT_TRUE(HitBitsets().cooccurrence().counts.empty());
+}
+
+TEST_F(HitBitsetsTest, MotifFinderKeepsBitsets) {
+    std::vector<ChIPSequence> sequences;
+    addRandomSequences(sequences, rng, 200, 40, "ACGT", "s");
+    std::vector<Motif> motifs = {
+        Motif("ACGTNN", 0.0, 0.0, 0.0), Motif("NNACGT", 0.0, 0.0, 0.0),
+        Motif("TRTTKAC", 0.0, 0.0, 0.0)};
+
+    MotifFinder finder(*iupac_codes);
+    SequenceStore store(sequences);
+    finder.prepareStore(store);
+
+    auto results = finder.findMotifs(store, motifs);
+    EXPECT_EQ(finder.getHitBitsets().motifCount(), 0);
+
+    ScanOptions options;
+    options.keep_hit_bitsets = true;
+    finder.setScanOptions(options);
+    results = finder.findMotifs(store, motifs);
+
+    const HitBitsets& bitsets = finder.getHitBitsets();
+    ASSERT_EQ(bitsets.motifCount(), motifs.size());
+    ASSERT_EQ(bitsets.sequenceCount(), sequences.size());
+    for (size_t m = 0; m < motifs.size(); ++m) {
+        EXPECT_EQ(bitsets.count(m), results[m].match_count);
+        for (const auto& match : results[m].matches) {
+            EXPECT_TRUE(bitsets.test(m, match.sequence_index));
+        }
+    }
+}
@@ -147,3 +147,33 @@ TEST_F(IUPACCodesTest, GetNucleotides) {
     auto invalid_nucs = iupac_codes->getNucleotides('X');
     EXPECT_EQ(invalid_nucs.size(), 0);
 }
+
+TEST_F(IUPACCodesTest, ReverseComplement) {
+    EXPECT_EQ(iupac_codes->getComplement('A'), 'T');
+    EXPECT_EQ(iupac_codes->getComplement('c'), 'G');
+    EXPECT_EQ(iupac_codes->getComplement('R'), 'Y');
+    EXPECT_EQ(iupac_codes->getComplement('K'), 'M');
+    EXPECT_EQ(iupac_codes->getComplement('B'), 'V');
+    EXPECT_EQ(iupac_codes->getComplement('D'), 'H');
+    EXPECT_EQ(iupac_codes->getComplement('S'), 'S');
+    EXPECT_EQ(iupac_codes->getComplement('N'), 'N');
+    EXPECT_EQ(iupac_codes->getComplement('X'), 'X');
+
+    EXPECT_EQ(iupac_codes->reverseComplement("TGTTTAC"), "GTAAACA");
+    EXPECT_EQ(iupac_codes->reverseComplement("ARYKNB"), "VNMRYT");
+
+    // The reverse complement matches the opposite strand of every hit
+    std::string sequence = "CCTGTTTACCC";
+    std::string opposite = "GGGTAAACAGG";
+    EXPECT_TRUE(iupac_codes->matchesMotif(sequence, "TGTTTAC", 2));
+    EXPECT_TRUE(iupac_codes->matchesMotif(opposite, iupac_codes->reverseComplement("TGTTTAC"), 2));
+}
+
+TEST_F(IUPACCodesTest, CountMismatches) {
+    std::string sequence = "ATGCATGC";
+    EXPECT_EQ(iupac_codes->countMismatches(sequence, "ATGC", 0), 0);
+    EXPECT_EQ(iupac_codes->countMismatches(sequence, "ATGG", 0), 1);
+    EXPECT_EQ(iupac_codes->countMismatches(sequence, "RRGN", 4), 1);
+    EXPECT_EQ(iupac_codes->countMismatches(sequence, "TTTT", 0), 3);
+    EXPECT_EQ(iupac_codes->countMismatches(sequence, "ATGC", 6), 4);
+}
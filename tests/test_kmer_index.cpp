@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "kmer_index.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class KmerIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+
+        // A skewed alphabet makes A-rich codes dense and others sparse
+        for (int i = 0; i < 3000; ++i) {
+            const int length = 20 + (i % 5) * 10;
+            std::string seq = randomSequence(rng, length, "AAAAAACGT");
+            if (i % 11 == 0) {
+                seq[seq.size() / 2] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+    }
+
+    static std::string decode(uint16_t code) {
+        std::string kmer(WINDOW_CODE_LENGTH, 'A');
+        for (size_t p = 0; p < WINDOW_CODE_LENGTH; ++p) {
+            kmer[WINDOW_CODE_LENGTH - 1 - p] = "ACTG"[(code >> (2 * p)) & 3];
+        }
+        return kmer;
+    }
+
+    size_t scanCount(const std::string& pattern, bool both_strands) const {
+        const std::string reverse = iupac_codes->reverseComplement(pattern);
+        size_t count = 0;
+        for (const auto& sequence : sequences) {
+            for (size_t pos = 0; pos < sequence.sequence.size(); ++pos) {
+                if (iupac_codes->matchesMotif(sequence.sequence, pattern, pos) ||
+                    (both_strands && iupac_codes->matchesMotif(sequence.sequence, reverse, pos))) {
+                    ++count;
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+    IUPACCodes* iupac_codes;
+    std::vector<ChIPSequence> sequences;
+    TestRandom rng{29};
+};
+
+TEST_F(KmerIndexTest, PostingsMatchBruteForce) {
+    SequenceStore store(sequences);
+    const KmerIndex index = KmerIndex::build(store);
+    ASSERT_EQ(index.sequenceCount(), sequences.size());
+
+    size_t dense = 0;
+    size_t sparse = 0;
+    for (const uint16_t code : std::vector<uint16_t>{0, 1, 2, 5, 64, 300, 4097, 65535}) {
+        const std::string kmer = decode(code);
+        std::vector<uint32_t> expected;
+        for (size_t s = 0; s < sequences.size(); ++s) {
+            if (sequences[s].sequence.find(kmer) != std::string::npos) {
+                expected.push_back(static_cast<uint32_t>(s));
+            }
+        }
+        EXPECT_EQ(index.posting(code), expected) << kmer;
+        EXPECT_EQ(index.postingSize(code), expected.size()) << kmer;
+        (index.isDense(code) ? dense : sparse)++;
+    }
+    EXPECT_GT(dense, 0);
+    EXPECT_GT(sparse, 0);
+    EXPECT_TRUE(index.isDense(0));
+}
+
+TEST_F(KmerIndexTest, LookupMatchesScan) {
+    SequenceStore store(sequences);
+    const KmerIndex index = KmerIndex::build(store);
+
+    for (const std::string pattern : {"AAAAAAAA", "ACGTAAAA", "AARAAAWN", "CCNNNNGG", "TTTTTTTT"}) {
+        auto table = KmerTable::compile(pattern, *iupac_codes);
+        ASSERT_TRUE(table.has_value()) << pattern;
+        EXPECT_EQ(index.count(*table), scanCount(pattern, false)) << pattern;
+
+        table->merge(*KmerTable::compile(iupac_codes->reverseComplement(pattern), *iupac_codes));
+        EXPECT_EQ(index.count(*table), scanCount(pattern, true)) << pattern;
+    }
+
+    // Sparse-only and mixed code sets leave the scratch bitset zeroed
+    std::vector<uint64_t> scratch((sequences.size() + 63) / 64, 0);
+    for (const auto& codes : {std::vector<uint16_t>{4097, 65535, 300}, std::vector<uint16_t>{0, 4097}}) {
+        std::vector<uint32_t> ids;
+        for (const uint16_t code : codes) {
+            const auto posting = index.posting(code);
+            ids.insert(ids.end(), posting.begin(), posting.end());
+        }
+        std::ranges::sort(ids);
+        const auto expected = static_cast<size_t>(std::ranges::unique(ids).begin() - ids.begin());
+        EXPECT_EQ(index.countUnion(codes, scratch), expected);
+        EXPECT_TRUE(std::ranges::all_of(scratch, [](uint64_t word) { return word == 0; }));
+    }
+
+    // Windows spanning the N are not indexed
+    const std::vector<ChIPSequence> dirty = {ChIPSequence("d", "AAAANAAAAAAAA")};
+    SequenceStore dirty_store(dirty);
+    const KmerIndex dirty_index = KmerIndex::build(dirty_store);
+    EXPECT_EQ(dirty_index.postingSize(0), 1);
+    EXPECT_EQ(dirty_index.count(*KmerTable::compile("AAAANAAA", *iupac_codes)), 1);
+    EXPECT_EQ(dirty_index.count(*KmerTable::compile("AAAAAAAC", *iupac_codes)), 0);
+}
+
+TEST_F(KmerIndexTest, SaveAndLoad) {
+    SequenceStore store(sequences);
+    const KmerIndex index = KmerIndex::build(store);
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "kmer_index_test.idx").string();
+    index.save(path);
+
+    const KmerIndex loaded = KmerIndex::load(path);
+    EXPECT_TRUE(loaded.matches(store));
+    EXPECT_EQ(loaded.encodedBytes(), index.encodedBytes());
+    for (const uint16_t code : std::vector<uint16_t>{0, 7, 1000, 65535}) {
+        EXPECT_EQ(loaded.posting(code), index.posting(code));
+    }
+    const auto table = KmerTable::compile("ANNNNNNT", *iupac_codes);
+    EXPECT_EQ(loaded.count(*table), index.count(*table));
+
+    // Another dataset is detected by its fingerprint
+    std::vector<ChIPSequence> changed = sequences;
+    changed[17].sequence[3] = changed[17].sequence[3] == 'A' ? 'C' : 'A';
+    SequenceStore changed_store(changed);
+    EXPECT_FALSE(loaded.matches(changed_store));
+
+    // Containers that would index out of bounds are rejected at load
+    std::ifstream file(path, std::ios::binary);
+    const std::string original((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    const size_t counts_at = KmerIndex::FILE_MAGIC.size() + 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+    const size_t dense_at = counts_at + WINDOW_CODE_SPACE * sizeof(uint32_t);
+    const size_t offsets_at = dense_at + WINDOW_CODE_SPACE;
+    const size_t data_at = offsets_at + (WINDOW_CODE_SPACE + 1) * sizeof(uint64_t);
+    size_t sparse = 0;
+    while (index.isDense(static_cast<uint16_t>(sparse)) || index.posting(static_cast<uint16_t>(sparse)).empty()) {
+        ++sparse;
+    }
+    uint64_t sparse_end = 0;
+    std::memcpy(&sparse_end, original.data() + offsets_at + (sparse + 1) * sizeof(uint64_t), sizeof(sparse_end));
+    const auto expectCorrupt = [&](size_t at, char value) {
+        std::string bytes = original;
+        bytes[at] = value;
+        std::ofstream(path, std::ios::binary) << bytes;
+        EXPECT_THROW((void)KmerIndex::load(path), std::runtime_error) << at;
+    };
+    // A sparse container read as a bitset of the wrong size
+    expectCorrupt(dense_at + sparse, 1);
+    // The last varint of a container continuing past its end
+    expectCorrupt(data_at + sparse_end - 1, static_cast<char>(original[data_at + sparse_end - 1] | 0x80));
+    // Ids beyond the sequence count
+    expectCorrupt(counts_at - 3 * sizeof(uint64_t), 10);
+    std::ofstream(path, std::ios::binary) << original;
+    EXPECT_NO_THROW((void)KmerIndex::load(path));
+
+    // Truncated files are rejected
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    EXPECT_THROW((void)KmerIndex::load(path), std::runtime_error);
+    std::filesystem::remove(path);
+    EXPECT_THROW((void)KmerIndex::load(path), std::runtime_error);
+}
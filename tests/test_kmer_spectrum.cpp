@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include "kmer_spectrum.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class KmerSpectrumTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (int i = 0; i < 500; ++i) {
+            const int length = static_cast<int>(rng.next() % 60);
+            std::string seq = randomSequence(rng, length, "AACGTacgt");
+            if (i % 7 == 0 && !seq.empty()) {
+                seq[seq.size() / 3] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+        sequences.emplace_back("repeat", std::string(100, 'A'));
+    }
+
+    std::vector<ChIPSequence> sequences;
+    TestRandom rng{37};
+};
+
+TEST_F(KmerSpectrumTest, MatchesBruteForce) {
+    std::map<std::string, std::pair<uint64_t, uint64_t>> expected;
+    uint64_t windows = 0;
+    for (const auto& sequence : sequences) {
+        std::string upper = sequence.sequence;
+        std::ranges::transform(upper, upper.begin(), [](char c) { return static_cast<char>(std::toupper(c)); });
+        std::set<std::string> seen;
+        for (size_t pos = 0; pos + WINDOW_CODE_LENGTH <= upper.size(); ++pos) {
+            const std::string kmer = upper.substr(pos, WINDOW_CODE_LENGTH);
+            if (std::ranges::all_of(kmer, isNucleotide)) {
+                expected[kmer].first++;
+                expected[kmer].second += seen.insert(kmer).second;
+                ++windows;
+            }
+        }
+    }
+
+    SequenceStore store(sequences);
+    const KmerSpectrum rolled = KmerSpectrum::count(store);
+    store.buildWindowCodes();
+    const KmerSpectrum coded = KmerSpectrum::count(store);
+    EXPECT_EQ(rolled, coded);
+    EXPECT_EQ(coded.sequence_count, sequences.size());
+    EXPECT_EQ(coded.windowCount(), windows);
+
+    for (size_t code = 0; code < WINDOW_CODE_SPACE; ++code) {
+        const auto it = expected.find(decodeWindowCode(code));
+        const auto counts = it == expected.end() ? std::pair<uint64_t, uint64_t>{} : it->second;
+        ASSERT_EQ(coded.occurrences()[code], counts.first) << decodeWindowCode(code);
+        ASSERT_EQ(coded.sequences()[code], counts.second) << decodeWindowCode(code);
+    }
+    EXPECT_EQ(coded.occurrences()[0], expected["AAAAAAAA"].first);
+    EXPECT_GE(coded.occurrences()[0], 93);
+}
+
+TEST_F(KmerSpectrumTest, IndependentOfThreadCount) {
+    SequenceStore store(sequences);
+    store.buildWindowCodes();
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    const KmerSpectrum single = KmerSpectrum::count(store);
+    omp_set_num_threads(7);
+    const KmerSpectrum many = KmerSpectrum::count(store);
+    omp_set_num_threads(threads);
+    EXPECT_EQ(single, many);
+
+    const std::vector<ChIPSequence> none;
+    SequenceStore empty(none);
+    const KmerSpectrum nothing = KmerSpectrum::count(empty);
+    EXPECT_EQ(nothing.windowCount(), 0);
+    EXPECT_EQ(nothing.sequence_count, 0);
+}
+
+TEST_F(KmerSpectrumTest, PartsSumToWholeStore) {
+    SequenceStore store(sequences);
+    const KmerSpectrum whole = KmerSpectrum::count(store);
+    KmerSpectrum summed;
+    for (size_t part = 0; part < 3; ++part) {
+        const KmerSpectrum counted = KmerSpectrum::count(store, part, 3);
+        for (size_t i = 0; i < summed.counts.size(); ++i) {
+            summed.counts[i] += counted.counts[i];
+        }
+        summed.sequence_count += counted.sequence_count;
+    }
+    EXPECT_EQ(summed, whole);
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <map>
+#include "iupac_codes.h"
+#include "markov_background.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MarkovBackgroundTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // CA-rich sequences with a bias towards repeating the previous base
+        for (int i = 0; i < 120; ++i) {
+            std::string seq;
+            const int length = i % 40 == 0 ? 90 : 20 + static_cast<int>(rng.next() % 25);
+            for (int j = 0; j < length; ++j) {
+                seq += !seq.empty() && rng.next() % 3 == 0 ? seq.back() : "CCAAAGTTCA"[rng.next() % 10];
+            }
+            if (i % 9 == 0) {
+                seq[static_cast<size_t>(rng.next() % 15)] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+    }
+
+    // Probability of a string under the model: context, then transitions
+    static double stringProbability(const MarkovBackground& model, const std::vector<uint8_t>& codes) {
+        const size_t order = model.order();
+        size_t context = 0;
+        for (size_t i = 0; i < order; ++i) {
+            context = context * 4 + codes[i];
+        }
+        double probability = model.contextProbability(context);
+        for (size_t i = order; i < codes.size(); ++i) {
+            probability *= model.transition(context, codes[i]);
+            context = order == 0 ? 0 : (context * 4 + codes[i]) % (1u << (2 * order));
+        }
+        return probability;
+    }
+
+    static bool windowMatches(const std::string& text, size_t pos, const std::string& pattern, const std::string& reverse,
+                              bool both_strands) {
+        const IUPACCodes& iupac = IUPACCodes::getInstance();
+        bool forward = true;
+        bool backward = both_strands;
+        for (size_t p = 0; p < pattern.size(); ++p) {
+            forward &= iupac.matches(text[pos + p], pattern[p]);
+            backward &= iupac.matches(text[pos + p], reverse[p]);
+        }
+        return forward || backward;
+    }
+
+    // Sum over every string of the given length after the context bases
+    template <typename Accept>
+    static double enumerate(const MarkovBackground& model, size_t length, Accept accept) {
+        double total = 0.0;
+        std::vector<uint8_t> codes(length);
+        std::string text(length, 'A');
+        for (size_t index = 0; index < (1uz << (2 * length)); ++index) {
+            for (size_t i = 0; i < length; ++i) {
+                codes[i] = (index >> (2 * i)) & 3;
+                text[i] = "ACTG"[codes[i]];
+            }
+            if (accept(text)) {
+                total += stringProbability(model, codes);
+            }
+        }
+        return total;
+    }
+
+    std::vector<ChIPSequence> sequences;
+    TestRandom rng{17};
+};
+
+TEST_F(MarkovBackgroundTest, FitsWordCounts) {
+    const SequenceStore store(sequences);
+    for (size_t order = 0; order <= MarkovBackground::MAX_ORDER; ++order) {
+        const MarkovBackground model(store, order);
+        EXPECT_EQ(model.sequenceCount(), sequences.size());
+
+        std::map<std::string, double> words;
+        double total = 0.0;
+        for (const auto& sequence : sequences) {
+            const std::string& text = sequence.sequence;
+            for (size_t i = 0; i + order < text.size(); ++i) {
+                const std::string word = text.substr(i, order + 1);
+                if (word.find('N') == std::string::npos) {
+                    words[word] += 1.0;
+                    total += 1.0;
+                }
+            }
+        }
+
+        const size_t contexts = 1uz << (2 * order);
+        double initial = 0.0;
+        for (size_t context = 0; context < contexts; ++context) {
+            std::string prefix;
+            for (size_t j = 0; j < order; ++j) {
+                prefix += "ACTG"[(context >> (2 * (order - 1 - j))) & 3];
+            }
+            double row = 0.0;
+            for (const char base : std::string("ACTG")) {
+                row += words[prefix + base];
+            }
+            EXPECT_NEAR(model.contextProbability(context), (row + 4.0) / (total + 4.0 * static_cast<double>(contexts)), 1e-12);
+            initial += model.contextProbability(context);
+            for (uint8_t base = 0; base < 4; ++base) {
+                EXPECT_NEAR(model.transition(context, base), (words[prefix + "ACTG"[base]] + 1.0) / (row + 4.0), 1e-12)
+                    << order << " " << prefix << base;
+            }
+        }
+        EXPECT_NEAR(initial, 1.0, 1e-12);
+    }
+    EXPECT_THROW(MarkovBackground(store, 4), std::invalid_argument);
+}
+
+TEST_F(MarkovBackgroundTest, WindowProbabilityMatchesEnumeration) {
+    const SequenceStore store(sequences);
+    for (size_t order = 0; order <= MarkovBackground::MAX_ORDER; ++order) {
+        const MarkovBackground model(store, order);
+        for (const std::string pattern : {"TGAS", "NNA", "AWT", "RYN", "C"}) {
+            const std::string reverse = IUPACCodes::getInstance().reverseComplement(pattern);
+            for (const bool both_strands : {false, true}) {
+                const auto probability = model.windowProbability(pattern, both_strands);
+                ASSERT_TRUE(probability.has_value());
+                const double expected = enumerate(model, order + pattern.size(), [&](const std::string& text) {
+                    return windowMatches(text, order, pattern, reverse, both_strands);
+                });
+                EXPECT_NEAR(*probability, expected, 1e-12) << order << " " << pattern << " " << both_strands;
+            }
+        }
+    }
+}
+
+TEST_F(MarkovBackgroundTest, PresenceMatchesEnumeration) {
+    const SequenceStore store(sequences);
+    for (size_t order = 0; order <= MarkovBackground::MAX_ORDER; ++order) {
+        const MarkovBackground model(store, order);
+        // Self-overlapping, palindromic and single-base motifs
+        for (const std::string pattern : {"AWA", "TT", "ACGTN", "G", "CAMCA"}) {
+            const std::string reverse = IUPACCodes::getInstance().reverseComplement(pattern);
+            for (const bool both_strands : {false, true}) {
+                for (const size_t length : {0uz, 2uz, 4uz, 6uz}) {
+                    const auto presence = model.presenceProbability(pattern, length, both_strands);
+                    ASSERT_TRUE(presence.has_value());
+                    const double expected = enumerate(model, std::max(length, order), [&](const std::string& text) {
+                        for (size_t pos = 0; pos + pattern.size() <= length; ++pos) {
+                            if (windowMatches(text, pos, pattern, reverse, both_strands)) {
+                                return true;
+                            }
+                        }
+                        return false;
+                    });
+                    EXPECT_NEAR(*presence, expected, 1e-12) << order << " " << pattern << " " << both_strands << " " << length;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(MarkovBackgroundTest, LongSpacersFallBackToIndependentWindows) {
+    const SequenceStore store(sequences);
+    // A spacer of k Ns has 2^k partial-match states; 40 would not fit in memory
+    const std::string pattern = "A" + std::string(40, 'N') + "C";
+    for (const size_t order : {0uz, 3uz}) {
+        const MarkovBackground model(store, order);
+        for (const bool both_strands : {false, true}) {
+            const double window = *model.windowProbability(pattern, both_strands);
+            for (const size_t length : {41uz, 42uz, 60uz, 2000uz}) {
+                const auto presence = model.presenceProbability(pattern, length, both_strands);
+                ASSERT_TRUE(presence.has_value());
+                const double windows = length >= pattern.size() ? static_cast<double>(length - pattern.size() + 1) : 0.0;
+                EXPECT_NEAR(*presence, 1.0 - std::pow(1.0 - window, windows), 1e-12) << order << " " << length;
+            }
+            const auto expected = model.expectedSequences(pattern, both_strands);
+            ASSERT_TRUE(expected.has_value());
+            EXPECT_GE(*expected, 0.0);
+            EXPECT_LE(*expected, static_cast<double>(sequences.size()));
+        }
+    }
+}
+
+TEST_F(MarkovBackgroundTest, ExpectedSumsOverSequenceLengths) {
+    sequences.emplace_back("long", std::string(1500, 'A'));
+    sequences.emplace_back("longer", std::string(2100, 'C'));
+    const SequenceStore store(sequences);
+    const MarkovBackground model(store, 2);
+    for (const std::string pattern : {"TGASTCA", "CAMCA", "GG"}) {
+        double expected = 0.0;
+        for (const auto& sequence : sequences) {
+            expected += *model.presenceProbability(pattern, sequence.sequence.size(), true);
+        }
+        // Long sequences are evaluated at their mean length
+        expected -= *model.presenceProbability(pattern, 1500, true) + *model.presenceProbability(pattern, 2100, true);
+        expected += 2.0 * *model.presenceProbability(pattern, 1800, true);
+        EXPECT_NEAR(*model.expectedSequences(pattern, true), expected, 1e-6 * expected) << pattern;
+    }
+
+    // Counts of one part, captured by its reduction, summed into the other
+    const size_t middle = 50;
+    const std::vector<ChIPSequence> head(sequences.begin(), sequences.begin() + middle);
+    const std::vector<ChIPSequence> tail(sequences.begin() + middle, sequences.end());
+    const SequenceStore head_store(head);
+    const SequenceStore tail_store(tail);
+    std::vector<uint64_t> tail_counts;
+    const MarkovBackground tail_model(tail_store, 2, [&](std::span<uint64_t> counts) {
+        tail_counts.assign(counts.begin(), counts.end());
+    });
+    const MarkovBackground joined(head_store, 2, [&](std::span<uint64_t> counts) {
+        ASSERT_EQ(counts.size(), tail_counts.size());
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += tail_counts[i];
+        }
+    });
+    EXPECT_EQ(joined.sequenceCount(), sequences.size());
+    for (size_t context = 0; context < 16; ++context) {
+        EXPECT_DOUBLE_EQ(joined.contextProbability(context), model.contextProbability(context));
+        for (uint8_t base = 0; base < 4; ++base) {
+            EXPECT_DOUBLE_EQ(joined.transition(context, base), model.transition(context, base));
+        }
+    }
+    EXPECT_DOUBLE_EQ(*joined.expectedSequences("CAMCA", false), *model.expectedSequences("CAMCA", false));
+}
+
+TEST_F(MarkovBackgroundTest, RejectsUnsupportedPatterns) {
+    const SequenceStore store(sequences);
+    const MarkovBackground model(store, 1);
+    EXPECT_FALSE(model.windowProbability("TG[2,4]CA", false).has_value());
+    EXPECT_FALSE(model.presenceProbability("TGXCA", 40, false).has_value());
+    EXPECT_FALSE(model.expectedSequences("", true).has_value());
+    EXPECT_NEAR(*model.windowProbability("N", true), 1.0, 1e-12);
+    EXPECT_NEAR(*model.presenceProbability("NNNN", 4, false), 1.0, 1e-12);
+    EXPECT_EQ(*model.presenceProbability("NNNN", 3, false), 0.0);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "dinucleotide_shuffle.h"
+#include "motif_bootstrap.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifBootstrapTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Motif m hits a sequence with probability (m * m + 1) / 64, from
+        // sparse to dense rows; more than one tile of words, with a partial
+        // last word
+        for (size_t m = 0; m < motifs; ++m) {
+            for (size_t s = 0; s < sequences; ++s) {
+                if (rng.next() % 64 <= m * m) {
+                    hits.emplace_back(m, s);
+                }
+            }
+        }
+    }
+
+    HitBitsets bitsets(size_t first, size_t last) const {
+        HitBitsets result(motifs, last - first);
+        for (const auto& [m, s] : hits) {
+            if (s >= first && s < last) {
+                result.set(m, s - first);
+            }
+        }
+        return result;
+    }
+
+    static constexpr size_t motifs = 7;
+    static constexpr size_t sequences = 4 * 64 * 64 + 37;
+    std::vector<std::pair<size_t, size_t>> hits;
+    TestRandom rng{41};
+};
+
+TEST_F(MotifBootstrapTest, PoissonWeights) {
+    EXPECT_EQ(poissonWeight(0), 0u);
+    EXPECT_EQ(poissonWeight(UINT32_MAX), 15u);
+
+    // Evenly spaced words follow the distribution up to rounding
+    constexpr size_t draws = 1u << 20;
+    std::array<size_t, 16> seen{};
+    double sum = 0.0;
+    double squares = 0.0;
+    for (size_t i = 0; i < draws; ++i) {
+        const uint32_t weight = poissonWeight(static_cast<uint32_t>(i << 12));
+        ++seen[weight];
+        sum += weight;
+        squares += static_cast<double>(weight) * weight;
+    }
+    double probability = std::exp(-1.0);
+    for (size_t k = 0; k < 6; ++k) {
+        EXPECT_NEAR(static_cast<double>(seen[k]) / draws, probability, 1e-5) << k;
+        probability /= static_cast<double>(k + 1);
+    }
+    const double mean = sum / draws;
+    EXPECT_NEAR(mean, 1.0, 1e-4);
+    EXPECT_NEAR(squares / draws - mean * mean, 1.0, 1e-3);
+}
+
+TEST_F(MotifBootstrapTest, MatchesDirectWeighting) {
+    const size_t replicates = 11;
+    const uint64_t seed = 5;
+    const uint64_t first_id = 1000;
+    const HitBitsets whole = bitsets(0, sequences);
+    const MotifBootstrap bootstrap = MotifBootstrap::count(whole, replicates, seed, first_id);
+    ASSERT_EQ(bootstrap.counts.size(), (replicates + 1) * (motifs + 1));
+
+    EXPECT_EQ(bootstrap.total(0), sequences);
+    for (size_t m = 0; m < motifs; ++m) {
+        EXPECT_EQ(bootstrap.weighted(0, m), whole.count(m));
+    }
+
+    for (size_t r = 0; r < replicates; ++r) {
+        const uint64_t key = mixBits(seed + mixBits(r));
+        std::vector<uint64_t> weights(sequences);
+        uint64_t total = 0;
+        for (size_t s = 0; s < sequences; ++s) {
+            weights[s] = poissonWeight(static_cast<uint32_t>(counterRandom(key, first_id + s) >> 32));
+            total += weights[s];
+        }
+        EXPECT_EQ(bootstrap.total(r + 1), total) << r;
+        for (size_t m = 0; m < motifs; ++m) {
+            uint64_t weighted = 0;
+            for (size_t s = 0; s < sequences; ++s) {
+                weighted += whole.test(m, s) ? weights[s] : 0;
+            }
+            EXPECT_EQ(bootstrap.weighted(r + 1, m), weighted) << r << " " << m;
+        }
+    }
+}
+
+TEST_F(MotifBootstrapTest, IndependentOfSplit) {
+    const size_t replicates = 20;
+    const MotifBootstrap expected = MotifBootstrap::count(bitsets(0, sequences), replicates, 3);
+
+    // Two "processes" holding parts of the sequences
+    const size_t middle = 5000;
+    MotifBootstrap joined = MotifBootstrap::count(bitsets(0, middle), replicates, 3, 0);
+    const MotifBootstrap tail = MotifBootstrap::count(bitsets(middle, sequences), replicates, 3, middle);
+    for (size_t i = 0; i < joined.counts.size(); ++i) {
+        joined.counts[i] += tail.counts[i];
+    }
+    EXPECT_EQ(joined, expected);
+    EXPECT_NE(expected.total(1), expected.total(2));
+
+    const MotifBootstrap empty = MotifBootstrap::count(HitBitsets(motifs, 0), replicates, 3);
+    EXPECT_EQ(empty, MotifBootstrap(motifs, replicates));
+}
+
+TEST_F(MotifBootstrapTest, PercentileIntervals) {
+    // One motif, frequencies 0.5 in the sequences and 0.1 .. 0.5 in five
+    // replicates
+    MotifBootstrap bootstrap(1, 5);
+    bootstrap.counts = {5, 10, 3, 10, 1, 10, 5, 10, 2, 10, 4, 10};
+    const auto intervals = bootstrap.intervals(0.5);
+    ASSERT_EQ(intervals.size(), 1);
+    EXPECT_DOUBLE_EQ(intervals[0].frequency, 0.5);
+    EXPECT_DOUBLE_EQ(intervals[0].lower, 0.2);
+    EXPECT_DOUBLE_EQ(intervals[0].upper, 0.4);
+    const auto wide = bootstrap.intervals(0.9);
+    EXPECT_NEAR(wide[0].lower, 0.12, 1e-12);
+    EXPECT_NEAR(wide[0].upper, 0.48, 1e-12);
+
+    EXPECT_THROW((void)bootstrap.intervals(1.0), std::invalid_argument);
+    EXPECT_THROW((void)bootstrap.intervals(0.0), std::invalid_argument);
+    EXPECT_THROW((void)MotifBootstrap(1, 0).intervals(0.95), std::invalid_argument);
+}
+
+TEST_F(MotifBootstrapTest, IntervalsCoverBinomialSpread) {
+    const MotifBootstrap bootstrap = MotifBootstrap::count(bitsets(0, sequences), 400, 9);
+    const auto intervals = bootstrap.intervals(0.95);
+    ASSERT_EQ(intervals.size(), motifs);
+    for (size_t m = 0; m < motifs; ++m) {
+        const double frequency = intervals[m].frequency;
+        const double width = 2.0 * 1.96 * std::sqrt(frequency * (1.0 - frequency) / sequences);
+        EXPECT_LT(intervals[m].lower, frequency) << m;
+        EXPECT_GT(intervals[m].upper, frequency) << m;
+        EXPECT_NEAR(intervals[m].upper - intervals[m].lower, width, 0.2 * width) << m;
+    }
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "motif_clustering.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifClusteringTest : public ::testing::Test {
+protected:
+    // Motifs 0-2 form a chain of near copies, 3 is unrelated, 4 never hits
+    // and 5-6 are near copies of each other; 1 hits the most sequences
+    HitBitsets groupedBitsets(size_t sequences) {
+        HitBitsets bitsets(7, sequences);
+        for (size_t s = 0; s < sequences; ++s) {
+            const uint32_t r = rng.next() % 100;
+            if (r < 30) {
+                bitsets.set(1, s);
+                if (r < 26) {
+                    bitsets.set(0, s);
+                }
+                if (r >= 4) {
+                    bitsets.set(2, s);
+                }
+            }
+            if (rng.next() % 100 < 20) {
+                bitsets.set(3, s);
+            }
+            if (r >= 60 && r < 85) {
+                bitsets.set(5, s);
+                if (r < 83) {
+                    bitsets.set(6, s);
+                }
+            }
+        }
+        return bitsets;
+    }
+
+    TestRandom rng{23};
+};
+
+TEST_F(MotifClusteringTest, JaccardFromCooccurrence) {
+    const HitBitsets bitsets = groupedBitsets(3000);
+    const CooccurrenceMatrix matrix = bitsets.cooccurrence();
+
+    for (size_t a = 0; a < bitsets.motifCount(); ++a) {
+        for (size_t b = 0; b < bitsets.motifCount(); ++b) {
+            size_t both = 0;
+            size_t either = 0;
+            for (size_t s = 0; s < bitsets.sequenceCount(); ++s) {
+                both += bitsets.test(a, s) && bitsets.test(b, s);
+                either += bitsets.test(a, s) || bitsets.test(b, s);
+            }
+            const double expected = either > 0 ? static_cast<double>(both) / static_cast<double>(either) : 0.0;
+            EXPECT_DOUBLE_EQ(matrix.jaccard(a, b), expected) << a << " " << b;
+        }
+    }
+    EXPECT_DOUBLE_EQ(matrix.jaccard(4, 4), 0.0);
+}
+
+TEST_F(MotifClusteringTest, ExactSingleLinkage) {
+    const HitBitsets bitsets = groupedBitsets(3000);
+    const CooccurrenceMatrix matrix = bitsets.cooccurrence();
+
+    // 0 and 2 are only linked through 1
+    ASSERT_LT(matrix.jaccard(0, 2), 0.8);
+    ASSERT_GE(matrix.jaccard(0, 1), 0.8);
+    ASSERT_GE(matrix.jaccard(1, 2), 0.8);
+
+    const MotifClusters clusters = clusterMotifs(matrix, 0.8);
+    EXPECT_EQ(clusters.cluster_of, (std::vector<size_t>{0, 0, 0, 1, 2, 3, 3}));
+    EXPECT_EQ(clusters.representatives, (std::vector<size_t>{1, 3, 4, 5}));
+    EXPECT_EQ(clusters.clusterCount(), 4);
+    EXPECT_EQ(clusters.members(0), (std::vector<size_t>{0, 1, 2}));
+
+    // At similarity 1 only identical non-empty hit sets link
+    const MotifClusters singletons = clusterMotifs(matrix, 1.0);
+    EXPECT_EQ(singletons.clusterCount(), 7);
+
+    EXPECT_THROW((void)clusterMotifs(matrix, 0.0), std::invalid_argument);
+    EXPECT_THROW((void)clusterMotifs(matrix, 1.5), std::invalid_argument);
+}
+
+TEST_F(MotifClusteringTest, MinHashEstimatesAndMerges) {
+    const HitBitsets bitsets = groupedBitsets(4000);
+    const CooccurrenceMatrix matrix = bitsets.cooccurrence();
+    const MinHashSketches sketches = MinHashSketches::fromBitsets(bitsets, 256);
+    ASSERT_EQ(sketches.motifCount(), 7);
+    ASSERT_EQ(sketches.hashCount(), 256);
+
+    for (size_t a = 0; a < 7; ++a) {
+        for (size_t b = 0; b < 7; ++b) {
+            EXPECT_NEAR(sketches.similarity(a, b), matrix.jaccard(a, b), 0.12)
+                << a << " " << b;
+        }
+    }
+    EXPECT_EQ(sketches.signature(4)[0], MinHashSketches::EMPTY);
+    EXPECT_DOUBLE_EQ(sketches.similarity(4, 4), 0.0);
+
+    // Signatures of two halves merge into the signatures of the whole
+    const size_t half = 1000;
+    HitBitsets first(7, half);
+    HitBitsets second(7, bitsets.sequenceCount() - half);
+    for (size_t m = 0; m < 7; ++m) {
+        for (size_t s = 0; s < bitsets.sequenceCount(); ++s) {
+            if (bitsets.test(m, s)) {
+                s < half ? first.set(m, s) : second.set(m, s - half);
+            }
+        }
+    }
+    MinHashSketches merged = MinHashSketches::fromBitsets(first, 256);
+    merged.merge(MinHashSketches::fromBitsets(second, 256, half));
+    EXPECT_EQ(merged.values(), sketches.values());
+    EXPECT_THROW(merged.merge(MinHashSketches(7, 8)), std::invalid_argument);
+
+    std::vector<uint64_t> hit_counts(7);
+    for (size_t m = 0; m < 7; ++m) {
+        hit_counts[m] = bitsets.count(m);
+    }
+    const MotifClusters clusters = clusterMotifs(sketches, hit_counts, 0.6);
+    EXPECT_EQ(clusters.cluster_of, (std::vector<size_t>{0, 0, 0, 1, 2, 3, 3}));
+    EXPECT_EQ(clusters.representatives, (std::vector<size_t>{1, 3, 4, 5}));
+}
+
+TEST_F(MotifClusteringTest, MinHashClustersIndependentOfSplit) {
+    const HitBitsets bitsets = groupedBitsets(4000);
+    std::vector<uint64_t> hit_counts(7);
+    for (size_t m = 0; m < 7; ++m) {
+        hit_counts[m] = bitsets.count(m);
+    }
+
+    // Each "process" sketches its part with global sequence ids, as
+    // ParallelProcessor does, and the signatures merge by minimum
+    const auto clusterParts = [&](const std::vector<size_t>& bounds) {
+        MinHashSketches merged(7, 64);
+        for (size_t p = 0; p + 1 < bounds.size(); ++p) {
+            HitBitsets part(7, bounds[p + 1] - bounds[p]);
+            for (size_t m = 0; m < 7; ++m) {
+                for (size_t s = bounds[p]; s < bounds[p + 1]; ++s) {
+                    if (bitsets.test(m, s)) {
+                        part.set(m, s - bounds[p]);
+                    }
+                }
+            }
+            merged.merge(MinHashSketches::fromBitsets(part, 64, bounds[p]));
+        }
+        return clusterMotifs(merged, hit_counts, 0.6);
+    };
+
+    const MotifClusters whole = clusterParts({0, 4000});
+    for (const auto& bounds : {std::vector<size_t>{0, 2000, 4000}, std::vector<size_t>{0, 700, 1333, 2500, 4000}}) {
+        const MotifClusters split = clusterParts(bounds);
+        EXPECT_EQ(split.cluster_of, whole.cluster_of) << bounds.size() - 1;
+        EXPECT_EQ(split.representatives, whole.representatives) << bounds.size() - 1;
+    }
+}
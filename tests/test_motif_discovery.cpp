@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "motif_discovery.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifDiscoveryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // AT-rich background with TGASTCA planted in a third of the sequences
+        for (int i = 0; i < 150; ++i) {
+            std::string seq = randomSequence(rng, 30, "AAATTTCGCG");
+            if (i % 3 == 0) {
+                seq.replace(rng.next() % 20, 7, rng.next() % 2 ? "TGACTCA" : "TGAGTCA");
+            }
+            if (i % 17 == 0) {
+                seq[5] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+        store = SequenceStore(sequences);
+        store.buildWindowCodes();
+        index = KmerIndex::build(store);
+    }
+
+    // Every pattern with at most one degenerate position, counted from the postings
+    std::vector<std::pair<uint32_t, uint64_t>> exhaustiveCounts(uint64_t min_sequences) const {
+        const std::string codes = "ACGTRYSWKMBDHVN";
+        std::vector<std::pair<uint32_t, uint64_t>> all;
+        for (int degenerate_at = -1; degenerate_at < 8; ++degenerate_at) {
+            for (size_t symbol = degenerate_at < 0 ? 14 : 4; symbol < 15; ++symbol) {
+                for (uint32_t rest = 0; rest < (degenerate_at < 0 ? 65536u : 16384u); ++rest) {
+                    std::string pattern;
+                    uint32_t bases = rest;
+                    for (int p = 0; p < 8; ++p) {
+                        if (p == degenerate_at) {
+                            pattern += codes[symbol];
+                        } else {
+                            pattern += "ACGT"[bases & 3];
+                            bases >>= 2;
+                        }
+                    }
+                    std::vector<uint32_t> ids;
+                    for (const char base : std::string_view("ACGT")) {
+                        std::string concrete = pattern;
+                        if (degenerate_at >= 0) {
+                            if (!IUPACCodes::getInstance().matches(base, codes[symbol])) {
+                                continue;
+                            }
+                            concrete[static_cast<size_t>(degenerate_at)] = base;
+                        } else if (base != 'A') {
+                            break;
+                        }
+                        uint16_t code = 0;
+                        for (const char c : concrete) {
+                            code = static_cast<uint16_t>((code << 2) | encodeNucleotide(c));
+                        }
+                        const auto posting = index.posting(code);
+                        ids.insert(ids.end(), posting.begin(), posting.end());
+                    }
+                    std::ranges::sort(ids);
+                    const auto count = static_cast<uint64_t>(std::ranges::unique(ids).begin() - ids.begin());
+                    if (count >= min_sequences) {
+                        all.emplace_back(MotifDiscovery::packPattern(pattern), count);
+                    }
+                }
+            }
+        }
+        return all;
+    }
+
+    static std::vector<DiscoveredMotif> rank(const MotifDiscovery& discovery,
+                                             const std::vector<std::pair<uint32_t, uint64_t>>& counts,
+                                             size_t top_k) {
+        std::vector<DiscoveredMotif> all;
+        for (const auto& [packed, count] : counts) {
+            all.push_back(discovery.describe(packed, count));
+        }
+        return MotifDiscovery::best(std::move(all), top_k);
+    }
+
+    std::vector<ChIPSequence> sequences;
+    SequenceStore store;
+    KmerIndex index;
+    TestRandom rng{41};
+};
+
+TEST_F(MotifDiscoveryTest, MatchesExhaustiveSearch) {
+    DiscoveryOptions options;
+    options.top_k = 8;
+    options.max_degenerate = 1;
+    options.min_frequency = 0.1;
+    const MotifDiscovery discovery(store, index, options);
+    const auto found = discovery.discover();
+    const auto counts = exhaustiveCounts(15);
+    ASSERT_EQ(found.size(), 8);
+    EXPECT_EQ(found, rank(discovery, counts, 8));
+    EXPECT_LT(discovery.nodesVisited(), 1500000);
+    EXPECT_TRUE(std::ranges::any_of(found, [](const auto& motif) {
+        return motif.pattern.find("TGASTCA") != std::string::npos;
+    }));
+    for (size_t i = 1; i < found.size(); ++i) {
+        EXPECT_GE(found[i - 1].score, found[i].score);
+    }
+
+    options.objective = DiscoveryObjective::Frequency;
+    const MotifDiscovery by_frequency(store, index, options);
+    const auto frequent = by_frequency.discover();
+    EXPECT_EQ(frequent, rank(by_frequency, counts, 8));
+    EXPECT_DOUBLE_EQ(frequent.front().score, frequent.front().frequency);
+}
+
+TEST_F(MotifDiscoveryTest, PartsMergeToWholeSearch) {
+    DiscoveryOptions options;
+    options.top_k = 5;
+    options.max_degenerate = 2;
+    const MotifDiscovery discovery(store, index, options);
+    const auto whole = discovery.discover();
+
+    std::vector<DiscoveredMotif> merged;
+    for (size_t part = 0; part < 3; ++part) {
+        const auto found = discovery.discover(part, 3);
+        merged.insert(merged.end(), found.begin(), found.end());
+    }
+    EXPECT_EQ(MotifDiscovery::best(merged, 5), whole);
+
+    const int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    EXPECT_EQ(discovery.discover(), whole);
+    omp_set_num_threads(threads);
+}
+
+TEST_F(MotifDiscoveryTest, TablesSumOverSequenceParts) {
+    DiscoveryOptions options;
+    options.top_k = 5;
+    const auto whole = MotifDiscovery(store, index, options).discover();
+    ASSERT_FALSE(whole.empty());
+
+    // Counts of the other parts, captured by their reductions, summed into
+    // the first part's
+    std::vector<std::vector<uint64_t>> captured;
+    for (size_t part = 1; part < 3; ++part) {
+        (void)MotifDiscovery(store, index, options, part, 3, [&](std::span<uint64_t> counts) {
+            captured.emplace_back(counts.begin(), counts.end());
+        });
+    }
+    const MotifDiscovery joined(store, index, options, 0, 3, [&](std::span<uint64_t> counts) {
+        for (const auto& other : captured) {
+            ASSERT_EQ(other.size(), counts.size());
+            for (size_t i = 0; i < counts.size(); ++i) {
+                counts[i] += other[i];
+            }
+        }
+    });
+    EXPECT_EQ(joined.discover(), whole);
+}
+
+TEST_F(MotifDiscoveryTest, PackAndDescribe) {
+    const uint32_t packed = MotifDiscovery::packPattern("TGASTCAN");
+    EXPECT_EQ(packed & 15u, 15u);
+    DiscoveryOptions options;
+    const MotifDiscovery discovery(store, index, options);
+    const DiscoveredMotif motif = discovery.describe(packed, 30);
+    EXPECT_EQ(motif.pattern, "TGASTCAN");
+    EXPECT_DOUBLE_EQ(motif.frequency, 0.2);
+    EXPECT_GT(motif.expected, 0.0);
+    EXPECT_DOUBLE_EQ(motif.enrichment, 30 / motif.expected);
+    EXPECT_THROW((void)MotifDiscovery::packPattern("TGAS"), std::invalid_argument);
+    EXPECT_THROW((void)MotifDiscovery::packPattern("TGASTCAX"), std::invalid_argument);
+    EXPECT_EQ(parseDiscoveryObjective("frequency"), DiscoveryObjective::Frequency);
+    EXPECT_FALSE(parseDiscoveryObjective("score").has_value());
+}
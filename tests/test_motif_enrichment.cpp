@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "motif_enrichment.h"
+
+using namespace dna_motif;
+
+class MotifEnrichmentTest : public ::testing::Test {
+protected:
+    static long double choose(uint64_t n, uint64_t k) {
+        if (k > n) {
+            return 0.0L;
+        }
+        long double result = 1.0L;
+        for (uint64_t i = 1; i <= k; ++i) {
+            result = result * static_cast<long double>(n - k + i) / static_cast<long double>(i);
+        }
+        return result;
+    }
+
+    static double directTail(uint64_t hits, uint64_t draws, uint64_t successes, uint64_t population) {
+        long double tail = 0.0L;
+        for (uint64_t x = hits; x <= std::min(draws, successes); ++x) {
+            tail += choose(successes, x) * choose(population - successes, draws - x);
+        }
+        return static_cast<double>(tail / choose(population, draws));
+    }
+};
+
+TEST_F(MotifEnrichmentTest, MatchesDirectSum) {
+    for (uint64_t population : {1, 7, 20, 41}) {
+        for (uint64_t draws = 0; draws <= population; draws += 3) {
+            for (uint64_t successes = 0; successes <= population; successes += 2) {
+                for (uint64_t hits = 0; hits <= std::min(draws, successes) + 1; ++hits) {
+                    const double expected = directTail(hits, draws, successes, population);
+                    const double actual = std::exp(hypergeometricLogTail(hits, draws, successes, population));
+                    EXPECT_NEAR(actual, expected, 1e-12 + 1e-9 * expected)
+                        << hits << " " << draws << " " << successes << " " << population;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(MotifEnrichmentTest, StaysFiniteInExtremeTails) {
+    // Every success drawn: P = 1 / C(N, n)
+    const double log_tail = hypergeometricLogTail(5000, 5000, 5000, 1000000);
+    const double exact = -(std::lgamma(1000001.0) - std::lgamma(5001.0) - std::lgamma(995001.0));
+    EXPECT_TRUE(std::isfinite(log_tail));
+    EXPECT_LT(log_tail, -20000.0);
+    EXPECT_NEAR(log_tail, exact, 1e-9 * std::abs(exact));
+
+    // Far below the mode the tail is almost certain
+    EXPECT_NEAR(hypergeometricLogTail(1, 500000, 400000, 1000000), 0.0, 1e-12);
+    EXPECT_EQ(hypergeometricLogTail(0, 10, 5, 20), 0.0);
+    EXPECT_TRUE(std::isinf(hypergeometricLogTail(6, 10, 5, 20)));
+
+    EXPECT_EQ(formatLogProbability(0.0), "1.000e+00");
+    EXPECT_EQ(formatLogProbability(std::log(0.05)), "5.000e-02");
+    EXPECT_EQ(formatLogProbability(-1000.0 * std::numbers::ln10), "1.000e-1000");
+    EXPECT_EQ(formatLogProbability(std::log(9.99999e-5)), "1.000e-04");
+    EXPECT_EQ(formatLogProbability(-std::numeric_limits<double>::infinity()), "0.000e+00");
+}
+
+TEST_F(MotifEnrichmentTest, ComputeFillsFields) {
+    const MotifEnrichment enriched = MotifEnrichment::compute("TGASTCA", 30, 100, 10, 200);
+    EXPECT_EQ(enriched.pattern, "TGASTCA");
+    EXPECT_DOUBLE_EQ(enriched.foreground_frequency, 0.3);
+    EXPECT_DOUBLE_EQ(enriched.background_frequency, 0.05);
+    EXPECT_DOUBLE_EQ(enriched.fold_enrichment, 6.0);
+    EXPECT_NEAR(std::exp(enriched.log_p_value), directTail(30, 100, 40, 300), 1e-20);
+    EXPECT_LT(enriched.log_p_value, std::log(1e-8));
+
+    const MotifEnrichment only_foreground = MotifEnrichment::compute("A", 3, 10, 0, 10);
+    EXPECT_TRUE(std::isinf(only_foreground.fold_enrichment));
+    const MotifEnrichment absent = MotifEnrichment::compute("A", 0, 10, 4, 10);
+    EXPECT_EQ(absent.fold_enrichment, 0.0);
+    EXPECT_EQ(absent.log_p_value, 0.0);
+    const MotifEnrichment empty = MotifEnrichment::compute("A", 0, 0, 0, 0);
+    EXPECT_EQ(empty.foreground_frequency, 0.0);
+    EXPECT_EQ(empty.fold_enrichment, 0.0);
+}
@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 #include "motif_finder.h"
 #include "iupac_codes.h"
+#include "test_utils.h"
 #include <span>
 
 using namespace dna_motif;
+using namespace dna_motif::test_utils;
 
 class MotifFinderTest : public ::testing::Test {
 protected:
@@ -153,3 +155,514 @@ TEST_F(MotifFinderTest, MotifMatchDetails) {
     EXPECT_TRUE(sequence_indices.find(0) != sequence_indices.end());  // seq1
     EXPECT_TRUE(sequence_indices.find(4) != sequence_indices.end());  // seq5
 }
+
+TEST_F(MotifFinderTest, SequenceStoreMatchesCharacterPath) {
+    sequences.push_back(ChIPSequence("seq6", "CCCCCCCCNNATGCATGCCCCCCCCCCCCCCCCCCCCCCC"));
+    sequences.push_back(ChIPSequence("seq7", "ccccccccccatgcatgccccccccccccccccccccccc"));
+
+    SequenceStore store(sequences);
+    store.buildWindowCodes();
+
+    auto expected = motif_finder->findMotifs(std::span<const ChIPSequence>(sequences), std::span<const Motif>(motifs));
+    auto results = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], expected[i]) << results[i].motif_pattern;
+    }
+}
+
+TEST_F(MotifFinderTest, SequenceStoreWithoutWindowCodes) {
+    SequenceStore store(sequences);
+
+    auto result = motif_finder->findSingleMotif(store, motifs[3]);
+    EXPECT_EQ(result.match_count, 2);
+    EXPECT_DOUBLE_EQ(result.frequency, 0.4);
+}
+
+TEST_F(MotifFinderTest, MotifMajorMatchesCharacterPath) {
+    const std::string codes = "ACGTRYSWKMBDHVN";
+    TestRandom rng(12345);
+
+    addRandomSequences(sequences, rng, 200, 40);
+
+    std::vector<Motif> panel;
+    for (int i = 0; i < 80; ++i) {
+        std::string pattern;
+        for (int j = 0; j < 8; ++j) {
+            // Bias towards specific codes so counts are not saturated
+            pattern += codes[rng.next() % 3 == 0 ? rng.next() % codes.size() : rng.next() % 4];
+        }
+        panel.emplace_back(pattern, 0.0, 0.0, 0.0);
+    }
+
+    SequenceStore store(sequences);
+    store.buildWindowCodes();
+
+    auto expected = motif_finder->findMotifs(std::span<const ChIPSequence>(sequences), std::span<const Motif>(panel));
+
+    motif_finder->setKernel(ScanKernel::Auto);
+    auto results = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], expected[i]) << results[i].motif_pattern;
+    }
+
+    // Forcing the motif-major kernel on a small panel gives the same answer
+    motif_finder->setKernel(ScanKernel::MotifMajor);
+    auto small = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+    motif_finder->setKernel(ScanKernel::Scalar);
+    auto small_expected = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+    EXPECT_EQ(small, small_expected);
+}
+
+TEST_F(MotifFinderTest, PrefilterMatchesCharacterPath) {
+    // Motif spanning the boundary of two concatenated sequences must not match
+    sequences.push_back(ChIPSequence("tail", "CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCATGC"));
+    sequences.push_back(ChIPSequence("head", "ATGCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCC"));
+    sequences.push_back(ChIPSequence("dirty", "CCCCCCCCNNATGCATGCCCCCCCCCCCCCCCCCCCCCCC"));
+    sequences.push_back(ChIPSequence("late", "CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCATGCATGC"));
+
+    SequenceStore store(sequences);
+
+    motif_finder->setKernel(ScanKernel::Scalar);
+    auto expected = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+
+    motif_finder->setKernel(ScanKernel::Prefilter);
+    auto results = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i], expected[i]) << results[i].motif_pattern;
+    }
+    EXPECT_EQ(results[0].match_count, 4);  // seq1, seq5, dirty, late
+}
+
+TEST_F(MotifFinderTest, AutoPrefiltersMotifsWithoutWindowTable) {
+    sequences.push_back(ChIPSequence("reverse", "CCCCCCCCCCCCCCCGTACGTACGTCCCCCCCCCCCCCCC"));
+    SequenceStore store(sequences);
+    store.buildWindowCodes();
+    motif_finder->setScanOptions(ScanOptions{ScanKernel::Auto, true});
+
+    // A 10-mer has no window code table; with both strands its summed pass
+    // rate is above the Auto limit, but the prefilter still beats the
+    // character path
+    const Motif ten("ACGTACGTAC", 0.0, 0.0, 0.0);
+    EXPECT_EQ(motif_finder->selectKernel(store, ten.pattern), ScanKernel::Prefilter);
+    EXPECT_EQ(motif_finder->selectKernel(store, "NNACGTNN"), ScanKernel::WindowCodes);
+
+    const MotifResult result = motif_finder->findSingleMotif(store, ten);
+    motif_finder->setScanOptions(ScanOptions{ScanKernel::Scalar, true});
+    EXPECT_EQ(motif_finder->selectKernel(store, ten.pattern), ScanKernel::Scalar);
+    EXPECT_EQ(result, motif_finder->findSingleMotif(store, ten));
+    EXPECT_EQ(result.match_count, 1);
+}
+
+TEST_F(MotifFinderTest, KernelNames) {
+    for (ScanKernel kernel : {ScanKernel::Auto, ScanKernel::Scalar, ScanKernel::WindowCodes,
+                              ScanKernel::Prefilter, ScanKernel::MotifMajor, ScanKernel::Swar}) {
+        EXPECT_EQ(parseScanKernel(scanKernelName(kernel)), kernel);
+    }
+    EXPECT_FALSE(parseScanKernel("avx512").has_value());
+}
+
+TEST_F(MotifFinderTest, EveryKernelMatchesCharacterPath) {
+    sequences.push_back(ChIPSequence("dirty", "CCCCCCCCNNATGCATGCCCCCCCCCCCCCCCCCCCCCCC"));
+    sequences.push_back(ChIPSequence("late", "CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCATGCATGC"));
+    sequences.push_back(ChIPSequence("short", "ATGCATG"));
+
+    auto expected = motif_finder->findMotifs(std::span<const ChIPSequence>(sequences), std::span<const Motif>(motifs));
+
+    for (ScanKernel kernel : {ScanKernel::Auto, ScanKernel::Scalar, ScanKernel::WindowCodes,
+                              ScanKernel::Prefilter, ScanKernel::MotifMajor, ScanKernel::Swar}) {
+        motif_finder->setKernel(kernel);
+        SequenceStore store(sequences);
+        motif_finder->prepareStore(store);
+
+        auto results = motif_finder->findMotifs(store, std::span<const Motif>(motifs));
+        EXPECT_EQ(results, expected) << scanKernelName(kernel);
+    }
+}
+
+TEST_F(MotifFinderTest, BothStrandsMatchesEveryKernel) {
+    TestRandom rng(777);
+
+    addRandomSequences(sequences, rng, 150, 40);
+    sequences.push_back(ChIPSequence("reverse", "CCCCCCCCCCCCCCCTGTAAACACCCCCCCCCCCCCCCCC"));
+    sequences.push_back(ChIPSequence("dirty", "CCCCCCCCNNTGTAAACACCCCCCCCCCCCCCCCCCCCCC"));
+
+    const std::string codes = "ACGTRYSWKMBDHVN";
+    std::vector<Motif> panel = {Motif("TGTTTACA", 0.0, 0.0, 0.0), Motif("ACGTACGT", 0.0, 0.0, 0.0)};
+    while (panel.size() < 20) {
+        std::string pattern;
+        for (int j = 0; j < 8; ++j) {
+            pattern += codes[rng.next() % 3 == 0 ? rng.next() % codes.size() : rng.next() % 4];
+        }
+        panel.emplace_back(pattern, 0.0, 0.0, 0.0);
+    }
+
+    // Reference: first window matching the motif or its reverse complement
+    std::vector<MotifResult> expected;
+    for (const auto &motif : panel) {
+        const std::string reverse = iupac_codes->reverseComplement(motif.pattern);
+        MotifResult result(motif.pattern);
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            const std::string &text = sequences[i].sequence;
+            for (size_t pos = 0; pos + motif.pattern.size() <= text.size(); ++pos) {
+                const bool forward = iupac_codes->matchesMotif(text, motif.pattern, pos);
+                const bool backward = iupac_codes->matchesMotif(text, reverse, pos);
+                if (forward || backward) {
+                    const Strand strand = forward ? (backward ? Strand::Both : Strand::Forward) : Strand::Reverse;
+                    result.match_count++;
+                    result.matches.emplace_back(i, pos, text.substr(pos, motif.pattern.size()), strand);
+                    break;
+                }
+            }
+        }
+        result.calculateFrequency(sequences.size());
+        expected.push_back(std::move(result));
+    }
+
+    ASSERT_GE(expected[0].matches.size(), 2);
+    EXPECT_EQ(expected[0].matches.back().sequence_index, sequences.size() - 1);
+    EXPECT_EQ(expected[0].matches.back().strand, Strand::Reverse);
+
+    for (ScanKernel kernel : {ScanKernel::Auto, ScanKernel::Scalar, ScanKernel::WindowCodes,
+                              ScanKernel::Prefilter, ScanKernel::MotifMajor, ScanKernel::Swar}) {
+        motif_finder->setScanOptions(ScanOptions{kernel, true});
+        SequenceStore store(sequences);
+        motif_finder->prepareStore(store);
+
+        // Full panel (motif-major under Auto) and two motifs scanned one by one
+        auto results = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+        EXPECT_EQ(results, expected) << scanKernelName(kernel);
+
+        auto pair = motif_finder->findMotifs(store, std::span<const Motif>(panel).first(2));
+        ASSERT_EQ(pair.size(), 2);
+        EXPECT_EQ(pair[0], expected[0]) << scanKernelName(kernel);
+        EXPECT_EQ(pair[1], expected[1]) << scanKernelName(kernel);
+    }
+}
+
+TEST_F(MotifFinderTest, ZoneMapsSkipBlocksWithoutHits) {
+    TestRandom rng(4242);
+
+    // Mostly A/C sequences; G/T-rich motifs only occur in a few planted blocks
+    sequences.clear();
+    for (int i = 0; i < 2000; ++i) {
+        std::string seq = randomSequence(rng, 40, "AACCACG");
+        if (i % 700 == 5) {
+            seq.replace(10, 10, "TGTTTACAGG");
+        }
+        if (i % 333 == 0) {
+            seq[20] = 'N';
+        }
+        sequences.emplace_back("z" + std::to_string(i), seq);
+    }
+    sequences.push_back(ChIPSequence("dirty", "CCCCCCCCNNTGTAAACACCCCCCCCCCCCCCCCCCCCCC"));
+    const std::vector<Motif> rare = {Motif("TGTTTACA", 0.0, 0.0, 0.0), Motif("TKTTTAYAGG", 0.0, 0.0, 0.0),
+                                     Motif("GGGTTT", 0.0, 0.0, 0.0), Motif("ACNNCA", 0.0, 0.0, 0.0)};
+
+    for (bool both_strands : {false, true}) {
+        for (ScanKernel kernel : {ScanKernel::Scalar, ScanKernel::WindowCodes, ScanKernel::Prefilter, ScanKernel::Swar}) {
+            motif_finder->setScanOptions(ScanOptions{kernel, both_strands});
+            SequenceStore plain(sequences);
+            motif_finder->prepareStore(plain);
+            const auto expected = motif_finder->findMotifs(plain, std::span<const Motif>(rare));
+            EXPECT_EQ(motif_finder->getZoneSkipStats().blocks_checked, 0);
+
+            ScanOptions options{kernel, both_strands};
+            options.zone_maps = true;
+            motif_finder->setScanOptions(options);
+            SequenceStore store(sequences);
+            motif_finder->prepareStore(store);
+            ASSERT_TRUE(store.hasZoneMaps());
+
+            const auto results = motif_finder->findMotifs(store, std::span<const Motif>(rare));
+            EXPECT_EQ(results, expected) << scanKernelName(kernel) << " " << both_strands;
+            EXPECT_GT(results[0].match_count, 1);
+
+            // Motifs of 8 or more bases are tested per block, shorter ones are not
+            const ZoneSkipStats &stats = motif_finder->getZoneSkipStats();
+            EXPECT_EQ(stats.blocks_checked, 2 * store.zoneCount()) << scanKernelName(kernel);
+            EXPECT_GT(stats.skipRate(), 0.5) << scanKernelName(kernel);
+        }
+    }
+}
+
+TEST_F(MotifFinderTest, GappedMotifsMatchExpansions) {
+    TestRandom rng(4242);
+
+    sequences.clear();
+    for (int i = 0; i < 120; ++i) {
+        std::string seq = randomSequence(rng, 60 + (i % 3) * 50, "ACGTAAC");
+        if (i % 10 == 0) {
+            seq[seq.size() / 2] = 'N';
+        }
+        sequences.emplace_back("rnd" + std::to_string(i), seq);
+    }
+    // A dimer whose spacer holds an N never matches
+    sequences.push_back(ChIPSequence("spacer", "GGGGTGTTTACGGNGGCATTGGGG"));
+
+    const std::vector<Motif> gapped = {
+        Motif("TRTTKAC[2-6]HYTW", 0.0, 0.0, 0.0), Motif("AAC[0-4]GT", 0.0, 0.0, 0.0),
+        Motif("ACG[3]AA", 0.0, 0.0, 0.0), Motif("ACG[3", 0.0, 0.0, 0.0)};
+
+    for (bool both_strands : {false, true}) {
+        // Reference: first offset where any expansion matches either strand
+        std::vector<MotifResult> expected;
+        for (const auto& motif : gapped) {
+            MotifResult result(motif.pattern);
+            const auto compiled = GappedMotif::compile(motif.pattern, *iupac_codes);
+            std::vector<std::pair<std::string, std::string>> expansions;
+            if (compiled) {
+                const std::string_view view(motif.pattern);
+                const std::string left(view.substr(0, view.find('[')));
+                const std::string right(view.substr(view.find(']') + 1));
+                for (size_t gap = compiled->spacer().first; gap <= compiled->spacer().second; ++gap) {
+                    const std::string forward = left + std::string(gap, 'N') + right;
+                    expansions.emplace_back(forward, iupac_codes->reverseComplement(forward));
+                }
+            }
+            for (size_t i = 0; i < sequences.size() && !expansions.empty(); ++i) {
+                const std::string& text = sequences[i].sequence;
+                bool found = false;
+                for (size_t pos = 0; pos < text.size() && !found; ++pos) {
+                    // Matched text ends after the shortest spacer of the forward
+                    // strand, or of the reverse strand when only that matches
+                    size_t forward = 0;
+                    size_t backward = 0;
+                    for (const auto& [pattern, reverse] : expansions) {
+                        if (forward == 0 && iupac_codes->matchesMotif(text, pattern, pos)) {
+                            forward = pattern.size();
+                        }
+                        if (backward == 0 && both_strands && iupac_codes->matchesMotif(text, reverse, pos)) {
+                            backward = reverse.size();
+                        }
+                    }
+                    const size_t length = forward != 0 ? forward : backward;
+                    if (forward || backward) {
+                        const Strand strand = forward ? (backward ? Strand::Both : Strand::Forward) : Strand::Reverse;
+                        result.match_count++;
+                        result.matches.emplace_back(i, pos, text.substr(pos, length), strand);
+                        found = true;
+                    }
+                }
+            }
+            result.calculateFrequency(sequences.size());
+            expected.push_back(std::move(result));
+        }
+
+        ScanOptions options;
+        options.both_strands = both_strands;
+        motif_finder->setScanOptions(options);
+        SequenceStore store(sequences);
+        motif_finder->prepareStore(store);
+
+        const auto results = motif_finder->findMotifs(store, std::span<const Motif>(gapped));
+        ASSERT_EQ(results.size(), gapped.size());
+        EXPECT_GT(results[0].match_count + results[1].match_count, 0);
+        EXPECT_EQ(results[3].match_count, 0);
+        for (size_t m = 0; m < gapped.size(); ++m) {
+            EXPECT_EQ(results[m], expected[m]) << gapped[m].pattern << " " << both_strands;
+        }
+    }
+}
+
+TEST_F(MotifFinderTest, MismatchesMatchReference) {
+    TestRandom rng(4242);
+
+    addRandomSequences(sequences, rng, 120, 40);
+    sequences.push_back(ChIPSequence("dirty", "CCCCCCCCNNATGCTTGCCCCCCCCCCCCCCCCCCCCCCC"));
+
+    std::vector<Motif> panel = {Motif("ATGCATGC", 0.0, 0.0, 0.0), Motif("TGTTTACA", 0.0, 0.0, 0.0),
+                                Motif("RYGCATGN", 0.0, 0.0, 0.0)};
+
+    for (size_t max_mismatches : {1uz, 2uz}) {
+        for (bool both_strands : {false, true}) {
+            // Reference: first window with the fewest mismatches on either strand
+            std::vector<MotifResult> expected;
+            for (const auto &motif : panel) {
+                const std::string reverse = iupac_codes->reverseComplement(motif.pattern);
+                MotifResult result(motif.pattern);
+                result.mismatch_counts.assign(max_mismatches + 1, 0);
+                for (size_t i = 0; i < sequences.size(); ++i) {
+                    const std::string &text = sequences[i].sequence;
+                    size_t best = max_mismatches + 1;
+                    size_t best_pos = 0;
+                    Strand best_strand = Strand::Forward;
+                    for (size_t pos = 0; pos + 8 <= text.size(); ++pos) {
+                        const size_t forward = iupac_codes->countMismatches(text, motif.pattern, pos);
+                        const size_t backward = both_strands ? iupac_codes->countMismatches(text, reverse, pos) : 8;
+                        const size_t level = std::min(forward, backward);
+                        if (level < best) {
+                            best = level;
+                            best_pos = pos;
+                            best_strand = forward == level ? (backward == level ? Strand::Both : Strand::Forward)
+                                                           : Strand::Reverse;
+                        }
+                    }
+                    if (best <= max_mismatches) {
+                        result.match_count++;
+                        result.mismatch_counts[best]++;
+                        result.matches.emplace_back(i, best_pos, text.substr(best_pos, 8), best_strand,
+                                                    static_cast<uint8_t>(best));
+                    }
+                }
+                result.calculateFrequency(sequences.size());
+                expected.push_back(std::move(result));
+            }
+
+            motif_finder->setScanOptions(ScanOptions{ScanKernel::Auto, both_strands, max_mismatches});
+            SequenceStore store(sequences);
+            motif_finder->prepareStore(store);
+            auto results = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+            EXPECT_EQ(results, expected) << max_mismatches << " " << both_strands;
+        }
+    }
+}
+
+TEST_F(MotifFinderTest, MismatchesSkipOverlongMotifs) {
+    // Longer than MAX_MOTIF_LENGTH: the mismatch kernel would read past the
+    // store padding, so the motif is scanned exactly instead
+    sequences.emplace_back("long1", std::string(150, 'A'));
+    sequences.emplace_back("long2", std::string(100, 'G') + "C");
+    const std::vector<Motif> panel = {Motif(std::string(100, 'N'), 0.0, 0.0, 0.0)};
+
+    SequenceStore store(sequences);
+    motif_finder->prepareStore(store);
+    const auto exact = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+    ASSERT_EQ(exact.size(), 1);
+    EXPECT_EQ(exact[0].match_count, 2);
+
+    motif_finder->setScanOptions(ScanOptions{ScanKernel::Auto, false, 1});
+    motif_finder->prepareStore(store);
+    EXPECT_EQ(motif_finder->findMotifs(store, std::span<const Motif>(panel)), exact);
+}
+
+TEST_F(MotifFinderTest, GenericLengthsMatchCharacterPath) {
+    TestRandom rng(99);
+
+    // Fixed 100 bp peaks (instantiated) and mixed lengths (runtime loops)
+    std::vector<ChIPSequence> uniform;
+    std::vector<ChIPSequence> mixed;
+    for (int i = 0; i < 80; ++i) {
+        uniform.emplace_back("u" + std::to_string(i), randomSequence(rng, 100));
+        mixed.emplace_back("m" + std::to_string(i), randomSequence(rng, 5 + rng.next() % 150));
+    }
+    mixed.push_back(ChIPSequence("dirty", "ACGTNACGTACGTACGTACGTAC"));
+
+    // 6, 12 and 20 bp motifs have dedicated kernels, 7 bp ones do not
+    const std::string codes = "ACGTRYSWKMBDHVN";
+    for (size_t motif_length : {6uz, 7uz, 12uz, 20uz}) {
+        std::vector<Motif> panel;
+        for (int m = 0; m < 20; ++m) {
+            std::string pattern;
+            for (size_t j = 0; j < motif_length; ++j) {
+                pattern += codes[rng.next() % 2 == 0 ? rng.next() % codes.size() : rng.next() % 4];
+            }
+            panel.emplace_back(pattern, 0.0, 0.0, 0.0);
+        }
+
+        for (const auto *input : {&uniform, &mixed}) {
+            auto expected = motif_finder->findMotifs(std::span<const ChIPSequence>(*input),
+                                                     std::span<const Motif>(panel));
+
+            for (ScanKernel kernel : {ScanKernel::Auto, ScanKernel::Prefilter, ScanKernel::MotifMajor,
+                                      ScanKernel::Swar}) {
+                motif_finder->setKernel(kernel);
+                SequenceStore store(*input);
+                motif_finder->prepareStore(store);
+
+                auto results = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+                EXPECT_EQ(results, expected) << motif_length << " " << scanKernelName(kernel);
+
+                // Per-motif kernels on a small panel
+                auto pair = motif_finder->findMotifs(store, std::span<const Motif>(panel).first(2));
+                ASSERT_EQ(pair.size(), 2);
+                EXPECT_EQ(pair[0], expected[0]) << motif_length << " " << scanKernelName(kernel);
+                EXPECT_EQ(pair[1], expected[1]) << motif_length << " " << scanKernelName(kernel);
+            }
+        }
+    }
+}
+
+TEST_F(MotifFinderTest, PositionHistogramCountsEveryHit) {
+    TestRandom rng(17);
+
+    std::vector<ChIPSequence> input;
+    for (int i = 0; i < 120; ++i) {
+        const size_t length = i % 3 == 0 ? 40 : 10 + rng.next() % 60;
+        std::string seq = randomSequence(rng, length);
+        if (i % 17 == 0) {
+            seq[rng.next() % length] = 'N';
+        }
+        input.emplace_back("s" + std::to_string(i), seq);
+    }
+
+    // Mixed lengths form separate panels; one motif with an invalid code
+    std::vector<Motif> panel;
+    const std::string codes = "ACGTRYSWKMN";
+    for (int m = 0; m < 24; ++m) {
+        std::string pattern;
+        const size_t length = m % 3 == 0 ? 6 : 8;
+        for (size_t j = 0; j < length; ++j) {
+            pattern += codes[rng.next() % 2 == 0 ? rng.next() % codes.size() : rng.next() % 4];
+        }
+        panel.emplace_back(pattern, 0.0, 0.0, 0.0);
+    }
+    panel.emplace_back("ACGTXA", 0.0, 0.0, 0.0);
+
+    size_t longest = 0;
+    for (const auto& seq : input) {
+        longest = std::max(longest, seq.sequence.size());
+    }
+
+    for (bool both_strands : {false, true}) {
+        ScanOptions options;
+        options.both_strands = both_strands;
+        motif_finder->setScanOptions(options);
+
+        SequenceStore store(input);
+        motif_finder->prepareStore(store);
+        auto expected = motif_finder->findMotifs(store, std::span<const Motif>(panel));
+
+        PositionHistogram histogram;
+        auto results = motif_finder->findMotifs(store, std::span<const Motif>(panel), histogram);
+        EXPECT_EQ(results, expected) << both_strands;
+
+        // Mismatch results would not match the exact histogram
+        options.max_mismatches = 1;
+        motif_finder->setScanOptions(options);
+        PositionHistogram mixed;
+        EXPECT_THROW((void)motif_finder->findMotifs(store, std::span<const Motif>(panel), mixed), std::invalid_argument);
+
+        ASSERT_EQ(histogram.motif_count, panel.size());
+        ASSERT_EQ(histogram.offset_count, longest - 6 + 1);
+        for (size_t m = 0; m < panel.size(); ++m) {
+            const std::string& pattern = panel[m].pattern;
+            const std::string reverse = iupac_codes->reverseComplement(pattern);
+            std::vector<uint64_t> reference(histogram.offset_count, 0);
+            for (const auto& seq : input) {
+                for (size_t pos = 0; pos + pattern.size() <= seq.sequence.size(); ++pos) {
+                    if (iupac_codes->matchesMotif(seq.sequence, pattern, pos) ||
+                        (both_strands && iupac_codes->matchesMotif(seq.sequence, reverse, pos))) {
+                        reference[pos]++;
+                    }
+                }
+            }
+            const auto row = histogram.row(m);
+            EXPECT_EQ(std::vector<uint64_t>(row.begin(), row.end()), reference) << pattern;
+        }
+    }
+}
+
+TEST_F(MotifFinderTest, PositionHistogramResize) {
+    PositionHistogram histogram(2, 3);
+    histogram.row(0)[2] = 5;
+    histogram.row(1)[0] = 7;
+
+    histogram.resizeOffsets(5);
+    EXPECT_EQ(histogram.counts, (std::vector<uint64_t>{0, 0, 5, 0, 0, 7, 0, 0, 0, 0}));
+}
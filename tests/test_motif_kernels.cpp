@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include "motif_kernels.h"
+#include "sequence_store.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifKernelsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+    }
+
+    static uint16_t codeOf(std::string_view window) {
+        uint16_t code = 0;
+        for (char c : window) {
+            code = static_cast<uint16_t>((code << 2) | encodeNucleotide(c));
+        }
+        return code;
+    }
+
+    IUPACCodes* iupac_codes;
+};
+
+TEST_F(MotifKernelsTest, BaseMasks) {
+    EXPECT_EQ(iupac_codes->getBaseMask('A'), 1u << encodeNucleotide('A'));
+    EXPECT_EQ(iupac_codes->getBaseMask('r'), (1u << encodeNucleotide('A')) | (1u << encodeNucleotide('G')));
+    EXPECT_EQ(iupac_codes->getBaseMask('N'), 0xF);
+    EXPECT_EQ(iupac_codes->getBaseMask('X'), 0);
+}
+
+TEST_F(MotifKernelsTest, KmerTableCompile) {
+    auto exact = KmerTable::compile("ATGCATGC", *iupac_codes);
+    ASSERT_TRUE(exact.has_value());
+    EXPECT_EQ(exact->cardinality(), 1);
+    EXPECT_TRUE(exact->contains(codeOf("ATGCATGC")));
+    EXPECT_FALSE(exact->contains(codeOf("ATGCATGG")));
+
+    auto ambiguous = KmerTable::compile("ATRCATGN", *iupac_codes);
+    ASSERT_TRUE(ambiguous.has_value());
+    EXPECT_EQ(ambiguous->cardinality(), 8);
+    EXPECT_TRUE(ambiguous->contains(codeOf("ATACATGT")));
+    EXPECT_FALSE(ambiguous->contains(codeOf("ATCCATGT")));
+
+    EXPECT_EQ(KmerTable::compile("NNNNNNNN", *iupac_codes)->cardinality(), 65536);
+
+    // Wrong length and invalid codes cannot be compiled
+    EXPECT_FALSE(KmerTable::compile("ATGC", *iupac_codes).has_value());
+    EXPECT_FALSE(KmerTable::compile("ATGCATGX", *iupac_codes).has_value());
+}
+
+TEST_F(MotifKernelsTest, MotifPanelMatchesEveryMotif) {
+    std::vector<Motif> motifs;
+    for (int i = 0; i < 70; ++i) {
+        motifs.emplace_back(i % 2 == 0 ? "ATGCATGC" : "ATRCNTGC", 0.0, 0.0, 0.0);
+    }
+    motifs[69].pattern = "TTTTTTTT";
+
+    auto panel = MotifPanel::compile(motifs, *iupac_codes);
+    ASSERT_TRUE(panel.has_value());
+    EXPECT_EQ(panel->motifCount(), 70);
+    EXPECT_EQ(panel->motifLength(), 8);
+    EXPECT_EQ(panel->wordCount(), 2);
+
+    ChIPSequence seq("seq", "ATACTTGCATGCATGC");
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+
+    std::vector<uint64_t> hits(panel->wordCount());
+
+    // ATACTTGC only matches the ambiguous motifs (odd indices except 69)
+    panel->matchWindow(store.bases(0).data(), hits.data());
+    for (size_t m = 0; m < motifs.size(); ++m) {
+        const bool hit = (hits[m / 64] >> (m % 64)) & 1;
+        EXPECT_EQ(hit, m % 2 == 1 && m != 69) << m;
+    }
+
+    // ATGCATGC matches every motif except TTTTTTTT
+    panel->matchWindow(store.bases(0).data() + 8, hits.data());
+    EXPECT_EQ(hits[0], ~0ull);
+    EXPECT_EQ(hits[1], (1ull << 5) - 1);
+}
+
+TEST_F(MotifKernelsTest, MotifPanelRejectsMixedLengths) {
+    std::vector<Motif> motifs = {
+        Motif("ATGCATGC", 0.0, 0.0, 0.0),
+        Motif("ATGC", 0.0, 0.0, 0.0)
+    };
+    EXPECT_FALSE(MotifPanel::compile(motifs, *iupac_codes).has_value());
+    EXPECT_FALSE(MotifPanel::compile({}, *iupac_codes).has_value());
+}
+
+TEST_F(MotifKernelsTest, PrefilterPlanSelectsSpecificPositions) {
+    auto plan = PrefilterPlan::compile("NNRANYKN", *iupac_codes);
+    ASSERT_TRUE(plan.has_value());
+    EXPECT_EQ(plan->motifLength(), 8);
+
+    // A at position 3 first, then one of the two-base codes
+    const auto positions = plan->filterPositions();
+    ASSERT_EQ(positions.size(), 2);
+    EXPECT_EQ(positions[0], 3);
+    EXPECT_EQ(positions[1], 2);  // first of the equally selective R, Y, K
+    EXPECT_DOUBLE_EQ(plan->passRate(), 0.25 * 0.5);
+
+    // Only N elsewhere: a single filter position is enough
+    auto single = PrefilterPlan::compile("NNNGNNNN", *iupac_codes);
+    ASSERT_TRUE(single.has_value());
+    EXPECT_EQ(single->filterPositions().size(), 1);
+
+    EXPECT_FALSE(PrefilterPlan::compile("", *iupac_codes).has_value());
+    EXPECT_FALSE(PrefilterPlan::compile("ATGX", *iupac_codes).has_value());
+}
+
+TEST_F(MotifKernelsTest, PrefilterCandidatesAndVerify) {
+    ChIPSequence seq("seq", "TTTTATGCATGCTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTATGCATGCTTTT");
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+    auto plan = PrefilterPlan::compile("ATGCATGC", *iupac_codes);
+    ASSERT_TRUE(plan.has_value());
+
+    const uint64_t candidates = plan->candidates(store.flatBases().data());
+    EXPECT_TRUE((candidates >> 4) & 1);
+    EXPECT_TRUE((candidates >> 56) & 1);
+
+    size_t verified = 0;
+    for (uint64_t c = candidates; c != 0; c &= c - 1) {
+        const size_t pos = static_cast<size_t>(std::countr_zero(c));
+        if (pos + 8 <= seq.sequence.size() && plan->verify(store.flatBases().data() + pos)) {
+            ++verified;
+            EXPECT_TRUE(pos == 4 || pos == 8 || pos == 56);
+        }
+    }
+    EXPECT_EQ(verified, 2);  // ATGCATGC at 4 and 56; 8 is ATGCTTTT
+}
+
+TEST_F(MotifKernelsTest, SwarMatchBlock) {
+    ChIPSequence seq("seq", "TTTTATGCATGCTTTTTTTTTTTTATACTTGCTTTTTTTT");
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+    store.buildBaseNibbles();
+
+    auto swar = SwarMotif::compile("ATRCNTGC", *iupac_codes);
+    ASSERT_TRUE(swar.has_value());
+    EXPECT_EQ(swar->motifLength(), 8);
+
+    const auto words = store.baseNibbles(0);
+
+    // ATGCATGC at 4 and ATACTTGC at 24 (window 8 is ATGCTTTT)
+    EXPECT_EQ(swar->matchBlock(words, 0), 1u << 4);
+    EXPECT_EQ(swar->matchBlock(words, 16), 1u << 8);
+    EXPECT_EQ(swar->matchBlock(words, 20), 1u << 4);
+
+    // Windows past the end of the sequence never match
+    auto tail = SwarMotif::compile("TTTTTTTT", *iupac_codes);
+    ASSERT_TRUE(tail.has_value());
+    EXPECT_EQ(tail->matchBlock(words, 32), 1u << 0);
+
+    EXPECT_FALSE(SwarMotif::compile("ATGX", *iupac_codes).has_value());
+}
+
+TEST_F(MotifKernelsTest, MotifPanelBothStrands) {
+    std::vector<Motif> motifs = {Motif("TGTTTACA", 0.0, 0.0, 0.0),
+                                 Motif("ACGTACGT", 0.0, 0.0, 0.0),
+                                 Motif("GGGGGGGG", 0.0, 0.0, 0.0)};
+
+    auto panel = MotifPanel::compile(motifs, *iupac_codes, true);
+    ASSERT_TRUE(panel.has_value());
+    EXPECT_EQ(panel->wordCount(), 1);
+    EXPECT_EQ(panel->strandCount(), 2);
+
+    // TGTAAACA is the reverse complement of motif 0, ACGTACGT is palindromic
+    ChIPSequence seq("seq", "TGTAAACAACGTACGTCCCCCCCC");
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+    std::vector<uint64_t> hits(panel->wordCount() * panel->strandCount());
+
+    panel->matchWindow(store.bases(0).data(), hits.data());
+    EXPECT_EQ(hits[0], 0u);
+    EXPECT_EQ(hits[1], 1u);
+
+    panel->matchWindow(store.bases(0).data() + 8, hits.data());
+    EXPECT_EQ(hits[0], 2u);
+    EXPECT_EQ(hits[1], 2u);
+
+    panel->matchWindow(store.bases(0).data() + 16, hits.data());
+    EXPECT_EQ(hits[0], 0u);
+    EXPECT_EQ(hits[1], 4u);
+
+    // Merged tables accept both strands in one lookup
+    auto table = KmerTable::compile("TGTTTACA", *iupac_codes);
+    auto reverse = KmerTable::compile(iupac_codes->reverseComplement("TGTTTACA"), *iupac_codes);
+    ASSERT_TRUE(table && reverse);
+    table->merge(*reverse);
+    EXPECT_EQ(table->cardinality(), 2);
+    EXPECT_TRUE(table->contains(codeOf("TGTTTACA")));
+    EXPECT_TRUE(table->contains(codeOf("TGTAAACA")));
+}
+
+TEST_F(MotifKernelsTest, MismatchMotifCountsLevels) {
+    EXPECT_FALSE(MismatchMotif::compile("ATGCATGC", *iupac_codes, 3).has_value());
+    EXPECT_FALSE(MismatchMotif::compile("ATGXATGC", *iupac_codes, 1).has_value());
+    // Windows past MAX_MOTIF_LENGTH would read beyond the store padding
+    EXPECT_TRUE(MismatchMotif::compile(std::string(MAX_MOTIF_LENGTH, 'N'), *iupac_codes, 1).has_value());
+    EXPECT_FALSE(MismatchMotif::compile(std::string(MAX_MOTIF_LENGTH + 1, 'N'), *iupac_codes, 1).has_value());
+
+    auto motif = MismatchMotif::compile("ATGCATGC", *iupac_codes, 2);
+    ASSERT_TRUE(motif.has_value());
+    EXPECT_EQ(motif->motifLength(), 8);
+    EXPECT_EQ(motif->maxMismatches(), 2);
+
+    // Offsets 0, 10 and 20 hold windows with 0, 1 and 2 mismatches
+    std::string text = "ATGCATGCCCATGCTTGCCCATGCTTGGCC";
+    text.resize(128, 'C');
+    ChIPSequence seq("seq", text);
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+
+    const auto levels = motif->countMismatches(store.bases(0).data());
+    for (size_t t = 0; t < 64; ++t) {
+        const size_t mismatches = iupac_codes->countMismatches(text, "ATGCATGC", t);
+        for (size_t k = 0; k <= 2; ++k) {
+            EXPECT_EQ((levels[k] >> t) & 1, mismatches <= k ? 1u : 0u) << t << " " << k;
+        }
+    }
+    EXPECT_EQ(levels[0], 1u);
+    EXPECT_EQ(levels[1] & (1ull << 10), 1ull << 10);
+    EXPECT_EQ(levels[2] & (1ull << 20), 1ull << 20);
+
+    // Levels above the budget stay empty
+    auto exact = MismatchMotif::compile("ATGCATGC", *iupac_codes, 0);
+    ASSERT_TRUE(exact.has_value());
+    const auto exact_levels = exact->countMismatches(store.bases(0).data());
+    EXPECT_EQ(exact_levels[0], 1u);
+    EXPECT_EQ(exact_levels[1], 0u);
+    EXPECT_EQ(exact_levels[2], 0u);
+}
+
+TEST_F(MotifKernelsTest, GappedMotifCompile) {
+    EXPECT_TRUE(GappedMotif::isGapped("TRTTKAC[2-6]HYTW"));
+    EXPECT_FALSE(GappedMotif::isGapped("TRTTKACHYTW"));
+
+    auto motif = GappedMotif::compile("TRTTKAC[2-6]HYTW", *iupac_codes);
+    ASSERT_TRUE(motif.has_value());
+    EXPECT_EQ(motif->minLength(), 13);
+    EXPECT_EQ(motif->spacer(), std::make_pair(2uz, 6uz));
+    EXPECT_EQ(motif->reverseComplement(*iupac_codes), "WARD[2-6]GTMAAYA");
+
+    auto fixed = GappedMotif::compile("ACG[3]TT", *iupac_codes);
+    ASSERT_TRUE(fixed.has_value());
+    EXPECT_EQ(fixed->spacer(), std::make_pair(3uz, 3uz));
+    EXPECT_EQ(fixed->reverseComplement(*iupac_codes), "AA[3]CGT");
+
+    for (const char* bad : {"ACGT", "ACG[3", "[2-4]ACG", "ACG[2-4]", "ACG[4-2]TT",
+                            "ACG[]TT", "ACG[2-]TT", "ACG[-2]TT", "ACG[x]TT",
+                            "ACX[2]TT", "ACG[1]T[2]T", "ACG[65]TT"}) {
+        EXPECT_FALSE(GappedMotif::compile(bad, *iupac_codes).has_value()) << bad;
+    }
+}
+
+TEST_F(MotifKernelsTest, GappedMotifMatchesExpansions) {
+    TestRandom rng(99);
+
+    // Mostly A/C so that both half-sites hit often, across several words
+    std::string text = randomSequence(rng, 300, "AACCAGT");
+    ChIPSequence seq("seq", text);
+    SequenceStore store(std::span<const ChIPSequence>(&seq, 1));
+
+    for (const char* pattern : {"MAC[0-3]CA", "AC[0]CA", "AMA[5-9]CM", "A[40-64]C"}) {
+        auto motif = GappedMotif::compile(pattern, *iupac_codes);
+        ASSERT_TRUE(motif.has_value()) << pattern;
+        const std::string_view view(pattern);
+        const std::string left(view.substr(0, view.find('[')));
+        const std::string right(view.substr(view.find(']') + 1));
+        const auto [low, high] = motif->spacer();
+
+        for (size_t length : {text.size(), 64uz, 70uz, 5uz}) {
+            std::vector<uint64_t> hits;
+            std::vector<uint64_t> scratch;
+            motif->matchRun(store.bases(0).data(), length, hits, scratch);
+            ASSERT_EQ(hits.size(), (length + 63) / 64);
+
+            const std::string_view run = std::string_view(text).substr(0, length);
+            for (size_t t = 0; t < length; ++t) {
+                size_t spacer = high + 1;
+                for (size_t gap = low; gap <= high && spacer > high; ++gap) {
+                    const std::string expanded = left + std::string(gap, 'N') + right;
+                    if (iupac_codes->matchesMotif(run, expanded, t)) {
+                        spacer = gap;
+                    }
+                }
+                const bool hit = (hits[t / 64] >> (t % 64)) & 1u;
+                ASSERT_EQ(hit, spacer <= high) << pattern << " " << length << " " << t;
+                if (hit) {
+                    EXPECT_EQ(motif->spacerAt(store.bases(0).data() + t), spacer);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "motif_neighbourhood.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifNeighbourhoodTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // AT-rich background with TGASTCA planted in a third of the sequences
+        for (int i = 0; i < 240; ++i) {
+            const int length = i % 40 == 0 ? 150 : 30 + static_cast<int>(rng.next() % 15);
+            std::string seq = randomSequence(rng, length, "AAATTTCGCG");
+            if (i % 3 == 0) {
+                seq.replace(rng.next() % 20, 7, rng.next() % 2 ? "TGACTCA" : "TGAGTCA");
+            }
+            if (i % 11 == 0) {
+                seq[static_cast<size_t>(rng.next() % 25)] = 'N';
+            }
+            if (i % 13 == 0) {
+                seq = "TGAC";
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+        motifs = {Motif("TGASTCA", 0, 0, 0), Motif("TRTTKAC", 0, 0, 0), Motif("NNGAC", 0, 0, 0),
+                  Motif("A", 0, 0, 0), Motif("TG[2,4]CA", 0, 0, 0), Motif("TGXCA", 0, 0, 0)};
+    }
+
+    uint64_t scanCount(const std::string& pattern, bool both_strands) const {
+        const IUPACCodes& iupac = IUPACCodes::getInstance();
+        const std::string reverse = iupac.reverseComplement(pattern);
+        uint64_t count = 0;
+        for (const auto& sequence : sequences) {
+            const std::string& text = sequence.sequence;
+            bool found = false;
+            for (size_t pos = 0; !found && pos + pattern.size() <= text.size(); ++pos) {
+                bool forward = true;
+                bool backward = both_strands;
+                for (size_t p = 0; p < pattern.size(); ++p) {
+                    forward &= iupac.matches(text[pos + p], pattern[p]);
+                    backward &= iupac.matches(text[pos + p], reverse[p]);
+                }
+                found = forward || backward;
+            }
+            count += found;
+        }
+        return count;
+    }
+
+    std::vector<ChIPSequence> sequences;
+    std::vector<Motif> motifs;
+    TestRandom rng{53};
+};
+
+TEST_F(MotifNeighbourhoodTest, NeighbourCountsMatchScan) {
+    const SequenceStore store(sequences);
+    for (const bool both_strands : {false, true}) {
+        NeighbourhoodOptions options;
+        options.enabled = true;
+        options.both_strands = both_strands;
+        const MotifNeighbourhood neighbourhood(store, IUPACCodes::getInstance(), options);
+        const auto refinements = neighbourhood.refine(motifs);
+        ASSERT_EQ(refinements.size(), motifs.size());
+        EXPECT_EQ(neighbourhood.scans(), 1);
+        EXPECT_EQ(neighbourhood.sequenceCount(), sequences.size());
+
+        for (size_t m = 0; m < 4; ++m) {
+            const auto& refinement = refinements[m];
+            ASSERT_EQ(refinement.trail.size(), 1) << motifs[m].pattern;
+            EXPECT_EQ(refinement.trail[0].pattern, motifs[m].pattern);
+            EXPECT_EQ(refinement.trail[0].sequences, scanCount(motifs[m].pattern, both_strands));
+
+            // Each position gains or loses one base of its code
+            size_t expected_neighbours = 0;
+            for (const char code : motifs[m].pattern) {
+                expected_neighbours += std::popcount(IUPACCodes::getInstance().getBaseMask(code)) == 1 ? 3 : 4;
+            }
+            ASSERT_EQ(refinement.neighbours.size(), expected_neighbours);
+            for (const auto& variant : refinement.neighbours) {
+                std::string pattern = motifs[m].pattern;
+                EXPECT_EQ(pattern[variant.position], variant.from);
+                pattern[variant.position] = variant.to;
+                EXPECT_EQ(variant.pattern, pattern);
+                EXPECT_EQ(variant.sequences, scanCount(pattern, both_strands)) << pattern << " " << both_strands;
+                if (variant.sequences > 0) {
+                    EXPECT_DOUBLE_EQ(variant.enrichment, static_cast<double>(variant.sequences) / variant.expected);
+                }
+            }
+        }
+        EXPECT_TRUE(refinements[4].trail.empty());
+        EXPECT_TRUE(refinements[5].neighbours.empty());
+    }
+}
+
+TEST_F(MotifNeighbourhoodTest, ClimbsToLocalOptimum) {
+    const SequenceStore store(sequences);
+    NeighbourhoodOptions options;
+    options.enabled = true;
+    options.max_steps = 10;
+    options.min_frequency = 0.1;
+    const std::vector<Motif> seeds = {Motif("TGNNTCN", 0, 0, 0)};
+    const MotifNeighbourhood neighbourhood(store, IUPACCodes::getInstance(), options);
+    const auto trail = neighbourhood.refine(seeds)[0].trail;
+    ASSERT_GE(trail.size(), 3);
+    EXPECT_EQ(neighbourhood.scans(), std::min(trail.size(), options.max_steps));
+
+    for (size_t step = 1; step < trail.size(); ++step) {
+        EXPECT_GT(trail[step].enrichment, trail[step - 1].enrichment);
+        EXPECT_GE(trail[step].sequences, 24);
+        std::string previous = trail[step - 1].pattern;
+        EXPECT_EQ(previous[trail[step].position], trail[step].from);
+        previous[trail[step].position] = trail[step].to;
+        EXPECT_EQ(previous, trail[step].pattern);
+        EXPECT_EQ(trail[step].sequences, scanCount(trail[step].pattern, false));
+    }
+
+    // No frequent neighbour of the end point is more enriched
+    options.max_steps = 0;
+    const MotifNeighbourhood check(store, IUPACCodes::getInstance(), options);
+    const auto last = check.refine(std::vector<Motif>{Motif(trail.back().pattern, 0, 0, 0)})[0];
+    EXPECT_EQ(last.trail[0].pattern, trail.back().pattern);
+    EXPECT_EQ(last.trail[0].sequences, trail.back().sequences);
+    for (const auto& variant : last.neighbours) {
+        if (variant.sequences >= 24) {
+            EXPECT_LE(variant.enrichment, trail.back().enrichment) << variant.pattern;
+        }
+    }
+}
+
+TEST_F(MotifNeighbourhoodTest, PartsReduceToWholeStore) {
+    NeighbourhoodOptions options;
+    options.enabled = true;
+    options.max_steps = 4;
+    options.both_strands = true;
+    const SequenceStore whole(sequences);
+    const auto expected = MotifNeighbourhood(whole, IUPACCodes::getInstance(), options).refine(motifs);
+
+    // Two "processes" over the halves, summing counts through shared memory
+    const auto middle = sequences.begin() + 100;
+    const std::vector<ChIPSequence> first(sequences.begin(), middle);
+    const std::vector<ChIPSequence> second(middle, sequences.end());
+    std::mutex mutex;
+    std::barrier sync(2);
+    std::vector<uint64_t> sum;
+    bool first_arrived = false;
+    const auto reduce = [&](std::span<uint64_t> counts) {
+        {
+            std::lock_guard lock(mutex);
+            if (!first_arrived) {
+                sum.assign(counts.begin(), counts.end());
+            } else {
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    sum[i] += counts[i];
+                }
+            }
+            first_arrived = !first_arrived;
+        }
+        sync.arrive_and_wait();
+        std::ranges::copy(sum, counts.begin());
+        sync.arrive_and_wait();
+    };
+
+    std::vector<MotifRefinement> parts[2];
+    const auto run = [&](const std::vector<ChIPSequence>& half, std::vector<MotifRefinement>& out) {
+        const SequenceStore store(half);
+        out = MotifNeighbourhood(store, IUPACCodes::getInstance(), options, reduce).refine(motifs);
+    };
+    std::thread worker(run, std::cref(first), std::ref(parts[0]));
+    run(second, parts[1]);
+    worker.join();
+
+    for (const auto& part : parts) {
+        ASSERT_EQ(part.size(), expected.size());
+        for (size_t m = 0; m < expected.size(); ++m) {
+            EXPECT_EQ(part[m].neighbours, expected[m].neighbours);
+            EXPECT_EQ(part[m].trail, expected[m].trail);
+        }
+    }
+}
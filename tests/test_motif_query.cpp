@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "motif_query.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class MotifQueryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        names = {"ACGT", "TRTTKAC", "GATA", "AND"};
+    }
+
+    HitBitsets randomBitsets(size_t sequences) {
+        HitBitsets bitsets(names.size(), sequences);
+        for (size_t m = 0; m < names.size(); ++m) {
+            for (size_t s = 0; s < sequences; ++s) {
+                if (rng.next() % 3 == 0) {
+                    bitsets.set(m, s);
+                }
+            }
+        }
+        return bitsets;
+    }
+
+    std::vector<std::string> names;
+    TestRandom rng{5};
+};
+
+TEST_F(MotifQueryTest, ParseErrorsReportPosition) {
+    auto query = MotifQuery::parse("ACGT AND", names);
+    ASSERT_FALSE(query.has_value());
+    EXPECT_EQ(query.error().position, 8);
+
+    query = MotifQuery::parse("(ACGT OR GATA", names);
+    ASSERT_FALSE(query.has_value());
+    EXPECT_EQ(query.error().position, 13);
+
+    query = MotifQuery::parse("ACGT OR CCCC", names);
+    ASSERT_FALSE(query.has_value());
+    EXPECT_EQ(query.error().position, 8);
+    EXPECT_NE(query.error().message.find("CCCC"), std::string::npos);
+
+    query = MotifQuery::parse("ACGT GATA", names);
+    ASSERT_FALSE(query.has_value());
+    EXPECT_EQ(query.error().position, 5);
+
+    query = MotifQuery::parse("#4", names);
+    ASSERT_FALSE(query.has_value());
+    EXPECT_EQ(query.error().position, 1);
+
+    EXPECT_FALSE(MotifQuery::parse("", names).has_value());
+}
+
+TEST_F(MotifQueryTest, KeywordsSymbolsAndIndices) {
+    const HitBitsets bitsets = randomBitsets(300);
+    const auto expected =
+        MotifQuery::parse("ACGT AND NOT GATA OR TRTTKAC", names);
+    ASSERT_TRUE(expected.has_value());
+
+    for (const char* text : {"ACGT and not GATA oR TRTTKAC",
+                             "ACGT & !GATA | TRTTKAC",
+                             "(ACGT & ~GATA) | TRTTKAC",
+                             "#0 And Not #2 Or #1"}) {
+        const auto query = MotifQuery::parse(text, names);
+        ASSERT_TRUE(query.has_value()) << text;
+        EXPECT_EQ(query->evaluate(bitsets), expected->evaluate(bitsets))
+            << text;
+    }
+
+    // A motif named like a keyword is reachable by index
+    const auto keyword = MotifQuery::parse("#3", names);
+    ASSERT_TRUE(keyword.has_value());
+    EXPECT_EQ(keyword->count(bitsets), bitsets.count(3));
+}
+
+TEST_F(MotifQueryTest, EvaluateMatchesBruteForce) {
+    // Several blocks, the last one partial
+    const size_t sequences = 64 * MotifQuery::BLOCK_WORDS * 3 + 45;
+    const HitBitsets bitsets = randomBitsets(sequences);
+
+    const auto query =
+        MotifQuery::parse("(ACGT AND NOT TRTTKAC) OR (GATA AND #3)", names);
+    ASSERT_TRUE(query.has_value());
+    EXPECT_EQ(query->expression(),
+              "(ACGT AND NOT TRTTKAC) OR (GATA AND #3)");
+
+    const std::vector<uint64_t> words = query->evaluate(bitsets);
+    ASSERT_EQ(words.size(), bitsets.wordCount());
+    size_t expected_count = 0;
+    for (size_t s = 0; s < sequences; ++s) {
+        const bool expected = (bitsets.test(0, s) && !bitsets.test(1, s)) ||
+                              (bitsets.test(2, s) && bitsets.test(3, s));
+        expected_count += expected;
+        ASSERT_EQ(((words[s / 64] >> (s % 64)) & 1u) != 0, expected) << s;
+    }
+    EXPECT_EQ(query->count(bitsets), expected_count);
+}
+
+TEST_F(MotifQueryTest, NotLeavesPaddingClear) {
+    HitBitsets bitsets(names.size(), 70);
+    bitsets.set(0, 3);
+
+    const auto query = MotifQuery::parse("NOT ACGT", names);
+    ASSERT_TRUE(query.has_value());
+    const std::vector<uint64_t> words = query->evaluate(bitsets);
+    EXPECT_EQ(words[1], (1ull << 6) - 1);
+    EXPECT_EQ(query->count(bitsets), 69);
+
+    const auto twice = MotifQuery::parse("NOT NOT NOT GATA", names);
+    ASSERT_TRUE(twice.has_value());
+    EXPECT_EQ(twice->count(bitsets), 70);
+
+    EXPECT_EQ(query->count(HitBitsets(names.size(), 0)), 0);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "pwm_scorer.h"
+#include "test_utils.h"
+#include <cmath>
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class PwmScorerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+
+        TestRandom rng(7);
+        for (int i = 0; i < 300; ++i) {
+            const size_t length = 20 + rng.next() % 200;
+            std::string seq = randomSequence(rng, length);
+            if (i % 10 == 0) {
+                seq[rng.next() % length] = 'N';
+            }
+            sequences.emplace_back(std::format("seq{}", i), seq);
+        }
+    }
+
+    // Best window score over A/C/G/T windows, NO_PWM_HIT below the threshold
+    static float referenceBest(const PositionWeightMatrix& pwm, std::string_view sequence,
+                               float threshold) {
+        float best = NO_PWM_HIT;
+        for (size_t pos = 0; pos + pwm.length() <= sequence.size(); ++pos) {
+            const std::string_view window = sequence.substr(pos, pwm.length());
+            if (!std::ranges::all_of(window, isNucleotide)) {
+                continue;
+            }
+            std::vector<uint8_t> codes;
+            for (char c : window) {
+                codes.push_back(encodeNucleotide(c));
+            }
+            const float score = pwm.score(codes.data());
+            if (score >= threshold) {
+                best = std::max(best, score);
+            }
+        }
+        return best;
+    }
+
+    IUPACCodes* iupac_codes;
+    std::vector<ChIPSequence> sequences;
+};
+
+TEST_F(PwmScorerTest, FromPatternWeights) {
+    auto pwm = PositionWeightMatrix::fromPattern("ARN", *iupac_codes, 0.01);
+    ASSERT_TRUE(pwm.has_value());
+    EXPECT_EQ(pwm->length(), 3);
+
+    const uint8_t a = encodeNucleotide('A');
+    const uint8_t c = encodeNucleotide('C');
+    const uint8_t g = encodeNucleotide('G');
+    EXPECT_NEAR(pwm->weight(0, a), std::log2(0.99 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(0, c), std::log2(0.01 / 3 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(1, g), std::log2(0.99 / 2 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(2, c), 0.0, 1e-6);
+    EXPECT_NEAR(pwm->maxScore(), std::log2(0.99 / 0.25) + std::log2(0.99 / 2 / 0.25), 1e-5);
+
+    EXPECT_FALSE(PositionWeightMatrix::fromPattern("", *iupac_codes).has_value());
+    EXPECT_FALSE(PositionWeightMatrix::fromPattern("ATX", *iupac_codes).has_value());
+    EXPECT_FALSE(PositionWeightMatrix::fromPattern("ATG", *iupac_codes, 0.0).has_value());
+}
+
+TEST_F(PwmScorerTest, FromCountsUsesAcgtColumns) {
+    const std::vector<std::array<double, 4>> counts = {
+        {10, 0, 0, 0}, {0, 0, 0, 10}, {2.5, 2.5, 2.5, 2.5}};
+    auto pwm = PositionWeightMatrix::fromCounts(counts, 0.5);
+    ASSERT_TRUE(pwm.has_value());
+    EXPECT_NEAR(pwm->weight(0, encodeNucleotide('A')), std::log2(10.5 / 12 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(1, encodeNucleotide('T')), std::log2(10.5 / 12 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(1, encodeNucleotide('G')), std::log2(0.5 / 12 / 0.25), 1e-5);
+    EXPECT_NEAR(pwm->weight(2, encodeNucleotide('C')), 0.0, 1e-6);
+
+    // Zero counts without pseudocount would give -inf weights
+    EXPECT_FALSE(PositionWeightMatrix::fromCounts(counts, 0.0).has_value());
+    EXPECT_FALSE(PositionWeightMatrix::fromCounts({}).has_value());
+}
+
+TEST_F(PwmScorerTest, RejectsInvalidArguments) {
+    EXPECT_THROW(PwmScorer(std::span<const PositionWeightMatrix>()), std::invalid_argument);
+    const std::vector<PositionWeightMatrix> matrices = {
+        *PositionWeightMatrix::fromPattern("ATGC", *iupac_codes)};
+    EXPECT_THROW(PwmScorer(matrices, 1.5), std::invalid_argument);
+    EXPECT_THROW(PwmScorer(matrices, -0.1), std::invalid_argument);
+}
+
+TEST_F(PwmScorerTest, BestScoresMatchReference) {
+    std::vector<PositionWeightMatrix> matrices;
+    for (std::string_view pattern : {"TRTTKAC", "ATGCATGC", "NNGCNNAT", "TGTTTACWYW", "ACGTACGTACGTACGTAC"}) {
+        matrices.push_back(*PositionWeightMatrix::fromPattern(pattern, *iupac_codes));
+    }
+    // Non-uniform weights exercise the evaluation reordering
+    matrices.push_back(*PositionWeightMatrix::fromCounts(std::vector<std::array<double, 4>>{
+        {5, 1, 1, 3}, {0, 9, 1, 0}, {1, 1, 1, 7}, {4, 4, 1, 1}, {2, 0, 8, 0}, {3, 3, 3, 1}}));
+
+    const SequenceStore store(sequences);
+    for (double relative : {0.0, 0.6, 0.8, 0.99}) {
+        const PwmScorer scorer(matrices, relative);
+        const PwmScores scores = scorer.scoreBest(store);
+        ASSERT_EQ(scores.sequence_count, sequences.size());
+
+        for (size_t m = 0; m < matrices.size(); ++m) {
+            size_t hits = 0;
+            for (size_t s = 0; s < sequences.size(); ++s) {
+                const float expected =
+                    referenceBest(matrices[m], sequences[s].sequence, scorer.threshold(m));
+                const float actual = scores.bestScores(m)[s];
+                if (expected == NO_PWM_HIT) {
+                    EXPECT_EQ(actual, NO_PWM_HIT) << "matrix " << m << " sequence " << s;
+                } else {
+                    EXPECT_NEAR(actual, expected, 1e-4) << "matrix " << m << " sequence " << s;
+                    ++hits;
+                }
+            }
+            EXPECT_EQ(scores.hit_counts[m], hits);
+        }
+    }
+}
+
+TEST_F(PwmScorerTest, FullThresholdFindsExactMatches) {
+    const std::vector<PositionWeightMatrix> matrices = {
+        *PositionWeightMatrix::fromPattern("GATTACA", *iupac_codes)};
+    const PwmScorer scorer(matrices, 0.99);
+
+    const std::vector<uint8_t> codes = [] {
+        std::vector<uint8_t> out;
+        for (char c : std::string_view("CCCCCCCCCCCCCCCCCCCCGATTACACCCCCC")) {
+            out.push_back(encodeNucleotide(c));
+        }
+        return out;
+    }();
+    EXPECT_NEAR(scorer.bestScore(0, codes), matrices[0].maxScore(), 1e-4);
+    EXPECT_EQ(scorer.bestScore(0, std::span(codes).first(25)), NO_PWM_HIT);
+}
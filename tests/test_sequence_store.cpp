@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "sequence_store.h"
+
+using namespace dna_motif;
+
+class SequenceStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sequences = {
+            ChIPSequence("seq1", "ATGCATGCATGCATGCATGCATGCATGCATGCATGCATGC"),
+            ChIPSequence("seq2", "acgtacgtacgtacgtacgtacgtacgtacgtacgtacgt"),
+            ChIPSequence("seq3", "ATGCATGCNNGCATGCATGCATGCATGCATGCATGCATGC"),
+            ChIPSequence("short", "ATG")
+        };
+    }
+
+    static uint16_t referenceCode(std::string_view window) {
+        uint16_t code = 0;
+        for (char c : window) {
+            code = static_cast<uint16_t>((code << 2) | encodeNucleotide(c));
+        }
+        return code;
+    }
+
+    std::vector<ChIPSequence> sequences;
+};
+
+TEST_F(SequenceStoreTest, NucleotideEncoding) {
+    EXPECT_EQ(encodeNucleotide('A'), 0);
+    EXPECT_EQ(encodeNucleotide('C'), 1);
+    EXPECT_EQ(encodeNucleotide('T'), 2);
+    EXPECT_EQ(encodeNucleotide('G'), 3);
+    EXPECT_EQ(encodeNucleotide('g'), 3);
+
+    // Complement is code ^ 2
+    EXPECT_EQ(encodeNucleotide('A') ^ 2, encodeNucleotide('T'));
+    EXPECT_EQ(encodeNucleotide('C') ^ 2, encodeNucleotide('G'));
+
+    EXPECT_TRUE(isNucleotide('t'));
+    EXPECT_FALSE(isNucleotide('N'));
+}
+
+TEST_F(SequenceStoreTest, DecodesBases) {
+    SequenceStore store(sequences);
+
+    ASSERT_EQ(store.size(), 4);
+    EXPECT_EQ(store.bases(0).size(), 40);
+    EXPECT_EQ(store.bases(3).size(), 3);
+    EXPECT_EQ(store.bases(0)[0], encodeNucleotide('A'));
+    EXPECT_EQ(store.bases(1)[3], encodeNucleotide('T'));
+
+    EXPECT_TRUE(store.isClean(0));
+    EXPECT_TRUE(store.isClean(1));
+    EXPECT_FALSE(store.isClean(2));
+    EXPECT_EQ(store.dirtyCount(), 1);
+}
+
+TEST_F(SequenceStoreTest, WindowCodesMatchReference) {
+    SequenceStore store(sequences);
+    EXPECT_FALSE(store.hasWindowCodes());
+    EXPECT_TRUE(store.windowCodes(0).empty());
+
+    store.buildWindowCodes();
+    ASSERT_TRUE(store.hasWindowCodes());
+
+    for (size_t i = 0; i < 2; ++i) {
+        const auto codes = store.windowCodes(i);
+        ASSERT_EQ(codes.size(), 33);
+        for (size_t w = 0; w < codes.size(); ++w) {
+            EXPECT_EQ(codes[w], referenceCode(std::string_view(sequences[i].sequence).substr(w, 8)));
+        }
+    }
+
+    // Too short for a single window
+    EXPECT_TRUE(store.windowCodes(3).empty());
+}
+
+TEST_F(SequenceStoreTest, EmptyStore) {
+    SequenceStore store;
+    EXPECT_TRUE(store.empty());
+
+    store.buildWindowCodes();
+    EXPECT_EQ(store.size(), 0);
+}
+
+TEST_F(SequenceStoreTest, BaseNibblesAreOneHot) {
+    SequenceStore store(sequences);
+    EXPECT_FALSE(store.hasBaseNibbles());
+
+    store.buildBaseNibbles();
+    ASSERT_TRUE(store.hasBaseNibbles());
+
+    // 40 bases -> 3 words plus the trailing zero word
+    const auto words = store.baseNibbles(0);
+    ASSERT_EQ(words.size(), 4);
+    EXPECT_EQ(words.back(), 0);
+
+    for (size_t j = 0; j < sequences[0].sequence.size(); ++j) {
+        const uint64_t nibble = (words[j / 16] >> (4 * (j % 16))) & 0xF;
+        EXPECT_EQ(nibble, 1u << encodeNucleotide(sequences[0].sequence[j]));
+    }
+
+    // Unused nibbles of the last word stay zero
+    EXPECT_EQ(words[2] >> 32, 0);
+    EXPECT_EQ(store.baseNibbles(3).size(), 2);
+}
+
+TEST_F(SequenceStoreTest, UniformLength) {
+    SequenceStore mixed(sequences);
+    EXPECT_EQ(mixed.uniformLength(), 0);
+
+    SequenceStore uniform(std::span<const ChIPSequence>(sequences).first(3));
+    EXPECT_EQ(uniform.uniformLength(), 40);
+
+    EXPECT_EQ(SequenceStore().uniformLength(), 0);
+}
+
+TEST_F(SequenceStoreTest, ZoneMapsHoldBlockWindows) {
+    SequenceStore store(sequences);
+    EXPECT_FALSE(store.hasZoneMaps());
+    EXPECT_EQ(store.zoneCount(), 0);
+
+    store.buildZoneMaps(2);
+    ASSERT_TRUE(store.hasZoneMaps());
+    EXPECT_EQ(store.zoneBlockSize(), 2);
+    ASSERT_EQ(store.zoneCount(), 2);
+
+    const auto present = [&](size_t block, std::string_view window) {
+        const uint16_t code = referenceCode(window);
+        return ((store.zoneMap(block)[code >> 6] >> (code & 63)) & 1u) != 0;
+    };
+    EXPECT_TRUE(present(0, "ATGCATGC"));
+    EXPECT_TRUE(present(0, "ACGTACGT"));
+    EXPECT_FALSE(present(0, "AAAAAAAA"));
+
+    // Block 1 holds a dirty and a short sequence only
+    EXPECT_FALSE(present(1, "ATGCATGC"));
+    const auto map = store.zoneMap(1);
+    EXPECT_TRUE(std::ranges::all_of(map, [](uint64_t word) { return word == 0; }));
+
+    // Exactly the distinct windows of the clean sequences are set
+    size_t bits = 0;
+    for (uint64_t word : store.zoneMap(0)) {
+        bits += static_cast<size_t>(std::popcount(word));
+    }
+    EXPECT_EQ(bits, 8);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "spacing_analyzer.h"
+#include "test_utils.h"
+
+using namespace dna_motif;
+using namespace dna_motif::test_utils;
+
+class SpacingAnalyzerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        iupac_codes = &IUPACCodes::getInstance();
+
+        for (int i = 0; i < 80; ++i) {
+            const int length = 40 + (i % 4) * 60;
+            std::string seq = randomSequence(rng, length, "AACGTT");
+            if (i % 9 == 0) {
+                seq[seq.size() / 3] = 'N';
+            }
+            sequences.emplace_back("s" + std::to_string(i), seq);
+        }
+
+        motifs = {Motif("AAC", 0.0, 0.0, 0.0), Motif("GTT", 0.0, 0.0, 0.0),
+                  Motif("WCG", 0.0, 0.0, 0.0), Motif("AC[1-3]T", 0.0, 0.0, 0.0),
+                  Motif("ACXT", 0.0, 0.0, 0.0)};
+    }
+
+    // Start offsets of every hit of a motif strand, by expansion of composites
+    std::vector<size_t> hitsOf(const std::string& text, const std::string& pattern,
+                               bool reverse) const {
+        std::vector<std::string> expansions;
+        if (GappedMotif::isGapped(pattern)) {
+            const auto gapped = GappedMotif::compile(pattern, *iupac_codes);
+            const std::string_view view(pattern);
+            for (size_t gap = gapped->spacer().first; gap <= gapped->spacer().second; ++gap) {
+                expansions.push_back(std::string(view.substr(0, view.find('['))) +
+                                     std::string(gap, 'N') +
+                                     std::string(view.substr(view.find(']') + 1)));
+            }
+        } else {
+            expansions.push_back(pattern);
+        }
+
+        std::vector<size_t> hits;
+        for (size_t pos = 0; pos < text.size(); ++pos) {
+            for (const auto& expansion : expansions) {
+                const std::string strand =
+                    reverse ? iupac_codes->reverseComplement(expansion) : expansion;
+                if (iupac_codes->matchesMotif(text, strand, pos)) {
+                    hits.push_back(pos);
+                    break;
+                }
+            }
+        }
+        return hits;
+    }
+
+    SpacingHistogram reference(const SpacingOptions& options,
+                               const std::vector<std::pair<size_t, size_t>>& pairs) const {
+        const size_t strands = options.both_strands ? 2 : 1;
+        SpacingHistogram histogram(pairs, strands * strands, options.max_distance);
+        const auto max_distance = static_cast<ptrdiff_t>(options.max_distance);
+        for (const auto& sequence : sequences) {
+            for (size_t p = 0; p < pairs.size(); ++p) {
+                const auto [a, b] = pairs[p];
+                for (size_t ka = 0; ka < strands; ++ka) {
+                    for (size_t kb = 0; kb < strands; ++kb) {
+                        const auto first = hitsOf(sequence.sequence, motifs[a].pattern, ka == 1);
+                        const auto second = hitsOf(sequence.sequence, motifs[b].pattern, kb == 1);
+                        for (size_t i : first) {
+                            for (size_t j : second) {
+                                const ptrdiff_t distance =
+                                    static_cast<ptrdiff_t>(j) - static_cast<ptrdiff_t>(i);
+                                if (std::abs(distance) > max_distance ||
+                                    (a == b && ka == kb && i == j)) {
+                                    continue;
+                                }
+                                histogram.row(p, ka * 2 + kb)[static_cast<size_t>(distance + max_distance)]++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return histogram;
+    }
+
+    IUPACCodes* iupac_codes;
+    std::vector<ChIPSequence> sequences;
+    std::vector<Motif> motifs;
+    TestRandom rng{17};
+};
+
+TEST_F(SpacingAnalyzerTest, RejectsInvalidOptions) {
+    SpacingOptions options;
+    EXPECT_THROW(SpacingAnalyzer(motifs, *iupac_codes, options), std::invalid_argument);
+
+    options.max_distance = 10;
+    options.pairs = {{0, 5}};
+    EXPECT_THROW(SpacingAnalyzer(motifs, *iupac_codes, options), std::invalid_argument);
+
+    options.pairs.clear();
+    const SpacingAnalyzer every(motifs, *iupac_codes, options);
+    EXPECT_EQ(every.pairs().size(), motifs.size() * (motifs.size() - 1) / 2);
+    EXPECT_EQ(every.pairs().front(), std::make_pair(0uz, 1uz));
+}
+
+TEST_F(SpacingAnalyzerTest, AllPairsMatchReference) {
+    SpacingOptions options;
+    options.max_distance = 12;
+    const SpacingAnalyzer analyzer(motifs, *iupac_codes, options);
+
+    SequenceStore store(sequences);
+    const SpacingHistogram histogram = analyzer.analyze(store);
+    EXPECT_EQ(histogram.orientation_count, 1);
+    EXPECT_EQ(histogram.binCount(), 25);
+    EXPECT_EQ(histogram, reference(options, analyzer.pairs()));
+    EXPECT_GT(histogram.at(0, 0, 3), 0);
+
+    // The invalid motif never hits
+    for (size_t p = 0; p < histogram.pairs.size(); ++p) {
+        if (histogram.pairs[p].second == 4) {
+            EXPECT_TRUE(std::ranges::all_of(histogram.row(p, 0), [](uint64_t c) { return c == 0; }));
+        }
+    }
+}
+
+TEST_F(SpacingAnalyzerTest, SelectedPairsBothStrands) {
+    SpacingOptions options;
+    // Wider than a word, so windows span several extracted chunks
+    options.max_distance = 90;
+    options.both_strands = true;
+    options.pairs = {{1, 0}, {3, 3}, {2, 3}};
+    const SpacingAnalyzer analyzer(motifs, *iupac_codes, options);
+
+    SequenceStore store(sequences);
+    const SpacingHistogram histogram = analyzer.analyze(store);
+    EXPECT_EQ(histogram.orientation_count, 4);
+    EXPECT_EQ(histogram, reference(options, options.pairs));
+
+    // AAC and GTT are reverse complements: every forward GTT hit is a
+    // reverse AAC hit at distance 0
+    EXPECT_GT(histogram.at(0, 1, 0), 0);
+
+    // A self pair is symmetric and never pairs a hit with itself
+    for (ptrdiff_t d = 1; d <= 90; ++d) {
+        EXPECT_EQ(histogram.at(1, 0, d), histogram.at(1, 0, -d));
+    }
+    EXPECT_EQ(histogram.at(1, 0, 0), 0);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common.h"
+
+namespace dna_motif::test_utils {
+
+// Deterministic generator of test data; each test seeds its own so fixtures
+// do not change when other tests draw more values
+class TestRandom {
+public:
+    explicit TestRandom(uint32_t seed) : state_(seed) {}
+
+    // Next value in [0, 32768)
+    uint32_t next() {
+        state_ = state_ * 1103515245u + 12345u;
+        return (state_ >> 16) & 0x7FFF;
+    }
+
+private:
+    uint32_t state_;
+};
+
+// Characters drawn uniformly from alphabet; repeated letters skew the
+// composition
+inline std::string randomSequence(TestRandom& rng, size_t length, std::string_view alphabet = "ACGT") {
+    std::string sequence;
+    sequence.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        sequence += alphabet[rng.next() % alphabet.size()];
+    }
+    return sequence;
+}
+
+// Append count random sequences of one length, named prefix + index
+inline void addRandomSequences(std::vector<ChIPSequence>& sequences, TestRandom& rng, size_t count, size_t length,
+                               std::string_view alphabet = "ACGT", std::string_view prefix = "rnd") {
+    for (size_t i = 0; i < count; ++i) {
+        sequences.emplace_back(std::string(prefix) + std::to_string(i), randomSequence(rng, length, alphabet));
+    }
+}
+
+} // namespace dna_motif::test_utils